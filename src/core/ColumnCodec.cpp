@@ -0,0 +1,329 @@
+#include "ColumnCodec.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace core {
+namespace ColumnCodec {
+namespace {
+std::runtime_error Corrupt() {
+  return std::runtime_error("Corrupt or truncated column.");
+}
+
+uint64_t ZigZag(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t UnZigZag(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+unsigned BitWidth(uint64_t value) {
+  unsigned width = 0;
+  while (value >> width) {
+    ++width;
+  }
+  return width;
+}
+
+unsigned LeadingZeros(uint32_t value) {
+#if defined(__GNUC__)
+  return __builtin_clz(value);
+#else
+  unsigned zeros = 0;
+  while (!(value & 0x80000000u)) {
+    value <<= 1;
+    ++zeros;
+  }
+  return zeros;
+#endif
+}
+
+unsigned TrailingZeros(uint32_t value) {
+#if defined(__GNUC__)
+  return __builtin_ctz(value);
+#else
+  unsigned zeros = 0;
+  while (!(value & 1)) {
+    value >>= 1;
+    ++zeros;
+  }
+  return zeros;
+#endif
+}
+
+// Packs values of up to 32 bits, least significant bit first.
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<char>& out)
+      : out_(out), buffer_(0), count_(0) {}
+
+  void Write(uint64_t value, unsigned bits) {
+    buffer_ |= value << count_;
+    count_ += bits;
+    while (count_ >= 8) {
+      out_.push_back(static_cast<char>(buffer_));
+      buffer_ >>= 8;
+      count_ -= 8;
+    }
+  }
+
+  // Pads the last byte with zeros.
+  void Flush() {
+    if (count_ > 0) {
+      out_.push_back(static_cast<char>(buffer_));
+    }
+    buffer_ = 0;
+    count_ = 0;
+  }
+
+ private:
+  std::vector<char>& out_;
+  uint64_t buffer_;
+  unsigned count_;
+};
+
+// Reads what BitWriter wrote. Reading past the end yields zeros, and is
+// detected by Consumed.
+class BitReader {
+ public:
+  BitReader(const char* data, std::size_t size)
+      : begin_(data), data_(data), end_(data + size), buffer_(0), count_(0),
+        padding_(0) {}
+
+  uint64_t Read(unsigned bits) {
+    if (count_ < bits) {
+      Refill();
+    }
+    uint64_t value = buffer_ & ((uint64_t(1) << bits) - 1);
+    buffer_ >>= bits;
+    count_ -= bits;
+    return value;
+  }
+
+  // The number of whole bytes read so far. Throws if that's more than there
+  // were.
+  std::size_t Consumed() const {
+    std::size_t bits = (data_ - begin_ + padding_) * 8 - count_;
+    std::size_t bytes = (bits + 7) / 8;
+    if (bytes > static_cast<std::size_t>(end_ - begin_)) {
+      throw Corrupt();
+    }
+    return bytes;
+  }
+
+ private:
+  // Fills the buffer to at least 56 bits. Whole words are loaded where
+  // possible; the bits beyond count_ are the next bytes, so loading them
+  // again later is harmless. Files are little endian, like all of the
+  // platforms the Myo runs on.
+  void Refill() {
+    if (end_ - data_ >= 8) {
+      uint64_t word;
+      std::memcpy(&word, data_, sizeof(word));
+      buffer_ |= word << count_;
+      std::size_t bytes = (63 - count_) / 8;
+      data_ += bytes;
+      count_ += bytes * 8;
+      return;
+    }
+    while (count_ <= 56) {
+      if (data_ < end_) {
+        buffer_ |= uint64_t(static_cast<unsigned char>(*data_++)) << count_;
+      } else {
+        ++padding_;
+      }
+      count_ += 8;
+    }
+  }
+
+  const char* const begin_;
+  const char* data_;
+  const char* const end_;
+  uint64_t buffer_;
+  unsigned count_;
+  std::size_t padding_;
+};
+
+void WriteVarint(uint64_t value, std::vector<char>& out) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+uint64_t ReadVarint(const char*& data, const char* end) {
+  uint64_t value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (data == end) {
+      throw Corrupt();
+    }
+    unsigned char byte = static_cast<unsigned char>(*data++);
+    value |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return value;
+    }
+  }
+  throw Corrupt();
+}
+
+enum Int8Mode : char { raw = 0, delta = 1 };
+}
+
+void EncodeTimestamps(const uint64_t* timestamps, std::size_t count,
+                      std::vector<char>& out) {
+  uint64_t previous = 0, previous_delta = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    uint64_t delta = timestamps[i] - previous;
+    WriteVarint(ZigZag(static_cast<int64_t>(delta - previous_delta)), out);
+    previous = timestamps[i];
+    previous_delta = delta;
+  }
+}
+
+std::size_t DecodeTimestamps(const char* data, std::size_t size,
+                             std::size_t count, uint64_t* timestamps) {
+  const char* position = data;
+  const char* end = data + size;
+  uint64_t previous = 0, previous_delta = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    // Most deltas don't change, so their difference is a single byte.
+    uint64_t delta_of_delta;
+    if (position != end && !(*position & 0x80)) {
+      delta_of_delta = static_cast<unsigned char>(*position++);
+    } else {
+      delta_of_delta = ReadVarint(position, end);
+    }
+    previous_delta += static_cast<uint64_t>(UnZigZag(delta_of_delta));
+    previous += previous_delta;
+    timestamps[i] = previous;
+  }
+  return position - data;
+}
+
+void EncodeInt8(const int8_t* values, std::size_t count, std::size_t stride,
+                std::vector<char>& out) {
+  uint64_t max_raw = 0, max_delta = 0;
+  int previous = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    int value = values[i * stride];
+    max_raw |= ZigZag(value);
+    max_delta |= ZigZag(value - previous);
+    previous = value;
+  }
+  // Noisy signals are better stored as they are, smooth ones as deltas.
+  const Int8Mode mode = BitWidth(max_delta) < BitWidth(max_raw) ? delta : raw;
+  const unsigned width = BitWidth(mode == delta ? max_delta : max_raw);
+  out.push_back(mode);
+  out.push_back(static_cast<char>(width));
+
+  BitWriter writer(out);
+  previous = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    int value = values[i * stride];
+    writer.Write(ZigZag(mode == delta ? value - previous : value), width);
+    previous = value;
+  }
+  writer.Flush();
+}
+
+std::size_t DecodeInt8(const char* data, std::size_t size, std::size_t count,
+                       std::size_t stride, int8_t* values) {
+  if (size < 2) {
+    throw Corrupt();
+  }
+  const char mode = data[0];
+  const unsigned width = static_cast<unsigned char>(data[1]);
+  if ((mode != raw && mode != delta) || width > 9) {
+    throw Corrupt();
+  }
+
+  BitReader reader(data + 2, size - 2);
+  if (mode == raw) {
+    for (std::size_t i = 0; i < count; ++i) {
+      values[i * stride] = static_cast<int8_t>(UnZigZag(reader.Read(width)));
+    }
+  } else {
+    int64_t previous = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      previous += UnZigZag(reader.Read(width));
+      values[i * stride] = static_cast<int8_t>(previous);
+    }
+  }
+  return 2 + reader.Consumed();
+}
+
+void EncodeFloats(const float* values, std::size_t count, std::size_t stride,
+                  std::vector<char>& out) {
+  BitWriter writer(out);
+  uint32_t previous = 0;
+  // The window of meaningful bits of the last value which needed a new one.
+  // 32 leading zeros means there is none yet.
+  unsigned leading = 32, trailing = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    uint32_t bits;
+    std::memcpy(&bits, &values[i * stride], sizeof(bits));
+    if (i == 0) {
+      writer.Write(bits, 32);
+      previous = bits;
+      continue;
+    }
+    uint32_t xored = bits ^ previous;
+    previous = bits;
+    if (xored == 0) {
+      writer.Write(0, 1);
+      continue;
+    }
+    unsigned value_leading = LeadingZeros(xored);
+    unsigned value_trailing = TrailingZeros(xored);
+    if (leading < 32 && value_leading >= leading &&
+        value_trailing >= trailing) {
+      // The meaningful bits fit into the previous window.
+      writer.Write(1, 2);
+      writer.Write(xored >> trailing, 32 - leading - trailing);
+    } else {
+      leading = value_leading;
+      trailing = value_trailing;
+      unsigned length = 32 - leading - trailing;
+      writer.Write(3, 2);
+      writer.Write(leading, 5);
+      writer.Write(length - 1, 5);
+      writer.Write(xored >> trailing, length);
+    }
+  }
+  writer.Flush();
+}
+
+std::size_t DecodeFloats(const char* data, std::size_t size, std::size_t count,
+                         std::size_t stride, float* values) {
+  BitReader reader(data, size);
+  uint32_t previous = 0;
+  unsigned leading = 32, trailing = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (i == 0) {
+      previous = static_cast<uint32_t>(reader.Read(32));
+    } else if (reader.Read(1)) {
+      if (!reader.Read(1)) {
+        if (leading == 32) {
+          throw Corrupt();
+        }
+        previous ^= static_cast<uint32_t>(
+            reader.Read(32 - leading - trailing) << trailing);
+      } else {
+        leading = static_cast<unsigned>(reader.Read(5));
+        unsigned length = static_cast<unsigned>(reader.Read(5)) + 1;
+        if (leading + length > 32) {
+          throw Corrupt();
+        }
+        trailing = 32 - leading - length;
+        previous ^= static_cast<uint32_t>(reader.Read(length) << trailing);
+      }
+    }
+    std::memcpy(&values[i * stride], &previous, sizeof(previous));
+  }
+  return reader.Consumed();
+}
+}
+}
@@ -0,0 +1,46 @@
+/* Compression of columns of sensor samples, for archives of long recordings.
+ * Every function encodes one column of count values, appending the result to
+ * out, and decodes it again from data, returning the number of bytes it used.
+ * Decoding throws std::runtime_error if data is truncated or corrupt.
+ *
+ * Values are read and written with a stride, so that the columns of
+ * interleaved samples, e.g. the eight channels of EMG data, can be encoded and
+ * decoded in place.
+ *
+ *  - Timestamps are stored as the zig-zag encoded difference between
+ *    successive deltas, as varints. Regularly sampled timestamps take a byte
+ *    each.
+ *  - 8 bit integers are zig-zag encoded either as they are or as deltas,
+ *    whichever needs fewer bits, and bit-packed with the smallest width that
+ *    fits the whole column.
+ *  - Floats are compressed as in Facebook's Gorilla: each value is XORed with
+ *    the previous one, and only the bits between the leading and trailing
+ *    zeros of the result are stored. Slowly changing values, like IMU data,
+ *    share most of their sign, exponent and high mantissa bits. Encoding is
+ *    lossless, including for NaNs.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace core {
+namespace ColumnCodec {
+void EncodeTimestamps(const uint64_t* timestamps, std::size_t count,
+                      std::vector<char>& out);
+std::size_t DecodeTimestamps(const char* data, std::size_t size,
+                             std::size_t count, uint64_t* timestamps);
+
+void EncodeInt8(const int8_t* values, std::size_t count, std::size_t stride,
+                std::vector<char>& out);
+std::size_t DecodeInt8(const char* data, std::size_t size, std::size_t count,
+                       std::size_t stride, int8_t* values);
+
+void EncodeFloats(const float* values, std::size_t count, std::size_t stride,
+                  std::vector<char>& out);
+std::size_t DecodeFloats(const char* data, std::size_t size, std::size_t count,
+                         std::size_t stride, float* values);
+}
+}
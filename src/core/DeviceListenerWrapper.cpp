@@ -1,117 +1,280 @@
 #include "DeviceListenerWrapper.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace core {
-void DeviceListenerWrapper::addChildFeature(child_feature_t feature) {
-  child_features_.insert(feature);
+template <typename Callback>
+void DeviceListenerWrapper::Dispatch(int event, const Callback& callback) {
+  // Indexed rather than iterated, since the receivers may be removed while
+  // the event is dispatched, see removeChildFeature.
+  const std::vector<child_feature_t>& receivers =
+      receivers_[Events::Index(event)];
+  ++dispatch_depth_;
+  try {
+    for (std::size_t i = 0; i < receivers.size(); ++i) {
+      if (receivers[i]) {
+        callback(receivers[i]);
+      }
+    }
+  } catch (...) {
+    EndDispatch();
+    throw;
+  }
+  EndDispatch();
+}
+
+DeviceListenerWrapper::DeviceListenerWrapper()
+    : dispatch_depth_(0), receivers_outdated_(false) {}
+
+void DeviceListenerWrapper::addChildFeature(child_feature_t feature,
+                                            int events) {
+  auto found = std::find_if(
+      child_features_.begin(), child_features_.end(),
+      [feature](const std::pair<child_feature_t, int>& child_feature) {
+        return child_feature.first == feature;
+      });
+  if (found == child_features_.end()) {
+    child_features_.push_back(std::make_pair(feature, events));
+  } else {
+    found->second = events;
+  }
+  // A feature added while an event is dispatched receives the next one.
+  if (dispatch_depth_ > 0) {
+    receivers_outdated_ = true;
+  } else {
+    UpdateReceivers();
+  }
 }
 
 void DeviceListenerWrapper::removeChildFeature(child_feature_t feature) {
-  child_features_.erase(feature);
+  child_features_.erase(
+      std::remove_if(
+          child_features_.begin(), child_features_.end(),
+          [feature](const std::pair<child_feature_t, int>& child_feature) {
+            return child_feature.first == feature;
+          }),
+      child_features_.end());
+  if (dispatch_depth_ > 0) {
+    // The lists are being iterated, so feature is only blanked out of them,
+    // and they are rebuilt once the outermost dispatch is done.
+    for (auto& receivers : receivers_) {
+      std::replace(receivers.begin(), receivers.end(), feature,
+                   static_cast<child_feature_t>(nullptr));
+    }
+    receivers_outdated_ = true;
+  } else {
+    UpdateReceivers();
+  }
 }
 
 void DeviceListenerWrapper::onPair(myo::Myo* myo, uint64_t timestamp,
                       myo::FirmwareVersion firmware_version) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::Pair, [&](child_feature_t feature) {
     feature->onPair(myo, timestamp, firmware_version);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onUnpair(myo::Myo* myo, uint64_t timestamp) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::Unpair, [&](child_feature_t feature) {
     feature->onUnpair(myo, timestamp);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onConnect(myo::Myo* myo, uint64_t timestamp,
                        myo::FirmwareVersion firmware_version) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::Connect, [&](child_feature_t feature) {
     feature->onConnect(myo, timestamp, firmware_version);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onDisconnect(myo::Myo* myo, uint64_t timestamp) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::Disconnect, [&](child_feature_t feature) {
     feature->onDisconnect(myo, timestamp);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onArmSync(myo::Myo* myo, uint64_t timestamp, myo::Arm arm,
                        myo::XDirection x_direction,
                        float rotation, myo::WarmupState warmupState) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::ArmSync, [&](child_feature_t feature) {
     feature->onArmSync(myo, timestamp, arm, x_direction, rotation, warmupState);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onArmUnsync(myo::Myo* myo, uint64_t timestamp) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::ArmUnsync, [&](child_feature_t feature) {
     feature->onArmUnsync(myo, timestamp);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onUnlock(myo::Myo* myo, uint64_t timestamp) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::Unlock, [&](child_feature_t feature) {
     feature->onUnlock(myo, timestamp);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onLock(myo::Myo* myo, uint64_t timestamp) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::Lock, [&](child_feature_t feature) {
     feature->onLock(myo, timestamp);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onPose(myo::Myo* myo, uint64_t timestamp,
                     const std::shared_ptr<Pose>& pose) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::Pose, [&](child_feature_t feature) {
     feature->onPose(myo, timestamp, pose);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onGesture(myo::Myo* myo, uint64_t timestamp,
                        const std::shared_ptr<Gesture>& gesture) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::Gesture, [&](child_feature_t feature) {
     feature->onGesture(myo, timestamp, gesture);
-  }
+  });
+}
+
+void DeviceListenerWrapper::onSpeculativeGesture(
+    myo::Myo* myo, uint64_t timestamp, const std::shared_ptr<Gesture>& gesture,
+    Gesture::Status status) {
+  Dispatch(Events::SpeculativeGesture, [&](child_feature_t feature) {
+    feature->onSpeculativeGesture(myo, timestamp, gesture, status);
+  });
 }
 
 void DeviceListenerWrapper::onOrientationData(myo::Myo* myo, uint64_t timestamp,
                                const myo::Quaternion<float>& rotation) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::OrientationData, [&](child_feature_t feature) {
     feature->onOrientationData(myo, timestamp, rotation);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onAccelerometerData(myo::Myo* myo, uint64_t timestamp,
                                  const myo::Vector3<float>& acceleration) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::AccelerometerData, [&](child_feature_t feature) {
     feature->onAccelerometerData(myo, timestamp, acceleration);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
                              const myo::Vector3<float>& gyro) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::GyroscopeData, [&](child_feature_t feature) {
     feature->onGyroscopeData(myo, timestamp, gyro);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onRssi(myo::Myo* myo, uint64_t timestamp, int8_t rssi) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::Rssi, [&](child_feature_t feature) {
     feature->onRssi(myo, timestamp, rssi);
-  }
+  });
 }
 
 void DeviceListenerWrapper::onEmgData(myo::Myo* myo, uint64_t timestamp,
                        const int8_t* emg) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::EmgData, [&](child_feature_t feature) {
     feature->onEmgData(myo, timestamp, emg);
-  }
+  });
+}
+
+void DeviceListenerWrapper::onEmgFeatures(myo::Myo* myo, uint64_t timestamp,
+                           const EmgFeatureVector& emg_features) {
+  Dispatch(Events::EmgFeatures, [&](child_feature_t feature) {
+    feature->onEmgFeatures(myo, timestamp, emg_features);
+  });
+}
+
+void DeviceListenerWrapper::onEmgSpectrum(myo::Myo* myo, uint64_t timestamp,
+                           const EmgSpectrum& emg_spectrum) {
+  Dispatch(Events::EmgSpectrum, [&](child_feature_t feature) {
+    feature->onEmgSpectrum(myo, timestamp, emg_spectrum);
+  });
+}
+
+void DeviceListenerWrapper::onSensorFrame(myo::Myo* myo, uint64_t timestamp,
+                           const SensorFrame& frame) {
+  Dispatch(Events::SensorFrame, [&](child_feature_t feature) {
+    feature->onSensorFrame(myo, timestamp, frame);
+  });
 }
 
 void DeviceListenerWrapper::onPeriodic(myo::Myo* myo) {
-  for (auto feature : child_features_) {
+  Dispatch(Events::Periodic, [&](child_feature_t feature) {
     feature->onPeriodic(myo);
+  });
+}
+
+void DeviceListenerWrapper::saveState(FeatureState&) const {}
+
+void DeviceListenerWrapper::loadState(FeatureState&) {}
+
+void DeviceListenerWrapper::saveTreeState(FeatureState& snapshot) const {
+  for (const DeviceListenerWrapper* feature : GetTree()) {
+    FeatureState state;
+    feature->saveState(state);
+    if (!state.empty()) {
+      snapshot.putState(state);
+    }
+  }
+}
+
+void DeviceListenerWrapper::loadTreeState(FeatureState& snapshot) {
+  for (DeviceListenerWrapper* feature : GetTree()) {
+    // Only the features which save state have an entry.
+    FeatureState current;
+    feature->saveState(current);
+    if (current.empty()) {
+      continue;
+    }
+    if (snapshot.exhausted()) {
+      throw std::runtime_error("The snapshot has too few feature states.");
+    }
+    FeatureState state = snapshot.getState();
+    feature->loadState(state);
+    if (!state.exhausted()) {
+      throw std::runtime_error(
+          "The snapshot doesn't match the features it's loaded into.");
+    }
+  }
+  if (!snapshot.exhausted()) {
+    throw std::runtime_error("The snapshot has too many feature states.");
+  }
+}
+
+void DeviceListenerWrapper::EndDispatch() {
+  if (--dispatch_depth_ == 0 && receivers_outdated_) {
+    receivers_outdated_ = false;
+    UpdateReceivers();
+  }
+}
+
+void DeviceListenerWrapper::UpdateReceivers() {
+  for (std::size_t event = 0; event < Events::count; ++event) {
+    receivers_[event].clear();
+    for (const auto& child_feature : child_features_) {
+      if (child_feature.second & (1 << event)) {
+        receivers_[event].push_back(child_feature.first);
+      }
+    }
+  }
+}
+
+std::vector<DeviceListenerWrapper*> DeviceListenerWrapper::GetTree() const {
+  std::vector<DeviceListenerWrapper*> tree;
+  std::vector<const DeviceListenerWrapper*> pending(1, this);
+  while (!pending.empty()) {
+    const DeviceListenerWrapper* feature = pending.back();
+    pending.pop_back();
+    if (std::find(tree.begin(), tree.end(), feature) != tree.end()) {
+      continue;
+    }
+    tree.push_back(const_cast<DeviceListenerWrapper*>(feature));
+    // In reverse, so that the children are visited in the order they were
+    // added.
+    for (auto child = feature->child_features_.rbegin();
+         child != feature->child_features_.rend(); ++child) {
+      pending.push_back(child->first);
+    }
   }
+  return tree;
 }
 }
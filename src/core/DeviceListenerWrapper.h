@@ -5,22 +5,43 @@
 
 #pragma once
 
-#include <set>
+#include <array>
 #include <memory>
+#include <utility>
+#include <vector>
 #include <myo/myo.hpp>
 
 #include "Pose.h"
 #include "Gesture.h"
+#include "EmgFeatureVector.h"
+#include "EmgSpectrum.h"
+#include "SensorFrame.h"
+#include "Events.h"
+#include "FeatureState.h"
 
 namespace core {
 class DeviceListenerWrapper {
  protected:
   typedef DeviceListenerWrapper* child_feature_t;
-  std::set<child_feature_t> child_features_;
+  // The child features in the order they were added, each with the mask of
+  // Events it receives.
+  std::vector<std::pair<child_feature_t, int>> child_features_;
 
  public:
-  void addChildFeature(child_feature_t feature);
-  void removeChildFeature(child_feature_t feature);
+  DeviceListenerWrapper();
+  virtual ~DeviceListenerWrapper() = default;
+
+  // Adds feature, or changes its mask if it's already a child. Events which
+  // aren't in the mask are never dispatched to feature, so a child which
+  // doesn't receive an event costs nothing when it occurs.
+  //
+  // Both may be called while this feature dispatches an event, e.g. by a
+  // child feature from its callback. A removed feature receives no further
+  // events, not even the current one, and a feature which is added or whose
+  // mask is changed only sees the change from the next event.
+  virtual void addChildFeature(child_feature_t feature,
+                               int events = Events::All);
+  virtual void removeChildFeature(child_feature_t feature);
 
   virtual void onPair(myo::Myo* myo, uint64_t timestamp,
                       myo::FirmwareVersion firmware_version);
@@ -48,6 +69,13 @@ class DeviceListenerWrapper {
   virtual void onGesture(myo::Myo* myo, uint64_t timestamp,
                          const std::shared_ptr<Gesture>& gesture);
 
+  // Gestures which may be reported before they are certain, so that features
+  // which can undo their effect can react with less latency. Features that
+  // don't override this only see the final gestures via onGesture.
+  virtual void onSpeculativeGesture(myo::Myo* myo, uint64_t timestamp,
+                                    const std::shared_ptr<Gesture>& gesture,
+                                    Gesture::Status status);
+
   virtual void onOrientationData(myo::Myo* myo, uint64_t timestamp,
                                  const myo::Quaternion<float>& rotation);
 
@@ -62,6 +90,47 @@ class DeviceListenerWrapper {
   virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
                          const int8_t* emg);
 
+  virtual void onEmgFeatures(myo::Myo* myo, uint64_t timestamp,
+                             const EmgFeatureVector& emg_features);
+
+  virtual void onEmgSpectrum(myo::Myo* myo, uint64_t timestamp,
+                             const EmgSpectrum& emg_spectrum);
+
+  virtual void onSensorFrame(myo::Myo* myo, uint64_t timestamp,
+                             const SensorFrame& frame);
+
   virtual void onPeriodic(myo::Myo* myo);
+
+  // The state a feature has accumulated from past events, e.g. the buffer of
+  // a filter, so that playback of a recording can resume from a snapshot with
+  // warm state, see ArchiveWriter. loadState reads back exactly what
+  // saveState wrote, and throws std::runtime_error if it doesn't fit the
+  // feature's parameters. The defaults save nothing and leave the state of
+  // the feature as it is.
+  virtual void saveState(FeatureState& state) const;
+  virtual void loadState(FeatureState& state);
+
+  // Saves the states of this feature and all features below it into
+  // snapshot, or loads them into a tree which was built the same way. Throws
+  // std::runtime_error if the stateful features of the tree don't match the
+  // snapshot.
+  void saveTreeState(FeatureState& snapshot) const;
+  void loadTreeState(FeatureState& snapshot);
+
+ private:
+  // Calls callback with each child feature which receives event.
+  template <typename Callback>
+  void Dispatch(int event, const Callback& callback);
+  void EndDispatch();
+  void UpdateReceivers();
+  // This feature and all features below it, depth first, each once.
+  std::vector<DeviceListenerWrapper*> GetTree() const;
+
+  // For each event, the child features which receive it.
+  std::array<std::vector<child_feature_t>, Events::count> receivers_;
+  // The number of events this feature is dispatching, which may be nested,
+  // and whether children were added or removed meanwhile.
+  int dispatch_depth_;
+  bool receivers_outdated_;
 };
 }
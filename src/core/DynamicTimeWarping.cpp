@@ -0,0 +1,293 @@
+#include "DynamicTimeWarping.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DYNAMIC_TIME_WARPING_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace core {
+namespace {
+const float infinity = std::numeric_limits<float>::infinity();
+
+// cost[j] = sum over d of (a[d * stride] - b[d * stride + j])^2 for j in
+// [begin, end).
+void CostRow(const float* a, const float* b, std::size_t dimensions,
+             std::size_t stride, std::size_t begin, std::size_t end,
+             float* cost) {
+  std::size_t j = begin;
+#ifdef DYNAMIC_TIME_WARPING_SSE2
+  for (; j + 4 <= end; j += 4) {
+    __m128 sum = _mm_setzero_ps();
+    for (std::size_t d = 0; d < dimensions; ++d) {
+      __m128 difference = _mm_sub_ps(_mm_set1_ps(a[d * stride]),
+                                     _mm_loadu_ps(b + d * stride + j));
+      sum = _mm_add_ps(sum, _mm_mul_ps(difference, difference));
+    }
+    _mm_storeu_ps(cost + j, sum);
+  }
+#endif
+  for (; j < end; ++j) {
+    float sum = 0.f;
+    for (std::size_t d = 0; d < dimensions; ++d) {
+      float difference = a[d * stride] - b[d * stride + j];
+      sum += difference * difference;
+    }
+    cost[j] = sum;
+  }
+}
+
+// The size of a sequence, checked before anything is allocated.
+std::size_t SequenceSize(std::size_t dimensions, std::size_t length) {
+  if (dimensions == 0 || length < 2) {
+    throw std::invalid_argument("DTW length must be at least two.");
+  }
+  return dimensions * length;
+}
+}
+
+DynamicTimeWarping::DynamicTimeWarping(std::size_t dimensions,
+                                       std::size_t length, std::size_t band)
+    : dimensions_(dimensions),
+      length_(length),
+      band_(band),
+      sequence_(SequenceSize(dimensions, length)),
+      sequence_upper_(dimensions * length),
+      sequence_lower_(dimensions * length),
+      contributions_(length),
+      bound_(length),
+      cost_(length),
+      previous_row_(length),
+      row_(length),
+      statistics_() {}
+
+std::size_t DynamicTimeWarping::dimensions() const { return dimensions_; }
+
+std::size_t DynamicTimeWarping::length() const { return length_; }
+
+std::size_t DynamicTimeWarping::numTemplates() const { return names_.size(); }
+
+const std::string& DynamicTimeWarping::templateName(std::size_t index) const {
+  return names_[index];
+}
+
+const DynamicTimeWarping::Statistics& DynamicTimeWarping::statistics() const {
+  return statistics_;
+}
+
+std::size_t DynamicTimeWarping::addTemplate(const std::string& name,
+                                            const float* points,
+                                            std::size_t count) {
+  if (count == 0) {
+    throw std::invalid_argument("The template has no points.");
+  }
+  const std::size_t d = dimensions_;
+  std::vector<float> resampled(length_ * d);
+  for (std::size_t n = 0; n < length_; ++n) {
+    float position =
+        count > 1 ? static_cast<float>(n) * (count - 1) / (length_ - 1) : 0.f;
+    std::size_t index = std::min(static_cast<std::size_t>(position),
+                                 count > 1 ? count - 2 : 0);
+    float t = count > 1 ? position - index : 0.f;
+    for (std::size_t j = 0; j < d; ++j) {
+      float start = points[index * d + j];
+      float end = count > 1 ? points[(index + 1) * d + j] : start;
+      resampled[n * d + j] = start + t * (end - start);
+    }
+  }
+
+  const std::size_t size = length_ * d;
+  templates_.resize(templates_.size() + size);
+  upper_.resize(templates_.size());
+  lower_.resize(templates_.size());
+  const std::size_t offset = templates_.size() - size;
+  Normalize(resampled.data(), &templates_[offset]);
+  Envelope(&templates_[offset], &upper_[offset], &lower_[offset]);
+  names_.push_back(name);
+  return names_.size() - 1;
+}
+
+DynamicTimeWarping::Match DynamicTimeWarping::recognize(const float* points,
+                                                        float max_distance) {
+  const std::size_t d = dimensions_, size = length_ * d;
+  Normalize(points, sequence_.data());
+  Envelope(sequence_.data(), sequence_upper_.data(), sequence_lower_.data());
+
+  // Compare costs rather than distances to avoid a square root per template.
+  float best_cost =
+      max_distance < std::sqrt(std::numeric_limits<float>::max() / length_)
+          ? max_distance * max_distance * length_
+          : infinity;
+  Match match = {-1, max_distance};
+  for (std::size_t t = 0; t < names_.size(); ++t) {
+    const float* points = &templates_[t * size];
+    float lower_bound = 0.f;
+    for (std::size_t j = 0; j < d; ++j) {
+      const float* a = points + j * length_;
+      const float* b = &sequence_[j * length_];
+      float first = a[0] - b[0], last = a[length_ - 1] - b[length_ - 1];
+      lower_bound += first * first + last * last;
+    }
+    if (lower_bound >= best_cost) {
+      ++statistics_.lb_kim;
+      continue;
+    }
+
+    // The sequence against the template's envelope bounds the cost of the
+    // columns of the cost matrix.
+    std::fill(contributions_.begin(), contributions_.end(), 0.f);
+    float column_bound =
+        LowerBoundKeogh(sequence_.data(), &upper_[t * size], &lower_[t * size],
+                        contributions_.data());
+    if (column_bound >= best_cost) {
+      ++statistics_.lb_keogh_template;
+      continue;
+    }
+    // Columns after i + band_ are still to be matched after row i.
+    float remaining = 0.f;
+    for (std::size_t i = length_; i-- > 0;) {
+      if (i + band_ + 1 < length_) {
+        remaining += contributions_[i + band_ + 1];
+      }
+      bound_[i] = remaining;
+    }
+
+    // The template against the sequence's envelope bounds the cost of the
+    // rows. Use whichever bound is tighter while warping.
+    std::fill(contributions_.begin(), contributions_.end(), 0.f);
+    float row_bound = LowerBoundKeogh(points, sequence_upper_.data(),
+                                      sequence_lower_.data(),
+                                      contributions_.data());
+    if (row_bound >= best_cost) {
+      ++statistics_.lb_keogh_sequence;
+      continue;
+    }
+    if (row_bound > column_bound) {
+      remaining = 0.f;
+      for (std::size_t i = length_; i-- > 0;) {
+        bound_[i] = remaining;
+        remaining += contributions_[i];
+      }
+    }
+
+    float cost = Warp(points, sequence_.data(), bound_.data(), best_cost);
+    if (cost < best_cost) {
+      ++statistics_.full;
+      best_cost = cost;
+      match.index = static_cast<int>(t);
+      match.distance = std::sqrt(cost / length_);
+    } else {
+      ++statistics_.abandoned;
+    }
+  }
+  return match;
+}
+
+float DynamicTimeWarping::distance(const float* a, const float* b) const {
+  std::vector<float> normalized_a(length_ * dimensions_),
+      normalized_b(length_ * dimensions_), bound(length_, 0.f);
+  Normalize(a, normalized_a.data());
+  Normalize(b, normalized_b.data());
+  return std::sqrt(
+      Warp(normalized_a.data(), normalized_b.data(), bound.data(), infinity) /
+      length_);
+}
+
+void DynamicTimeWarping::Normalize(const float* points,
+                                   float* normalized) const {
+  for (std::size_t j = 0; j < dimensions_; ++j) {
+    float mean = 0.f;
+    for (std::size_t n = 0; n < length_; ++n) {
+      mean += points[n * dimensions_ + j];
+    }
+    mean /= length_;
+    for (std::size_t n = 0; n < length_; ++n) {
+      normalized[j * length_ + n] = points[n * dimensions_ + j] - mean;
+    }
+  }
+}
+
+void DynamicTimeWarping::Envelope(const float* normalized, float* upper,
+                                  float* lower) const {
+  for (std::size_t j = 0; j < dimensions_; ++j) {
+    const float* values = normalized + j * length_;
+    for (std::size_t n = 0; n < length_; ++n) {
+      std::size_t begin = n > band_ ? n - band_ : 0;
+      std::size_t end = std::min(length_, n + band_ + 1);
+      upper[j * length_ + n] = *std::max_element(values + begin, values + end);
+      lower[j * length_ + n] = *std::min_element(values + begin, values + end);
+    }
+  }
+}
+
+float DynamicTimeWarping::LowerBoundKeogh(const float* normalized,
+                                          const float* upper,
+                                          const float* lower,
+                                          float* contributions) const {
+  for (std::size_t j = 0; j < dimensions_; ++j) {
+    const float* values = normalized + j * length_;
+    const float* u = upper + j * length_;
+    const float* l = lower + j * length_;
+    std::size_t n = 0;
+#ifdef DYNAMIC_TIME_WARPING_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    for (; n + 4 <= length_; n += 4) {
+      __m128 value = _mm_loadu_ps(values + n);
+      // At most one of the two differences is positive.
+      __m128 excess =
+          _mm_add_ps(_mm_max_ps(_mm_sub_ps(value, _mm_loadu_ps(u + n)), zero),
+                     _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(l + n), value), zero));
+      _mm_storeu_ps(contributions + n,
+                    _mm_add_ps(_mm_loadu_ps(contributions + n),
+                               _mm_mul_ps(excess, excess)));
+    }
+#endif
+    for (; n < length_; ++n) {
+      float excess = std::max(values[n] - u[n], 0.f) +
+                     std::max(l[n] - values[n], 0.f);
+      contributions[n] += excess * excess;
+    }
+  }
+  float sum = 0.f;
+  for (std::size_t n = 0; n < length_; ++n) {
+    sum += contributions[n];
+  }
+  return sum;
+}
+
+float DynamicTimeWarping::Warp(const float* a, const float* b,
+                               const float* bound, float best_cost) const {
+  float* previous = previous_row_.data();
+  float* row = row_.data();
+  std::fill(previous, previous + length_, infinity);
+  std::fill(row, row + length_, infinity);
+  for (std::size_t i = 0; i < length_; ++i) {
+    const std::size_t begin = i > band_ ? i - band_ : 0;
+    const std::size_t end = std::min(length_, i + band_ + 1);
+    CostRow(a + i, b, dimensions_, length_, begin, end, cost_.data());
+    if (begin > 0) {
+      row[begin - 1] = infinity;
+    }
+    float row_min = infinity;
+    for (std::size_t j = begin; j < end; ++j) {
+      float best;
+      if (j == 0) {
+        best = i == 0 ? 0.f : previous[0];
+      } else {
+        best = std::min(std::min(previous[j - 1], previous[j]), row[j - 1]);
+      }
+      row[j] = cost_[j] + best;
+      row_min = std::min(row_min, row[j]);
+    }
+    if (row_min + bound[i] >= best_cost) {
+      return infinity;
+    }
+    std::swap(previous, row);
+  }
+  return previous[length_ - 1];
+}
+}
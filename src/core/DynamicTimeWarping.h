@@ -0,0 +1,100 @@
+/* Dynamic time warping of N-dimensional sequences against a library of
+ * templates, for spotting gestures which are performed at varying speeds.
+ * Templates are resampled to length() points when they are added. Sequences
+ * are compared after removing the mean of each dimension, with the squared
+ * Euclidean distance between points as the cost and the warping path
+ * constrained to a Sakoe-Chiba band of the given width.
+ *
+ * The warping path always runs from the first point of both sequences to the
+ * last. Spotting a gesture in a stream is left to the caller, which compares
+ * the latest length() points as the window slides, as in the UCR suite's
+ * subsequence search. A template therefore has to fill the whole window: it
+ * only matches a motion whose duration is within band points of length(),
+ * and which starts and ends within band points of the window's ends. The
+ * path has no free start or end that would find a shorter motion inside the
+ * window.
+ *
+ * Following the UCR suite, every template passes through a cascade of lower
+ * bounds before the full DTW is computed: LB_Kim on the first and last points,
+ * LB_Keogh of the sequence against the template's envelope, then LB_Keogh of
+ * the template against the sequence's envelope, which is computed once per
+ * sequence and reused for all templates. The DTW itself is abandoned as soon as
+ * its smallest partial cost plus the remaining lower bound exceeds the best
+ * match found. The cost rows and lower bounds are computed four points at a
+ * time with SSE2 where available, on data stored one dimension after another.
+ * http://www.cs.ucr.edu/~eamonn/UCRsuite.html
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace core {
+class DynamicTimeWarping {
+ public:
+  struct Match {
+    // The index of the matching template, or -1 if there is none.
+    int index;
+    // The root mean square cost per point along the warping path.
+    float distance;
+  };
+
+  // The number of templates that were rejected by each stage of the cascade,
+  // or compared in full, since construction.
+  struct Statistics {
+    std::size_t lb_kim, lb_keogh_template, lb_keogh_sequence, abandoned, full;
+  };
+
+  // length must be at least two; throws std::invalid_argument before
+  // allocating anything otherwise.
+  DynamicTimeWarping(std::size_t dimensions, std::size_t length,
+                     std::size_t band);
+
+  std::size_t dimensions() const;
+  std::size_t length() const;
+  std::size_t numTemplates() const;
+  const std::string& templateName(std::size_t index) const;
+  const Statistics& statistics() const;
+
+  // points holds count consecutive points of dimensions() values each, which
+  // are resampled to length() points. Returns the index of the new template.
+  // Throws std::invalid_argument if count is 0.
+  std::size_t addTemplate(const std::string& name, const float* points,
+                          std::size_t count);
+
+  // Returns the closest template to the length() consecutive points whose
+  // distance is less than max_distance. Doesn't allocate.
+  Match recognize(const float* points,
+                  float max_distance = std::numeric_limits<float>::max());
+
+  // The distance between two sequences of length() points, without pruning.
+  float distance(const float* a, const float* b) const;
+
+ private:
+  // Copies length() points into dimension-major order without their means.
+  void Normalize(const float* points, float* normalized) const;
+  void Envelope(const float* normalized, float* upper, float* lower) const;
+  // Adds the LB_Keogh cost of every point of normalized to contributions and
+  // returns the sum.
+  float LowerBoundKeogh(const float* normalized, const float* upper,
+                        const float* lower, float* contributions) const;
+  // Returns the sum of the squared costs along the best warping path, or
+  // infinity if it is at least best_cost. bound[i] is a lower bound of the
+  // cost of rows i and later.
+  float Warp(const float* a, const float* b, const float* bound,
+             float best_cost) const;
+
+  const std::size_t dimensions_, length_, band_;
+  std::vector<std::string> names_;
+  // The normalized points and envelopes of all templates.
+  std::vector<float> templates_, upper_, lower_;
+  // Scratch space for recognize, and the rows of the cost matrix for Warp.
+  std::vector<float> sequence_, sequence_upper_, sequence_lower_;
+  std::vector<float> contributions_, bound_;
+  mutable std::vector<float> cost_, previous_row_, row_;
+  Statistics statistics_;
+};
+}
@@ -0,0 +1,41 @@
+/* A fixed size vector of time-domain features computed for each of the Myo's
+ * eight EMG channels over a window of samples. Features are stored feature
+ * major, so all eight channels of one feature are contiguous.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace core {
+class EmgFeatureVector {
+ public:
+  enum Feature {
+    rms,
+    meanAbsoluteValue,
+    waveformLength,
+    zeroCrossings,
+    slopeSignChanges
+  };
+
+  static const std::size_t numChannels = 8;
+  static const std::size_t numFeatures = 5;
+  static const std::size_t size = numChannels * numFeatures;
+
+  EmgFeatureVector() { values_.fill(0.f); }
+
+  float& operator()(Feature feature, std::size_t channel) {
+    return values_[feature * numChannels + channel];
+  }
+  float operator()(Feature feature, std::size_t channel) const {
+    return values_[feature * numChannels + channel];
+  }
+
+  // Flat view of all features, suitable as the input of a classifier.
+  const float* data() const { return values_.data(); }
+
+ private:
+  std::array<float, size> values_;
+};
+}
@@ -0,0 +1,56 @@
+/* Spectral features of the Myo's eight EMG channels computed over one window
+ * of samples. Storage is allocated once at construction; producers overwrite
+ * the values in place for every window.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace core {
+class EmgSpectrum {
+ public:
+  static const std::size_t numChannels = 8;
+  typedef std::array<float, numChannels> Channels;
+
+  EmgSpectrum(std::size_t num_bins = 0, float bin_width = 0.f,
+              std::size_t num_bands = 0)
+      : bin_width_(bin_width),
+        power_(num_bins),
+        mean_frequency_(),
+        median_frequency_(),
+        total_power_(),
+        band_power_(num_bands) {}
+
+  // Number of frequency bins, starting at 0 Hz, and their width in Hz.
+  std::size_t numBins() const { return power_.size(); }
+  float binWidth() const { return bin_width_; }
+  std::size_t numBands() const { return band_power_.size(); }
+
+  // The power of every channel in bin.
+  const Channels& power(std::size_t bin) const { return power_[bin]; }
+  Channels& power(std::size_t bin) { return power_[bin]; }
+
+  // Power weighted mean frequency and the frequency which splits the power in
+  // half, in Hz. The DC bin is excluded.
+  const Channels& meanFrequency() const { return mean_frequency_; }
+  Channels& meanFrequency() { return mean_frequency_; }
+  const Channels& medianFrequency() const { return median_frequency_; }
+  Channels& medianFrequency() { return median_frequency_; }
+  const Channels& totalPower() const { return total_power_; }
+  Channels& totalPower() { return total_power_; }
+
+  const Channels& bandPower(std::size_t band) const {
+    return band_power_[band];
+  }
+  Channels& bandPower(std::size_t band) { return band_power_[band]; }
+
+ private:
+  float bin_width_;
+  std::vector<Channels> power_;
+  Channels mean_frequency_, median_frequency_, total_power_;
+  std::vector<Channels> band_power_;
+};
+}
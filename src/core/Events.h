@@ -0,0 +1,47 @@
+/* The events of DeviceListenerWrapper as bit flags. A feature is added to its
+ * parent with a mask of these, and only receives the events in its mask.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace core {
+struct Events {
+  enum Flags {
+    Pair               = 1 << 0,
+    Unpair             = 1 << 1,
+    Connect            = 1 << 2,
+    Disconnect         = 1 << 3,
+    ArmSync            = 1 << 4,
+    ArmUnsync          = 1 << 5,
+    Unlock             = 1 << 6,
+    Lock               = 1 << 7,
+    Pose               = 1 << 8,
+    Gesture            = 1 << 9,
+    OrientationData    = 1 << 10,
+    AccelerometerData  = 1 << 11,
+    GyroscopeData      = 1 << 12,
+    Rssi               = 1 << 13,
+    EmgData            = 1 << 14,
+    Periodic           = 1 << 15,
+    EmgFeatures        = 1 << 16,
+    EmgSpectrum        = 1 << 17,
+    SensorFrame        = 1 << 18,
+    SpeculativeGesture = 1 << 19,
+    All                = (1 << 20) - 1
+  };
+
+  static const std::size_t count = 20;
+
+  // The index of the bit of a single event, e.g. 8 for Pose.
+  static constexpr std::size_t Index(int event) {
+    return event == 1 ? 0 : 1 + Index(event >> 1);
+  }
+};
+
+constexpr Events::Flags operator|(Events::Flags lhs, Events::Flags rhs) {
+  return static_cast<Events::Flags>(static_cast<int>(lhs) |
+                                    static_cast<int>(rhs));
+}
+}
@@ -0,0 +1,103 @@
+#include "FastFourierTransform.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace core {
+namespace {
+// Checked before the tables are allocated.
+std::size_t CheckPowerOfTwo(std::size_t size) {
+  if (size == 0 || (size & (size - 1)) != 0) {
+    throw std::invalid_argument("FFT size must be a power of two.");
+  }
+  return size;
+}
+}
+
+FastFourierTransform::FastFourierTransform(std::size_t size,
+                                           std::size_t batch_size)
+    : size_(CheckPowerOfTwo(size)),
+      batch_size_(batch_size),
+      bit_reversed_(size_),
+      cos_(size_ / 2),
+      sin_(size_ / 2) {
+  std::size_t num_bits = 0;
+  while ((std::size_t(1) << num_bits) < size) {
+    ++num_bits;
+  }
+  for (std::size_t i = 0; i < size; ++i) {
+    std::size_t reversed = 0;
+    for (std::size_t bit = 0; bit < num_bits; ++bit) {
+      reversed |= ((i >> bit) & 1) << (num_bits - 1 - bit);
+    }
+    bit_reversed_[i] = reversed;
+  }
+  for (std::size_t k = 0; k < size / 2; ++k) {
+    double angle = 2 * M_PI * k / size;
+    cos_[k] = static_cast<float>(std::cos(angle));
+    sin_[k] = static_cast<float>(std::sin(angle));
+  }
+}
+
+std::size_t FastFourierTransform::size() const { return size_; }
+
+std::size_t FastFourierTransform::batchSize() const { return batch_size_; }
+
+void FastFourierTransform::transform(float* real, float* imag) const {
+  const std::size_t batch = batch_size_;
+  for (std::size_t i = 0; i < size_; ++i) {
+    std::size_t j = bit_reversed_[i];
+    if (i < j) {
+      for (std::size_t b = 0; b < batch; ++b) {
+        std::swap(real[i * batch + b], real[j * batch + b]);
+        std::swap(imag[i * batch + b], imag[j * batch + b]);
+      }
+    }
+  }
+
+  for (std::size_t length = 2; length <= size_; length <<= 1) {
+    const std::size_t half = length / 2;
+    const std::size_t step = size_ / length;
+    for (std::size_t start = 0; start < size_; start += length) {
+      for (std::size_t k = 0; k < half; ++k) {
+        // Forward transform, so the twiddle factor is exp(-2 pi i k / length).
+        const float w_real = cos_[k * step];
+        const float w_imag = -sin_[k * step];
+        float* a_real = real + (start + k) * batch;
+        float* a_imag = imag + (start + k) * batch;
+        float* b_real = real + (start + k + half) * batch;
+        float* b_imag = imag + (start + k + half) * batch;
+        for (std::size_t b = 0; b < batch; ++b) {
+          float t_real = w_real * b_real[b] - w_imag * b_imag[b];
+          float t_imag = w_real * b_imag[b] + w_imag * b_real[b];
+          b_real[b] = a_real[b] - t_real;
+          b_imag[b] = a_imag[b] - t_imag;
+          a_real[b] += t_real;
+          a_imag[b] += t_imag;
+        }
+      }
+    }
+  }
+}
+
+void FastFourierTransform::splitRealSpectra(const float* real,
+                                            const float* imag, float* power_a,
+                                            float* power_b) const {
+  const std::size_t batch = batch_size_;
+  for (std::size_t k = 0; k <= size_ / 2; ++k) {
+    // Z[k] = A[k] + iB[k] and Z[N - k] = conj(A[k]) + i conj(B[k]).
+    const std::size_t mirror = (size_ - k) % size_;
+    for (std::size_t b = 0; b < batch; ++b) {
+      float z_real = real[k * batch + b], z_imag = imag[k * batch + b];
+      float m_real = real[mirror * batch + b];
+      float m_imag = imag[mirror * batch + b];
+      float a_real = 0.5f * (z_real + m_real);
+      float a_imag = 0.5f * (z_imag - m_imag);
+      float b_real = 0.5f * (z_imag + m_imag);
+      float b_imag = -0.5f * (z_real - m_real);
+      power_a[k * batch + b] = a_real * a_real + a_imag * a_imag;
+      power_b[k * batch + b] = b_real * b_real + b_imag * b_imag;
+    }
+  }
+}
+}
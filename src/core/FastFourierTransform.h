@@ -0,0 +1,44 @@
+/* A radix-2 fast Fourier transform plan. The bit reversal permutation and the
+ * twiddle factors are computed once at construction so that transforms never
+ * allocate. Transforms are done in place on a batch of signals which are
+ * interleaved sample by sample (sample n of signal b is at n * batch_size + b)
+ * so that the innermost loop runs over the batch and can be vectorized.
+ *
+ * Two real signals can be transformed at the cost of one complex signal by
+ * storing them as the real and imaginary parts and splitting the result with
+ * splitRealSpectra.
+ */
+
+#pragma once
+
+/* for MSVC++ */
+#define _USE_MATH_DEFINES
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace core {
+class FastFourierTransform {
+ public:
+  // Throws std::invalid_argument if size is not a power of two.
+  FastFourierTransform(std::size_t size, std::size_t batch_size = 1);
+
+  std::size_t size() const;
+  std::size_t batchSize() const;
+
+  // Forward transform of size() * batchSize() interleaved complex values.
+  void transform(float* real, float* imag) const;
+
+  // Given the transform of a + ib for real signals a and b, computes the power
+  // |A[k]|^2 and |B[k]|^2 of bins k = 0 ... size() / 2 of every signal in the
+  // batch. The powers are written to power_a and power_b, which are laid out
+  // the same way as the input.
+  void splitRealSpectra(const float* real, const float* imag, float* power_a,
+                        float* power_b) const;
+
+ private:
+  const std::size_t size_, batch_size_;
+  std::vector<std::size_t> bit_reversed_;
+  std::vector<float> cos_, sin_;
+};
+}
@@ -0,0 +1,88 @@
+#include "FeatureState.h"
+
+#include <cstdint>
+
+namespace core {
+FeatureState::Pose::Pose(const std::string& name) : name_(name) {}
+
+std::string FeatureState::Pose::toString() const { return name_; }
+
+FeatureState::FeatureState() : position_(0) {}
+
+FeatureState::FeatureState(std::vector<char> data)
+    : data_(std::move(data)), position_(0) {}
+
+void FeatureState::putString(const std::string& string) {
+  put<uint32_t>(static_cast<uint32_t>(string.size()));
+  data_.insert(data_.end(), string.begin(), string.end());
+}
+
+std::string FeatureState::getString() {
+  std::size_t size = get<uint32_t>();
+  return std::string(Take(size), size);
+}
+
+void FeatureState::putPose(const std::shared_ptr<core::Pose>& pose) {
+  putString(pose->toString());
+}
+
+std::shared_ptr<core::Pose> FeatureState::getPose() {
+  std::string name = getString();
+  std::shared_ptr<core::Pose> pose = core::Pose::fromString(name);
+  return pose ? pose : std::make_shared<Pose>(name);
+}
+
+void FeatureState::putQuaternion(const myo::Quaternion<float>& quaternion) {
+  put<float>(quaternion.x());
+  put<float>(quaternion.y());
+  put<float>(quaternion.z());
+  put<float>(quaternion.w());
+}
+
+myo::Quaternion<float> FeatureState::getQuaternion() {
+  float x = get<float>();
+  float y = get<float>();
+  float z = get<float>();
+  float w = get<float>();
+  return myo::Quaternion<float>(x, y, z, w);
+}
+
+void FeatureState::putVector(const myo::Vector3<float>& vector) {
+  put<float>(vector.x());
+  put<float>(vector.y());
+  put<float>(vector.z());
+}
+
+myo::Vector3<float> FeatureState::getVector() {
+  float x = get<float>();
+  float y = get<float>();
+  float z = get<float>();
+  return myo::Vector3<float>(x, y, z);
+}
+
+void FeatureState::putState(const FeatureState& state) {
+  put<uint32_t>(static_cast<uint32_t>(state.data_.size()));
+  data_.insert(data_.end(), state.data_.begin(), state.data_.end());
+}
+
+FeatureState FeatureState::getState() {
+  std::size_t size = get<uint32_t>();
+  const char* data = Take(size);
+  return FeatureState(std::vector<char>(data, data + size));
+}
+
+const std::vector<char>& FeatureState::data() const { return data_; }
+
+bool FeatureState::empty() const { return data_.empty(); }
+
+bool FeatureState::exhausted() const { return position_ == data_.size(); }
+
+const char* FeatureState::Take(std::size_t size) {
+  if (data_.size() - position_ < size) {
+    throw std::runtime_error("The feature state is truncated.");
+  }
+  const char* data = data_.data() + position_;
+  position_ += size;
+  return data;
+}
+}
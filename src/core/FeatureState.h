@@ -0,0 +1,83 @@
+/* The state of a feature, saved into a snapshot so that playback of a
+ * recording can resume with warm state, see DeviceListenerWrapper::saveState.
+ * Values are appended with the put functions and read back in the same order
+ * with the get functions, which throw std::runtime_error when there are no
+ * more values.
+ *
+ * Poses are saved by name. Restored poses which aren't one of the Myo's poses
+ * are FeatureState::Poses with the saved name, which compare equal to the
+ * original, since poses compare by name.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <myo/myo.hpp>
+
+#include "Pose.h"
+
+namespace core {
+class FeatureState {
+ public:
+  class Pose : public core::Pose {
+   public:
+    Pose(const std::string& name);
+
+    virtual std::string toString() const override;
+
+   private:
+    const std::string name_;
+  };
+
+  FeatureState();
+  explicit FeatureState(std::vector<char> data);
+
+  // T must be trivially copyable.
+  template <typename T>
+  void put(const T& value);
+  template <typename T>
+  T get();
+
+  void putString(const std::string& string);
+  std::string getString();
+  void putPose(const std::shared_ptr<core::Pose>& pose);
+  std::shared_ptr<core::Pose> getPose();
+  void putQuaternion(const myo::Quaternion<float>& quaternion);
+  myo::Quaternion<float> getQuaternion();
+  void putVector(const myo::Vector3<float>& vector);
+  myo::Vector3<float> getVector();
+  // Nests the state of another feature.
+  void putState(const FeatureState& state);
+  FeatureState getState();
+
+  const std::vector<char>& data() const;
+  bool empty() const;
+  // Whether all values have been read.
+  bool exhausted() const;
+
+ private:
+  // Returns size bytes to read, throwing if there aren't as many left.
+  const char* Take(std::size_t size);
+
+  std::vector<char> data_;
+  std::size_t position_;
+};
+
+template <typename T>
+void FeatureState::put(const T& value) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  data_.insert(data_.end(), bytes, bytes + sizeof(value));
+}
+
+template <typename T>
+T FeatureState::get() {
+  T value;
+  std::memcpy(&value, Take(sizeof(value)), sizeof(value));
+  return value;
+}
+}
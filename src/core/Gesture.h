@@ -8,6 +8,9 @@ namespace core {
 class Gesture {
  public:
   enum Type { unknown };
+  // The status of a gesture reported via onSpeculativeGesture. A tentative
+  // gesture is later either confirmed or cancelled.
+  enum class Status { tentative, confirmed, cancelled };
 
   Gesture(Type type = unknown);
   Gesture(const std::shared_ptr<Pose>& pose, Type type = unknown);
@@ -0,0 +1,133 @@
+#include "GestureEvaluation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+
+namespace core {
+namespace GestureEvaluation {
+namespace {
+// The timestamps of the events of one gesture, sorted.
+typedef std::map<std::string, std::vector<uint64_t>> Timestamps;
+
+void AddTimestamps(const std::vector<Event>& events, Timestamps& timestamps) {
+  for (const Event& event : events) {
+    timestamps[event.gesture].push_back(event.timestamp);
+  }
+  for (auto& gesture : timestamps) {
+    std::sort(gesture.second.begin(), gesture.second.end());
+  }
+}
+}
+
+Result::Result() : true_positives(0), false_positives(0), false_negatives(0) {}
+
+double Result::precision() const {
+  std::size_t detected = true_positives + false_positives;
+  return detected == 0 ? 1.0 : static_cast<double>(true_positives) / detected;
+}
+
+double Result::recall() const {
+  std::size_t labelled = true_positives + false_negatives;
+  return labelled == 0 ? 1.0 : static_cast<double>(true_positives) / labelled;
+}
+
+double Result::f1() const {
+  double p = precision(), r = recall();
+  return p + r == 0 ? 0.0 : 2 * p * r / (p + r);
+}
+
+int64_t Result::latencyPercentile(double fraction) const {
+  if (latencies.empty()) {
+    return 0;
+  }
+  std::vector<int64_t> sorted = latencies;
+  std::size_t rank = static_cast<std::size_t>(
+      std::ceil(std::min(std::max(fraction, 0.0), 1.0) * sorted.size()));
+  std::size_t index = rank == 0 ? 0 : rank - 1;
+  std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+  return sorted[index];
+}
+
+void Result::add(const Result& other) {
+  true_positives += other.true_positives;
+  false_positives += other.false_positives;
+  false_negatives += other.false_negatives;
+  latencies.insert(latencies.end(), other.latencies.begin(),
+                   other.latencies.end());
+}
+
+std::vector<Event> ReadLabels(std::istream& is) {
+  std::vector<Event> labels;
+  std::string line;
+  for (std::size_t line_number = 1; std::getline(is, line); ++line_number) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream ss(line);
+    Event label;
+    char comma;
+    if (!(ss >> label.timestamp >> comma) || comma != ',' ||
+        !std::getline(ss, label.gesture) || label.gesture.empty()) {
+      throw std::runtime_error("Invalid label on line " +
+                               std::to_string(line_number) + ".");
+    }
+    labels.push_back(label);
+  }
+  return labels;
+}
+
+std::map<std::string, Result> Match(const std::vector<Event>& labels,
+                                    const std::vector<Event>& detections,
+                                    uint64_t before, uint64_t after) {
+  Timestamps label_timestamps, detection_timestamps;
+  AddTimestamps(labels, label_timestamps);
+  AddTimestamps(detections, detection_timestamps);
+
+  std::map<std::string, Result> results;
+  for (const auto& gesture : label_timestamps) {
+    Result& result = results[gesture.first];
+    const std::vector<uint64_t>& detected =
+        detection_timestamps[gesture.first];
+    std::size_t next = 0;
+    for (uint64_t label : gesture.second) {
+      // Detections too early for this label are too early for all later
+      // ones as well.
+      while (next < detected.size() && detected[next] + before < label) {
+        ++result.false_positives;
+        ++next;
+      }
+      if (next < detected.size() && detected[next] <= label + after) {
+        ++result.true_positives;
+        result.latencies.push_back(static_cast<int64_t>(detected[next]) -
+                                   static_cast<int64_t>(label));
+        ++next;
+      } else {
+        ++result.false_negatives;
+      }
+    }
+    result.false_positives += detected.size() - next;
+  }
+  // Gestures which were detected but never labelled.
+  for (const auto& gesture : detection_timestamps) {
+    if (label_timestamps.find(gesture.first) == label_timestamps.end()) {
+      results[gesture.first].false_positives += gesture.second.size();
+    }
+  }
+  return results;
+}
+
+Result Total(const std::map<std::string, Result>& results) {
+  Result total;
+  for (const auto& result : results) {
+    total.add(result.second);
+  }
+  return total;
+}
+}
+}
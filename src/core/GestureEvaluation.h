@@ -0,0 +1,68 @@
+/* Evaluation of detected gestures against ground truth labels, e.g. to choose
+ * the Debounce timeout or PoseGestures thresholds from data.
+ *
+ * A detection matches a label of the same gesture if it occurs within a
+ * tolerance window around the label, from before microseconds earlier to
+ * after microseconds later. Every label and detection is matched at most
+ * once, and since all windows have the same width, matching them in time
+ * order yields the most matches. Matched detections are true positives and
+ * have a latency, the time from the label to the detection, which is
+ * negative for early detections. Unmatched detections are false positives,
+ * unmatched labels false negatives.
+ *
+ * Labels are read from CSV files with a timestamp in microseconds, on the
+ * clock of the recording, and a gesture name per line, e.g.
+ * "1250000,doubleClick: fist". Names are compared as they are, so labels
+ * have to name gestures the way the detections do, e.g. by
+ * core::Gesture::toDescriptiveString, the gesture and its pose, which tells
+ * the same gesture of different poses apart. Empty lines and lines starting
+ * with # are ignored.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace core {
+namespace GestureEvaluation {
+struct Event {
+  uint64_t timestamp;
+  std::string gesture;
+};
+
+struct Result {
+  Result();
+
+  // 1 if nothing was detected.
+  double precision() const;
+  // 1 if there was nothing to detect.
+  double recall() const;
+  double f1() const;
+  // The latency below which the given fraction of the latencies lie, by
+  // nearest rank, or 0 if there are none.
+  int64_t latencyPercentile(double fraction) const;
+
+  // Adds the counts and latencies of other.
+  void add(const Result& other);
+
+  std::size_t true_positives, false_positives, false_negatives;
+  // In microseconds, in no particular order.
+  std::vector<int64_t> latencies;
+};
+
+// Throws std::runtime_error with the line number if a line is invalid.
+std::vector<Event> ReadLabels(std::istream& is);
+
+// The result for each gesture which has labels or detections.
+std::map<std::string, Result> Match(const std::vector<Event>& labels,
+                                    const std::vector<Event>& detections,
+                                    uint64_t before, uint64_t after);
+// The sum of the results of all gestures.
+Result Total(const std::map<std::string, Result>& results);
+}
+}
@@ -0,0 +1,378 @@
+#include "LinearDiscriminant.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+namespace core {
+namespace {
+const char magic[4] = {'M', 'I', 'L', 'D'};
+const uint32_t version = 2;
+const uint32_t minVersion = 1;
+// Sizes beyond this are assumed to come from a corrupt file.
+const std::size_t maxSize = 1 << 16;
+
+void WriteUint32(std::ostream& os, uint32_t value) {
+  unsigned char bytes[4] = {
+      static_cast<unsigned char>(value), static_cast<unsigned char>(value >> 8),
+      static_cast<unsigned char>(value >> 16),
+      static_cast<unsigned char>(value >> 24)};
+  os.write(reinterpret_cast<const char*>(bytes), 4);
+}
+
+uint32_t ReadUint32(std::istream& is) {
+  unsigned char bytes[4];
+  if (!is.read(reinterpret_cast<char*>(bytes), 4)) {
+    throw std::runtime_error("Unexpected end of model file.");
+  }
+  return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+         (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+void WriteFloats(std::ostream& os, const std::vector<float>& values) {
+  for (float value : values) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    WriteUint32(os, bits);
+  }
+}
+
+void ReadFloats(std::istream& is, std::vector<float>& values) {
+  for (float& value : values) {
+    uint32_t bits = ReadUint32(is);
+    std::memcpy(&value, &bits, sizeof(value));
+  }
+}
+
+void WriteFloats(std::ostream& os, const std::vector<double>& values) {
+  WriteFloats(os, std::vector<float>(values.begin(), values.end()));
+}
+
+void ReadFloats(std::istream& is, std::vector<double>& values) {
+  std::vector<float> floats(values.size());
+  ReadFloats(is, floats);
+  values.assign(floats.begin(), floats.end());
+}
+
+// Four independent sums so that consecutive multiply-adds don't wait for each
+// other, and so that the compiler can vectorize without reassociating.
+float Dot(const float* a, const float* b, std::size_t size) {
+  float sums[4] = {0.f, 0.f, 0.f, 0.f};
+  std::size_t i = 0;
+  for (; i + 4 <= size; i += 4) {
+    for (std::size_t j = 0; j < 4; ++j) {
+      sums[j] += a[i + j] * b[i + j];
+    }
+  }
+  for (; i < size; ++i) {
+    sums[0] += a[i] * b[i];
+  }
+  return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+}
+
+LinearDiscriminant::LinearDiscriminant() : num_features_(0) {}
+
+LinearDiscriminant LinearDiscriminant::Train(
+    const std::vector<std::string>& class_names, std::size_t num_features,
+    const std::vector<float>& samples, const std::vector<int>& labels,
+    float shrinkage) {
+  const std::size_t p = num_features, k = class_names.size();
+  const std::size_t n = labels.size();
+  if (p == 0 || k == 0 || samples.size() != n * p || n <= k) {
+    throw std::invalid_argument("Inconsistent LDA training data.");
+  }
+
+  std::vector<double> means(k * p, 0.0);
+  std::vector<std::size_t> counts(k, 0);
+  for (std::size_t i = 0; i < n; ++i) {
+    if (labels[i] < 0 || static_cast<std::size_t>(labels[i]) >= k) {
+      throw std::invalid_argument("LDA label out of range.");
+    }
+    ++counts[labels[i]];
+    for (std::size_t j = 0; j < p; ++j) {
+      means[labels[i] * p + j] += samples[i * p + j];
+    }
+  }
+  for (std::size_t c = 0; c < k; ++c) {
+    for (std::size_t j = 0; j < p; ++j) {
+      means[c * p + j] /= counts[c] > 0 ? counts[c] : 1;
+    }
+  }
+
+  // Pooled within-class covariance, shrunk towards its mean variance.
+  std::vector<double> covariance(p * p, 0.0);
+  std::vector<double> centered(p);
+  for (std::size_t i = 0; i < n; ++i) {
+    for (std::size_t j = 0; j < p; ++j) {
+      centered[j] = samples[i * p + j] - means[labels[i] * p + j];
+    }
+    for (std::size_t a = 0; a < p; ++a) {
+      for (std::size_t b = 0; b <= a; ++b) {
+        covariance[a * p + b] += centered[a] * centered[b];
+      }
+    }
+  }
+  double trace = 0.0;
+  for (std::size_t a = 0; a < p; ++a) {
+    for (std::size_t b = 0; b <= a; ++b) {
+      covariance[a * p + b] /= n - k;
+    }
+    trace += covariance[a * p + a];
+  }
+  for (std::size_t a = 0; a < p; ++a) {
+    for (std::size_t b = 0; b <= a; ++b) {
+      covariance[a * p + b] *= 1.0 - shrinkage;
+    }
+    covariance[a * p + a] += shrinkage * trace / p;
+  }
+
+  // Cholesky decomposition of the lower triangle, in place.
+  for (std::size_t a = 0; a < p; ++a) {
+    for (std::size_t b = 0; b <= a; ++b) {
+      double sum = covariance[a * p + b];
+      for (std::size_t m = 0; m < b; ++m) {
+        sum -= covariance[a * p + m] * covariance[b * p + m];
+      }
+      if (a == b) {
+        if (sum <= 0.0) {
+          throw std::runtime_error("LDA covariance matrix isn't invertible.");
+        }
+        covariance[a * p + a] = std::sqrt(sum);
+      } else {
+        covariance[a * p + b] = sum / covariance[b * p + b];
+      }
+    }
+  }
+
+  // Solves covariance * solution = rhs by forward and back substitution.
+  auto solve = [&](const double* rhs, double* solution) {
+    for (std::size_t a = 0; a < p; ++a) {
+      double sum = rhs[a];
+      for (std::size_t m = 0; m < a; ++m) {
+        sum -= covariance[a * p + m] * solution[m];
+      }
+      solution[a] = sum / covariance[a * p + a];
+    }
+    for (std::size_t a = p; a-- > 0;) {
+      double sum = solution[a];
+      for (std::size_t m = a + 1; m < p; ++m) {
+        sum -= covariance[m * p + a] * solution[m];
+      }
+      solution[a] = sum / covariance[a * p + a];
+    }
+  };
+
+  LinearDiscriminant model;
+  model.num_features_ = p;
+  model.class_names_ = class_names;
+  model.log_priors_.resize(k);
+  for (std::size_t c = 0; c < k; ++c) {
+    model.log_priors_[c] =
+        std::log(static_cast<double>(counts[c] > 0 ? counts[c] : 1) / n);
+  }
+  model.means_ = means;
+  model.precision_.resize(p * p);
+  std::vector<double> unit(p, 0.0);
+  for (std::size_t a = 0; a < p; ++a) {
+    unit[a] = 1.0;
+    solve(unit.data(), &model.precision_[a * p]);
+    unit[a] = 0.0;
+  }
+  for (std::size_t a = 0; a < p; ++a) {
+    for (std::size_t b = 0; b < a; ++b) {
+      model.precision_[a * p + b] = model.precision_[b * p + a] =
+          0.5 * (model.precision_[a * p + b] + model.precision_[b * p + a]);
+    }
+  }
+  model.exact_weights_.resize(k * p);
+  for (std::size_t c = 0; c < k; ++c) {
+    solve(&means[c * p], &model.exact_weights_[c * p]);
+  }
+  model.deviation_.resize(p);
+  model.projected_.resize(p);
+  model.UpdateDiscriminants();
+  return model;
+}
+
+LinearDiscriminant LinearDiscriminant::Load(std::istream& is) {
+  char file_magic[4];
+  if (!is.read(file_magic, 4) || std::memcmp(file_magic, magic, 4) != 0) {
+    throw std::runtime_error("Not an LDA model file.");
+  }
+  uint32_t file_version = ReadUint32(is);
+  if (file_version < minVersion || file_version > version) {
+    throw std::runtime_error("Unsupported LDA model version.");
+  }
+  LinearDiscriminant model;
+  model.num_features_ = ReadUint32(is);
+  std::size_t num_classes = ReadUint32(is);
+  if (num_classes > maxSize || model.num_features_ > maxSize) {
+    throw std::runtime_error("Invalid LDA model size.");
+  }
+  for (std::size_t c = 0; c < num_classes; ++c) {
+    std::size_t length = ReadUint32(is);
+    if (length > maxSize) {
+      throw std::runtime_error("Invalid LDA class name.");
+    }
+    std::string name(length, '\0');
+    if (length > 0 && !is.read(&name[0], length)) {
+      throw std::runtime_error("Unexpected end of model file.");
+    }
+    model.class_names_.push_back(name);
+  }
+  model.weights_.resize(num_classes * model.num_features_);
+  model.biases_.resize(num_classes);
+  ReadFloats(is, model.weights_);
+  ReadFloats(is, model.biases_);
+  if (file_version >= 2 && ReadUint32(is) != 0) {
+    const std::size_t p = model.num_features_;
+    model.log_priors_.resize(num_classes);
+    model.means_.resize(num_classes * p);
+    model.precision_.resize(p * p);
+    ReadFloats(is, model.log_priors_);
+    ReadFloats(is, model.means_);
+    ReadFloats(is, model.precision_);
+    model.exact_weights_.assign(model.weights_.begin(), model.weights_.end());
+    model.deviation_.resize(p);
+    model.projected_.resize(p);
+  }
+  return model;
+}
+
+void LinearDiscriminant::save(std::ostream& os) const {
+  os.write(magic, 4);
+  WriteUint32(os, version);
+  WriteUint32(os, static_cast<uint32_t>(num_features_));
+  WriteUint32(os, static_cast<uint32_t>(class_names_.size()));
+  for (const auto& name : class_names_) {
+    WriteUint32(os, static_cast<uint32_t>(name.size()));
+    os.write(name.data(), name.size());
+  }
+  WriteFloats(os, weights_);
+  WriteFloats(os, biases_);
+  WriteUint32(os, adaptive() ? 1 : 0);
+  if (adaptive()) {
+    WriteFloats(os, log_priors_);
+    WriteFloats(os, means_);
+    WriteFloats(os, precision_);
+  }
+}
+
+std::size_t LinearDiscriminant::numFeatures() const { return num_features_; }
+
+std::size_t LinearDiscriminant::numClasses() const {
+  return class_names_.size();
+}
+
+const std::string& LinearDiscriminant::className(std::size_t index) const {
+  return class_names_[index];
+}
+
+std::size_t LinearDiscriminant::classify(const float* features) const {
+  std::size_t best = 0;
+  float best_score = 0.f;
+  for (std::size_t c = 0; c < class_names_.size(); ++c) {
+    float score =
+        biases_[c] + Dot(&weights_[c * num_features_], features, num_features_);
+    if (c == 0 || score > best_score) {
+      best = c;
+      best_score = score;
+    }
+  }
+  return best;
+}
+
+void LinearDiscriminant::scores(const float* features, float* scores) const {
+  for (std::size_t c = 0; c < class_names_.size(); ++c) {
+    scores[c] =
+        biases_[c] + Dot(&weights_[c * num_features_], features, num_features_);
+  }
+}
+
+bool LinearDiscriminant::adaptive() const { return !precision_.empty(); }
+
+void LinearDiscriminant::adapt(const float* features, std::size_t label,
+                               float rate) {
+  const std::size_t p = num_features_, k = class_names_.size();
+  if (label >= k || !(rate > 0.f && rate < 1.f)) {
+    throw std::invalid_argument("Invalid LDA adaptation sample.");
+  }
+  if (!adaptive()) {
+    throw std::runtime_error("LDA model has no adaptation state.");
+  }
+  // With d the deviation from the old class mean, the new covariance is
+  // (1 - rate) (C + rate d d^T), so by Sherman-Morrison the new precision is
+  // (P - rate (P d) (P d)^T / (1 + rate d^T P d)) / (1 - rate).
+  double* deviation = deviation_.data();
+  double* projected = projected_.data();
+  std::fill(projected, projected + p, 0.0);
+  double* mean = &means_[label * p];
+  for (std::size_t j = 0; j < p; ++j) {
+    deviation[j] = features[j] - mean[j];
+  }
+  for (std::size_t a = 0; a < p; ++a) {
+    const double* row = &precision_[a * p];
+    for (std::size_t b = 0; b < p; ++b) {
+      projected[a] += row[b] * deviation[b];
+    }
+  }
+  double quadratic = 0.0;
+  for (std::size_t j = 0; j < p; ++j) {
+    quadratic += deviation[j] * projected[j];
+  }
+  const double denominator = 1.0 + rate * quadratic;
+  const double scale = 1.0 / (1.0 - rate);
+  const double correction = rate / denominator;
+  // Rounding errors that make the precision matrix asymmetric grow by scale
+  // with every update, so only the lower triangle is computed and mirrored.
+  for (std::size_t a = 0; a < p; ++a) {
+    const double factor = correction * projected[a];
+    for (std::size_t b = 0; b <= a; ++b) {
+      precision_[a * p + b] = precision_[b * p + a] =
+          scale * (precision_[a * p + b] - factor * projected[b]);
+    }
+  }
+
+  // The weights w = P m of every class follow from the same correction, with
+  // (P d)^T m == d^T w. Using the weights rather than the means keeps their
+  // rounding errors from growing, since the weights are then transformed
+  // exactly like the precision matrix. The mean of class label also moves by
+  // rate d, which adds rate P' d = rate scale P d / denominator.
+  for (std::size_t c = 0; c < k; ++c) {
+    double* weights = &exact_weights_[c * p];
+    double dot = 0.0;
+    for (std::size_t j = 0; j < p; ++j) {
+      dot += deviation[j] * weights[j];
+    }
+    const double factor = correction * dot;
+    for (std::size_t j = 0; j < p; ++j) {
+      weights[j] = scale * (weights[j] - factor * projected[j]);
+    }
+  }
+  double* weights = &exact_weights_[label * p];
+  for (std::size_t j = 0; j < p; ++j) {
+    weights[j] += rate * scale * projected[j] / denominator;
+    mean[j] += rate * deviation[j];
+  }
+  UpdateDiscriminants();
+}
+
+void LinearDiscriminant::UpdateDiscriminants() {
+  const std::size_t p = num_features_, k = class_names_.size();
+  weights_.resize(k * p);
+  biases_.resize(k);
+  for (std::size_t c = 0; c < k; ++c) {
+    double bias = log_priors_[c];
+    for (std::size_t j = 0; j < p; ++j) {
+      weights_[c * p + j] = static_cast<float>(exact_weights_[c * p + j]);
+      bias -= 0.5 * means_[c * p + j] * exact_weights_[c * p + j];
+    }
+    biases_[c] = static_cast<float>(bias);
+  }
+}
+}
@@ -0,0 +1,81 @@
+/* A linear discriminant analysis classifier. Training estimates the mean of
+ * every class and a covariance matrix shared by all classes, which is shrunk
+ * towards a multiple of the identity so that it stays invertible with few
+ * samples. The discriminant of class c is then the linear function
+ * w_c . x + b_c, so classifying a sample costs one dot product per class.
+ * Weights are stored class major so that each dot product is contiguous.
+ *
+ * Trained models keep the class means and the inverse of the covariance
+ * matrix, so that they can be adapted at run time to labeled samples, e.g.
+ * when the electrodes have shifted after putting the armband back on. Each
+ * sample is a rank-1 update of the covariance matrix, so its inverse is
+ * updated with the Sherman-Morrison formula in O(p^2) for p features, and the
+ * discriminants in O(k p) for k classes, instead of training from scratch.
+ *
+ * Models are saved in a compact little-endian binary format: the magic
+ * "MILD", a version, the number of features and classes, the class names, and
+ * the weights and biases as 32 bit floats. Since version 2 these are followed
+ * by the state needed for adaptation, if the model has it.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace core {
+class LinearDiscriminant {
+ public:
+  LinearDiscriminant();
+
+  // Trains a classifier on samples of num_features values each, where
+  // labels[i] is the index into class_names of sample i. shrinkage is between
+  // 0 and 1. Throws std::invalid_argument if the data is inconsistent or
+  // std::runtime_error if the covariance matrix isn't invertible.
+  static LinearDiscriminant Train(const std::vector<std::string>& class_names,
+                                  std::size_t num_features,
+                                  const std::vector<float>& samples,
+                                  const std::vector<int>& labels,
+                                  float shrinkage = 0.01f);
+
+  // Throws std::runtime_error if the stream doesn't contain a valid model.
+  static LinearDiscriminant Load(std::istream& is);
+  void save(std::ostream& os) const;
+
+  std::size_t numFeatures() const;
+  std::size_t numClasses() const;
+  const std::string& className(std::size_t index) const;
+
+  // Returns the index of the class with the highest discriminant.
+  std::size_t classify(const float* features) const;
+  // Writes the discriminant of every class to scores.
+  void scores(const float* features, float* scores) const;
+
+  // Whether the model can be adapted, which is the case unless it was loaded
+  // from a version 1 file.
+  bool adaptive() const;
+  // Moves the model towards a sample of class label. The mean of that class
+  // and the shared covariance matrix become exponentially weighted moving
+  // averages, where rate is the weight of the new sample. Throws
+  // std::invalid_argument if label or rate is out of range, or
+  // std::runtime_error if the model isn't adaptive.
+  void adapt(const float* features, std::size_t label, float rate);
+
+ private:
+  // Recomputes the single precision weights and the biases from the
+  // adaptation state.
+  void UpdateDiscriminants();
+
+  std::size_t num_features_;
+  std::vector<std::string> class_names_;
+  std::vector<float> weights_, biases_;
+  // Adaptation state in double precision, so that many updates don't
+  // accumulate rounding errors. The precision matrix is the inverse of the
+  // covariance matrix. All empty if the model isn't adaptive.
+  std::vector<double> log_priors_, means_, precision_, exact_weights_;
+  // Scratch space for adapt, so that adapting doesn't allocate.
+  std::vector<double> deviation_, projected_;
+};
+}
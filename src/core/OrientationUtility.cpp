@@ -1,7 +1,116 @@
 #include "OrientationUtility.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ORIENTATION_UTILITY_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace core {
 namespace OrientationUtility {
+namespace {
+// Minimax polynomial for atan(x) on [0, 1].
+const float atan_coefficients[] = {0.99997726f,  -0.33262347f, 0.19354346f,
+                                   -0.11643287f, 0.05265332f,  -0.01172120f};
+const float pi = static_cast<float>(M_PI);
+const float half_pi = static_cast<float>(M_PI / 2);
+
+float AtanPolynomial(float x) {
+  float x2 = x * x;
+  float p = atan_coefficients[5];
+  p = p * x2 + atan_coefficients[4];
+  p = p * x2 + atan_coefficients[3];
+  p = p * x2 + atan_coefficients[2];
+  p = p * x2 + atan_coefficients[1];
+  p = p * x2 + atan_coefficients[0];
+  return p * x;
+}
+
+// The arguments of the atan2 / asin calls of QuaternionToRoll/Pitch/Yaw.
+void RollArguments(const myo::Quaternion<float>& quat, float& y, float& x) {
+  y = 2.0f * (quat.w() * quat.x() + quat.y() * quat.z());
+  x = 1.0f - 2.0f * (quat.x() * quat.x() + quat.y() * quat.y());
+}
+
+float PitchArgument(const myo::Quaternion<float>& quat) {
+  return std::max(
+      -1.0f,
+      std::min(1.0f, 2.0f * (quat.w() * quat.y() - quat.z() * quat.x())));
+}
+
+void YawArguments(const myo::Quaternion<float>& quat, float& y, float& x) {
+  y = 2.0f * (quat.w() * quat.z() + quat.x() * quat.y());
+  x = 1.0f - 2.0f * (quat.y() * quat.y() + quat.z() * quat.z());
+}
+
+#ifdef ORIENTATION_UTILITY_SSE2
+__m128 Select(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+__m128 FastAtan2(__m128 y, __m128 x) {
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  __m128 abs_y = _mm_andnot_ps(sign_mask, y);
+  __m128 abs_x = _mm_andnot_ps(sign_mask, x);
+  __m128 numerator = _mm_min_ps(abs_y, abs_x);
+  __m128 denominator = _mm_max_ps(abs_y, abs_x);
+  // Avoid dividing 0 by 0 for atan2(0, 0).
+  __m128 zero = _mm_cmpeq_ps(denominator, _mm_setzero_ps());
+  __m128 a = _mm_div_ps(numerator, Select(zero, _mm_set1_ps(1.f), denominator));
+  __m128 a2 = _mm_mul_ps(a, a);
+  __m128 p = _mm_set1_ps(atan_coefficients[5]);
+  for (int i = 4; i >= 0; --i) {
+    p = _mm_add_ps(_mm_mul_ps(p, a2), _mm_set1_ps(atan_coefficients[i]));
+  }
+  __m128 r = _mm_mul_ps(p, a);
+  r = Select(_mm_cmpgt_ps(abs_y, abs_x),
+             _mm_sub_ps(_mm_set1_ps(half_pi), r), r);
+  r = Select(_mm_cmplt_ps(x, _mm_setzero_ps()),
+             _mm_sub_ps(_mm_set1_ps(pi), r), r);
+  // Copy the sign of y.
+  return _mm_or_ps(r, _mm_and_ps(sign_mask, y));
+}
+
+__m128 FastAsin(__m128 x) {
+  // (1 - x)(1 + x) is more accurate than 1 - x^2 when |x| is close to 1.
+  const __m128 one = _mm_set1_ps(1.f);
+  __m128 cos = _mm_sqrt_ps(_mm_max_ps(
+      _mm_setzero_ps(),
+      _mm_mul_ps(_mm_sub_ps(one, x), _mm_add_ps(one, x))));
+  return FastAtan2(x, cos);
+}
+
+// Converts four x, y, z vectors between consecutive values (a, b, c) and
+// separate x, y and z lanes.
+void Deinterleave(__m128 a, __m128 b, __m128 c, __m128& x, __m128& y,
+                  __m128& z) {
+  // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+  x = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 3, 0, 0)),
+                     _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 1, 0, 2)),
+                     _MM_SHUFFLE(2, 0, 2, 0));
+  y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 0, 1)),
+                     _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 2, 0, 3)),
+                     _MM_SHUFFLE(2, 0, 2, 0));
+  z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 1, 0, 2)),
+                     _mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 3, 0, 0)),
+                     _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+void Interleave(__m128 x, __m128 y, __m128 z, __m128& a, __m128& b,
+                __m128& c) {
+  __m128 xy_low = _mm_unpacklo_ps(x, y);   // x0 y0 x1 y1
+  __m128 xy_high = _mm_unpackhi_ps(x, y);  // x2 y2 x3 y3
+  a = _mm_shuffle_ps(xy_low, _mm_shuffle_ps(z, x, _MM_SHUFFLE(0, 1, 0, 0)),
+                     _MM_SHUFFLE(2, 0, 1, 0));
+  b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(0, 1, 0, 1)), xy_high,
+                     _MM_SHUFFLE(1, 0, 2, 0));
+  c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(0, 3, 0, 2)),
+                     _mm_shuffle_ps(y, z, _MM_SHUFFLE(0, 3, 0, 3)),
+                     _MM_SHUFFLE(2, 0, 2, 0));
+}
+#endif
+}
+
 float QuaternionToRoll(const myo::Quaternion<float>& quat) {
   return std::atan2(2.0f * (quat.w() * quat.x() + quat.y() * quat.z()),
                     1.0f - 2.0f * (quat.x() * quat.x() + quat.y() * quat.y()));
@@ -18,6 +127,131 @@ float QuaternionToYaw(const myo::Quaternion<float>& quat) {
                     1.0f - 2.0f * (quat.y() * quat.y() + quat.z() * quat.z()));
 }
 
+float FastAtan2(float y, float x) {
+  float abs_y = std::fabs(y), abs_x = std::fabs(x);
+  float denominator = std::max(abs_y, abs_x);
+  float a = denominator == 0.f ? 0.f : std::min(abs_y, abs_x) / denominator;
+  float r = AtanPolynomial(a);
+  r = abs_y > abs_x ? half_pi - r : r;
+  r = x < 0.f ? pi - r : r;
+  return std::signbit(y) ? -r : r;
+}
+
+float FastAsin(float x) {
+  // (1 - x)(1 + x) is more accurate than 1 - x^2 when |x| is close to 1.
+  return FastAtan2(x, std::sqrt(std::max(0.f, (1.f - x) * (1.f + x))));
+}
+
+void QuaternionsToRollPitchYaw(const myo::Quaternion<float>* quats,
+                               std::size_t count, float* roll, float* pitch,
+                               float* yaw, Precision precision) {
+  if (precision == Precision::precise) {
+    for (std::size_t i = 0; i < count; ++i) {
+      if (roll) roll[i] = QuaternionToRoll(quats[i]);
+      if (pitch) pitch[i] = QuaternionToPitch(quats[i]);
+      if (yaw) yaw[i] = QuaternionToYaw(quats[i]);
+    }
+    return;
+  }
+
+  std::size_t i = 0;
+#ifdef ORIENTATION_UTILITY_SSE2
+  for (; i + 4 <= count; i += 4) {
+    float roll_y[4], roll_x[4], sin_pitch[4], yaw_y[4], yaw_x[4];
+    for (std::size_t j = 0; j < 4; ++j) {
+      RollArguments(quats[i + j], roll_y[j], roll_x[j]);
+      sin_pitch[j] = PitchArgument(quats[i + j]);
+      YawArguments(quats[i + j], yaw_y[j], yaw_x[j]);
+    }
+    if (roll) {
+      _mm_storeu_ps(roll + i,
+                    FastAtan2(_mm_loadu_ps(roll_y), _mm_loadu_ps(roll_x)));
+    }
+    if (pitch) {
+      _mm_storeu_ps(pitch + i, FastAsin(_mm_loadu_ps(sin_pitch)));
+    }
+    if (yaw) {
+      _mm_storeu_ps(yaw + i,
+                    FastAtan2(_mm_loadu_ps(yaw_y), _mm_loadu_ps(yaw_x)));
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    float y, x;
+    if (roll) {
+      RollArguments(quats[i], y, x);
+      roll[i] = FastAtan2(y, x);
+    }
+    if (pitch) {
+      pitch[i] = FastAsin(PitchArgument(quats[i]));
+    }
+    if (yaw) {
+      YawArguments(quats[i], y, x);
+      yaw[i] = FastAtan2(y, x);
+    }
+  }
+}
+
+RotationMatrix QuaternionToRotationMatrix(const myo::Quaternion<float>& quat) {
+  const float x = quat.x(), y = quat.y(), z = quat.z(), w = quat.w();
+  RotationMatrix matrix = {{w * w + x * x - y * y - z * z,
+                            2.f * (x * y - w * z),
+                            2.f * (x * z + w * y),
+                            2.f * (x * y + w * z),
+                            w * w - x * x + y * y - z * z,
+                            2.f * (y * z - w * x),
+                            2.f * (x * z - w * y),
+                            2.f * (y * z + w * x),
+                            w * w - x * x - y * y + z * z}};
+  return matrix;
+}
+
+myo::Vector3<float> Rotate(const RotationMatrix& matrix,
+                           const myo::Vector3<float>& vec) {
+  return myo::Vector3<float>(
+      matrix[0] * vec.x() + matrix[1] * vec.y() + matrix[2] * vec.z(),
+      matrix[3] * vec.x() + matrix[4] * vec.y() + matrix[5] * vec.z(),
+      matrix[6] * vec.x() + matrix[7] * vec.y() + matrix[8] * vec.z());
+}
+
+void RotateVectors(const RotationMatrix& matrix, const float* vectors,
+                   std::size_t count, float* rotated) {
+  std::size_t i = 0;
+#ifdef ORIENTATION_UTILITY_SSE2
+  __m128 m[9];
+  for (std::size_t j = 0; j < 9; ++j) {
+    m[j] = _mm_set1_ps(matrix[j]);
+  }
+  for (; i + 4 <= count; i += 4) {
+    __m128 x, y, z;
+    Deinterleave(_mm_loadu_ps(vectors + 3 * i),
+                 _mm_loadu_ps(vectors + 3 * i + 4),
+                 _mm_loadu_ps(vectors + 3 * i + 8), x, y, z);
+    __m128 rotated_x = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(m[0], x), _mm_mul_ps(m[1], y)),
+        _mm_mul_ps(m[2], z));
+    __m128 rotated_y = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(m[3], x), _mm_mul_ps(m[4], y)),
+        _mm_mul_ps(m[5], z));
+    __m128 rotated_z = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(m[6], x), _mm_mul_ps(m[7], y)),
+        _mm_mul_ps(m[8], z));
+    __m128 a, b, c;
+    Interleave(rotated_x, rotated_y, rotated_z, a, b, c);
+    _mm_storeu_ps(rotated + 3 * i, a);
+    _mm_storeu_ps(rotated + 3 * i + 4, b);
+    _mm_storeu_ps(rotated + 3 * i + 8, c);
+  }
+#endif
+  for (; i < count; ++i) {
+    const float x = vectors[3 * i], y = vectors[3 * i + 1],
+                z = vectors[3 * i + 2];
+    rotated[3 * i] = matrix[0] * x + matrix[1] * y + matrix[2] * z;
+    rotated[3 * i + 1] = matrix[3] * x + matrix[4] * y + matrix[5] * z;
+    rotated[3 * i + 2] = matrix[6] * x + matrix[7] * y + matrix[8] * z;
+  }
+}
+
 float RelativeOrientation(float start, float end) {
   float diff = end - start;
   if (diff > M_PI) {
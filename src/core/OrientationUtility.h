@@ -8,24 +8,70 @@
 /* for MSVC++ */
 #define _USE_MATH_DEFINES
 #include <cmath>
+#include <cstddef>
 #include <algorithm>
+#include <array>
 #include <functional>
 
 #include <myo/myo.hpp>
 
 namespace core {
 namespace OrientationUtility {
+enum class Precision { precise, fast };
+
 float QuaternionToRoll(const myo::Quaternion<float>& quat);
 
 float QuaternionToPitch(const myo::Quaternion<float>& quat);
 
 float QuaternionToYaw(const myo::Quaternion<float>& quat);
 
+// Polynomial approximations of std::atan2 and std::asin. The maximum absolute
+// error is FastTrigMaxError radians over the whole domain (measured at just
+// under 2e-6). Unlike std::atan2, FastAtan2(+-0, -0) returns +-0.
+const float FastTrigMaxError = 2.5e-6f;
+float FastAtan2(float y, float x);
+float FastAsin(float x);
+
+// Converts count quaternions to roll, pitch and yaw, which are written to
+// separate arrays. The fast path uses FastAtan2 and FastAsin, four quaternions
+// at a time with SSE2 where available. The precise path uses the standard
+// library and matches QuaternionToRoll/Pitch/Yaw exactly. Any of the output
+// arrays may be null if that angle isn't needed.
+void QuaternionsToRollPitchYaw(const myo::Quaternion<float>* quats,
+                               std::size_t count, float* roll, float* pitch,
+                               float* yaw,
+                               Precision precision = Precision::fast);
+
+// A 3x3 rotation matrix in row-major order.
+typedef std::array<float, 9> RotationMatrix;
+
+// The matrix M such that M * v == myo::rotate(quat, v). quat doesn't need to
+// be normalized, in which case the result is scaled by its squared norm just
+// like myo::rotate.
+RotationMatrix QuaternionToRotationMatrix(const myo::Quaternion<float>& quat);
+
+myo::Vector3<float> Rotate(const RotationMatrix& matrix,
+                           const myo::Vector3<float>& vec);
+
+// Rotates count vectors stored as consecutive x, y, z values, four vectors at
+// a time with SSE2 where available. vectors and rotated may be the same array.
+void RotateVectors(const RotationMatrix& matrix, const float* vectors,
+                   std::size_t count, float* rotated);
+
 float RelativeOrientation(float start, float end);
 
 float RelativeOrientation(
     const myo::Quaternion<float>& start, const myo::Quaternion<float>& end,
     const std::function<float(const myo::Quaternion<float>&)>&
         QuaternionConversion);
+
+// Same as above, but the conversion is called directly instead of through a
+// std::function, so it can be inlined.
+template <typename QuaternionConversion>
+float RelativeOrientation(const myo::Quaternion<float>& start,
+                          const myo::Quaternion<float>& end,
+                          QuaternionConversion conversion) {
+  return RelativeOrientation(conversion(start), conversion(end));
+}
 }
 }
@@ -58,6 +58,16 @@ std::string Pose::toString() const {
   }
 }
 
+std::shared_ptr<Pose> Pose::fromString(const std::string& name) {
+  for (int type = rest; type <= unknown; ++type) {
+    Pose pose(static_cast<Type>(type));
+    if (pose.toString() == name) {
+      return std::make_shared<Pose>(pose);
+    }
+  }
+  return nullptr;
+}
+
 std::ostream& operator<<(std::ostream& os, const Pose& pose) {
   return os << pose.toString();
 }
@@ -19,6 +19,10 @@ class Pose {
 
   virtual std::string toString() const;
 
+  // The Myo pose whose toString() is name, or nullptr if there is none, e.g.
+  // for features which name their own poses and use the Myo's where they can.
+  static std::shared_ptr<Pose> fromString(const std::string& name);
+
  private:
   Type type_;
 };
@@ -0,0 +1,200 @@
+#include "PoseSequenceAutomaton.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace core {
+namespace {
+// The subset of partially matched patterns, and the patterns completed on
+// entering the state.
+typedef std::pair<std::vector<std::size_t>, std::vector<std::size_t>>
+    StateKey;
+}
+
+const PoseSequenceAutomaton::State PoseSequenceAutomaton::start;
+
+PoseSequenceAutomaton::Pattern PoseSequenceAutomaton::ParsePattern(
+    const std::string& name, const std::string& sequence) {
+  Pattern pattern = {name, {}};
+  std::size_t begin = 0;
+  while (true) {
+    std::size_t end = sequence.find("->", begin);
+    std::istringstream tokens(sequence.substr(
+        begin, end == std::string::npos ? std::string::npos : end - begin));
+    Step step = {"", 0};
+    std::string within, extra;
+    if (!(tokens >> step.pose)) {
+      throw std::invalid_argument("Missing pose in pattern " + name + ".");
+    }
+    if (tokens >> within) {
+      if (within != "within" || !(tokens >> step.within_ms) ||
+          step.within_ms == 0 || tokens >> extra) {
+        throw std::invalid_argument("Invalid time limit in pattern " + name +
+                                    ".");
+      }
+    }
+    pattern.steps.push_back(step);
+    if (end == std::string::npos) {
+      return pattern;
+    }
+    begin = end + 2;
+  }
+}
+
+PoseSequenceAutomaton::PoseSequenceAutomaton(
+    const std::vector<Pattern>& patterns, std::size_t max_states)
+    : patterns_(patterns) {
+  // Number the poses and the time limits.
+  for (const Pattern& pattern : patterns_) {
+    if (pattern.steps.empty()) {
+      throw std::invalid_argument("Pattern " + pattern.name +
+                                  " has no steps.");
+    }
+    for (std::size_t i = 0; i < pattern.steps.size(); ++i) {
+      const Step& step = pattern.steps[i];
+      if (symbols_.count(step.pose) == 0) {
+        std::size_t index = symbols_.size();
+        symbols_[step.pose] = index;
+      }
+      if (i > 0 && step.within_ms > 0) {
+        limits_.push_back(step.within_ms * 1000);
+      }
+    }
+  }
+  num_symbols_ = symbols_.size() + 1;
+  std::sort(limits_.begin(), limits_.end());
+  limits_.erase(std::unique(limits_.begin(), limits_.end()), limits_.end());
+  const std::size_t num_intervals = limits_.size() + 1;
+
+  // A partial match is numbered by its pattern and the number of steps
+  // matched so far, from 1 up to one less than the length of the pattern.
+  std::vector<std::size_t> first_item;
+  std::vector<std::pair<std::size_t, std::size_t>> items;
+  for (std::size_t p = 0; p < patterns_.size(); ++p) {
+    first_item.push_back(items.size());
+    for (std::size_t matched = 1; matched < patterns_[p].steps.size();
+         ++matched) {
+      items.push_back(std::make_pair(p, matched));
+    }
+  }
+  // Whether a step is satisfied by a symbol and time interval.
+  auto satisfied = [&](const Step& step, std::size_t symbol,
+                       std::size_t interval, bool first) {
+    if (symbols_.at(step.pose) != symbol) {
+      return false;
+    }
+    if (first || step.within_ms == 0) {
+      return true;
+    }
+    std::size_t limit =
+        std::lower_bound(limits_.begin(), limits_.end(),
+                         step.within_ms * 1000) -
+        limits_.begin();
+    return interval <= limit;
+  };
+
+  // Subset construction, numbering the states in the order they are found.
+  std::map<StateKey, State> states;
+  std::vector<StateKey> keys(1);
+  states[keys[0]] = start;
+  for (State state = 0; state < keys.size(); ++state) {
+    const std::vector<std::size_t> current = keys[state].first;
+    matches_.push_back(keys[state].second);
+    partial_matches_.push_back(std::vector<PartialMatch>());
+    for (std::size_t item : current) {
+      PartialMatch partial_match = {items[item].first, items[item].second};
+      partial_matches_.back().push_back(partial_match);
+    }
+    for (std::size_t symbol = 0; symbol < num_symbols_; ++symbol) {
+      for (std::size_t interval = 0; interval < num_intervals; ++interval) {
+        StateKey key;
+        // Every pose can start a pattern.
+        for (std::size_t p = 0; p < patterns_.size(); ++p) {
+          if (satisfied(patterns_[p].steps[0], symbol, interval, true)) {
+            if (patterns_[p].steps.size() == 1) {
+              key.second.push_back(p);
+            } else {
+              key.first.push_back(first_item[p]);
+            }
+          }
+        }
+        for (std::size_t item : current) {
+          std::size_t p = items[item].first, matched = items[item].second;
+          if (satisfied(patterns_[p].steps[matched], symbol, interval,
+                        false)) {
+            if (matched + 1 == patterns_[p].steps.size()) {
+              key.second.push_back(p);
+            } else {
+              key.first.push_back(item + 1);
+            }
+          }
+        }
+        std::sort(key.first.begin(), key.first.end());
+        std::sort(key.second.begin(), key.second.end());
+        key.second.erase(std::unique(key.second.begin(), key.second.end()),
+                         key.second.end());
+        auto found = states.find(key);
+        if (found == states.end()) {
+          if (keys.size() == max_states) {
+            throw std::runtime_error("Too many pose sequence states.");
+          }
+          found = states.insert(std::make_pair(key, keys.size())).first;
+          keys.push_back(key);
+        }
+        next_.push_back(found->second);
+      }
+    }
+  }
+}
+
+std::size_t PoseSequenceAutomaton::symbol(const std::string& pose) const {
+  auto found = symbols_.find(pose);
+  return found == symbols_.end() ? num_symbols_ - 1 : found->second;
+}
+
+PoseSequenceAutomaton::State PoseSequenceAutomaton::next(
+    State state, std::size_t symbol, uint64_t elapsed_us) const {
+  return next_[(state * num_symbols_ + symbol) * (limits_.size() + 1) +
+               Interval(elapsed_us)];
+}
+
+const std::vector<std::size_t>& PoseSequenceAutomaton::matches(
+    State state) const {
+  return matches_[state];
+}
+
+bool PoseSequenceAutomaton::partial(State state) const {
+  return !partial_matches_[state].empty();
+}
+
+const std::vector<PoseSequenceAutomaton::PartialMatch>&
+PoseSequenceAutomaton::partialMatches(State state) const {
+  return partial_matches_[state];
+}
+
+std::size_t PoseSequenceAutomaton::numStates() const {
+  return matches_.size();
+}
+
+std::size_t PoseSequenceAutomaton::numPatterns() const {
+  return patterns_.size();
+}
+
+const PoseSequenceAutomaton::Pattern& PoseSequenceAutomaton::pattern(
+    std::size_t index) const {
+  return patterns_[index];
+}
+
+std::size_t PoseSequenceAutomaton::Interval(uint64_t elapsed_us) const {
+  // There are only as many limits as distinct time limits in the patterns, so
+  // a linear search is cheaper than a binary search in practice.
+  std::size_t interval = 0;
+  while (interval < limits_.size() && elapsed_us > limits_[interval]) {
+    ++interval;
+  }
+  return interval;
+}
+}
@@ -0,0 +1,91 @@
+/* A deterministic automaton which finds pose sequence patterns in a stream of
+ * poses. A pattern is a list of poses which have to occur consecutively, each
+ * optionally within a maximum time after the previous one, e.g.
+ * "fist -> waveIn within 400 -> rest".
+ *
+ * All patterns are compiled into a single automaton by subset construction,
+ * so the work per pose doesn't depend on the number of patterns. Timing
+ * constraints are handled by splitting the time since the previous pose into
+ * intervals at every distinct limit used by a pattern, so a transition is
+ * taken on a pair of pose and interval and the automaton stays deterministic.
+ * The states are numbered densely, with the transitions in one flat table.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace core {
+class PoseSequenceAutomaton {
+ public:
+  struct Step {
+    std::string pose;
+    // The maximum time since the previous pose in milliseconds, or 0 if there
+    // is no limit. Ignored for the first step.
+    uint64_t within_ms;
+  };
+
+  struct Pattern {
+    std::string name;
+    std::vector<Step> steps;
+  };
+
+  // A pattern of which the first matched steps have been matched, with the
+  // step at index matched still to come.
+  struct PartialMatch {
+    std::size_t pattern, matched;
+  };
+
+  typedef std::size_t State;
+  static const State start = 0;
+
+  // Parses poses separated by "->", each optionally followed by "within" and
+  // a time in milliseconds, e.g. "fist -> waveIn within 400 -> rest". Throws
+  // std::invalid_argument if sequence isn't of this form.
+  static Pattern ParsePattern(const std::string& name,
+                              const std::string& sequence);
+
+  // Throws std::invalid_argument if a pattern has no steps, or
+  // std::runtime_error if the automaton would have more than max_states
+  // states.
+  PoseSequenceAutomaton(const std::vector<Pattern>& patterns,
+                        std::size_t max_states = 1 << 16);
+
+  // The symbol of a pose for next. All poses that don't occur in any pattern
+  // share one symbol.
+  std::size_t symbol(const std::string& pose) const;
+  // The state after a pose with the given symbol, which was entered
+  // elapsed_us microseconds after the previous pose.
+  State next(State state, std::size_t symbol, uint64_t elapsed_us) const;
+  // The indices of the patterns which are completed by entering state.
+  const std::vector<std::size_t>& matches(State state) const;
+  // Whether state is partway through at least one pattern, i.e. whether the
+  // last pose might still become part of a match.
+  bool partial(State state) const;
+  // The patterns state is partway through.
+  const std::vector<PartialMatch>& partialMatches(State state) const;
+
+  std::size_t numStates() const;
+  std::size_t numPatterns() const;
+  const Pattern& pattern(std::size_t index) const;
+
+ private:
+  // The interval of the time since the previous pose.
+  std::size_t Interval(uint64_t elapsed_us) const;
+
+  const std::vector<Pattern> patterns_;
+  std::unordered_map<std::string, std::size_t> symbols_;
+  std::size_t num_symbols_;
+  // Distinct time limits in microseconds, in increasing order. Interval i
+  // holds the times greater than limits_[i - 1] and at most limits_[i].
+  std::vector<uint64_t> limits_;
+  // next_[(state * num_symbols_ + symbol) * (limits_.size() + 1) + interval]
+  std::vector<State> next_;
+  std::vector<std::vector<std::size_t>> matches_;
+  std::vector<std::vector<PartialMatch>> partial_matches_;
+};
+}
@@ -0,0 +1,383 @@
+#include "QuantizedNetwork.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define QUANTIZED_NETWORK_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+#define QUANTIZED_NETWORK_AVX512VNNI
+#include <immintrin.h>
+#elif defined(__AVXVNNI__)
+#define QUANTIZED_NETWORK_AVXVNNI
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define QUANTIZED_NETWORK_AVX2
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define QUANTIZED_NETWORK_NEON
+#include <arm_neon.h>
+#endif
+
+namespace core {
+namespace {
+const char magic[4] = {'M', 'I', 'Q', 'N'};
+const uint32_t version = 1;
+const std::size_t alignment = 32;
+const std::size_t headerSize = 32;
+
+std::size_t Align(std::size_t size) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+void WriteUint32(std::ostream& os, uint32_t value) {
+  unsigned char bytes[4] = {
+      static_cast<unsigned char>(value), static_cast<unsigned char>(value >> 8),
+      static_cast<unsigned char>(value >> 16),
+      static_cast<unsigned char>(value >> 24)};
+  os.write(reinterpret_cast<const char*>(bytes), 4);
+}
+
+void WriteFloat(std::ostream& os, float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  WriteUint32(os, bits);
+}
+
+void WritePadding(std::ostream& os, std::size_t size) {
+  for (std::size_t i = size; i < Align(size); ++i) {
+    os.put(0);
+  }
+}
+
+// Reads the n-th 32 bit value of a header. Model files are little endian, as
+// are all of the platforms the Myo runs on.
+template <typename T>
+T ReadField(const char* header, std::size_t n) {
+  T value;
+  std::memcpy(&value, header + 4 * n, sizeof(value));
+  return value;
+}
+
+// Dot product of size values, where size is a multiple of 32. The weights
+// must be in [-127, 127], so that the sign of the activations can be moved
+// onto them for the unsigned by signed multiplies of x86.
+int32_t Dot(const int8_t* weights, const int8_t* activations,
+            std::size_t size) {
+#if defined(QUANTIZED_NETWORK_AVX512VNNI) || \
+    defined(QUANTIZED_NETWORK_AVXVNNI) || defined(QUANTIZED_NETWORK_AVX2)
+  __m256i sum = _mm256_setzero_si256();
+#ifdef QUANTIZED_NETWORK_AVX2
+  const __m256i ones = _mm256_set1_epi16(1);
+#endif
+  for (std::size_t i = 0; i < size; i += 32) {
+    __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+    __m256i a =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(activations + i));
+    __m256i unsigned_a = _mm256_abs_epi8(a);
+    __m256i signed_w = _mm256_sign_epi8(w, a);
+#if defined(QUANTIZED_NETWORK_AVX512VNNI)
+    sum = _mm256_dpbusd_epi32(sum, unsigned_a, signed_w);
+#elif defined(QUANTIZED_NETWORK_AVXVNNI)
+    sum = _mm256_dpbusd_avx_epi32(sum, unsigned_a, signed_w);
+#else
+    // Pairs of products are at most 2 * 128 * 127, so they don't saturate.
+    __m256i pairs = _mm256_maddubs_epi16(unsigned_a, signed_w);
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(pairs, ones));
+#endif
+  }
+  __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                                 _mm256_extracti128_si256(sum, 1));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4e));
+  sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xb1));
+  return _mm_cvtsi128_si32(sum128);
+#elif defined(QUANTIZED_NETWORK_NEON)
+  int32x4_t sum = vdupq_n_s32(0);
+  for (std::size_t i = 0; i < size; i += 16) {
+    int8x16_t w = vld1q_s8(weights + i);
+    int8x16_t a = vld1q_s8(activations + i);
+#ifdef __ARM_FEATURE_DOTPROD
+    sum = vdotq_s32(sum, w, a);
+#else
+    sum = vpadalq_s16(sum, vmull_s8(vget_low_s8(w), vget_low_s8(a)));
+    sum = vpadalq_s16(sum, vmull_s8(vget_high_s8(w), vget_high_s8(a)));
+#endif
+  }
+  int32x2_t pair = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+  return vget_lane_s32(vpadd_s32(pair, pair), 0);
+#else
+  int32_t sum = 0;
+  for (std::size_t i = 0; i < size; ++i) {
+    sum += weights[i] * activations[i];
+  }
+  return sum;
+#endif
+}
+}
+
+void QuantizedNetwork::Write(std::ostream& os, uint32_t input_length,
+                             uint32_t input_channels, float input_scale,
+                             const std::vector<LayerSpec>& layers) {
+  os.write(magic, 4);
+  WriteUint32(os, version);
+  WriteUint32(os, static_cast<uint32_t>(layers.size()));
+  WriteUint32(os, input_length);
+  WriteUint32(os, input_channels);
+  WriteFloat(os, input_scale);
+  WritePadding(os, 24);
+  for (const auto& layer : layers) {
+    const std::size_t row_size = layer.kernel_size * layer.in_channels;
+    if (layer.weights.size() != layer.out_channels * row_size ||
+        layer.biases.size() != layer.out_channels ||
+        layer.weight_scales.size() != layer.out_channels) {
+      throw std::invalid_argument("Inconsistent quantized layer.");
+    }
+    WriteUint32(os, static_cast<uint32_t>(layer.type));
+    WriteUint32(os, static_cast<uint32_t>(layer.activation));
+    WriteUint32(os, layer.in_channels);
+    WriteUint32(os, layer.out_channels);
+    WriteUint32(os, layer.kernel_size);
+    WriteUint32(os, layer.stride);
+    WriteFloat(os, layer.output_scale);
+    WritePadding(os, 28);
+    for (std::size_t o = 0; o < layer.out_channels; ++o) {
+      os.write(reinterpret_cast<const char*>(&layer.weights[o * row_size]),
+               row_size);
+      WritePadding(os, row_size);
+    }
+    for (int32_t bias : layer.biases) {
+      WriteUint32(os, static_cast<uint32_t>(bias));
+    }
+    for (float scale : layer.weight_scales) {
+      WriteFloat(os, scale);
+    }
+    WritePadding(os, 8 * layer.out_channels);
+  }
+}
+
+std::unique_ptr<QuantizedNetwork> QuantizedNetwork::Load(
+    const std::string& path) {
+  std::unique_ptr<QuantizedNetwork> network(new QuantizedNetwork());
+#ifdef QUANTIZED_NETWORK_MMAP
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Can't open " + path);
+  }
+  struct stat st;
+  void* mapping = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::runtime_error("Can't map " + path);
+  }
+  network->mapping_ = mapping;
+  network->mapping_size_ = st.st_size;
+  network->Parse(static_cast<const char*>(mapping), st.st_size);
+  return network;
+#else
+  std::ifstream is(path, std::ios::binary);
+  if (!is) {
+    throw std::runtime_error("Can't open " + path);
+  }
+  return Load(is);
+#endif
+}
+
+std::unique_ptr<QuantizedNetwork> QuantizedNetwork::Load(std::istream& is) {
+  std::unique_ptr<QuantizedNetwork> network(new QuantizedNetwork());
+  std::vector<char> contents((std::istreambuf_iterator<char>(is)),
+                             std::istreambuf_iterator<char>());
+  // Copy to an aligned position so that the weights are aligned too.
+  network->buffer_.resize(contents.size() + alignment);
+  char* data = network->buffer_.data();
+  data += (alignment - reinterpret_cast<uintptr_t>(data) % alignment) %
+          alignment;
+  std::copy(contents.begin(), contents.end(), data);
+  network->Parse(data, contents.size());
+  return network;
+}
+
+QuantizedNetwork::QuantizedNetwork()
+    : input_length_(0), input_channels_(0), mapping_(nullptr),
+      mapping_size_(0) {}
+
+QuantizedNetwork::~QuantizedNetwork() {
+#ifdef QUANTIZED_NETWORK_MMAP
+  if (mapping_) {
+    munmap(mapping_, mapping_size_);
+  }
+#endif
+}
+
+std::size_t QuantizedNetwork::inputLength() const { return input_length_; }
+
+std::size_t QuantizedNetwork::inputChannels() const { return input_channels_; }
+
+std::size_t QuantizedNetwork::numOutputs() const { return outputs_.size(); }
+
+const char* QuantizedNetwork::kernelName() {
+#if defined(QUANTIZED_NETWORK_AVX512VNNI)
+  return "AVX512-VNNI";
+#elif defined(QUANTIZED_NETWORK_AVXVNNI)
+  return "AVX-VNNI";
+#elif defined(QUANTIZED_NETWORK_AVX2)
+  return "AVX2";
+#elif defined(QUANTIZED_NETWORK_NEON)
+  return "NEON";
+#else
+  return "scalar";
+#endif
+}
+
+void QuantizedNetwork::Parse(const char* data, std::size_t size) {
+  if (size < headerSize || std::memcmp(data, magic, 4) != 0) {
+    throw std::runtime_error("Not a quantized network model file.");
+  }
+  if (ReadField<uint32_t>(data, 1) != version) {
+    throw std::runtime_error("Unsupported quantized network model version.");
+  }
+  const std::size_t num_layers = ReadField<uint32_t>(data, 2);
+  input_length_ = ReadField<uint32_t>(data, 3);
+  input_channels_ = ReadField<uint32_t>(data, 4);
+  float scale = ReadField<float>(data, 5);
+  if (num_layers == 0 || input_length_ == 0 || input_channels_ == 0) {
+    throw std::runtime_error("Empty quantized network model.");
+  }
+
+  std::size_t offset = headerSize;
+  std::size_t length = input_length_, channels = input_channels_;
+  std::size_t buffer_size = length * channels, max_row_size = 0;
+  for (std::size_t l = 0; l < num_layers; ++l) {
+    if (offset + headerSize > size) {
+      throw std::runtime_error("Truncated quantized network model.");
+    }
+    const char* header = data + offset;
+    offset += headerSize;
+    Layer layer;
+    layer.type = ReadField<LayerType>(header, 0);
+    layer.activation = ReadField<Activation>(header, 1);
+    layer.in_channels = ReadField<uint32_t>(header, 2);
+    layer.out_channels = ReadField<uint32_t>(header, 3);
+    layer.kernel_size = ReadField<uint32_t>(header, 4);
+    layer.stride = ReadField<uint32_t>(header, 5);
+    float output_scale = ReadField<float>(header, 6);
+
+    if (layer.type == LayerType::dense) {
+      // A dense layer is a convolution over the flattened input.
+      channels *= length;
+      length = 1;
+      layer.kernel_size = layer.stride = 1;
+    } else if (layer.type != LayerType::conv1d) {
+      throw std::runtime_error("Unknown quantized network layer type.");
+    }
+    if (layer.in_channels != channels || layer.out_channels == 0 ||
+        layer.kernel_size == 0 || layer.kernel_size > length ||
+        layer.stride == 0) {
+      throw std::runtime_error("Inconsistent quantized network layer.");
+    }
+    layer.input_length = length;
+    layer.output_length = (length - layer.kernel_size) / layer.stride + 1;
+    layer.row_size = layer.kernel_size * layer.in_channels;
+    layer.padded_row_size = Align(layer.row_size);
+
+    const std::size_t weights_size = layer.out_channels * layer.padded_row_size;
+    const std::size_t tail_size = Align(8 * layer.out_channels);
+    if (offset + weights_size + tail_size > size) {
+      throw std::runtime_error("Truncated quantized network model.");
+    }
+    layer.weights = reinterpret_cast<const int8_t*>(data + offset);
+    if (std::find(layer.weights, layer.weights + weights_size, -128) !=
+        layer.weights + weights_size) {
+      throw std::runtime_error("Quantized weights must be in [-127, 127].");
+    }
+    // The padding is multiplied with whatever follows the activations, so it
+    // has to be zero for the outputs to be right.
+    for (std::size_t o = 0; o < layer.out_channels; ++o) {
+      const int8_t* row = layer.weights + o * layer.padded_row_size;
+      if (std::find_if(row + layer.row_size, row + layer.padded_row_size,
+                       [](int8_t weight) { return weight != 0; }) !=
+          row + layer.padded_row_size) {
+        throw std::runtime_error(
+            "Quantized network weight rows must be zero padded.");
+      }
+    }
+    offset += weights_size;
+    layer.biases = reinterpret_cast<const int32_t*>(data + offset);
+    const char* weight_scales = data + offset + 4 * layer.out_channels;
+    offset += tail_size;
+
+    // Hidden layers requantize to their output scale, the last layer
+    // dequantizes to real values.
+    const bool last = l + 1 == num_layers;
+    for (std::size_t o = 0; o < layer.out_channels; ++o) {
+      float weight_scale = ReadField<float>(weight_scales, o);
+      layer.multipliers.push_back(scale * weight_scale /
+                                  (last ? 1.f : output_scale));
+    }
+    scale = output_scale;
+    length = layer.output_length;
+    channels = layer.out_channels;
+    buffer_size = std::max(buffer_size, length * channels);
+    max_row_size = std::max(max_row_size, layer.padded_row_size);
+    layers_.push_back(layer);
+  }
+
+  // Rows of zero padded weights may read up to a padded row past the end of
+  // the activations.
+  for (auto& activations : activations_) {
+    activations.assign(buffer_size + max_row_size, 0);
+  }
+  outputs_.resize(length * channels);
+}
+
+const float* QuantizedNetwork::infer(const int8_t* input) {
+  std::copy(input, input + input_length_ * input_channels_,
+            activations_[0].begin());
+  for (std::size_t l = 0; l < layers_.size(); ++l) {
+    const Layer& layer = layers_[l];
+    const int8_t* in = activations_[l % 2].data();
+    int8_t* out = activations_[(l + 1) % 2].data();
+    const bool last = l + 1 == layers_.size();
+    const int low = layer.activation == Activation::relu ? 0 : -128;
+    for (std::size_t t = 0; t < layer.output_length; ++t) {
+      const int8_t* window = in + t * layer.stride * layer.in_channels;
+      for (std::size_t o = 0; o < layer.out_channels; ++o) {
+        int32_t sum = Dot(layer.weights + o * layer.padded_row_size, window,
+                          layer.padded_row_size) +
+                      layer.biases[o];
+        float value = sum * layer.multipliers[o];
+        if (last) {
+          if (layer.activation == Activation::relu) {
+            value = std::max(0.f, value);
+          }
+          outputs_[t * layer.out_channels + o] = value;
+        } else {
+          value = std::max(static_cast<float>(low), std::min(127.f, value));
+          out[t * layer.out_channels + o] =
+              static_cast<int8_t>(std::floor(value + 0.5f));
+        }
+      }
+    }
+  }
+  return outputs_.data();
+}
+
+std::size_t QuantizedNetwork::classify(const int8_t* input) {
+  const float* outputs = infer(input);
+  return std::max_element(outputs, outputs + outputs_.size()) - outputs;
+}
+}
@@ -0,0 +1,106 @@
+/* A small inference engine for quantized neural networks made of 1-D
+ * convolution and fully connected layers, for classifying windows of raw EMG
+ * data. Weights and activations are 8 bit integers with a real value scale
+ * (per output channel for weights, per layer for activations), dot products
+ * are accumulated in 32 bit integers and requantized with a fused ReLU. The
+ * last layer's outputs are dequantized to floats instead.
+ *
+ * Activations are stored time major, so the receptive field of a convolution
+ * output and the input of a fully connected layer are both one contiguous
+ * run of values, and every output is a single dot product with a row of
+ * weights. Rows are zero padded to a multiple of 32 values for the SIMD dot
+ * products (AVX-VNNI / AVX512-VNNI, AVX2, NEON, or scalar, chosen at compile
+ * time). All activation buffers are allocated when the model is loaded.
+ *
+ * Model files are little endian and laid out so that they can be used in
+ * place when memory mapped: a header, then for every layer a header followed
+ * by its 32 byte aligned weight rows, biases and weight scales. Load memory
+ * maps the file where available and reads it into memory otherwise.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace core {
+class QuantizedNetwork {
+ public:
+  enum class LayerType : uint32_t { dense = 0, conv1d = 1 };
+  enum class Activation : uint32_t { none = 0, relu = 1 };
+
+  // The description of a layer, used to write model files.
+  struct LayerSpec {
+    LayerType type;
+    Activation activation;
+    // A dense layer treats its whole input as in_channels values and has a
+    // kernel_size and stride of one.
+    uint32_t in_channels, out_channels, kernel_size, stride;
+    // The real value of one unit of the layer's output.
+    float output_scale;
+    // out_channels rows of kernel_size * in_channels weights, in the same time
+    // major order as the input.
+    std::vector<int8_t> weights;
+    // In units of input scale * weight scale.
+    std::vector<int32_t> biases;
+    std::vector<float> weight_scales;
+  };
+
+  // Writes a model taking input_length samples of input_channels values, each
+  // unit of which has the real value input_scale.
+  static void Write(std::ostream& os, uint32_t input_length,
+                    uint32_t input_channels, float input_scale,
+                    const std::vector<LayerSpec>& layers);
+
+  // Throws std::runtime_error if the file can't be read or isn't a valid
+  // model.
+  static std::unique_ptr<QuantizedNetwork> Load(const std::string& path);
+  static std::unique_ptr<QuantizedNetwork> Load(std::istream& is);
+
+  ~QuantizedNetwork();
+
+  std::size_t inputLength() const;
+  std::size_t inputChannels() const;
+  std::size_t numOutputs() const;
+
+  // Runs the network on inputLength() * inputChannels() time major values and
+  // returns numOutputs() dequantized outputs. Doesn't allocate.
+  const float* infer(const int8_t* input);
+  // Returns the index of the largest output.
+  std::size_t classify(const int8_t* input);
+
+  // The name of the dot product kernel this build uses.
+  static const char* kernelName();
+
+ private:
+  struct Layer {
+    LayerType type;
+    Activation activation;
+    std::size_t in_channels, out_channels, kernel_size, stride;
+    std::size_t input_length, output_length, row_size, padded_row_size;
+    const int8_t* weights;
+    const int32_t* biases;
+    std::vector<float> multipliers;
+  };
+
+  QuantizedNetwork();
+  // Parses the model at data, which must stay valid and be 32 byte aligned.
+  void Parse(const char* data, std::size_t size);
+
+  std::size_t input_length_, input_channels_;
+  std::vector<Layer> layers_;
+  // The model when it was read into memory, over-allocated for alignment.
+  std::vector<char> buffer_;
+  // The model when it was memory mapped.
+  void* mapping_;
+  std::size_t mapping_size_;
+  // Ping-pong activation buffers with room for reading a padded row past the
+  // end, and the outputs of the last layer.
+  std::vector<int8_t> activations_[2];
+  std::vector<float> outputs_;
+};
+}
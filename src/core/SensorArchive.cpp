@@ -0,0 +1,438 @@
+#include "SensorArchive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+
+#include "ColumnCodec.h"
+
+namespace core {
+namespace SensorArchive {
+namespace {
+const char magic[4] = {'M', 'I', 'S', 'A'};
+const char segmentMagic[4] = {'M', 'I', 'S', 'G'};
+const char snapshotMagic[4] = {'M', 'I', 'S', 'S'};
+const char indexMagic[4] = {'M', 'I', 'S', 'I'};
+const char footerMagic[4] = {'M', 'I', 'S', 'E'};
+const uint32_t version = 2;
+// Every chunk starts with its magic and the size of the rest of it.
+const std::size_t chunkHeaderSize = 8;
+const std::size_t segmentHeaderSize = 32;
+const std::size_t snapshotHeaderSize = 16;
+const std::size_t footerSize = 16;
+// The index holds the timestamps and offset of each segment, and the
+// timestamp and offset of each snapshot.
+const std::size_t segmentEntrySize = 24;
+const std::size_t snapshotEntrySize = 16;
+// A block of a stream of width 3 without samples: its header, the minimum and
+// maximum of each column and the size of its payload.
+const std::size_t minBlockSize = 24 + 2 * 3 * sizeof(float) + 4;
+// Chunks larger than this are assumed to be corrupt rather than allocated.
+const uint32_t maxChunkSize = 1 << 30;
+
+template <typename T>
+void Append(std::vector<char>& buffer, T value) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(value));
+}
+
+template <typename T>
+void Overwrite(std::vector<char>& buffer, std::size_t offset, T value) {
+  std::memcpy(buffer.data() + offset, &value, sizeof(value));
+}
+
+std::runtime_error Corrupt() {
+  return std::runtime_error("Corrupt or truncated archive segment.");
+}
+
+// Reads the magic and size of the next chunk, and returns false at the end
+// of the archive.
+bool ReadChunkHeader(std::istream& is, char* magic, uint32_t& size) {
+  char header[chunkHeaderSize];
+  is.read(header, sizeof(header));
+  if (is.gcount() == 0 && is.eof()) {
+    return false;
+  }
+  if (is.gcount() != sizeof(header)) {
+    throw Corrupt();
+  }
+  std::memcpy(magic, header, 4);
+  std::memcpy(&size, header + 4, sizeof(size));
+  if (size > maxChunkSize) {
+    throw Corrupt();
+  }
+  return true;
+}
+
+bool IsChunk(const char* magic, const char* expected) {
+  return std::memcmp(magic, expected, 4) == 0;
+}
+
+template <typename T>
+T Get(const char*& data, const char* end) {
+  if (static_cast<std::size_t>(end - data) < sizeof(T)) {
+    throw Corrupt();
+  }
+  T value;
+  std::memcpy(&value, data, sizeof(value));
+  data += sizeof(value);
+  return value;
+}
+
+template <typename T>
+void AppendStatistics(const std::vector<T>& values, std::size_t width,
+                      std::vector<char>& buffer) {
+  const std::size_t count = values.size() / width;
+  for (int max = 0; max < 2; ++max) {
+    for (std::size_t column = 0; column < width; ++column) {
+      T value = values[column];
+      for (std::size_t i = 1; i < count; ++i) {
+        T v = values[i * width + column];
+        value = max ? std::max(value, v) : std::min(value, v);
+      }
+      Append<float>(buffer, static_cast<float>(value));
+    }
+  }
+}
+}
+
+std::size_t Width(Stream stream) {
+  switch (stream) {
+    case Stream::emg:
+      return 8;
+    case Stream::orientation:
+      return 4;
+    case Stream::acceleration:
+    case Stream::gyro:
+      return 3;
+  }
+  throw std::invalid_argument("Unknown stream.");
+}
+
+void WriteHeader(std::ostream& os) {
+  os.write(magic, sizeof(magic));
+  os.write(reinterpret_cast<const char*>(&version), sizeof(version));
+}
+
+void ReadHeader(std::istream& is) {
+  char header[8];
+  is.read(header, sizeof(header));
+  uint32_t file_version;
+  std::memcpy(&file_version, header + 4, sizeof(file_version));
+  if (is.gcount() != sizeof(header) ||
+      std::memcmp(header, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("Not a sensor archive.");
+  }
+  if (file_version != version) {
+    throw std::runtime_error("Unsupported sensor archive version.");
+  }
+}
+
+std::size_t WriteSegment(std::ostream& os, const Segment& segment,
+                         std::vector<char>& buffer) {
+  buffer.assign(segmentHeaderSize, 0);
+  uint32_t num_blocks = 0;
+  uint64_t first_timestamp = std::numeric_limits<uint64_t>::max();
+  uint64_t last_timestamp = 0;
+  for (const Block& block : segment.blocks) {
+    const std::size_t count = block.size();
+    const std::size_t width = Width(block.stream);
+    const bool emg = block.stream == Stream::emg;
+    if (count == 0) {
+      continue;
+    }
+    if ((emg ? block.emg.size() : block.values.size()) != count * width) {
+      throw std::invalid_argument("The block has the wrong number of values.");
+    }
+    ++num_blocks;
+    first_timestamp = std::min(first_timestamp, block.timestamps.front());
+    last_timestamp = std::max(last_timestamp, block.timestamps.back());
+
+    Append<uint8_t>(buffer, static_cast<uint8_t>(block.stream));
+    Append<uint8_t>(buffer, 0);
+    Append<uint16_t>(buffer, block.device);
+    Append<uint32_t>(buffer, static_cast<uint32_t>(count));
+    Append<uint64_t>(buffer, block.timestamps.front());
+    Append<uint64_t>(buffer, block.timestamps.back());
+    if (emg) {
+      AppendStatistics(block.emg, width, buffer);
+    } else {
+      AppendStatistics(block.values, width, buffer);
+    }
+    const std::size_t size_offset = buffer.size();
+    Append<uint32_t>(buffer, 0);
+    ColumnCodec::EncodeTimestamps(block.timestamps.data(), count, buffer);
+    for (std::size_t column = 0; column < width; ++column) {
+      if (emg) {
+        ColumnCodec::EncodeInt8(block.emg.data() + column, count, width,
+                                buffer);
+      } else {
+        ColumnCodec::EncodeFloats(block.values.data() + column, count, width,
+                                  buffer);
+      }
+    }
+    Overwrite<uint32_t>(buffer, size_offset,
+                        buffer.size() - size_offset - sizeof(uint32_t));
+  }
+  if (num_blocks == 0) {
+    return 0;
+  }
+
+  std::memcpy(buffer.data(), segmentMagic, sizeof(segmentMagic));
+  Overwrite<uint32_t>(buffer, 4, buffer.size() - chunkHeaderSize);
+  Overwrite<uint32_t>(buffer, 8, num_blocks);
+  Overwrite<uint64_t>(buffer, 16, first_timestamp);
+  Overwrite<uint64_t>(buffer, 24, last_timestamp);
+  os.write(buffer.data(), buffer.size());
+  return buffer.size();
+}
+
+std::size_t WriteSnapshot(std::ostream& os, uint64_t timestamp,
+                          const FeatureState& snapshot) {
+  const std::vector<char>& data = snapshot.data();
+  std::vector<char> header;
+  header.insert(header.end(), snapshotMagic,
+                snapshotMagic + sizeof(snapshotMagic));
+  Append<uint32_t>(header, static_cast<uint32_t>(
+                               snapshotHeaderSize - chunkHeaderSize +
+                               data.size()));
+  Append<uint64_t>(header, timestamp);
+  os.write(header.data(), header.size());
+  os.write(data.data(), data.size());
+  return header.size() + data.size();
+}
+
+void WriteIndex(std::ostream& os, const Index& index, uint64_t offset) {
+  std::vector<char> buffer(indexMagic, indexMagic + sizeof(indexMagic));
+  Append<uint32_t>(buffer, 0);
+  Append<uint32_t>(buffer, static_cast<uint32_t>(index.segments.size()));
+  Append<uint32_t>(buffer, static_cast<uint32_t>(index.snapshots.size()));
+  for (const Index::SegmentEntry& entry : index.segments) {
+    Append<uint64_t>(buffer, entry.first_timestamp);
+    Append<uint64_t>(buffer, entry.last_timestamp);
+    Append<uint64_t>(buffer, entry.offset);
+  }
+  for (const Index::SnapshotEntry& entry : index.snapshots) {
+    Append<uint64_t>(buffer, entry.timestamp);
+    Append<uint64_t>(buffer, entry.offset);
+  }
+  Overwrite<uint32_t>(buffer, 4, buffer.size() - chunkHeaderSize);
+
+  buffer.insert(buffer.end(), footerMagic, footerMagic + sizeof(footerMagic));
+  Append<uint32_t>(buffer, footerSize - chunkHeaderSize);
+  Append<uint64_t>(buffer, offset);
+  os.write(buffer.data(), buffer.size());
+}
+
+bool ReadSegment(std::istream& is, Segment& segment,
+                 std::vector<char>& buffer) {
+  char magic[4];
+  uint32_t size;
+  while (true) {
+    if (!ReadChunkHeader(is, magic, size)) {
+      return false;
+    }
+    if (IsChunk(magic, segmentMagic)) {
+      break;
+    }
+    if (!IsChunk(magic, snapshotMagic) && !IsChunk(magic, indexMagic) &&
+        !IsChunk(magic, footerMagic)) {
+      throw Corrupt();
+    }
+    // Skipped, including the index and footer, so that reading on at the end
+    // keeps returning false.
+    is.ignore(size);
+    if (static_cast<uint32_t>(is.gcount()) != size) {
+      throw Corrupt();
+    }
+    if (!IsChunk(magic, snapshotMagic)) {
+      return false;
+    }
+  }
+  buffer.resize(size);
+  is.read(buffer.data(), size);
+  if (static_cast<uint32_t>(is.gcount()) != size) {
+    throw Corrupt();
+  }
+
+  const char* position = buffer.data();
+  const char* end = buffer.data() + size;
+  uint32_t num_blocks = Get<uint32_t>(position, end);
+  Get<uint32_t>(position, end);
+  segment.first_timestamp = Get<uint64_t>(position, end);
+  segment.last_timestamp = Get<uint64_t>(position, end);
+  if (num_blocks > static_cast<std::size_t>(end - position) / minBlockSize) {
+    throw Corrupt();
+  }
+  segment.blocks.resize(num_blocks);
+  for (Block& block : segment.blocks) {
+    uint8_t stream = Get<uint8_t>(position, end);
+    if (stream > static_cast<uint8_t>(Stream::gyro)) {
+      throw Corrupt();
+    }
+    block.stream = static_cast<Stream>(stream);
+    Get<uint8_t>(position, end);
+    block.device = Get<uint16_t>(position, end);
+    const std::size_t count = Get<uint32_t>(position, end);
+    const std::size_t width = Width(block.stream);
+    Get<uint64_t>(position, end);
+    Get<uint64_t>(position, end);
+    block.min.resize(width);
+    block.max.resize(width);
+    for (std::size_t column = 0; column < width; ++column) {
+      block.min[column] = Get<float>(position, end);
+    }
+    for (std::size_t column = 0; column < width; ++column) {
+      block.max[column] = Get<float>(position, end);
+    }
+    const std::size_t payload_size = Get<uint32_t>(position, end);
+    // Every sample takes at least a byte for its timestamp.
+    if (payload_size > static_cast<std::size_t>(end - position) ||
+        count > payload_size) {
+      throw Corrupt();
+    }
+    const char* payload_end = position + payload_size;
+
+    block.timestamps.resize(count);
+    position += ColumnCodec::DecodeTimestamps(
+        position, payload_end - position, count, block.timestamps.data());
+    if (block.stream == Stream::emg) {
+      block.emg.resize(count * width);
+      block.values.clear();
+    } else {
+      block.values.resize(count * width);
+      block.emg.clear();
+    }
+    for (std::size_t column = 0; column < width; ++column) {
+      if (block.stream == Stream::emg) {
+        position += ColumnCodec::DecodeInt8(position, payload_end - position,
+                                            count, width,
+                                            block.emg.data() + column);
+      } else {
+        position += ColumnCodec::DecodeFloats(
+            position, payload_end - position, count, width,
+            block.values.data() + column);
+      }
+    }
+    if (position != payload_end) {
+      throw Corrupt();
+    }
+  }
+  if (position != end) {
+    throw Corrupt();
+  }
+  return true;
+}
+FeatureState ReadSnapshot(std::istream& is, uint64_t offset) {
+  is.clear();
+  is.seekg(offset);
+  char magic[4];
+  uint32_t size;
+  if (!is || !ReadChunkHeader(is, magic, size) ||
+      !IsChunk(magic, snapshotMagic) ||
+      size < snapshotHeaderSize - chunkHeaderSize) {
+    throw std::runtime_error("There is no snapshot at the offset.");
+  }
+  uint64_t timestamp;
+  is.read(reinterpret_cast<char*>(&timestamp), sizeof(timestamp));
+  std::vector<char> data(size - sizeof(timestamp));
+  is.read(data.data(), data.size());
+  if (!is) {
+    throw Corrupt();
+  }
+  return FeatureState(std::move(data));
+}
+
+Index ReadIndex(std::istream& is) {
+  Index index;
+  is.clear();
+  is.seekg(0, std::ios::end);
+  const uint64_t length = is.tellg();
+  if (!is) {
+    throw std::runtime_error("Seeking requires a seekable archive.");
+  }
+
+  // The footer, if the archive was finished.
+  if (length >= headerSize + footerSize) {
+    char footer[footerSize];
+    is.seekg(length - footerSize);
+    is.read(footer, sizeof(footer));
+    uint64_t offset;
+    std::memcpy(&offset, footer + chunkHeaderSize, sizeof(offset));
+    if (is && IsChunk(footer, footerMagic) && offset < length - footerSize) {
+      is.seekg(offset);
+      char magic[4];
+      uint32_t size;
+      if (!ReadChunkHeader(is, magic, size) || !IsChunk(magic, indexMagic) ||
+          offset + chunkHeaderSize + size > length) {
+        throw Corrupt();
+      }
+      std::vector<char> buffer(size);
+      is.read(buffer.data(), size);
+      const char* position = buffer.data();
+      const char* end = buffer.data() + size;
+      const uint32_t num_segments = Get<uint32_t>(position, end);
+      const uint32_t num_snapshots = Get<uint32_t>(position, end);
+      // Checked before allocating the entries, so that a corrupt count
+      // can't allocate more than the chunk holds.
+      const uint64_t entries_size =
+          static_cast<uint64_t>(num_segments) * segmentEntrySize +
+          static_cast<uint64_t>(num_snapshots) * snapshotEntrySize;
+      if (!is || entries_size != static_cast<uint64_t>(end - position)) {
+        throw Corrupt();
+      }
+      index.segments.resize(num_segments);
+      index.snapshots.resize(num_snapshots);
+      for (Index::SegmentEntry& entry : index.segments) {
+        entry.first_timestamp = Get<uint64_t>(position, end);
+        entry.last_timestamp = Get<uint64_t>(position, end);
+        entry.offset = Get<uint64_t>(position, end);
+      }
+      for (Index::SnapshotEntry& entry : index.snapshots) {
+        entry.timestamp = Get<uint64_t>(position, end);
+        entry.offset = Get<uint64_t>(position, end);
+      }
+      return index;
+    }
+  }
+
+  // Otherwise every complete chunk is indexed, and a chunk which was cut off
+  // ends the archive.
+  uint64_t offset = headerSize;
+  while (offset + chunkHeaderSize <= length) {
+    char header[segmentHeaderSize];
+    is.clear();
+    is.seekg(offset);
+    is.read(header, std::min<uint64_t>(sizeof(header), length - offset));
+    uint32_t size;
+    std::memcpy(&size, header + 4, sizeof(size));
+    const uint64_t next = offset + chunkHeaderSize + size;
+    if (next > length) {
+      break;
+    }
+    if (IsChunk(header, segmentMagic) &&
+        size >= segmentHeaderSize - chunkHeaderSize) {
+      Index::SegmentEntry entry;
+      std::memcpy(&entry.first_timestamp, header + 16, sizeof(uint64_t));
+      std::memcpy(&entry.last_timestamp, header + 24, sizeof(uint64_t));
+      entry.offset = offset;
+      index.segments.push_back(entry);
+    } else if (IsChunk(header, snapshotMagic) &&
+               size >= snapshotHeaderSize - chunkHeaderSize) {
+      Index::SnapshotEntry entry;
+      std::memcpy(&entry.timestamp, header + chunkHeaderSize,
+                  sizeof(uint64_t));
+      entry.offset = offset;
+      index.snapshots.push_back(entry);
+    } else {
+      break;
+    }
+    offset = next;
+  }
+  return index;
+}
+}
+}
@@ -0,0 +1,109 @@
+/* The file format of archives of sensor recordings. An archive stores the EMG,
+ * orientation, accelerometer and gyroscope samples of any number of Myos
+ * column-wise, compressed with ColumnCodec.
+ *
+ * An archive is a header followed by chunks, each of which starts with its
+ * magic and size so that readers can skip it. Most chunks are segments. A
+ * segment holds a block of
+ * consecutive samples for each stream of each Myo which had samples in the
+ * segment's time range. Each block stores its timestamps and each of its
+ * columns separately: EMG channels are bit-packed, IMU values are XOR
+ * compressed. Blocks carry the range of their timestamps and the minimum and
+ * maximum of every column, and segments the range of their timestamps and
+ * their size, so that they can be filtered and skipped without decoding.
+ *
+ * Between segments, an archive can hold snapshots of the state of the feature
+ * tree which processed the samples, see DeviceListenerWrapper::saveState.
+ * It ends with an index of the time ranges and offsets of all segments and
+ * snapshots, followed by a fixed size footer pointing at the index, so that
+ * playback can seek to any time in O(log n). Archives which weren't finished,
+ * e.g. because the recording crashed, have no index, and ReadIndex rebuilds
+ * it by scanning the chunk headers.
+ *
+ * Files are little endian, like all of the platforms the Myo runs on.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+#include "FeatureState.h"
+
+namespace core {
+namespace SensorArchive {
+enum class Stream : uint8_t { emg, orientation, acceleration, gyro };
+
+// The number of columns of a stream, e.g. 4 for the orientation quaternion.
+std::size_t Width(Stream stream);
+
+struct Block {
+  Stream stream;
+  uint16_t device;
+  std::vector<uint64_t> timestamps;
+  // Width(stream) values per sample, interleaved. EMG samples are stored in
+  // emg, all others in values.
+  std::vector<int8_t> emg;
+  std::vector<float> values;
+  // The minimum and maximum of each column. Set by ReadSegment, and ignored
+  // by WriteSegment, which computes them.
+  std::vector<float> min, max;
+
+  std::size_t size() const { return timestamps.size(); }
+};
+
+struct Segment {
+  // The range of the timestamps of all blocks. Set by ReadSegment.
+  uint64_t first_timestamp, last_timestamp;
+  std::vector<Block> blocks;
+};
+
+struct Index {
+  struct SegmentEntry {
+    uint64_t first_timestamp, last_timestamp;
+    // From the start of the archive.
+    uint64_t offset;
+  };
+  struct SnapshotEntry {
+    uint64_t timestamp, offset;
+  };
+
+  // Both in the order they were written, and therefore by timestamp.
+  std::vector<SegmentEntry> segments;
+  std::vector<SnapshotEntry> snapshots;
+};
+
+// The size of the header, and the offset of the first chunk.
+const std::size_t headerSize = 8;
+
+void WriteHeader(std::ostream& os);
+// Throws std::runtime_error if the stream isn't an archive.
+void ReadHeader(std::istream& is);
+
+// Writes the non-empty blocks of segment, and returns the number of bytes
+// written, 0 if all blocks are empty. The timestamps of each block must be in
+// order. buffer is scratch space, which is reused between calls.
+std::size_t WriteSegment(std::ostream& os, const Segment& segment,
+                         std::vector<char>& buffer);
+// Writes a snapshot of the feature state at timestamp, which playback resumes
+// from with the segment after it, and returns the number of bytes written.
+std::size_t WriteSnapshot(std::ostream& os, uint64_t timestamp,
+                          const FeatureState& snapshot);
+// Ends the archive with index, which starts at offset.
+void WriteIndex(std::ostream& os, const Index& index, uint64_t offset);
+
+// Reads the next segment into segment, reusing its storage, and returns
+// false at the end of the archive. Snapshots are skipped. Throws
+// std::runtime_error if the segment is truncated or corrupt.
+bool ReadSegment(std::istream& is, Segment& segment,
+                 std::vector<char>& buffer);
+// Reads the snapshot at offset and leaves is at the chunk after it. Throws
+// std::runtime_error if there is no snapshot at offset.
+FeatureState ReadSnapshot(std::istream& is, uint64_t offset);
+// Reads the index of an archive, which must be seekable, or rebuilds it if
+// the archive wasn't finished. Leaves the position of is undefined.
+Index ReadIndex(std::istream& is);
+}
+}
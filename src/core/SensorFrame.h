@@ -0,0 +1,33 @@
+/* A single time-aligned sample of all of the Myo's sensor streams. The layout
+ * is fixed and packed into 48 bytes so that frames can be stored in arrays
+ * and copied cheaply.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <myo/myo.hpp>
+
+namespace core {
+struct SensorFrame {
+  // Orientation quaternion as x, y, z, w.
+  float rotation[4];
+  float acceleration[3];
+  float gyro[3];
+  int8_t emg[8];
+
+  myo::Quaternion<float> getRotation() const {
+    return myo::Quaternion<float>(rotation[0], rotation[1], rotation[2],
+                                  rotation[3]);
+  }
+  myo::Vector3<float> getAcceleration() const {
+    return myo::Vector3<float>(acceleration[0], acceleration[1],
+                               acceleration[2]);
+  }
+  myo::Vector3<float> getGyro() const {
+    return myo::Vector3<float>(gyro[0], gyro[1], gyro[2]);
+  }
+};
+
+static_assert(sizeof(SensorFrame) == 48, "SensorFrame must be packed.");
+}
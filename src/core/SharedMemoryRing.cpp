@@ -0,0 +1,248 @@
+#include "SharedMemoryRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SHARED_MEMORY_RING_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace core {
+namespace {
+const char magic[4] = {'M', 'I', 'S', 'R'};
+const uint32_t version = 1;
+// Slots are aligned to cache lines, so that writing one doesn't disturb
+// readers of its neighbours.
+const std::size_t alignment = 64;
+
+std::size_t Align(std::size_t size) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+// Names of POSIX shared memory objects start with a slash.
+std::string ObjectName(const std::string& name) {
+  return !name.empty() && name[0] == '/' ? name : "/" + name;
+}
+
+std::runtime_error Error(const std::string& what, const std::string& name) {
+  return std::runtime_error(what + " " + name + ": " + std::strerror(errno));
+}
+}
+
+struct SharedMemoryRing::Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t num_slots;
+  uint32_t slot_size;
+  // The number of records written so far.
+  alignas(alignment) std::atomic<uint64_t> head;
+};
+
+struct SharedMemoryRing::Slot {
+  // 2n + 1 while record n is being written, 2n + 2 once it's complete.
+  std::atomic<uint64_t> sequence;
+  uint32_t size;
+  uint32_t reserved;
+
+  char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+              "The ring is shared between processes, so its atomics must be "
+              "plain integers.");
+
+#ifdef SHARED_MEMORY_RING_POSIX
+SharedMemoryRing::SharedMemoryRing(const std::string& name,
+                                   std::size_t num_slots, std::size_t slot_size)
+    : name_(ObjectName(name)),
+      writer_(true),
+      mapping_(nullptr),
+      mapping_size_(0),
+      header_(nullptr),
+      num_slots_(num_slots),
+      slot_size_(slot_size),
+      slot_stride_(Align(sizeof(Slot) + slot_size)),
+      next_(0),
+      lost_(0) {
+  if (num_slots == 0 || slot_size == 0) {
+    throw std::invalid_argument("A ring needs slots of a non-zero size.");
+  }
+  // A stale ring of a writer which crashed would otherwise be reused with
+  // whatever its readers left behind.
+  shm_unlink(name_.c_str());
+  int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    throw Error("Can't create", name_);
+  }
+  std::size_t size = Align(sizeof(Header)) + num_slots * slot_stride_;
+  if (ftruncate(fd, size) != 0) {
+    close(fd);
+    shm_unlink(name_.c_str());
+    throw Error("Can't resize", name_);
+  }
+  try {
+    Map(fd, size);
+  } catch (...) {
+    shm_unlink(name_.c_str());
+    throw;
+  }
+
+  // ftruncate zeroes the memory, so all of the sequence numbers are 0 and
+  // don't match any record. The magic is written last, so that readers don't
+  // accept a ring which is still being set up.
+  header_->version = version;
+  header_->num_slots = static_cast<uint32_t>(num_slots);
+  header_->slot_size = static_cast<uint32_t>(slot_size);
+  header_->head.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header_->magic, magic, sizeof(magic));
+}
+
+SharedMemoryRing::SharedMemoryRing(const std::string& name)
+    : name_(ObjectName(name)),
+      writer_(false),
+      mapping_(nullptr),
+      mapping_size_(0),
+      header_(nullptr),
+      num_slots_(0),
+      slot_size_(0),
+      slot_stride_(0),
+      next_(0),
+      lost_(0) {
+  int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    throw Error("Can't open", name_);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw Error("Can't stat", name_);
+  }
+  if (static_cast<std::size_t>(st.st_size) < Align(sizeof(Header))) {
+    close(fd);
+    throw std::runtime_error(name_ + " is not a ring.");
+  }
+  Map(fd, st.st_size);
+
+  if (std::memcmp(header_->magic, magic, sizeof(magic)) != 0) {
+    munmap(mapping_, mapping_size_);
+    throw std::runtime_error(name_ + " is not a ring.");
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  num_slots_ = header_->num_slots;
+  slot_size_ = header_->slot_size;
+  slot_stride_ = Align(sizeof(Slot) + slot_size_);
+  if (header_->version != version ||
+      Align(sizeof(Header)) + num_slots_ * slot_stride_ > mapping_size_) {
+    munmap(mapping_, mapping_size_);
+    throw std::runtime_error(name_ + " has an unsupported version.");
+  }
+  next_ = header_->head.load(std::memory_order_acquire);
+}
+
+SharedMemoryRing::~SharedMemoryRing() {
+  munmap(mapping_, mapping_size_);
+  if (writer_) {
+    shm_unlink(name_.c_str());
+  }
+}
+
+void SharedMemoryRing::Map(int fd, std::size_t size) {
+  int protection = writer_ ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* mapping = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    throw Error("Can't map", name_);
+  }
+  mapping_ = mapping;
+  mapping_size_ = size;
+  header_ = static_cast<Header*>(mapping);
+}
+#else
+SharedMemoryRing::SharedMemoryRing(const std::string& name, std::size_t,
+                                   std::size_t)
+    : name_(name), writer_(true) {
+  throw std::runtime_error("Shared memory rings aren't supported here.");
+}
+
+SharedMemoryRing::SharedMemoryRing(const std::string& name)
+    : name_(name), writer_(false) {
+  throw std::runtime_error("Shared memory rings aren't supported here.");
+}
+
+SharedMemoryRing::~SharedMemoryRing() {}
+
+void SharedMemoryRing::Map(int, std::size_t) {}
+#endif
+
+std::size_t SharedMemoryRing::numSlots() const { return num_slots_; }
+
+std::size_t SharedMemoryRing::slotSize() const { return slot_size_; }
+
+bool SharedMemoryRing::writer() const { return writer_; }
+
+SharedMemoryRing::Slot& SharedMemoryRing::GetSlot(uint64_t index) const {
+  char* slots = static_cast<char*>(mapping_) + Align(sizeof(Header));
+  return *reinterpret_cast<Slot*>(slots + (index % num_slots_) * slot_stride_);
+}
+
+void SharedMemoryRing::write(const void* data, std::size_t size) {
+  if (!writer_) {
+    throw std::logic_error("The ring was opened for reading.");
+  }
+  if (size > slot_size_) {
+    throw std::invalid_argument("The record is larger than the slots.");
+  }
+  // Only the writer changes head, so it can read it without ordering.
+  uint64_t index = header_->head.load(std::memory_order_relaxed);
+  Slot& slot = GetSlot(index);
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.size = static_cast<uint32_t>(size);
+  std::memcpy(slot.data(), data, size);
+  slot.sequence.store(2 * index + 2, std::memory_order_release);
+  header_->head.store(index + 1, std::memory_order_release);
+}
+
+bool SharedMemoryRing::read(std::vector<char>& record) {
+  while (true) {
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    if (next_ == head) {
+      return false;
+    }
+    // The slots of the oldest records have already been reused.
+    if (head - next_ > num_slots_) {
+      lost_ += head - next_ - num_slots_;
+      next_ = head - num_slots_;
+    }
+
+    Slot& slot = GetSlot(next_);
+    uint64_t expected = 2 * next_ + 2;
+    ++next_;
+    if (slot.sequence.load(std::memory_order_acquire) != expected) {
+      ++lost_;
+      continue;
+    }
+    std::size_t size = std::min<std::size_t>(slot.size, slot_size_);
+    record.resize(size);
+    std::memcpy(record.data(), slot.data(), size);
+    // The copy may have raced with the writer reusing the slot, in which case
+    // the sequence number has changed since.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+      ++lost_;
+      continue;
+    }
+    return true;
+  }
+}
+
+uint64_t SharedMemoryRing::lost() const { return lost_; }
+}
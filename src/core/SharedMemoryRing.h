@@ -0,0 +1,73 @@
+/* A ring of fixed size records in POSIX shared memory, with one writer and any
+ * number of readers in other processes. It's lock free, and the writer never
+ * waits for the readers: every record is written into the next slot whether
+ * or not it has been read, so a reader which falls more than the number of
+ * slots behind loses records, and counts them.
+ *
+ * Each slot is a seqlock. Its sequence number is odd while the writer fills
+ * it, and afterwards identifies the record in it, so a reader checks the
+ * number before and after copying a record to detect that it was overwritten
+ * meanwhile. The records are numbered consecutively, and the number of the
+ * next one is published in the header, so readers know how far behind they
+ * are.
+ *
+ * The writer creates the ring and removes its name when it's destroyed.
+ * Readers start with the records written after they open the ring.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace core {
+class SharedMemoryRing {
+ public:
+  // Creates a ring of num_slots records of up to slot_size bytes for writing,
+  // replacing any ring with the same name. Throws std::runtime_error if the
+  // shared memory can't be created, or std::invalid_argument if num_slots or
+  // slot_size is 0.
+  SharedMemoryRing(const std::string& name, std::size_t num_slots,
+                   std::size_t slot_size);
+  // Opens an existing ring for reading. Throws std::runtime_error if there is
+  // no ring with that name.
+  explicit SharedMemoryRing(const std::string& name);
+  ~SharedMemoryRing();
+
+  SharedMemoryRing(const SharedMemoryRing&) = delete;
+  SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+  std::size_t numSlots() const;
+  std::size_t slotSize() const;
+  bool writer() const;
+
+  // Writes a record. Throws std::invalid_argument if size is larger than
+  // slotSize(), or std::logic_error if the ring was opened for reading.
+  void write(const void* data, std::size_t size);
+  // Copies the next record into record and returns true, or returns false if
+  // there is none yet. Records which were overwritten before they could be
+  // read are skipped.
+  bool read(std::vector<char>& record);
+  // The number of records a reader has skipped.
+  uint64_t lost() const;
+
+ private:
+  struct Header;
+  struct Slot;
+
+  // Maps the shared memory object fd of size bytes.
+  void Map(int fd, std::size_t size);
+  Slot& GetSlot(uint64_t index) const;
+
+  const std::string name_;
+  const bool writer_;
+  void* mapping_;
+  std::size_t mapping_size_;
+  Header* header_;
+  std::size_t num_slots_, slot_size_, slot_stride_;
+  // The number of the next record to read, and of the records skipped.
+  uint64_t next_, lost_;
+};
+}
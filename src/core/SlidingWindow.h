@@ -0,0 +1,101 @@
+/* The last size samples of a stream, each of dimensions values, stored as one
+ * contiguous array from the oldest sample to the newest, so that recognizers
+ * can work on the window in place.
+ *
+ * Each sample is written twice, size samples apart, into a buffer of twice
+ * the window size. The window then always starts at the oldest sample and is
+ * never wrapped, so adding a sample costs two copies and no shifting.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace core {
+template <typename T>
+class SlidingWindow {
+ public:
+  // The window is empty and zero filled at first. Throws
+  // std::invalid_argument if size is 0.
+  SlidingWindow(std::size_t size, std::size_t dimensions);
+
+  // Adds the dimensions() values at sample, dropping the oldest sample once
+  // the window is full.
+  void push(const T* sample);
+  // Empties the window, so that it has to be filled again before full()
+  // returns true. The values stay until they are overwritten.
+  void clear();
+
+  // size() samples, oldest first. Samples which weren't added yet are zero,
+  // or are the values left from before clear().
+  const T* data() const;
+  std::size_t size() const;
+  std::size_t dimensions() const;
+  // The number of samples added since construction or clear(), at most
+  // size(). They are the last ones of data().
+  std::size_t numSamples() const;
+  // Whether size() samples were added since construction or clear().
+  bool full() const;
+
+ private:
+  const std::size_t size_, dimensions_;
+  std::vector<T> buffer_;
+  // The oldest sample, which the next one replaces.
+  std::size_t next_;
+  std::size_t num_samples_;
+};
+
+template <typename T>
+SlidingWindow<T>::SlidingWindow(std::size_t size, std::size_t dimensions)
+    : size_(size),
+      dimensions_(dimensions),
+      buffer_(2 * size * dimensions, T()),
+      next_(0),
+      num_samples_(0) {
+  if (size == 0) {
+    throw std::invalid_argument("The window size must be positive.");
+  }
+}
+
+template <typename T>
+void SlidingWindow<T>::push(const T* sample) {
+  std::copy(sample, sample + dimensions_, &buffer_[next_ * dimensions_]);
+  std::copy(sample, sample + dimensions_,
+            &buffer_[(next_ + size_) * dimensions_]);
+  next_ = (next_ + 1) % size_;
+  num_samples_ = std::min(num_samples_ + 1, size_);
+}
+
+template <typename T>
+void SlidingWindow<T>::clear() {
+  num_samples_ = 0;
+}
+
+template <typename T>
+const T* SlidingWindow<T>::data() const {
+  return &buffer_[next_ * dimensions_];
+}
+
+template <typename T>
+std::size_t SlidingWindow<T>::size() const {
+  return size_;
+}
+
+template <typename T>
+std::size_t SlidingWindow<T>::dimensions() const {
+  return dimensions_;
+}
+
+template <typename T>
+std::size_t SlidingWindow<T>::numSamples() const {
+  return num_samples_;
+}
+
+template <typename T>
+bool SlidingWindow<T>::full() const {
+  return num_samples_ == size_;
+}
+}
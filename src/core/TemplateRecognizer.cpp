@@ -0,0 +1,187 @@
+#include "TemplateRecognizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace core {
+namespace {
+float PointDistance(const float* a, const float* b, std::size_t dimensions) {
+  float squared = 0.f;
+  for (std::size_t j = 0; j < dimensions; ++j) {
+    float difference = a[j] - b[j];
+    squared += difference * difference;
+  }
+  return std::sqrt(squared);
+}
+}
+
+TemplateRecognizer::TemplateRecognizer(std::size_t dimensions,
+                                       std::size_t num_points,
+                                       std::size_t num_segments)
+    : dimensions_(dimensions),
+      num_points_(num_points),
+      num_segments_(num_segments),
+      normalized_(num_points * dimensions),
+      means_(num_segments * dimensions) {
+  if (dimensions == 0 || num_points < 2 || num_segments == 0 ||
+      num_points % num_segments != 0) {
+    throw std::invalid_argument(
+        "num_points must be a multiple of num_segments.");
+  }
+}
+
+std::size_t TemplateRecognizer::dimensions() const { return dimensions_; }
+
+std::size_t TemplateRecognizer::numPoints() const { return num_points_; }
+
+std::size_t TemplateRecognizer::numTemplates() const { return names_.size(); }
+
+const std::string& TemplateRecognizer::templateName(std::size_t index) const {
+  return names_[index];
+}
+
+std::size_t TemplateRecognizer::addTemplate(const std::string& name,
+                                            const float* points,
+                                            std::size_t count) {
+  const std::size_t size = num_points_ * dimensions_;
+  templates_.resize(templates_.size() + size);
+  float* normalized = &templates_[templates_.size() - size];
+  normalize(points, count, normalized);
+  template_means_.resize(template_means_.size() + num_segments_ * dimensions_);
+  SegmentMeans(normalized, &template_means_[template_means_.size() -
+                                            num_segments_ * dimensions_]);
+  names_.push_back(name);
+  bounds_.reserve(names_.size());
+  return names_.size() - 1;
+}
+
+TemplateRecognizer::Match TemplateRecognizer::recognize(
+    const float* points, std::size_t count, float max_distance) {
+  normalize(points, count, normalized_.data());
+  SegmentMeans(normalized_.data(), means_.data());
+  bounds_.clear();
+  for (std::size_t i = 0; i < names_.size(); ++i) {
+    float bound = LowerBound(means_.data(), i);
+    if (bound < max_distance) {
+      bounds_.push_back(std::make_pair(bound, i));
+    }
+  }
+  std::sort(bounds_.begin(), bounds_.end());
+
+  Match match = {-1, max_distance};
+  for (const auto& bound : bounds_) {
+    if (bound.first >= match.distance) {
+      break;
+    }
+    float distance = Distance(normalized_.data(), bound.second, match.distance);
+    if (distance < match.distance) {
+      match.index = static_cast<int>(bound.second);
+      match.distance = distance;
+    }
+  }
+  return match;
+}
+
+void TemplateRecognizer::normalize(const float* points, std::size_t count,
+                                   float* normalized) const {
+  const std::size_t d = dimensions_;
+  std::fill(normalized, normalized + num_points_ * d, 0.f);
+  if (count == 0) {
+    return;
+  }
+
+  // Resample to num_points_ points equally spaced along the path. The first
+  // pass measures the length of the path, the second interpolates.
+  float length = 0.f;
+  for (std::size_t i = 1; i < count; ++i) {
+    length += PointDistance(points + (i - 1) * d, points + i * d, d);
+  }
+  const float interval = length / (num_points_ - 1);
+  std::copy(points, points + d, normalized);
+  std::size_t n = 1;
+  float travelled = 0.f;
+  for (std::size_t i = 1; i < count && n + 1 < num_points_; ++i) {
+    const float* start = points + (i - 1) * d;
+    const float* end = points + i * d;
+    const float segment_length = PointDistance(start, end, d);
+    while (n + 1 < num_points_ && n * interval <= travelled + segment_length) {
+      float t = segment_length > 0.f
+                    ? (n * interval - travelled) / segment_length
+                    : 0.f;
+      for (std::size_t j = 0; j < d; ++j) {
+        normalized[n * d + j] = start[j] + t * (end[j] - start[j]);
+      }
+      ++n;
+    }
+    travelled += segment_length;
+  }
+  // The last point, and any left over due to rounding, are the end of the
+  // path.
+  for (; n < num_points_; ++n) {
+    std::copy(points + (count - 1) * d, points + count * d,
+              normalized + n * d);
+  }
+
+  // Translate the centroid to the origin and scale to unit RMS distance.
+  float squared_sum = 0.f;
+  for (std::size_t j = 0; j < d; ++j) {
+    float centroid = 0.f;
+    for (std::size_t n = 0; n < num_points_; ++n) {
+      centroid += normalized[n * d + j];
+    }
+    centroid /= num_points_;
+    for (std::size_t n = 0; n < num_points_; ++n) {
+      normalized[n * d + j] -= centroid;
+      squared_sum += normalized[n * d + j] * normalized[n * d + j];
+    }
+  }
+  if (squared_sum > 0.f) {
+    const float scale = 1.f / std::sqrt(squared_sum / num_points_);
+    for (std::size_t i = 0; i < num_points_ * d; ++i) {
+      normalized[i] *= scale;
+    }
+  }
+}
+
+void TemplateRecognizer::SegmentMeans(const float* normalized,
+                                      float* means) const {
+  const std::size_t d = dimensions_;
+  const std::size_t points_per_segment = num_points_ / num_segments_;
+  for (std::size_t s = 0; s < num_segments_; ++s) {
+    for (std::size_t j = 0; j < d; ++j) {
+      float sum = 0.f;
+      for (std::size_t n = 0; n < points_per_segment; ++n) {
+        sum += normalized[(s * points_per_segment + n) * d + j];
+      }
+      means[s * d + j] = sum / points_per_segment;
+    }
+  }
+}
+
+float TemplateRecognizer::LowerBound(const float* means,
+                                     std::size_t index) const {
+  const std::size_t d = dimensions_;
+  const float* template_means = &template_means_[index * num_segments_ * d];
+  float bound = 0.f;
+  for (std::size_t s = 0; s < num_segments_; ++s) {
+    bound += PointDistance(means + s * d, template_means + s * d, d);
+  }
+  return bound / num_segments_;
+}
+
+float TemplateRecognizer::Distance(const float* normalized, std::size_t index,
+                                   float best_distance) const {
+  const std::size_t d = dimensions_;
+  const float* points = &templates_[index * num_points_ * d];
+  const float abandon = best_distance * num_points_;
+  float sum = 0.f;
+  for (std::size_t n = 0; n < num_points_; ++n) {
+    sum += PointDistance(normalized + n * d, points + n * d, d);
+    if (sum >= abandon) {
+      return best_distance;
+    }
+  }
+  return sum / num_points_;
+}
+}
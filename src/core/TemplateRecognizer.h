@@ -0,0 +1,73 @@
+/* An N-dimensional $1 recognizer. Trajectories of N-dimensional points are
+ * resampled to a fixed number of points equally spaced along the path,
+ * translated so that their centroid is at the origin and scaled to a root mean
+ * square distance of one from it. The distance between two trajectories is the
+ * mean Euclidean distance between corresponding points. Unlike the original $1
+ * recognizer, trajectories aren't rotated, since the direction of a motion is
+ * usually what distinguishes IMU gestures.
+ *
+ * Matching is done against a lower bound first: the trajectory is split into
+ * segments, and by convexity the distance between the segment means bounds the
+ * distance between the points. Templates are compared in order of increasing
+ * lower bound, which stops once the lower bound exceeds the best distance
+ * found, and each distance computation is abandoned as soon as it exceeds it.
+ * http://depts.washington.edu/acelab/proj/dollar/index.html
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace core {
+class TemplateRecognizer {
+ public:
+  struct Match {
+    // The index of the matching template, or -1 if there is none.
+    int index;
+    float distance;
+  };
+
+  // num_points must be a multiple of num_segments.
+  TemplateRecognizer(std::size_t dimensions, std::size_t num_points = 32,
+                     std::size_t num_segments = 8);
+
+  std::size_t dimensions() const;
+  std::size_t numPoints() const;
+  std::size_t numTemplates() const;
+  const std::string& templateName(std::size_t index) const;
+
+  // points holds count consecutive points of dimensions() values each. Returns
+  // the index of the new template.
+  std::size_t addTemplate(const std::string& name, const float* points,
+                          std::size_t count);
+
+  // Returns the closest template whose distance is less than max_distance.
+  // Doesn't allocate once the templates have been added.
+  Match recognize(const float* points, std::size_t count,
+                  float max_distance = std::numeric_limits<float>::max());
+
+  // Resamples and normalizes count points into numPoints() points.
+  void normalize(const float* points, std::size_t count,
+                 float* normalized) const;
+
+ private:
+  void SegmentMeans(const float* normalized, float* means) const;
+  float LowerBound(const float* means, std::size_t index) const;
+  // Returns the mean distance to the template, or a value of at least
+  // best_distance if the computation was abandoned early.
+  float Distance(const float* normalized, std::size_t index,
+                 float best_distance) const;
+
+  const std::size_t dimensions_, num_points_, num_segments_;
+  std::vector<std::string> names_;
+  // The normalized points and segment means of all templates.
+  std::vector<float> templates_, template_means_;
+  // Scratch space for recognize.
+  std::vector<float> normalized_, means_;
+  std::vector<std::pair<float, std::size_t>> bounds_;
+};
+}
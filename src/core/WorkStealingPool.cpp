@@ -0,0 +1,130 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace core {
+namespace {
+// The pool and index of the thread running the current task, if any.
+thread_local WorkStealingPool* currentPool = nullptr;
+thread_local std::size_t currentIndex = 0;
+}
+
+WorkStealingPool::WorkStealingPool(std::size_t num_threads)
+    : queued_(0),
+      unfinished_(0),
+      stolen_(0),
+      stopping_(false) {
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    queues_.emplace_back(new Queue());
+  }
+  for (std::size_t i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this, i]() { Run(i); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_condition_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkStealingPool::submit(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Queue& queue = currentPool == this ? *queues_[currentIndex] : submitted_;
+    std::lock_guard<std::mutex> queue_lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+    ++queued_;
+    ++unfinished_;
+  }
+  work_condition_.notify_one();
+}
+
+void WorkStealingPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_condition_.wait(lock, [this]() { return unfinished_ == 0; });
+  if (error_) {
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+std::size_t WorkStealingPool::numThreads() const { return threads_.size(); }
+
+uint64_t WorkStealingPool::stolen() const { return stolen_; }
+
+void WorkStealingPool::Run(std::size_t index) {
+  currentPool = this;
+  currentIndex = index;
+  while (true) {
+    Task task;
+    if (Take(index, task)) {
+      std::exception_ptr error;
+      try {
+        task();
+      } catch (...) {
+        error = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (error && !error_) {
+        error_ = error;
+      }
+      if (--unfinished_ == 0) {
+        done_condition_.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_condition_.wait(lock,
+                         [this]() { return stopping_ || queued_ > 0; });
+    if (stopping_ && queued_ == 0) {
+      return;
+    }
+  }
+}
+
+bool WorkStealingPool::Take(std::size_t index, Task& task) {
+  {
+    Queue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      --queued_;
+      return true;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(submitted_.mutex);
+    if (!submitted_.tasks.empty()) {
+      task = std::move(submitted_.tasks.front());
+      submitted_.tasks.pop_front();
+      --queued_;
+      return true;
+    }
+  }
+  for (std::size_t i = 1; i < queues_.size(); ++i) {
+    Queue& queue = *queues_[(index + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+    task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    ++stolen_;
+    --queued_;
+    return true;
+  }
+  return false;
+}
+}
@@ -0,0 +1,77 @@
+/* A fixed set of threads which run tasks, for batch work such as processing
+ * many recordings at once.
+ *
+ * Every thread has its own deque of tasks. Tasks submitted by a task go to
+ * the back of the deque of the thread running it, which runs the tasks at the
+ * back of its deque first, so a task's subtasks run depth first while their
+ * data is still in the cache. Tasks submitted from outside the pool go to a
+ * queue which all threads share, and run in the order they were submitted,
+ * so the caller decides which tasks start first. A thread whose deque is
+ * empty takes the oldest task of the shared queue, and if that's empty as
+ * well steals the task at the front of another thread's deque, so threads
+ * which run out of work take over from busy ones.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+class WorkStealingPool {
+ public:
+  typedef std::function<void()> Task;
+
+  // Starts num_threads threads, or one per core if it's 0.
+  explicit WorkStealingPool(std::size_t num_threads = 0);
+  // Runs the remaining tasks, and stops the threads.
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  void submit(Task task);
+  // Blocks until all tasks submitted so far, and the tasks they submitted,
+  // have run. Rethrows the first exception thrown by one of them, if any.
+  // Mustn't be called from a task.
+  void wait();
+
+  std::size_t numThreads() const;
+  // The number of tasks which were run by another thread than the one whose
+  // deque they were in.
+  uint64_t stolen() const;
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void Run(std::size_t index);
+  // Takes a task from the back of the deque of thread index, from the front
+  // of the shared queue, or from the front of another thread's deque.
+  bool Take(std::size_t index, Task& task);
+
+  // The tasks submitted from outside the pool, oldest first.
+  Queue submitted_;
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable work_condition_, done_condition_;
+  // The tasks in the deques, and those which haven't finished yet.
+  std::atomic<std::size_t> queued_;
+  std::size_t unfinished_;
+  std::atomic<uint64_t> stolen_;
+  std::exception_ptr error_;
+  bool stopping_;
+};
+}
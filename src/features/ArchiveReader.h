@@ -0,0 +1,231 @@
+/* ArchiveReader plays back an archive written by ArchiveWriter, by calling
+ * the event handlers of a feature, usually the RootFeature of the same tree
+ * which processes live data. The archive is read one segment at a time, so
+ * recordings of any length can be played back.
+ *
+ * Within a segment, the samples of all streams are merged by timestamp, and
+ * samples with the same timestamp are passed on in the order their streams
+ * first occurred in the recording. Segments can also be inspected directly,
+ * e.g. to process the columns without dispatching events at all.
+ *
+ * Playback can seek to any time of a seekable archive. If the archive has
+ * snapshots, the state of the target's feature tree is restored from the last
+ * one before that time, and playback resumes right after it, so features
+ * continue with warm state after playing back at most one snapshot interval.
+ * The target must be built the same way as the tree which was recorded.
+ *
+ * The recorded Myos are represented by stand-ins: every Myo has a stable
+ * myo::Myo* which identifies it, but which mustn't be dereferenced.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <cstdint>
+#include <algorithm>
+#include <deque>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "../core/DeviceListenerWrapper.h"
+#include "../core/SensorArchive.h"
+
+namespace features {
+class ArchiveReader {
+ public:
+  // Throws std::runtime_error if in isn't an archive.
+  explicit ArchiveReader(std::istream& in);
+
+  // Reads the next segment, and returns false at the end of the archive.
+  // Throws std::runtime_error if the segment is corrupt.
+  bool readSegment();
+  // The segment read last.
+  const core::SensorArchive::Segment& segment() const;
+
+  // Passes the samples of the segment read last to target, and returns how
+  // many there were.
+  std::size_t replaySegment(core::DeviceListenerWrapper& target);
+  // Reads and passes on all remaining segments.
+  std::size_t replay(core::DeviceListenerWrapper& target);
+
+  // Moves playback to the last snapshot at or before timestamp and loads it
+  // into target's tree, and returns the time of the snapshot. Without such
+  // a snapshot, playback moves to the last segment starting at or before
+  // timestamp, or to the start, and target's state is left as it is. Takes
+  // O(log n) after the index is read on the first call. Throws
+  // std::runtime_error if the archive isn't seekable or the snapshot doesn't
+  // match target.
+  uint64_t seek(uint64_t timestamp, core::DeviceListenerWrapper& target);
+
+  // The stand-in for the recorded Myo with the given index.
+  myo::Myo* device(std::size_t index);
+
+ private:
+  // Passes on the samples [begin, end) of block.
+  void Dispatch(core::DeviceListenerWrapper& target,
+                const core::SensorArchive::Block& block, std::size_t begin,
+                std::size_t end);
+
+  std::istream& in_;
+  // Read on the first seek.
+  std::unique_ptr<core::SensorArchive::Index> index_;
+  core::SensorArchive::Segment segment_;
+  std::vector<char> buffer_;
+  std::vector<std::size_t> positions_;
+  // A byte per Myo, whose addresses are the stand-ins. A deque never moves
+  // its elements when it grows.
+  std::deque<char> devices_;
+};
+
+ArchiveReader::ArchiveReader(std::istream& in) : in_(in) {
+  core::SensorArchive::ReadHeader(in_);
+}
+
+bool ArchiveReader::readSegment() {
+  if (core::SensorArchive::ReadSegment(in_, segment_, buffer_)) {
+    return true;
+  }
+  segment_.blocks.clear();
+  return false;
+}
+
+const core::SensorArchive::Segment& ArchiveReader::segment() const {
+  return segment_;
+}
+
+std::size_t ArchiveReader::replaySegment(core::DeviceListenerWrapper& target) {
+  const std::vector<core::SensorArchive::Block>& blocks = segment_.blocks;
+  const uint64_t none = std::numeric_limits<uint64_t>::max();
+  positions_.assign(blocks.size(), 0);
+  std::size_t num_samples = 0;
+  while (true) {
+    // The block with the earliest next sample, and the earliest next sample
+    // of all others. The block's samples up to that one can be passed on in
+    // one run.
+    std::size_t earliest = blocks.size();
+    uint64_t earliest_timestamp = none, next_timestamp = none;
+    bool next_before = false;
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+      if (positions_[i] == blocks[i].size()) {
+        continue;
+      }
+      uint64_t timestamp = blocks[i].timestamps[positions_[i]];
+      if (timestamp < earliest_timestamp) {
+        next_timestamp = earliest_timestamp;
+        next_before = earliest < i;
+        earliest = i;
+        earliest_timestamp = timestamp;
+      } else if (timestamp < next_timestamp) {
+        next_timestamp = timestamp;
+        next_before = false;
+      }
+    }
+    if (earliest == blocks.size()) {
+      return num_samples;
+    }
+
+    const core::SensorArchive::Block& block = blocks[earliest];
+    std::size_t begin = positions_[earliest], end = begin;
+    // Samples with the same timestamp go to the block which comes first.
+    while (end < block.size() &&
+           (block.timestamps[end] < next_timestamp ||
+            (block.timestamps[end] == next_timestamp && !next_before))) {
+      ++end;
+    }
+    Dispatch(target, block, begin, end);
+    positions_[earliest] = end;
+    num_samples += end - begin;
+  }
+}
+
+std::size_t ArchiveReader::replay(core::DeviceListenerWrapper& target) {
+  std::size_t num_samples = 0;
+  while (readSegment()) {
+    num_samples += replaySegment(target);
+  }
+  return num_samples;
+}
+
+uint64_t ArchiveReader::seek(uint64_t timestamp,
+                             core::DeviceListenerWrapper& target) {
+  typedef core::SensorArchive::Index Index;
+  if (!index_) {
+    index_.reset(new Index(core::SensorArchive::ReadIndex(in_)));
+  }
+  segment_.blocks.clear();
+
+  const std::vector<Index::SnapshotEntry>& snapshots = index_->snapshots;
+  auto snapshot = std::upper_bound(
+      snapshots.begin(), snapshots.end(), timestamp,
+      [](uint64_t timestamp, const Index::SnapshotEntry& entry) {
+        return timestamp < entry.timestamp;
+      });
+  if (snapshot != snapshots.begin()) {
+    --snapshot;
+    core::FeatureState state =
+        core::SensorArchive::ReadSnapshot(in_, snapshot->offset);
+    target.loadTreeState(state);
+    return snapshot->timestamp;
+  }
+
+  const std::vector<Index::SegmentEntry>& segments = index_->segments;
+  auto segment = std::upper_bound(
+      segments.begin(), segments.end(), timestamp,
+      [](uint64_t timestamp, const Index::SegmentEntry& entry) {
+        return timestamp < entry.first_timestamp;
+      });
+  in_.clear();
+  if (segment == segments.begin()) {
+    in_.seekg(core::SensorArchive::headerSize);
+    return segments.empty() ? 0 : segments.front().first_timestamp;
+  }
+  --segment;
+  in_.seekg(segment->offset);
+  return segment->first_timestamp;
+}
+
+myo::Myo* ArchiveReader::device(std::size_t index) {
+  if (index >= devices_.size()) {
+    devices_.resize(index + 1);
+  }
+  return reinterpret_cast<myo::Myo*>(&devices_[index]);
+}
+
+void ArchiveReader::Dispatch(core::DeviceListenerWrapper& target,
+                             const core::SensorArchive::Block& block,
+                             std::size_t begin, std::size_t end) {
+  typedef core::SensorArchive::Stream Stream;
+  myo::Myo* myo = device(block.device);
+  const uint64_t* timestamps = block.timestamps.data();
+  switch (block.stream) {
+    case Stream::emg:
+      for (std::size_t i = begin; i < end; ++i) {
+        target.onEmgData(myo, timestamps[i], &block.emg[i * 8]);
+      }
+      break;
+    case Stream::orientation:
+      for (std::size_t i = begin; i < end; ++i) {
+        const float* q = &block.values[i * 4];
+        target.onOrientationData(myo, timestamps[i],
+                                 myo::Quaternion<float>(q[0], q[1], q[2], q[3]));
+      }
+      break;
+    case Stream::acceleration:
+      for (std::size_t i = begin; i < end; ++i) {
+        const float* v = &block.values[i * 3];
+        target.onAccelerometerData(myo, timestamps[i],
+                                   myo::Vector3<float>(v[0], v[1], v[2]));
+      }
+      break;
+    case Stream::gyro:
+      for (std::size_t i = begin; i < end; ++i) {
+        const float* v = &block.values[i * 3];
+        target.onGyroscopeData(myo, timestamps[i],
+                               myo::Vector3<float>(v[0], v[1], v[2]));
+      }
+      break;
+  }
+}
+}
@@ -0,0 +1,244 @@
+/* ArchiveWriter records the EMG and IMU data it receives into a compressed
+ * archive, see core/SensorArchive.h, which ArchiveReader plays back. It's
+ * meant for long recordings: the archive is written as it's recorded, and
+ * only the current segment is kept in memory.
+ *
+ * A segment is written whenever one of its blocks has block_size samples, so
+ * larger blocks compress better but take longer to be written. Only the raw
+ * sensor streams are recorded; the other events can be derived from them by
+ * playing them back through a feature tree.
+ *
+ * Given the feature tree which processes the recorded data, the writer also
+ * saves a snapshot of its state after every snapshot_interval segments, so
+ * that ArchiveReader can seek to any time and resume with warm state rather
+ * than play back everything before it. A full segment is written when the
+ * next sample arrives, and the snapshot along with it, when the tree has
+ * processed exactly the samples written so far. That's only the case if the
+ * writer receives each sample before any feature of the tree does, so it
+ * must be the first child of the root feature. The index which makes seeking
+ * fast is written when the writer is destroyed.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../core/DeviceListenerWrapper.h"
+#include "../core/Events.h"
+#include "../core/SensorArchive.h"
+
+namespace features {
+class ArchiveWriter : public core::DeviceListenerWrapper {
+ public:
+  // Throws std::invalid_argument if block_size or snapshot_interval is 0.
+  ArchiveWriter(core::DeviceListenerWrapper& parent_feature, std::ostream& out,
+                std::size_t block_size = 1024,
+                const core::DeviceListenerWrapper* snapshot_root = nullptr,
+                std::size_t snapshot_interval = 8);
+  // Writes the last segment and the index.
+  virtual ~ArchiveWriter();
+
+  virtual void onOrientationData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Quaternion<float>& rotation) override;
+  virtual void onAccelerometerData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Vector3<float>& acceleration) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) override;
+
+  // Writes the samples received so far as a segment.
+  void flush();
+
+  // The number of samples recorded, and of segments and snapshots written.
+  uint64_t samples() const;
+  uint64_t segments() const;
+  uint64_t snapshots() const;
+
+ private:
+  typedef core::SensorArchive::Stream Stream;
+
+  // The block of the current segment which the samples of stream go to.
+  core::SensorArchive::Block& GetBlock(myo::Myo* myo, Stream stream);
+  // Writes the full segment, and a snapshot if one is due, before the sample
+  // at timestamp is added.
+  void Prepare(uint64_t timestamp);
+  // Marks the segment as full if block is.
+  void Added(const core::SensorArchive::Block& block);
+
+  std::ostream& out_;
+  const std::size_t block_size_;
+  const core::DeviceListenerWrapper* const snapshot_root_;
+  const std::size_t snapshot_interval_;
+  core::SensorArchive::Segment segment_;
+  bool full_;
+  std::map<std::pair<myo::Myo*, Stream>, std::size_t> blocks_;
+  std::map<myo::Myo*, uint16_t> devices_;
+  std::vector<char> buffer_;
+  // The offset of the next chunk, and the chunks written so far.
+  uint64_t offset_;
+  core::SensorArchive::Index index_;
+  uint64_t samples_, segments_since_snapshot_;
+};
+
+ArchiveWriter::ArchiveWriter(
+    core::DeviceListenerWrapper& parent_feature, std::ostream& out,
+    std::size_t block_size, const core::DeviceListenerWrapper* snapshot_root,
+    std::size_t snapshot_interval)
+    : out_(out),
+      block_size_(block_size),
+      snapshot_root_(snapshot_root),
+      snapshot_interval_(snapshot_interval),
+      full_(false),
+      offset_(core::SensorArchive::headerSize),
+      samples_(0),
+      segments_since_snapshot_(0) {
+  if (block_size == 0) {
+    throw std::invalid_argument("Blocks must hold at least one sample.");
+  }
+  if (snapshot_interval == 0) {
+    throw std::invalid_argument(
+        "Snapshots must be at least one segment apart.");
+  }
+  core::SensorArchive::WriteHeader(out_);
+  parent_feature.addChildFeature(
+      this, core::Events::OrientationData | core::Events::AccelerometerData |
+                core::Events::GyroscopeData | core::Events::EmgData);
+}
+
+ArchiveWriter::~ArchiveWriter() {
+  flush();
+  core::SensorArchive::WriteIndex(out_, index_, offset_);
+}
+
+void ArchiveWriter::onOrientationData(myo::Myo* myo, uint64_t timestamp,
+                                      const myo::Quaternion<float>& rotation) {
+  Prepare(timestamp);
+  core::SensorArchive::Block& block = GetBlock(myo, Stream::orientation);
+  block.timestamps.push_back(timestamp);
+  block.values.push_back(rotation.x());
+  block.values.push_back(rotation.y());
+  block.values.push_back(rotation.z());
+  block.values.push_back(rotation.w());
+  Added(block);
+}
+
+void ArchiveWriter::onAccelerometerData(
+    myo::Myo* myo, uint64_t timestamp,
+    const myo::Vector3<float>& acceleration) {
+  Prepare(timestamp);
+  core::SensorArchive::Block& block = GetBlock(myo, Stream::acceleration);
+  block.timestamps.push_back(timestamp);
+  block.values.push_back(acceleration.x());
+  block.values.push_back(acceleration.y());
+  block.values.push_back(acceleration.z());
+  Added(block);
+}
+
+void ArchiveWriter::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                                    const myo::Vector3<float>& gyro) {
+  Prepare(timestamp);
+  core::SensorArchive::Block& block = GetBlock(myo, Stream::gyro);
+  block.timestamps.push_back(timestamp);
+  block.values.push_back(gyro.x());
+  block.values.push_back(gyro.y());
+  block.values.push_back(gyro.z());
+  Added(block);
+}
+
+void ArchiveWriter::onEmgData(myo::Myo* myo, uint64_t timestamp,
+                              const int8_t* emg) {
+  Prepare(timestamp);
+  core::SensorArchive::Block& block = GetBlock(myo, Stream::emg);
+  block.timestamps.push_back(timestamp);
+  block.emg.insert(block.emg.end(), emg, emg + 8);
+  Added(block);
+}
+
+void ArchiveWriter::flush() {
+  full_ = false;
+  std::size_t size =
+      core::SensorArchive::WriteSegment(out_, segment_, buffer_);
+  if (size == 0) {
+    return;
+  }
+  core::SensorArchive::Index::SegmentEntry entry = {
+      std::numeric_limits<uint64_t>::max(), 0, offset_};
+  offset_ += size;
+  ++segments_since_snapshot_;
+  for (core::SensorArchive::Block& block : segment_.blocks) {
+    if (block.size() > 0) {
+      entry.first_timestamp =
+          std::min(entry.first_timestamp, block.timestamps.front());
+      entry.last_timestamp =
+          std::max(entry.last_timestamp, block.timestamps.back());
+    }
+    block.timestamps.clear();
+    block.emg.clear();
+    block.values.clear();
+  }
+  index_.segments.push_back(entry);
+}
+
+uint64_t ArchiveWriter::samples() const { return samples_; }
+
+uint64_t ArchiveWriter::segments() const { return index_.segments.size(); }
+
+uint64_t ArchiveWriter::snapshots() const { return index_.snapshots.size(); }
+
+core::SensorArchive::Block& ArchiveWriter::GetBlock(myo::Myo* myo,
+                                                    Stream stream) {
+  auto block = blocks_.find(std::make_pair(myo, stream));
+  if (block != blocks_.end()) {
+    return segment_.blocks[block->second];
+  }
+  auto device = devices_.find(myo);
+  if (device == devices_.end()) {
+    device = devices_.emplace(myo, static_cast<uint16_t>(devices_.size()))
+                 .first;
+  }
+  blocks_.emplace(std::make_pair(myo, stream), segment_.blocks.size());
+  segment_.blocks.emplace_back();
+  core::SensorArchive::Block& new_block = segment_.blocks.back();
+  new_block.stream = stream;
+  new_block.device = device->second;
+  new_block.timestamps.reserve(block_size_);
+  if (stream == Stream::emg) {
+    new_block.emg.reserve(block_size_ * core::SensorArchive::Width(stream));
+  } else {
+    new_block.values.reserve(block_size_ * core::SensorArchive::Width(stream));
+  }
+  return new_block;
+}
+
+void ArchiveWriter::Prepare(uint64_t timestamp) {
+  if (!full_) {
+    return;
+  }
+  flush();
+  if (snapshot_root_ && segments_since_snapshot_ >= snapshot_interval_) {
+    core::FeatureState snapshot;
+    snapshot_root_->saveTreeState(snapshot);
+    index_.snapshots.push_back({timestamp, offset_});
+    offset_ += core::SensorArchive::WriteSnapshot(out_, timestamp, snapshot);
+    segments_since_snapshot_ = 0;
+  }
+}
+
+void ArchiveWriter::Added(const core::SensorArchive::Block& block) {
+  ++samples_;
+  if (block.size() >= block_size_) {
+    full_ = true;
+  }
+}
+}
@@ -1,5 +1,14 @@
 /* Prevents events from propogating to child features. Any event specified in
- * the EventFlags argument in the constructor will be blocked.
+ * the flags will be blocked.
+ *
+ * Blockers are structural: a Blocker isn't a child of its parent feature, but
+ * adds its own child features to its parent with the blocked events removed
+ * from their masks. Blocked events are therefore never dispatched to the
+ * subtree, and events which pass through cost exactly as much as without the
+ * Blocker. Blockers can be nested, and the masks combine.
+ *
+ * Use Blocker<Flags> when the events are known at compile time, and
+ * DynamicBlocker otherwise, e.g. for a FeatureGraph read from a file.
  */
 
 #pragma once
@@ -7,175 +16,54 @@
 #include <myo/myo.hpp>
 
 #include "../core/DeviceListenerWrapper.h"
+#include "../core/Events.h"
 
 namespace features {
-class Blocker : public core::DeviceListenerWrapper {
+class DynamicBlocker : public core::DeviceListenerWrapper {
  public:
-  enum EventFlags {
-    Pair              = 1 << 0,
-    Unpair            = 1 << 1,
-    Connect           = 1 << 2,
-    Disconnect        = 1 << 3,
-    ArmSync           = 1 << 4,
-    ArmUnsync         = 1 << 5,
-    Unlock            = 1 << 6,
-    Lock              = 1 << 7,
-    Pose              = 1 << 8,
-    Gesture           = 1 << 9,
-    OrientationData   = 1 << 10,
-    AccelerometerData = 1 << 11,
-    GyroscopeData     = 1 << 12,
-    Rssi              = 1 << 13,
-    EmgData           = 1 << 14,
-    Periodic          = 1 << 15
-  };
+  typedef core::Events::Flags EventFlags;
 
-  Blocker(core::DeviceListenerWrapper& parent_feature, EventFlags flags);
+  DynamicBlocker(core::DeviceListenerWrapper& parent_feature,
+                 EventFlags flags);
 
-  virtual void onPair(myo::Myo* myo, uint64_t timestamp,
-                      myo::FirmwareVersion firmware_version) override;
-  virtual void onUnpair(myo::Myo* myo, uint64_t timestamp) override;
-  virtual void onConnect(myo::Myo* myo, uint64_t timestamp,
-                         myo::FirmwareVersion firmware_version) override;
-  virtual void onDisconnect(myo::Myo* myo, uint64_t timestamp) override;
-  virtual void onArmSync(myo::Myo* myo, uint64_t timestamp, myo::Arm arm,
-                         myo::XDirection x_direction) override;
-  virtual void onArmUnsync(myo::Myo* myo, uint64_t timestamp) override;
-  virtual void onUnlock(myo::Myo* myo, uint64_t timestamp) override;
-  virtual void onLock(myo::Myo* myo, uint64_t timestamp) override;
-  virtual void onPose(myo::Myo* myo, uint64_t timestamp,
-                      const std::shared_ptr<core::Pose>& pose) override;
-  virtual void onGesture(
-      myo::Myo* myo, uint64_t timestamp,
-      const std::shared_ptr<core::Gesture>& gesture) override;
-  virtual void onOrientationData(
-      myo::Myo* myo, uint64_t timestamp,
-      const myo::Quaternion<float>& rotation) override;
-  virtual void onAccelerometerData(myo::Myo* myo, uint64_t timestamp,
-                                   const myo::Vector3<float>& accel) override;
-  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
-                               const myo::Vector3<float>& gyro) override;
-  virtual void onRssi(myo::Myo* myo, uint64_t timestamp, int8_t rssi) override;
-  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
-                         const int8_t* emg) override;
-  virtual void onPeriodic(myo::Myo* myo) override;
+  virtual void addChildFeature(child_feature_t feature,
+                               int events = core::Events::All) override;
+  virtual void removeChildFeature(child_feature_t feature) override;
+
+  EventFlags flags() const;
 
  private:
+  core::DeviceListenerWrapper& parent_feature_;
   const EventFlags flags_;
 };
 
-Blocker::EventFlags operator|(Blocker::EventFlags lhs,
-                              Blocker::EventFlags rhs) {
-  return static_cast<Blocker::EventFlags>(static_cast<int>(lhs) |
-                                          static_cast<int>(rhs));
-}
-
-Blocker::Blocker(core::DeviceListenerWrapper& parent_feature, EventFlags flags)
-    : flags_(flags) {
-  parent_feature.addChildFeature(this);
-}
-
-void Blocker::onPair(myo::Myo* myo, uint64_t timestamp,
-            myo::FirmwareVersion firmware_version) {
-  if (!(flags_ & Pair)) {
-    core::DeviceListenerWrapper::onPair(myo, timestamp, firmware_version);
-  }
-}
-
-void Blocker::onUnpair(myo::Myo* myo, uint64_t timestamp) {
-  if (!(flags_ & Unpair)) {
-    core::DeviceListenerWrapper::onUnpair(myo, timestamp);
-  }
-}
-
-void Blocker::onConnect(myo::Myo* myo, uint64_t timestamp,
-               myo::FirmwareVersion firmware_version) {
-  if (!(flags_ & Connect)) {
-    core::DeviceListenerWrapper::onConnect(myo, timestamp, firmware_version);
-  }
-}
-
-void Blocker::onDisconnect(myo::Myo* myo, uint64_t timestamp) {
-  if (!(flags_ & Disconnect)) {
-    core::DeviceListenerWrapper::onDisconnect(myo, timestamp);
-  }
-}
-
-void Blocker::onArmSync(myo::Myo* myo, uint64_t timestamp, myo::Arm arm,
-               myo::XDirection x_direction) {
-  if (!(flags_ & ArmSync)) {
-    core::DeviceListenerWrapper::onArmSync(myo, timestamp, arm, x_direction);
-  }
-}
-
-void Blocker::onArmUnsync(myo::Myo* myo, uint64_t timestamp) {
-  if (!(flags_ & ArmUnsync)) {
-    core::DeviceListenerWrapper::onArmUnsync(myo, timestamp);
-  }
-}
-
-void Blocker::onUnlock(myo::Myo* myo, uint64_t timestamp) {
-  if (!(flags_ & Unlock)) {
-    core::DeviceListenerWrapper::onUnlock(myo, timestamp);
-  }
-}
-
-void Blocker::onLock(myo::Myo* myo, uint64_t timestamp) {
-  if (!(flags_ & Lock)) {
-    core::DeviceListenerWrapper::onLock(myo, timestamp);
-  }
-}
-
-void Blocker::onPose(myo::Myo* myo, uint64_t timestamp,
-            const std::shared_ptr<core::Pose>& pose) {
-  if (!(flags_ & Pose)) {
-    core::DeviceListenerWrapper::onPose(myo, timestamp, pose);
-  }
-}
+template <int Flags>
+class Blocker : public DynamicBlocker {
+  static_assert((Flags & ~core::Events::All) == 0, "Unknown events.");
 
-void Blocker::onGesture(myo::Myo* myo, uint64_t timestamp,
-               const std::shared_ptr<core::Gesture>& gesture) {
-  if (!(flags_ & Gesture)) {
-    core::DeviceListenerWrapper::onGesture(myo, timestamp, gesture);
-  }
-}
+ public:
+  explicit Blocker(core::DeviceListenerWrapper& parent_feature);
+};
 
-void Blocker::onOrientationData(myo::Myo* myo, uint64_t timestamp,
-                       const myo::Quaternion<float>& rotation) {
-  if (!(flags_ & OrientationData)) {
-    core::DeviceListenerWrapper::onOrientationData(myo, timestamp, rotation);
-  }
-}
+DynamicBlocker::DynamicBlocker(core::DeviceListenerWrapper& parent_feature,
+                               EventFlags flags)
+    : parent_feature_(parent_feature), flags_(flags) {}
 
-void Blocker::onAccelerometerData(myo::Myo* myo, uint64_t timestamp,
-                         const myo::Vector3<float>& accel) {
-  if (!(flags_ & AccelerometerData)) {
-    core::DeviceListenerWrapper::onAccelerometerData(myo, timestamp, accel);
-  }
+void DynamicBlocker::addChildFeature(child_feature_t feature, int events) {
+  // The children are also kept here, so that events passed to the Blocker
+  // directly are blocked the same way.
+  core::DeviceListenerWrapper::addChildFeature(feature, events & ~flags_);
+  parent_feature_.addChildFeature(feature, events & ~flags_);
 }
 
-void Blocker::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
-                     const myo::Vector3<float>& gyro) {
-  if (!(flags_ & GyroscopeData)) {
-    core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, gyro);
-  }
+void DynamicBlocker::removeChildFeature(child_feature_t feature) {
+  core::DeviceListenerWrapper::removeChildFeature(feature);
+  parent_feature_.removeChildFeature(feature);
 }
 
-void Blocker::onRssi(myo::Myo* myo, uint64_t timestamp, int8_t rssi) {
-  if (!(flags_ & Rssi)) {
-    core::DeviceListenerWrapper::onRssi(myo, timestamp, rssi);
-  }
-}
+DynamicBlocker::EventFlags DynamicBlocker::flags() const { return flags_; }
 
-void Blocker::onEmgData(myo::Myo* myo, uint64_t timestamp, const int8_t* emg) {
-  if (!(flags_ & EmgData)) {
-    core::DeviceListenerWrapper::onEmgData(myo, timestamp, emg);
-  }
-}
-
-void Blocker::onPeriodic(myo::Myo* myo) {
-  if (!(flags_ & Periodic)) {
-    core::DeviceListenerWrapper::onPeriodic(myo);
-  }
-}
+template <int Flags>
+Blocker<Flags>::Blocker(core::DeviceListenerWrapper& parent_feature)
+    : DynamicBlocker(parent_feature, static_cast<EventFlags>(Flags)) {}
 }
@@ -0,0 +1,423 @@
+/* Coalesce decouples its child features from the thread which delivers the
+ * events, so that a slow consumer, like a classifier or a UI callback, doesn't
+ * hold up the Myo hub. Events are queued, and delivered to the child features
+ * in order by dispatch, either on the consumer's own thread or on a thread
+ * started with start.
+ *
+ * While the consumer keeps up every event is delivered. It's overloaded once
+ * the oldest pending event has waited longer than the latency target. A new
+ * sample of a stream in events, by default orientation, accelerometer,
+ * gyroscope and RSSI data and periodic updates, then replaces the pending
+ * sample of the same stream and Myo, so at most one sample per stream is
+ * pending and the latency stays bounded. The new sample takes the place of
+ * the old one at the end of the queue, so it's never delivered before events
+ * which happened before it. Discrete events like poses, gestures, locks and
+ * syncs are never coalesced.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "../core/DeviceListenerWrapper.h"
+#include "../core/Events.h"
+
+namespace features {
+class Coalesce : public core::DeviceListenerWrapper {
+ public:
+  struct Counters {
+    uint64_t received, delivered;
+    // The number of events of each kind which were replaced by a later one,
+    // indexed by core::Events::Index.
+    std::array<uint64_t, core::Events::count> coalesced;
+    // The number of delivered events which waited longer than the latency
+    // target, and the longest wait in microseconds.
+    uint64_t late, max_latency_us;
+    std::size_t max_pending;
+  };
+
+  // Returns the time in microseconds. Defaults to the steady clock.
+  typedef std::function<int64_t()> Clock;
+
+  // The events which are samples of a stream, and can be coalesced.
+  static const int Coalescible =
+      core::Events::OrientationData | core::Events::AccelerometerData |
+      core::Events::GyroscopeData | core::Events::Rssi | core::Events::EmgData |
+      core::Events::EmgFeatures | core::Events::EmgSpectrum |
+      core::Events::SensorFrame | core::Events::Periodic;
+
+  // Throws std::invalid_argument if events contains events which aren't
+  // Coalescible.
+  Coalesce(core::DeviceListenerWrapper& parent_feature,
+           int latency_target_ms = 20,
+           int events = core::Events::OrientationData |
+                        core::Events::AccelerometerData |
+                        core::Events::GyroscopeData | core::Events::Rssi |
+                        core::Events::Periodic,
+           const Clock& clock = Clock());
+  // Stops the dispatch thread, if started.
+  virtual ~Coalesce();
+
+  virtual void onPair(myo::Myo* myo, uint64_t timestamp,
+                      myo::FirmwareVersion firmware_version) override;
+  virtual void onUnpair(myo::Myo* myo, uint64_t timestamp) override;
+  virtual void onConnect(myo::Myo* myo, uint64_t timestamp,
+                         myo::FirmwareVersion firmware_version) override;
+  virtual void onDisconnect(myo::Myo* myo, uint64_t timestamp) override;
+  virtual void onArmSync(myo::Myo* myo, uint64_t timestamp, myo::Arm arm,
+                         myo::XDirection x_direction, float rotation,
+                         myo::WarmupState warmup_state) override;
+  virtual void onArmUnsync(myo::Myo* myo, uint64_t timestamp) override;
+  virtual void onUnlock(myo::Myo* myo, uint64_t timestamp) override;
+  virtual void onLock(myo::Myo* myo, uint64_t timestamp) override;
+  virtual void onPose(myo::Myo* myo, uint64_t timestamp,
+                      const std::shared_ptr<core::Pose>& pose) override;
+  virtual void onGesture(
+      myo::Myo* myo, uint64_t timestamp,
+      const std::shared_ptr<core::Gesture>& gesture) override;
+  virtual void onSpeculativeGesture(
+      myo::Myo* myo, uint64_t timestamp,
+      const std::shared_ptr<core::Gesture>& gesture,
+      core::Gesture::Status status) override;
+  virtual void onOrientationData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Quaternion<float>& rotation) override;
+  virtual void onAccelerometerData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Vector3<float>& acceleration) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+  virtual void onRssi(myo::Myo* myo, uint64_t timestamp, int8_t rssi) override;
+  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) override;
+  virtual void onEmgFeatures(
+      myo::Myo* myo, uint64_t timestamp,
+      const core::EmgFeatureVector& emg_features) override;
+  virtual void onEmgSpectrum(myo::Myo* myo, uint64_t timestamp,
+                             const core::EmgSpectrum& emg_spectrum) override;
+  virtual void onSensorFrame(myo::Myo* myo, uint64_t timestamp,
+                             const core::SensorFrame& frame) override;
+  virtual void onPeriodic(myo::Myo* myo) override;
+
+  // Delivers up to max_events pending events to the child features on the
+  // calling thread, and returns how many were delivered. Must not be called
+  // concurrently with itself or with the dispatch thread.
+  std::size_t dispatch(
+      std::size_t max_events = std::numeric_limits<std::size_t>::max());
+  // Starts or stops a thread which dispatches events as they arrive.
+  void start();
+  void stop();
+
+  std::size_t pending() const;
+  bool overloaded() const;
+  Counters counters() const;
+  void resetCounters();
+
+ private:
+  struct Event {
+    int64_t time;
+    myo::Myo* myo;
+    int event;
+    std::function<void()> deliver;
+  };
+  typedef std::list<Event>::iterator Position;
+
+  // Queues the delivery of an event, coalescing it if necessary.
+  void Enqueue(myo::Myo* myo, int event, std::function<void()> deliver);
+  bool Overloaded(int64_t now) const;
+
+  const int64_t latency_target_us_;
+  const int events_;
+  const Clock clock_;
+  mutable std::mutex mutex_;
+  std::condition_variable condition_;
+  std::list<Event> pending_;
+  // The latest pending sample of each coalesced stream of each Myo.
+  std::map<std::pair<myo::Myo*, int>, Position> latest_;
+  Counters counters_;
+  std::thread thread_;
+  bool stopping_;
+};
+
+Coalesce::Coalesce(core::DeviceListenerWrapper& parent_feature,
+                   int latency_target_ms, int events, const Clock& clock)
+    : latency_target_us_(1000 * static_cast<int64_t>(latency_target_ms)),
+      events_(events),
+      clock_(clock ? clock : Clock([]() {
+        return static_cast<int64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+      })),
+      counters_(),
+      stopping_(false) {
+  if (events & ~Coalescible) {
+    throw std::invalid_argument("Only samples of streams can be coalesced.");
+  }
+  parent_feature.addChildFeature(this);
+}
+
+Coalesce::~Coalesce() { stop(); }
+
+void Coalesce::onPair(myo::Myo* myo, uint64_t timestamp,
+                      myo::FirmwareVersion firmware_version) {
+  Enqueue(myo, core::Events::Pair, [=]() {
+    core::DeviceListenerWrapper::onPair(myo, timestamp, firmware_version);
+  });
+}
+
+void Coalesce::onUnpair(myo::Myo* myo, uint64_t timestamp) {
+  Enqueue(myo, core::Events::Unpair, [=]() {
+    core::DeviceListenerWrapper::onUnpair(myo, timestamp);
+  });
+}
+
+void Coalesce::onConnect(myo::Myo* myo, uint64_t timestamp,
+                         myo::FirmwareVersion firmware_version) {
+  Enqueue(myo, core::Events::Connect, [=]() {
+    core::DeviceListenerWrapper::onConnect(myo, timestamp, firmware_version);
+  });
+}
+
+void Coalesce::onDisconnect(myo::Myo* myo, uint64_t timestamp) {
+  Enqueue(myo, core::Events::Disconnect, [=]() {
+    core::DeviceListenerWrapper::onDisconnect(myo, timestamp);
+  });
+}
+
+void Coalesce::onArmSync(myo::Myo* myo, uint64_t timestamp, myo::Arm arm,
+                         myo::XDirection x_direction, float rotation,
+                         myo::WarmupState warmup_state) {
+  Enqueue(myo, core::Events::ArmSync, [=]() {
+    core::DeviceListenerWrapper::onArmSync(myo, timestamp, arm, x_direction,
+                                           rotation, warmup_state);
+  });
+}
+
+void Coalesce::onArmUnsync(myo::Myo* myo, uint64_t timestamp) {
+  Enqueue(myo, core::Events::ArmUnsync, [=]() {
+    core::DeviceListenerWrapper::onArmUnsync(myo, timestamp);
+  });
+}
+
+void Coalesce::onUnlock(myo::Myo* myo, uint64_t timestamp) {
+  Enqueue(myo, core::Events::Unlock, [=]() {
+    core::DeviceListenerWrapper::onUnlock(myo, timestamp);
+  });
+}
+
+void Coalesce::onLock(myo::Myo* myo, uint64_t timestamp) {
+  Enqueue(myo, core::Events::Lock, [=]() {
+    core::DeviceListenerWrapper::onLock(myo, timestamp);
+  });
+}
+
+void Coalesce::onPose(myo::Myo* myo, uint64_t timestamp,
+                      const std::shared_ptr<core::Pose>& pose) {
+  Enqueue(myo, core::Events::Pose, [=]() {
+    core::DeviceListenerWrapper::onPose(myo, timestamp, pose);
+  });
+}
+
+void Coalesce::onGesture(myo::Myo* myo, uint64_t timestamp,
+                         const std::shared_ptr<core::Gesture>& gesture) {
+  Enqueue(myo, core::Events::Gesture, [=]() {
+    core::DeviceListenerWrapper::onGesture(myo, timestamp, gesture);
+  });
+}
+
+void Coalesce::onSpeculativeGesture(
+    myo::Myo* myo, uint64_t timestamp,
+    const std::shared_ptr<core::Gesture>& gesture,
+    core::Gesture::Status status) {
+  Enqueue(myo, core::Events::SpeculativeGesture, [=]() {
+    core::DeviceListenerWrapper::onSpeculativeGesture(myo, timestamp, gesture,
+                                                      status);
+  });
+}
+
+void Coalesce::onOrientationData(myo::Myo* myo, uint64_t timestamp,
+                                 const myo::Quaternion<float>& rotation) {
+  Enqueue(myo, core::Events::OrientationData, [=]() {
+    core::DeviceListenerWrapper::onOrientationData(myo, timestamp, rotation);
+  });
+}
+
+void Coalesce::onAccelerometerData(myo::Myo* myo, uint64_t timestamp,
+                                   const myo::Vector3<float>& acceleration) {
+  Enqueue(myo, core::Events::AccelerometerData, [=]() {
+    core::DeviceListenerWrapper::onAccelerometerData(myo, timestamp,
+                                                     acceleration);
+  });
+}
+
+void Coalesce::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) {
+  Enqueue(myo, core::Events::GyroscopeData, [=]() {
+    core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, gyro);
+  });
+}
+
+void Coalesce::onRssi(myo::Myo* myo, uint64_t timestamp, int8_t rssi) {
+  Enqueue(myo, core::Events::Rssi, [=]() {
+    core::DeviceListenerWrapper::onRssi(myo, timestamp, rssi);
+  });
+}
+
+void Coalesce::onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) {
+  std::array<int8_t, 8> data;
+  std::copy(emg, emg + data.size(), data.begin());
+  Enqueue(myo, core::Events::EmgData, [=]() {
+    core::DeviceListenerWrapper::onEmgData(myo, timestamp, data.data());
+  });
+}
+
+void Coalesce::onEmgFeatures(myo::Myo* myo, uint64_t timestamp,
+                             const core::EmgFeatureVector& emg_features) {
+  Enqueue(myo, core::Events::EmgFeatures, [=]() {
+    core::DeviceListenerWrapper::onEmgFeatures(myo, timestamp, emg_features);
+  });
+}
+
+void Coalesce::onEmgSpectrum(myo::Myo* myo, uint64_t timestamp,
+                             const core::EmgSpectrum& emg_spectrum) {
+  Enqueue(myo, core::Events::EmgSpectrum, [=]() {
+    core::DeviceListenerWrapper::onEmgSpectrum(myo, timestamp, emg_spectrum);
+  });
+}
+
+void Coalesce::onSensorFrame(myo::Myo* myo, uint64_t timestamp,
+                             const core::SensorFrame& frame) {
+  Enqueue(myo, core::Events::SensorFrame, [=]() {
+    core::DeviceListenerWrapper::onSensorFrame(myo, timestamp, frame);
+  });
+}
+
+void Coalesce::onPeriodic(myo::Myo* myo) {
+  Enqueue(myo, core::Events::Periodic,
+          [=]() { core::DeviceListenerWrapper::onPeriodic(myo); });
+}
+
+std::size_t Coalesce::dispatch(std::size_t max_events) {
+  std::size_t delivered = 0;
+  while (delivered < max_events) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (pending_.empty()) {
+      break;
+    }
+    Event event = std::move(pending_.front());
+    auto latest = latest_.find(std::make_pair(event.myo, event.event));
+    if (latest != latest_.end() && latest->second == pending_.begin()) {
+      latest_.erase(latest);
+    }
+    pending_.pop_front();
+    uint64_t latency =
+        static_cast<uint64_t>(std::max<int64_t>(clock_() - event.time, 0));
+    ++counters_.delivered;
+    if (latency > static_cast<uint64_t>(latency_target_us_)) {
+      ++counters_.late;
+    }
+    counters_.max_latency_us = std::max(counters_.max_latency_us, latency);
+    // Deliver without the lock, so that events can be queued meanwhile.
+    lock.unlock();
+    event.deliver();
+    ++delivered;
+  }
+  return delivered;
+}
+
+void Coalesce::start() {
+  if (thread_.joinable()) {
+    return;
+  }
+  thread_ = std::thread([this]() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      condition_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+      if (stopping_) {
+        break;
+      }
+      lock.unlock();
+      dispatch();
+      lock.lock();
+    }
+  });
+}
+
+void Coalesce::stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_one();
+  thread_.join();
+  stopping_ = false;
+}
+
+std::size_t Coalesce::pending() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_.size();
+}
+
+bool Coalesce::overloaded() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return Overloaded(clock_());
+}
+
+Coalesce::Counters Coalesce::counters() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return counters_;
+}
+
+void Coalesce::resetCounters() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  counters_ = Counters();
+}
+
+void Coalesce::Enqueue(myo::Myo* myo, int event,
+                       std::function<void()> deliver) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t now = clock_();
+    const auto key = std::make_pair(myo, event);
+    if (events_ & event) {
+      auto latest = latest_.find(key);
+      if (latest != latest_.end() && Overloaded(now)) {
+        pending_.erase(latest->second);
+        ++counters_.coalesced[core::Events::Index(event)];
+      }
+    }
+    Event entry = {now, myo, event, std::move(deliver)};
+    pending_.push_back(std::move(entry));
+    if (events_ & event) {
+      latest_[key] = std::prev(pending_.end());
+    }
+    ++counters_.received;
+    counters_.max_pending = std::max(counters_.max_pending, pending_.size());
+  }
+  condition_.notify_one();
+}
+
+bool Coalesce::Overloaded(int64_t now) const {
+  return !pending_.empty() &&
+         now - pending_.front().time > latency_target_us_;
+}
+}
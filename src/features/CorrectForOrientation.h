@@ -1,6 +1,10 @@
 /* Uses the Myo's orientation to rotate accelerometer and / or gyroscope data
  * such that it is the same regardless of orientation. This makes accelerometer
  * and gyroscope data consistent no matter the Myo's orientation on the arm.
+ *
+ * The orientation is converted to a rotation matrix once per orientation
+ * sample, which is then reused for all accelerometer and gyroscope samples
+ * until the next one.
  */
 
 #pragma once
@@ -8,6 +12,7 @@
 #include <myo/myo.hpp>
 
 #include "../core/DeviceListenerWrapper.h"
+#include "../core/OrientationUtility.h"
 
 namespace features {
 class CorrectForOrientation : public core::DeviceListenerWrapper {
@@ -27,9 +32,15 @@ class CorrectForOrientation : public core::DeviceListenerWrapper {
   virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
                                const myo::Vector3<float>& gyro) override;
 
+  // Rotates count vectors stored as consecutive x, y, z values by the last
+  // orientation, e.g. all of the samples of a recording that share it.
+  // vectors and rotated may be the same array.
+  void rotateVectors(const float* vectors, std::size_t count,
+                     float* rotated) const;
+
  private:
   const DataFlags flags_;
-  myo::Quaternion<float> last_quat_;
+  core::OrientationUtility::RotationMatrix rotation_matrix_;
 };
 
 CorrectForOrientation::DataFlags operator|(
@@ -41,20 +52,22 @@ CorrectForOrientation::DataFlags operator|(
 
 CorrectForOrientation::CorrectForOrientation(
     core::DeviceListenerWrapper& parent_feature, DataFlags flags)
-    : flags_(flags), last_quat_(0, 0, 0, 1) {
+    : flags_(flags),
+      rotation_matrix_(core::OrientationUtility::QuaternionToRotationMatrix(
+          myo::Quaternion<float>(0, 0, 0, 1))) {
   parent_feature.addChildFeature(this);
 }
 
 void CorrectForOrientation::onOrientationData(
     myo::Myo* myo, uint64_t timestamp, const myo::Quaternion<float>& quat) {
-  last_quat_ = quat;
+  rotation_matrix_ = core::OrientationUtility::QuaternionToRotationMatrix(quat);
   core::DeviceListenerWrapper::onOrientationData(myo, timestamp, quat);
 }
 
 void CorrectForOrientation::onAccelerometerData(
     myo::Myo* myo, uint64_t timestamp, const myo::Vector3<float>& accel) {
   if (flags_ & AccelerometerData) {
-    auto rotated = rotate(last_quat_, accel);
+    auto rotated = core::OrientationUtility::Rotate(rotation_matrix_, accel);
     core::DeviceListenerWrapper::onAccelerometerData(myo, timestamp, rotated);
   } else {
     core::DeviceListenerWrapper::onAccelerometerData(myo, timestamp, accel);
@@ -64,10 +77,17 @@ void CorrectForOrientation::onAccelerometerData(
 void CorrectForOrientation::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
                                             const myo::Vector3<float>& gyro) {
   if (flags_ & GyroscopeData) {
-    auto rotated = rotate(last_quat_, gyro);
+    auto rotated = core::OrientationUtility::Rotate(rotation_matrix_, gyro);
     core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, rotated);
   } else {
     core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, gyro);
   }
 }
+
+void CorrectForOrientation::rotateVectors(const float* vectors,
+                                          std::size_t count,
+                                          float* rotated) const {
+  core::OrientationUtility::RotateVectors(rotation_matrix_, vectors, count,
+                                          rotated);
+}
 }
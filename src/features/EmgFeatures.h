@@ -0,0 +1,199 @@
+/* Extracts time-domain features from the raw EMG stream. For each of the eight
+ * channels the root mean square, mean absolute value, waveform length, zero
+ * crossings and slope sign changes are maintained over a sliding window of
+ * samples. Every hop_size samples (once the window is full) the features are
+ * emitted to the child features via onEmgFeatures. Raw EMG data is passed on
+ * unmodified.
+ *
+ * Each sample's contribution to the running sums is stored in a ring buffer
+ * and subtracted again once it leaves the window, so an update is O(1) in the
+ * window size. The per-channel loops work on fixed size arrays of 32 bit
+ * integers so that the compiler can vectorize them across channels.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <array>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "../core/DeviceListenerWrapper.h"
+#include "../core/EmgFeatureVector.h"
+
+namespace features {
+class EmgFeatures : public core::DeviceListenerWrapper {
+ public:
+  // Changes in amplitude smaller than threshold are not counted as zero
+  // crossings or slope sign changes. Throws std::invalid_argument unless
+  // window_size and hop_size are positive.
+  EmgFeatures(core::DeviceListenerWrapper& parent_feature, int window_size = 40,
+              int hop_size = 10, int threshold = 0);
+
+  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) override;
+
+  const core::EmgFeatureVector& getFeatures() const;
+
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
+
+ private:
+  static const std::size_t numChannels = core::EmgFeatureVector::numChannels;
+  typedef std::array<int32_t, numChannels> Channels;
+
+  // The amount a single sample adds to each of the running sums.
+  struct Contribution {
+    Channels square, absolute, absolute_difference, zero_crossing,
+        slope_sign_change;
+  };
+
+  // Throws std::invalid_argument unless size is positive.
+  static std::size_t CheckSize(int size, const std::string& name);
+
+  void UpdateFeatures();
+
+  const std::size_t window_size_, hop_size_;
+  const int32_t threshold_;
+  std::vector<Contribution> window_;
+  std::size_t next_, num_samples_, samples_since_emit_;
+  Channels previous_, previous_2_;
+  Contribution sums_;
+  core::EmgFeatureVector features_;
+};
+
+EmgFeatures::EmgFeatures(core::DeviceListenerWrapper& parent_feature,
+                         int window_size, int hop_size, int threshold)
+    : window_size_(CheckSize(window_size, "window size")),
+      hop_size_(CheckSize(hop_size, "hop size")),
+      threshold_(threshold),
+      window_(window_size_),
+      next_(0),
+      num_samples_(0),
+      samples_since_emit_(0),
+      previous_(),
+      previous_2_(),
+      sums_(),
+      features_() {
+  parent_feature.addChildFeature(this);
+}
+
+std::size_t EmgFeatures::CheckSize(int size, const std::string& name) {
+  if (size <= 0) {
+    throw std::invalid_argument("The " + name + " must be positive.");
+  }
+  return size;
+}
+
+void EmgFeatures::onEmgData(myo::Myo* myo, uint64_t timestamp,
+                            const int8_t* emg) {
+  Contribution& contribution = window_[next_];
+  if (num_samples_ >= window_size_) {
+    for (std::size_t i = 0; i < numChannels; ++i) {
+      sums_.square[i] -= contribution.square[i];
+      sums_.absolute[i] -= contribution.absolute[i];
+      sums_.absolute_difference[i] -= contribution.absolute_difference[i];
+      sums_.zero_crossing[i] -= contribution.zero_crossing[i];
+      sums_.slope_sign_change[i] -= contribution.slope_sign_change[i];
+    }
+  }
+
+  // Differences are only meaningful once the previous samples exist.
+  const int32_t has_previous = num_samples_ >= 1;
+  const int32_t has_previous_2 = num_samples_ >= 2;
+  for (std::size_t i = 0; i < numChannels; ++i) {
+    const int32_t x = emg[i];
+    const int32_t difference = x - previous_[i];
+    const int32_t absolute_difference =
+        difference < 0 ? -difference : difference;
+    const int32_t slope = previous_[i] - previous_2_[i];
+    const int32_t absolute_slope = slope < 0 ? -slope : slope;
+    contribution.square[i] = x * x;
+    contribution.absolute[i] = x < 0 ? -x : x;
+    contribution.absolute_difference[i] = has_previous * absolute_difference;
+    contribution.zero_crossing[i] =
+        has_previous * (x * previous_[i] < 0) *
+        (absolute_difference >= threshold_);
+    // The slope sign change is attributed to the newest sample, although it
+    // occurs at the previous one.
+    contribution.slope_sign_change[i] =
+        has_previous_2 * (slope * -difference > 0) *
+        ((absolute_slope >= threshold_) | (absolute_difference >= threshold_));
+    previous_2_[i] = previous_[i];
+    previous_[i] = x;
+  }
+
+  for (std::size_t i = 0; i < numChannels; ++i) {
+    sums_.square[i] += contribution.square[i];
+    sums_.absolute[i] += contribution.absolute[i];
+    sums_.absolute_difference[i] += contribution.absolute_difference[i];
+    sums_.zero_crossing[i] += contribution.zero_crossing[i];
+    sums_.slope_sign_change[i] += contribution.slope_sign_change[i];
+  }
+
+  next_ = (next_ + 1) % window_size_;
+  ++num_samples_;
+  ++samples_since_emit_;
+
+  core::DeviceListenerWrapper::onEmgData(myo, timestamp, emg);
+
+  if (num_samples_ >= window_size_ && samples_since_emit_ >= hop_size_) {
+    samples_since_emit_ = 0;
+    UpdateFeatures();
+    core::DeviceListenerWrapper::onEmgFeatures(myo, timestamp, features_);
+  }
+}
+
+const core::EmgFeatureVector& EmgFeatures::getFeatures() const {
+  return features_;
+}
+
+void EmgFeatures::saveState(core::FeatureState& state) const {
+  state.put<uint32_t>(static_cast<uint32_t>(window_size_));
+  for (const Contribution& contribution : window_) {
+    state.put<Contribution>(contribution);
+  }
+  state.put<uint32_t>(static_cast<uint32_t>(next_));
+  state.put<uint64_t>(num_samples_);
+  state.put<uint32_t>(static_cast<uint32_t>(samples_since_emit_));
+  state.put<Channels>(previous_);
+  state.put<Channels>(previous_2_);
+  state.put<Contribution>(sums_);
+}
+
+void EmgFeatures::loadState(core::FeatureState& state) {
+  if (state.get<uint32_t>() != window_size_) {
+    throw std::runtime_error(
+        "The window size of the EMG features has changed.");
+  }
+  for (Contribution& contribution : window_) {
+    contribution = state.get<Contribution>();
+  }
+  next_ = state.get<uint32_t>() % window_size_;
+  num_samples_ = state.get<uint64_t>();
+  samples_since_emit_ = state.get<uint32_t>();
+  previous_ = state.get<Channels>();
+  previous_2_ = state.get<Channels>();
+  sums_ = state.get<Contribution>();
+}
+
+void EmgFeatures::UpdateFeatures() {
+  using core::EmgFeatureVector;
+  const float inverse_window_size = 1.f / window_size_;
+  for (std::size_t i = 0; i < numChannels; ++i) {
+    features_(EmgFeatureVector::rms, i) =
+        std::sqrt(sums_.square[i] * inverse_window_size);
+    features_(EmgFeatureVector::meanAbsoluteValue, i) =
+        sums_.absolute[i] * inverse_window_size;
+    features_(EmgFeatureVector::waveformLength, i) =
+        static_cast<float>(sums_.absolute_difference[i]);
+    features_(EmgFeatureVector::zeroCrossings, i) =
+        static_cast<float>(sums_.zero_crossing[i]);
+    features_(EmgFeatureVector::slopeSignChanges, i) =
+        static_cast<float>(sums_.slope_sign_change[i]);
+  }
+}
+}
@@ -0,0 +1,189 @@
+/* EmgPoses classifies the EMG features emitted by EmgFeatures with a linear
+ * discriminant model, so that users can train their own poses in addition to
+ * the ones recognized by the Myo. Whenever the classified pose changes it is
+ * emitted to the child features via onPose, so filters such as Debounce and
+ * gestures such as PoseGestures work on custom poses unchanged. Poses from
+ * the Myo itself are blocked unless forward_device_poses is set.
+ *
+ * Each class of the model is emitted as the pose registered for it with
+ * registerPose. Classes named after one of the Myo's poses default to that
+ * core::Pose, all other classes to an EmgPoses::Pose with the class name.
+ * Models are trained offline with the train_emg_poses tool, using the same
+ * EmgFeatures window and hop size as at run time.
+ *
+ * Since the electrodes rarely end up in the same place after taking the
+ * armband off, the model can be adapted at run time: calibrate labels the next
+ * few windows as one class and adapts the model to each of them, and
+ * calibrateOnArmSync does the same after every arm sync, e.g. with the user
+ * holding the rest pose after the sync gesture.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../core/DeviceListenerWrapper.h"
+#include "../core/EmgFeatureVector.h"
+#include "../core/LinearDiscriminant.h"
+#include "../core/Pose.h"
+
+namespace features {
+class EmgPoses : public core::DeviceListenerWrapper {
+ public:
+  class Pose : public core::Pose {
+   public:
+    Pose(const std::string& name);
+
+    virtual std::string toString() const override;
+
+   private:
+    const std::string name_;
+  };
+
+  // Throws std::invalid_argument if the model doesn't take an
+  // EmgFeatureVector as input.
+  EmgPoses(core::DeviceListenerWrapper& parent_feature,
+           const core::LinearDiscriminant& model,
+           bool forward_device_poses = false);
+
+  virtual void onPose(myo::Myo* myo, uint64_t timestamp,
+                      const std::shared_ptr<core::Pose>& pose) override;
+  virtual void onEmgFeatures(myo::Myo* myo, uint64_t timestamp,
+                             const core::EmgFeatureVector& features) override;
+  virtual void onArmSync(myo::Myo* myo, uint64_t timestamp, myo::Arm arm,
+                         myo::XDirection x_direction, float rotation,
+                         myo::WarmupState warmup_state) override;
+
+  // Emits pose whenever the model classifies a window as class_name.
+  void registerPose(const std::string& class_name,
+                    const std::shared_ptr<core::Pose>& pose);
+
+  // Adapts the model to the next num_windows windows as samples of
+  // class_name, see LinearDiscriminant::adapt for rate. Throws
+  // std::invalid_argument if there is no such class, or std::runtime_error if
+  // the model isn't adaptive.
+  void calibrate(const std::string& class_name, std::size_t num_windows,
+                 float rate = 0.05f);
+  // Calls calibrate with these arguments after every arm sync.
+  void calibrateOnArmSync(const std::string& class_name,
+                          std::size_t num_windows, float rate = 0.05f);
+
+  const core::LinearDiscriminant& model() const;
+
+ private:
+  struct Calibration {
+    std::size_t class_index, num_windows;
+    float rate;
+  };
+
+  // Throws the same exceptions as calibrate.
+  Calibration MakeCalibration(const std::string& class_name,
+                              std::size_t num_windows, float rate) const;
+
+  core::LinearDiscriminant model_;
+  const bool forward_device_poses_;
+  std::vector<std::shared_ptr<core::Pose>> poses_;
+  // The last emitted class, or -1 before the first window.
+  int last_class_;
+  // The calibration in progress, and the one started on arm sync. No
+  // calibration is done while num_windows is zero.
+  Calibration calibration_, arm_sync_calibration_;
+};
+
+EmgPoses::Pose::Pose(const std::string& name) : core::Pose(), name_(name) {}
+
+std::string EmgPoses::Pose::toString() const { return name_; }
+
+EmgPoses::EmgPoses(core::DeviceListenerWrapper& parent_feature,
+                   const core::LinearDiscriminant& model,
+                   bool forward_device_poses)
+    : model_(model),
+      forward_device_poses_(forward_device_poses),
+      last_class_(-1),
+      calibration_(),
+      arm_sync_calibration_() {
+  if (model.numFeatures() != core::EmgFeatureVector::size) {
+    throw std::invalid_argument("EmgPoses model has the wrong input size.");
+  }
+  for (std::size_t c = 0; c < model.numClasses(); ++c) {
+    const std::string& name = model.className(c);
+    std::shared_ptr<core::Pose> pose = core::Pose::fromString(name);
+    poses_.push_back(pose ? pose : std::make_shared<Pose>(name));
+  }
+  parent_feature.addChildFeature(this);
+}
+
+void EmgPoses::onPose(myo::Myo* myo, uint64_t timestamp,
+                      const std::shared_ptr<core::Pose>& pose) {
+  if (forward_device_poses_) {
+    core::DeviceListenerWrapper::onPose(myo, timestamp, pose);
+  }
+}
+
+void EmgPoses::onEmgFeatures(myo::Myo* myo, uint64_t timestamp,
+                             const core::EmgFeatureVector& features) {
+  core::DeviceListenerWrapper::onEmgFeatures(myo, timestamp, features);
+  if (calibration_.num_windows > 0) {
+    model_.adapt(features.data(), calibration_.class_index, calibration_.rate);
+    --calibration_.num_windows;
+  }
+  int current_class = static_cast<int>(model_.classify(features.data()));
+  if (current_class != last_class_) {
+    last_class_ = current_class;
+    core::DeviceListenerWrapper::onPose(myo, timestamp, poses_[current_class]);
+  }
+}
+
+void EmgPoses::registerPose(const std::string& class_name,
+                            const std::shared_ptr<core::Pose>& pose) {
+  for (std::size_t c = 0; c < model_.numClasses(); ++c) {
+    if (model_.className(c) == class_name) {
+      poses_[c] = pose;
+    }
+  }
+}
+
+void EmgPoses::onArmSync(myo::Myo* myo, uint64_t timestamp, myo::Arm arm,
+                         myo::XDirection x_direction, float rotation,
+                         myo::WarmupState warmup_state) {
+  if (arm_sync_calibration_.num_windows > 0) {
+    calibration_ = arm_sync_calibration_;
+  }
+  core::DeviceListenerWrapper::onArmSync(myo, timestamp, arm, x_direction,
+                                         rotation, warmup_state);
+}
+
+void EmgPoses::calibrate(const std::string& class_name,
+                         std::size_t num_windows, float rate) {
+  calibration_ = MakeCalibration(class_name, num_windows, rate);
+}
+
+void EmgPoses::calibrateOnArmSync(const std::string& class_name,
+                                  std::size_t num_windows, float rate) {
+  arm_sync_calibration_ = MakeCalibration(class_name, num_windows, rate);
+}
+
+const core::LinearDiscriminant& EmgPoses::model() const { return model_; }
+
+EmgPoses::Calibration EmgPoses::MakeCalibration(const std::string& class_name,
+                                                std::size_t num_windows,
+                                                float rate) const {
+  if (!model_.adaptive()) {
+    throw std::runtime_error("EmgPoses model isn't adaptive.");
+  }
+  if (!(rate > 0.f && rate < 1.f)) {
+    throw std::invalid_argument("EmgPoses calibration rate out of range.");
+  }
+  for (std::size_t c = 0; c < model_.numClasses(); ++c) {
+    if (model_.className(c) == class_name) {
+      Calibration calibration = {c, num_windows, rate};
+      return calibration;
+    }
+  }
+  throw std::invalid_argument("EmgPoses has no class " + class_name + ".");
+}
+}
@@ -0,0 +1,224 @@
+/* Computes a short-time Fourier transform of the EMG stream. Every hop_size
+ * samples (once fft_size samples have been received) the last fft_size
+ * samples of each channel are multiplied by a Hann window and transformed, and
+ * the resulting power spectrum, mean and median frequencies and band powers are
+ * emitted to the child features via onEmgSpectrum. Raw EMG data is passed on
+ * unmodified.
+ *
+ * The eight real channels are transformed as four complex signals in a single
+ * batched FFT. The window, twiddle factors and all buffers are created in the
+ * constructor, so no memory is allocated while processing data.
+ */
+
+#pragma once
+
+/* for MSVC++ */
+#define _USE_MATH_DEFINES
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../core/DeviceListenerWrapper.h"
+#include "../core/EmgSpectrum.h"
+#include "../core/FastFourierTransform.h"
+#include "../core/SlidingWindow.h"
+
+namespace features {
+class EmgSpectrogram : public core::DeviceListenerWrapper {
+ public:
+  // band_edges are the edges of consecutive frequency bands in Hz, so n edges
+  // define n - 1 bands. fft_size must be a power of two and hop_size
+  // positive, or std::invalid_argument is thrown.
+  EmgSpectrogram(core::DeviceListenerWrapper& parent_feature,
+                 int fft_size = 64, int hop_size = 16,
+                 float sample_rate = 200.f,
+                 const std::vector<float>& band_edges = {10.f, 30.f, 50.f,
+                                                         75.f, 100.f});
+
+  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) override;
+
+  const core::EmgSpectrum& getSpectrum() const;
+
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
+
+ private:
+  static const std::size_t numChannels = core::EmgSpectrum::numChannels;
+  static const std::size_t numPairs = numChannels / 2;
+
+  static std::size_t CheckSize(int size, const std::string& name);
+  void UpdateSpectrum();
+
+  const std::size_t fft_size_, hop_size_, num_bins_;
+  const core::FastFourierTransform fft_;
+  std::vector<float> window_;
+  core::SlidingWindow<float> history_;
+  std::vector<float> real_, imag_, power_even_, power_odd_;
+  // The band each bin belongs to, or -1 if it is outside of all bands.
+  std::vector<int> bin_band_;
+  std::size_t samples_since_emit_;
+  core::EmgSpectrum spectrum_;
+};
+
+EmgSpectrogram::EmgSpectrogram(core::DeviceListenerWrapper& parent_feature,
+                               int fft_size, int hop_size, float sample_rate,
+                               const std::vector<float>& band_edges)
+    : fft_size_(CheckSize(fft_size, "FFT size")),
+      hop_size_(CheckSize(hop_size, "hop size")),
+      num_bins_(fft_size_ / 2 + 1),
+      // Checks that fft_size is a power of two before the buffers below are
+      // allocated.
+      fft_(fft_size_, numPairs),
+      window_(fft_size_),
+      history_(fft_size_, numChannels),
+      real_(fft_size_ * numPairs),
+      imag_(fft_size_ * numPairs),
+      power_even_(num_bins_ * numPairs),
+      power_odd_(num_bins_ * numPairs),
+      bin_band_(num_bins_, -1),
+      samples_since_emit_(0),
+      spectrum_(num_bins_, sample_rate / fft_size_,
+                band_edges.empty() ? 0 : band_edges.size() - 1) {
+  // Hann window, normalized so that the power is independent of fft_size.
+  float window_energy = 0.f;
+  for (std::size_t n = 0; n < fft_size_; ++n) {
+    window_[n] = 0.5f - 0.5f * std::cos(2 * M_PI * n / fft_size_);
+    window_energy += window_[n] * window_[n];
+  }
+  for (auto& w : window_) {
+    w /= std::sqrt(window_energy);
+  }
+  for (std::size_t k = 0; k < num_bins_; ++k) {
+    float frequency = k * spectrum_.binWidth();
+    for (std::size_t band = 0; band + 1 < band_edges.size(); ++band) {
+      if (frequency >= band_edges[band] && frequency < band_edges[band + 1]) {
+        bin_band_[k] = band;
+        break;
+      }
+    }
+  }
+  parent_feature.addChildFeature(this);
+}
+
+std::size_t EmgSpectrogram::CheckSize(int size, const std::string& name) {
+  if (size <= 0) {
+    throw std::invalid_argument("The " + name + " must be positive.");
+  }
+  return size;
+}
+
+void EmgSpectrogram::onEmgData(myo::Myo* myo, uint64_t timestamp,
+                               const int8_t* emg) {
+  float sample[numChannels];
+  std::copy(emg, emg + numChannels, sample);
+  history_.push(sample);
+  ++samples_since_emit_;
+
+  core::DeviceListenerWrapper::onEmgData(myo, timestamp, emg);
+
+  if (history_.full() && samples_since_emit_ >= hop_size_) {
+    samples_since_emit_ = 0;
+    UpdateSpectrum();
+    core::DeviceListenerWrapper::onEmgSpectrum(myo, timestamp, spectrum_);
+  }
+}
+
+const core::EmgSpectrum& EmgSpectrogram::getSpectrum() const {
+  return spectrum_;
+}
+
+void EmgSpectrogram::saveState(core::FeatureState& state) const {
+  state.put<uint32_t>(static_cast<uint32_t>(fft_size_));
+  // Only the samples received so far, which are the last ones of the window.
+  const std::size_t num_samples = history_.numSamples();
+  state.put<uint32_t>(static_cast<uint32_t>(num_samples));
+  const float* samples =
+      history_.data() + (fft_size_ - num_samples) * numChannels;
+  for (std::size_t i = 0; i < num_samples * numChannels; ++i) {
+    state.put<float>(samples[i]);
+  }
+  state.put<uint32_t>(static_cast<uint32_t>(samples_since_emit_));
+}
+
+void EmgSpectrogram::loadState(core::FeatureState& state) {
+  if (state.get<uint32_t>() != fft_size_) {
+    throw std::runtime_error("The FFT size of the spectrogram has changed.");
+  }
+  const uint32_t num_samples = state.get<uint32_t>();
+  if (num_samples > fft_size_) {
+    throw std::runtime_error("The spectrogram has too many samples.");
+  }
+  history_.clear();
+  for (uint32_t n = 0; n < num_samples; ++n) {
+    float sample[numChannels];
+    for (float& value : sample) {
+      value = state.get<float>();
+    }
+    history_.push(sample);
+  }
+  samples_since_emit_ = state.get<uint32_t>();
+}
+
+void EmgSpectrogram::UpdateSpectrum() {
+  const float* samples = history_.data();
+  for (std::size_t n = 0; n < fft_size_; ++n) {
+    for (std::size_t p = 0; p < numPairs; ++p) {
+      real_[n * numPairs + p] = window_[n] * samples[n * numChannels + 2 * p];
+      imag_[n * numPairs + p] =
+          window_[n] * samples[n * numChannels + 2 * p + 1];
+    }
+  }
+  fft_.transform(real_.data(), imag_.data());
+  fft_.splitRealSpectra(real_.data(), imag_.data(), power_even_.data(),
+                        power_odd_.data());
+
+  for (std::size_t band = 0; band < spectrum_.numBands(); ++band) {
+    spectrum_.bandPower(band).fill(0.f);
+  }
+  core::EmgSpectrum::Channels weighted_sum = {};
+  spectrum_.totalPower().fill(0.f);
+  for (std::size_t k = 0; k < num_bins_; ++k) {
+    core::EmgSpectrum::Channels& power = spectrum_.power(k);
+    // Fold the negative frequencies into the one-sided spectrum.
+    float scale = (k == 0 || 2 * k == fft_size_) ? 1.f : 2.f;
+    for (std::size_t p = 0; p < numPairs; ++p) {
+      power[2 * p] = scale * power_even_[k * numPairs + p];
+      power[2 * p + 1] = scale * power_odd_[k * numPairs + p];
+    }
+    if (k == 0) {
+      continue;
+    }
+    float frequency = k * spectrum_.binWidth();
+    for (std::size_t i = 0; i < numChannels; ++i) {
+      spectrum_.totalPower()[i] += power[i];
+      weighted_sum[i] += frequency * power[i];
+    }
+    if (bin_band_[k] >= 0) {
+      core::EmgSpectrum::Channels& band_power =
+          spectrum_.bandPower(bin_band_[k]);
+      for (std::size_t i = 0; i < numChannels; ++i) {
+        band_power[i] += power[i];
+      }
+    }
+  }
+
+  for (std::size_t i = 0; i < numChannels; ++i) {
+    float total = spectrum_.totalPower()[i];
+    spectrum_.meanFrequency()[i] = total > 0.f ? weighted_sum[i] / total : 0.f;
+    float cumulative = 0.f;
+    spectrum_.medianFrequency()[i] = 0.f;
+    for (std::size_t k = 1; k < num_bins_ && total > 0.f; ++k) {
+      cumulative += spectrum_.power(k)[i];
+      if (cumulative >= 0.5f * total) {
+        spectrum_.medianFrequency()[i] = k * spectrum_.binWidth();
+        break;
+      }
+    }
+  }
+}
+}
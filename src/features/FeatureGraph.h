@@ -0,0 +1,670 @@
+/* FeatureGraph builds a tree of features from a declarative description, such
+ * as a JSON file, instead of constructing each feature by hand:
+ *
+ *   {"features": [
+ *     {"type": "Debounce", "timeout_ms": 10, "children": [
+ *       {"type": "PoseGestures", "name": "gestures"}]},
+ *     {"type": "ExponentialMovingAverage", "flags": "AccelerometerData",
+ *      "alpha": 0.2, "children": [
+ *       {"type": "Orientation", "name": "orientation"}]}]}
+ *
+ * Every feature has a type, an optional name and the parameters of its type.
+ * The application attaches its own features to named ones with get, or
+ * registers its own types with registerType. Features which need another
+ * feature, like OrientationPoses, refer to it by name, which has to occur
+ * earlier in the description.
+ *
+ * Before building, the description is optimized into the cheapest equivalent
+ * tree:
+ *  - A Blocker, ExponentialMovingAverage or CascadedExponentialMovingAverage
+ *    whose only child is a feature of the same kind is fused with it, so each
+ *    event is dispatched once instead of twice. Chains of exponential moving
+ *    averages become one CascadedExponentialMovingAverage, since a cascade of
+ *    them isn't a single exponential moving average. Blockers cost nothing
+ *    per event, see Blocker.h, so fusing them only saves a feature.
+ *  - Subtrees which can never receive an event because the Blockers above
+ *    them block every event are dropped, as are pure features without
+ *    children, i.e. filters whose output nobody sees.
+ *  - Pass-through features, i.e. Groups, Blockers which block nothing and
+ *    filters of no stream, are replaced with their children.
+ * Named features are the application's handles into the tree, so they are
+ * never fused, collapsed or dropped: named features in an unreachable
+ * subtree are built below a Detached feature instead, which never receives
+ * events.
+ *
+ * The features are owned by the FeatureGraph, which has to outlive the
+ * delivery of events to them.
+ */
+
+#pragma once
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../core/DeviceListenerWrapper.h"
+#include "Blocker.h"
+#include "Coalesce.h"
+#include "Group.h"
+#include "Orientation.h"
+#include "OrientationPoses.h"
+#include "SharedMemoryPublisher.h"
+#include "filters/CascadedExponentialMovingAverage.h"
+#include "filters/Debounce.h"
+#include "filters/Decimate.h"
+#include "filters/ExponentialMovingAverage.h"
+#include "filters/MovingAverage.h"
+#include "gestures/PoseGestures.h"
+
+namespace features {
+class FeatureGraph {
+ public:
+  struct Node {
+    std::string type;
+    // Empty for anonymous features, which the optimizer may remove.
+    std::string name;
+    // All properties of the feature in the description but its children.
+    boost::property_tree::ptree params;
+    std::vector<Node> children;
+  };
+
+  struct Statistics {
+    // The number of features removed by each optimization.
+    std::size_t fused, collapsed, dropped;
+  };
+
+  // Creates the feature described by node as a child of parent_feature. The
+  // parameters are read from node.params, and may throw any
+  // boost::property_tree::ptree_error. Invalid parameters throw
+  // std::invalid_argument, and resources which can't be acquired, like shared
+  // memory or threads, throw std::runtime_error.
+  typedef std::function<std::unique_ptr<core::DeviceListenerWrapper>(
+      core::DeviceListenerWrapper& parent_feature, const Node& node,
+      FeatureGraph& graph)> Factory;
+
+  // Reads the list of features under "features" of config. Throws
+  // std::invalid_argument if a feature has no type.
+  static std::vector<Node> Parse(const boost::property_tree::ptree& config);
+  // Throws std::invalid_argument if in isn't a valid JSON description.
+  static std::vector<Node> ParseJson(std::istream& in);
+  // Parses flags separated by "|", such as "Pose|Gesture", where names[i] is
+  // the name of the flag 1 << i. Throws std::invalid_argument for unknown
+  // flags.
+  static int ParseFlags(const std::string& flags,
+                        const std::vector<std::string>& names);
+  static std::string FormatFlags(int flags,
+                                 const std::vector<std::string>& names);
+  // The names of core::Events and of the filters' DataFlags.
+  static const std::vector<std::string>& EventNames();
+  static const std::vector<std::string>& DataNames();
+
+  // Registers all the types of this library.
+  FeatureGraph();
+
+  // A pure feature has no effect other than the events it passes to its
+  // children, so it's dropped if it has none.
+  void registerType(const std::string& type, const Factory& factory,
+                    bool pure = false);
+
+  // Throws std::invalid_argument for unknown types.
+  std::vector<Node> optimize(const std::vector<Node>& nodes,
+                             Statistics* statistics = nullptr) const;
+  // Builds the features as children of parent_feature. Throws
+  // std::invalid_argument for unknown types and names, duplicate names, or
+  // invalid parameters, naming the type of the feature. Other exceptions of
+  // the factories, like std::runtime_error, are passed on unchanged. In either
+  // case none of the features are added.
+  void build(core::DeviceListenerWrapper& parent_feature,
+             const std::vector<Node>& nodes, bool optimize = true);
+
+  // Throws std::invalid_argument if there is no feature with that name, or if
+  // it isn't a Feature.
+  core::DeviceListenerWrapper& get(const std::string& name);
+  template <typename Feature>
+  Feature& get(const std::string& name);
+
+  std::size_t numFeatures() const;
+  // The sum of the statistics of all optimized builds.
+  const Statistics& statistics() const;
+
+ private:
+  struct Type {
+    Factory factory;
+    bool pure;
+  };
+
+  static Node ParseNode(const boost::property_tree::ptree& config);
+  static bool HasName(const Node& node);
+  static std::size_t Size(const Node& node);
+  // Whether node passes on every event unmodified.
+  static bool PassThrough(const Node& node);
+  // Whether node and its only child can be replaced with one feature, and the
+  // feature which does so.
+  static bool Fusible(const Node& parent, const Node& child);
+  static Node Fuse(const Node& parent, const Node& child);
+  static std::vector<filters::CascadedExponentialMovingAverage::Stage> Stages(
+      const Node& node);
+
+  // The nodes to replace node with, which receives the events in the events
+  // mask.
+  std::vector<Node> Optimize(const Node& node, int events,
+                             Statistics& statistics) const;
+  // Appends the features it builds to features, and the names it registers
+  // to names.
+  void Build(
+      core::DeviceListenerWrapper& parent_feature, const Node& node,
+      std::vector<std::unique_ptr<core::DeviceListenerWrapper>>& features,
+      std::vector<std::string>& names);
+
+  std::map<std::string, Type> types_;
+  std::vector<std::unique_ptr<core::DeviceListenerWrapper>> features_;
+  std::map<std::string, core::DeviceListenerWrapper*> names_;
+  Statistics statistics_;
+};
+
+std::vector<FeatureGraph::Node> FeatureGraph::Parse(
+    const boost::property_tree::ptree& config) {
+  std::vector<Node> nodes;
+  if (auto features = config.get_child_optional("features")) {
+    for (const auto& child : *features) {
+      nodes.push_back(ParseNode(child.second));
+    }
+  }
+  return nodes;
+}
+
+std::vector<FeatureGraph::Node> FeatureGraph::ParseJson(std::istream& in) {
+  boost::property_tree::ptree config;
+  try {
+    boost::property_tree::read_json(in, config);
+  } catch (const boost::property_tree::json_parser_error& e) {
+    throw std::invalid_argument(std::string("Invalid feature graph: ") +
+                                e.what());
+  }
+  return Parse(config);
+}
+
+int FeatureGraph::ParseFlags(const std::string& flags,
+                             const std::vector<std::string>& names) {
+  if (flags.find_first_not_of(" ") == std::string::npos) {
+    return 0;
+  }
+  int result = 0;
+  std::size_t begin = 0;
+  while (true) {
+    std::size_t end = flags.find('|', begin);
+    std::string flag = flags.substr(
+        begin, end == std::string::npos ? std::string::npos : end - begin);
+    flag.erase(0, flag.find_first_not_of(" "));
+    flag.erase(flag.find_last_not_of(" ") + 1);
+    std::size_t bit = 0;
+    while (bit < names.size() && names[bit] != flag) {
+      ++bit;
+    }
+    if (bit == names.size()) {
+      throw std::invalid_argument("Unknown flag " + flag + ".");
+    }
+    result |= 1 << bit;
+    if (end == std::string::npos) {
+      return result;
+    }
+    begin = end + 1;
+  }
+}
+
+std::string FeatureGraph::FormatFlags(int flags,
+                                      const std::vector<std::string>& names) {
+  std::string result;
+  for (std::size_t bit = 0; bit < names.size(); ++bit) {
+    if (flags & (1 << bit)) {
+      result += (result.empty() ? "" : "|") + names[bit];
+    }
+  }
+  return result;
+}
+
+const std::vector<std::string>& FeatureGraph::EventNames() {
+  static const std::vector<std::string> names = {
+      "Pair",        "Unpair",        "Connect",         "Disconnect",
+      "ArmSync",     "ArmUnsync",     "Unlock",          "Lock",
+      "Pose",        "Gesture",       "OrientationData", "AccelerometerData",
+      "GyroscopeData", "Rssi",        "EmgData",         "Periodic",
+      "EmgFeatures", "EmgSpectrum",   "SensorFrame",     "SpeculativeGesture"};
+  return names;
+}
+
+const std::vector<std::string>& FeatureGraph::DataNames() {
+  static const std::vector<std::string> names = {
+      "OrientationData", "AccelerometerData", "GyroscopeData", "EmgData"};
+  return names;
+}
+
+FeatureGraph::FeatureGraph() : statistics_() {
+  using filters::InfiniteImpulseResponse;
+  registerType("Group", [](core::DeviceListenerWrapper& parent_feature,
+                           const Node&, FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(
+        new Group(parent_feature));
+  }, true);
+  // Not added to its parent, so its children never receive events.
+  registerType("Detached", [](core::DeviceListenerWrapper&, const Node&,
+                              FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(
+        new core::DeviceListenerWrapper());
+  }, true);
+  registerType("Blocker", [](core::DeviceListenerWrapper& parent_feature,
+                             const Node& node, FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(new DynamicBlocker(
+        parent_feature,
+        static_cast<DynamicBlocker::EventFlags>(ParseFlags(
+            node.params.get<std::string>("events", ""), EventNames()))));
+  }, true);
+  // Dispatches on its own thread if "thread" is true, and otherwise has to be
+  // named so that the application can dispatch its events.
+  registerType("Coalesce", [](core::DeviceListenerWrapper& parent_feature,
+                              const Node& node, FeatureGraph&) {
+    // Without its own thread the application has to call dispatch, which it
+    // can only do on a named Coalesce.
+    const bool thread = node.params.get<bool>("thread", false);
+    if (!thread && node.name.empty()) {
+      throw std::invalid_argument(
+          "A Coalesce without a thread needs a name to be dispatched.");
+    }
+    std::unique_ptr<Coalesce> feature(new Coalesce(
+        parent_feature, node.params.get<int>("latency_target_ms", 20),
+        ParseFlags(node.params.get<std::string>(
+                       "events",
+                       "OrientationData|AccelerometerData|GyroscopeData|Rssi|"
+                       "Periodic"),
+                   EventNames())));
+    if (thread) {
+      feature->start();
+    }
+    return std::unique_ptr<core::DeviceListenerWrapper>(std::move(feature));
+  }, true);
+  registerType("Debounce", [](core::DeviceListenerWrapper& parent_feature,
+                              const Node& node, FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(new filters::Debounce(
+        parent_feature, node.params.get<int>("timeout_ms", 10)));
+  }, true);
+  registerType("MovingAverage", [](core::DeviceListenerWrapper& parent_feature,
+                                   const Node& node, FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(
+        new filters::MovingAverage(
+            parent_feature,
+            static_cast<filters::MovingAverage::DataFlags>(
+                ParseFlags(node.params.get<std::string>("flags"),
+                           DataNames())),
+            node.params.get<int>("window_size")));
+  }, true);
+  registerType("ExponentialMovingAverage",
+               [](core::DeviceListenerWrapper& parent_feature,
+                  const Node& node, FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(
+        new filters::ExponentialMovingAverage(
+            parent_feature,
+            static_cast<InfiniteImpulseResponse::DataFlags>(ParseFlags(
+                node.params.get<std::string>("flags"), DataNames())),
+            node.params.get<float>("alpha")));
+  }, true);
+  registerType("CascadedExponentialMovingAverage",
+               [](core::DeviceListenerWrapper& parent_feature,
+                  const Node& node, FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(
+        new filters::CascadedExponentialMovingAverage(parent_feature,
+                                                      Stages(node)));
+  }, true);
+  registerType("Decimate", [](core::DeviceListenerWrapper& parent_feature,
+                              const Node& node, FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(new filters::Decimate(
+        parent_feature,
+        static_cast<filters::Decimate::DataFlags>(
+            ParseFlags(node.params.get<std::string>("flags"), DataNames())),
+        node.params.get<int>("factor"), node.params.get<int>("num_taps", 0)));
+  }, true);
+  registerType("Orientation", [](core::DeviceListenerWrapper& parent_feature,
+                                 const Node&, FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(
+        new Orientation(parent_feature));
+  }, true);
+  registerType("OrientationPoses",
+               [](core::DeviceListenerWrapper& parent_feature,
+                  const Node& node, FeatureGraph& graph) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(new OrientationPoses(
+        parent_feature, graph.get<Orientation>(
+                            node.params.get<std::string>("orientation"))));
+  }, true);
+  registerType("PoseGestures", [](core::DeviceListenerWrapper& parent_feature,
+                                  const Node& node, FeatureGraph&) {
+    std::string mode = node.params.get<std::string>("mode", "conservative");
+    if (mode != "conservative" && mode != "speculative") {
+      throw std::invalid_argument("Unknown PoseGestures mode " + mode + ".");
+    }
+    return std::unique_ptr<core::DeviceListenerWrapper>(
+        new gestures::PoseGestures(
+            parent_feature, node.params.get<int>("click_max_hold_min", 1000),
+            node.params.get<int>("double_click_timeout", 750),
+            mode == "speculative" ? gestures::PoseGestures::Mode::speculative
+                                  : gestures::PoseGestures::Mode::conservative));
+  }, true);
+  // A leaf whose output is seen by other processes, so it's never dropped.
+  registerType("SharedMemoryPublisher",
+               [](core::DeviceListenerWrapper& parent_feature,
+                  const Node& node, FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(
+        new SharedMemoryPublisher(
+            parent_feature, node.params.get<std::string>("ring"),
+            node.params.get<std::size_t>("num_slots", 4096),
+            node.params.get<std::size_t>("slot_size", 1024)));
+  });
+}
+
+void FeatureGraph::registerType(const std::string& type,
+                                const Factory& factory, bool pure) {
+  Type entry = {factory, pure};
+  types_[type] = entry;
+}
+
+std::vector<FeatureGraph::Node> FeatureGraph::optimize(
+    const std::vector<Node>& nodes, Statistics* statistics) const {
+  Statistics local_statistics = Statistics();
+  std::vector<Node> optimized;
+  try {
+    for (const Node& node : nodes) {
+      for (Node& replacement : Optimize(node, (1 << EventNames().size()) - 1,
+                                        local_statistics)) {
+        optimized.push_back(std::move(replacement));
+      }
+    }
+  } catch (const boost::property_tree::ptree_error& e) {
+    throw std::invalid_argument(std::string("Invalid feature graph: ") +
+                                e.what());
+  }
+  if (statistics) {
+    *statistics = local_statistics;
+  }
+  return optimized;
+}
+
+void FeatureGraph::build(core::DeviceListenerWrapper& parent_feature,
+                         const std::vector<Node>& nodes, bool optimize) {
+  Statistics statistics = Statistics();
+  const std::vector<Node> built_nodes =
+      optimize ? this->optimize(nodes, &statistics) : nodes;
+  // The features are only added to the graph once all of them are built, and
+  // detached from parent_feature again if any of them throws.
+  std::vector<std::unique_ptr<core::DeviceListenerWrapper>> features;
+  std::vector<std::string> names;
+  try {
+    for (const Node& node : built_nodes) {
+      Build(parent_feature, node, features, names);
+    }
+  } catch (...) {
+    // Blockers add their children to their own parent, so any of the
+    // features may be a child of parent_feature.
+    for (const auto& feature : features) {
+      parent_feature.removeChildFeature(feature.get());
+    }
+    for (const std::string& name : names) {
+      names_.erase(name);
+    }
+    throw;
+  }
+  for (auto& feature : features) {
+    features_.push_back(std::move(feature));
+  }
+  statistics_.fused += statistics.fused;
+  statistics_.collapsed += statistics.collapsed;
+  statistics_.dropped += statistics.dropped;
+}
+
+core::DeviceListenerWrapper& FeatureGraph::get(const std::string& name) {
+  auto found = names_.find(name);
+  if (found == names_.end()) {
+    throw std::invalid_argument("Unknown feature " + name + ".");
+  }
+  return *found->second;
+}
+
+template <typename Feature>
+Feature& FeatureGraph::get(const std::string& name) {
+  Feature* feature = dynamic_cast<Feature*>(&get(name));
+  if (!feature) {
+    throw std::invalid_argument("Feature " + name +
+                                " doesn't have the expected type.");
+  }
+  return *feature;
+}
+
+std::size_t FeatureGraph::numFeatures() const { return features_.size(); }
+
+const FeatureGraph::Statistics& FeatureGraph::statistics() const {
+  return statistics_;
+}
+
+FeatureGraph::Node FeatureGraph::ParseNode(
+    const boost::property_tree::ptree& config) {
+  Node node;
+  node.type = config.get<std::string>("type", "");
+  if (node.type.empty()) {
+    throw std::invalid_argument("Feature without a type.");
+  }
+  node.name = config.get<std::string>("name", "");
+  node.params = config;
+  node.params.erase("children");
+  if (auto children = config.get_child_optional("children")) {
+    for (const auto& child : *children) {
+      node.children.push_back(ParseNode(child.second));
+    }
+  }
+  return node;
+}
+
+bool FeatureGraph::HasName(const Node& node) {
+  if (!node.name.empty()) {
+    return true;
+  }
+  for (const Node& child : node.children) {
+    if (HasName(child)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::size_t FeatureGraph::Size(const Node& node) {
+  std::size_t size = 1;
+  for (const Node& child : node.children) {
+    size += Size(child);
+  }
+  return size;
+}
+
+bool FeatureGraph::PassThrough(const Node& node) {
+  if (node.type == "Group") {
+    return true;
+  } else if (node.type == "Blocker") {
+    return ParseFlags(node.params.get<std::string>("events", ""),
+                      EventNames()) == 0;
+  } else if (node.type == "ExponentialMovingAverage" ||
+             node.type == "MovingAverage" || node.type == "Decimate") {
+    return ParseFlags(node.params.get<std::string>("flags", ""),
+                      DataNames()) == 0;
+  } else if (node.type == "CascadedExponentialMovingAverage") {
+    for (const auto& stage : Stages(node)) {
+      if (stage.flags != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+bool FeatureGraph::Fusible(const Node& parent, const Node& child) {
+  auto ema = [](const Node& node) {
+    return node.type == "ExponentialMovingAverage" ||
+           node.type == "CascadedExponentialMovingAverage";
+  };
+  return (parent.type == "Blocker" && child.type == "Blocker") ||
+         (ema(parent) && ema(child));
+}
+
+FeatureGraph::Node FeatureGraph::Fuse(const Node& parent, const Node& child) {
+  Node fused;
+  fused.type = parent.type;
+  fused.children = child.children;
+  if (parent.type == "Blocker") {
+    fused.params.put(
+        "events",
+        FormatFlags(ParseFlags(parent.params.get<std::string>("events", ""),
+                               EventNames()) |
+                        ParseFlags(child.params.get<std::string>("events", ""),
+                                   EventNames()),
+                    EventNames()));
+  } else {
+    fused.type = "CascadedExponentialMovingAverage";
+    boost::property_tree::ptree stages;
+    for (const Node* node : {&parent, &child}) {
+      for (const auto& stage : Stages(*node)) {
+        boost::property_tree::ptree entry;
+        entry.put("flags", FormatFlags(stage.flags, DataNames()));
+        entry.put("alpha", stage.alpha);
+        stages.push_back(std::make_pair("", entry));
+      }
+    }
+    fused.params.add_child("stages", stages);
+  }
+  fused.params.put("type", fused.type);
+  return fused;
+}
+
+std::vector<filters::CascadedExponentialMovingAverage::Stage>
+FeatureGraph::Stages(const Node& node) {
+  typedef filters::CascadedExponentialMovingAverage::Stage Stage;
+  auto stage = [](const boost::property_tree::ptree& params) {
+    Stage stage = {
+        static_cast<filters::InfiniteImpulseResponse::DataFlags>(ParseFlags(
+            params.get<std::string>("flags"), DataNames())),
+        params.get<float>("alpha")};
+    return stage;
+  };
+  std::vector<Stage> stages;
+  if (node.type == "ExponentialMovingAverage") {
+    stages.push_back(stage(node.params));
+  } else if (auto entries = node.params.get_child_optional("stages")) {
+    for (const auto& entry : *entries) {
+      stages.push_back(stage(entry.second));
+    }
+  }
+  return stages;
+}
+
+std::vector<FeatureGraph::Node> FeatureGraph::Optimize(
+    const Node& node, int events, Statistics& statistics) const {
+  auto type = types_.find(node.type);
+  if (type == types_.end()) {
+    throw std::invalid_argument("Unknown feature type " + node.type + ".");
+  }
+  if (events == 0 || node.type == "Detached") {
+    statistics.dropped += Size(node);
+    if (!HasName(node)) {
+      return {};
+    } else if (node.type == "Detached") {
+      return {node};
+    }
+    Node detached;
+    detached.type = "Detached";
+    detached.params.put("type", detached.type);
+    detached.children.push_back(node);
+    return {detached};
+  }
+
+  // Groups and Blockers only pass on the events they receive, so their
+  // children can't receive any others.
+  int child_events = (1 << EventNames().size()) - 1;
+  if (node.type == "Group") {
+    child_events = events;
+  } else if (node.type == "Blocker") {
+    child_events = events & ~ParseFlags(
+                                node.params.get<std::string>("events", ""),
+                                EventNames());
+  }
+  // The Detached children of a pure anonymous feature don't need it, so they
+  // are moved up to be removed with it.
+  const bool hoist = node.name.empty() && type->second.pure;
+  std::vector<Node> result;
+  Node optimized = node;
+  optimized.children.clear();
+  for (const Node& child : node.children) {
+    for (Node& replacement : Optimize(child, child_events, statistics)) {
+      if (hoist && replacement.type == "Detached") {
+        result.push_back(std::move(replacement));
+      } else {
+        optimized.children.push_back(std::move(replacement));
+      }
+    }
+  }
+  if (!optimized.name.empty()) {
+    result.push_back(std::move(optimized));
+    return result;
+  }
+
+  while (optimized.children.size() == 1 &&
+         optimized.children[0].name.empty() &&
+         Fusible(optimized, optimized.children[0])) {
+    optimized = Fuse(optimized, optimized.children[0]);
+    ++statistics.fused;
+  }
+  if (optimized.children.empty() && types_.at(optimized.type).pure) {
+    ++statistics.dropped;
+  } else if (PassThrough(optimized)) {
+    ++statistics.collapsed;
+    for (Node& child : optimized.children) {
+      result.push_back(std::move(child));
+    }
+  } else {
+    result.push_back(std::move(optimized));
+  }
+  return result;
+}
+
+void FeatureGraph::Build(
+    core::DeviceListenerWrapper& parent_feature, const Node& node,
+    std::vector<std::unique_ptr<core::DeviceListenerWrapper>>& features,
+    std::vector<std::string>& names) {
+  auto type = types_.find(node.type);
+  if (type == types_.end()) {
+    throw std::invalid_argument("Unknown feature type " + node.type + ".");
+  }
+  if (!node.name.empty() && names_.count(node.name) > 0) {
+    throw std::invalid_argument("Duplicate feature " + node.name + ".");
+  }
+  std::unique_ptr<core::DeviceListenerWrapper> feature;
+  try {
+    feature = type->second.factory(parent_feature, node, *this);
+  } catch (const boost::property_tree::ptree_error& e) {
+    throw std::invalid_argument("Invalid parameters of " + node.type + ": " +
+                                e.what());
+  } catch (const std::invalid_argument& e) {
+    throw std::invalid_argument("Invalid parameters of " + node.type + ": " +
+                                e.what());
+  }
+  core::DeviceListenerWrapper& built = *feature;
+  features.push_back(std::move(feature));
+  if (!node.name.empty()) {
+    names_[node.name] = &built;
+    names.push_back(node.name);
+  }
+  for (const Node& child : node.children) {
+    Build(built, child, features, names);
+  }
+}
+}
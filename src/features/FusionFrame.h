@@ -0,0 +1,268 @@
+/* Combines the separate orientation, accelerometer, gyroscope and EMG
+ * callbacks into a single time-aligned SensorFrame which is emitted to the
+ * child features via onSensorFrame. All other events, including the original
+ * sensor data, are passed on unmodified.
+ *
+ * The Myo reports orientation, accelerometer and gyroscope data together at
+ * 50 Hz, and EMG data at 200 Hz. A frame is emitted either for every EMG
+ * sample or for every IMU sample. At the EMG rate the IMU values are either
+ * held from the last IMU sample, or linearly interpolated (the orientation is
+ * normalized linearly interpolated) between the IMU samples before and after
+ * the EMG sample, which delays EMG frames by up to one IMU period. At the IMU
+ * rate the most recent EMG sample is held.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <boost/circular_buffer.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+#include "../core/DeviceListenerWrapper.h"
+#include "../core/SensorFrame.h"
+
+namespace features {
+class FusionFrame : public core::DeviceListenerWrapper {
+ public:
+  enum class Rate { emg, imu };
+  enum class Alignment { hold, interpolate };
+
+  FusionFrame(core::DeviceListenerWrapper& parent_feature,
+              Rate rate = Rate::emg,
+              Alignment alignment = Alignment::interpolate);
+
+  virtual void onOrientationData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Quaternion<float>& rotation) override;
+  virtual void onAccelerometerData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Vector3<float>& acceleration) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) override;
+
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
+
+ private:
+  enum ImuFlags {
+    OrientationData   = 1 << 0,
+    AccelerometerData = 1 << 1,
+    GyroscopeData     = 1 << 2,
+    AllImuData        = (1 << 3) - 1
+  };
+
+  struct EmgSample {
+    uint64_t timestamp;
+    int8_t emg[8];
+  };
+
+  // Starts a new IMU sample if timestamp differs from the pending one, and
+  // completes the pending sample once all three streams have been received.
+  void BeginImuData(myo::Myo* myo, uint64_t timestamp);
+  void EndImuData(myo::Myo* myo, ImuFlags flag);
+  void CompleteImuSample(myo::Myo* myo);
+  void EmitEmgFrame(myo::Myo* myo, const EmgSample& sample);
+
+  const Rate rate_;
+  const Alignment alignment_;
+  // The IMU sample being assembled, and the last two complete IMU samples.
+  core::SensorFrame pending_imu_, previous_imu_, current_imu_;
+  uint64_t pending_timestamp_, previous_timestamp_, current_timestamp_;
+  int pending_flags_, num_imu_samples_;
+  EmgSample last_emg_;
+  // EMG samples newer than the current IMU sample, waiting to be interpolated.
+  boost::circular_buffer<EmgSample> emg_queue_;
+  core::SensorFrame frame_;
+};
+
+FusionFrame::FusionFrame(core::DeviceListenerWrapper& parent_feature,
+                         Rate rate, Alignment alignment)
+    : rate_(rate),
+      alignment_(alignment),
+      pending_imu_(),
+      previous_imu_(),
+      current_imu_(),
+      pending_timestamp_(0),
+      previous_timestamp_(0),
+      current_timestamp_(0),
+      pending_flags_(0),
+      num_imu_samples_(0),
+      last_emg_(),
+      emg_queue_(32),
+      frame_() {
+  pending_imu_.rotation[3] = 1.f;
+  current_imu_ = previous_imu_ = pending_imu_;
+  parent_feature.addChildFeature(this);
+}
+
+void FusionFrame::onOrientationData(myo::Myo* myo, uint64_t timestamp,
+                                    const myo::Quaternion<float>& rotation) {
+  BeginImuData(myo, timestamp);
+  pending_imu_.rotation[0] = rotation.x();
+  pending_imu_.rotation[1] = rotation.y();
+  pending_imu_.rotation[2] = rotation.z();
+  pending_imu_.rotation[3] = rotation.w();
+  core::DeviceListenerWrapper::onOrientationData(myo, timestamp, rotation);
+  EndImuData(myo, OrientationData);
+}
+
+void FusionFrame::onAccelerometerData(myo::Myo* myo, uint64_t timestamp,
+                                      const myo::Vector3<float>& acceleration) {
+  BeginImuData(myo, timestamp);
+  pending_imu_.acceleration[0] = acceleration.x();
+  pending_imu_.acceleration[1] = acceleration.y();
+  pending_imu_.acceleration[2] = acceleration.z();
+  core::DeviceListenerWrapper::onAccelerometerData(myo, timestamp,
+                                                   acceleration);
+  EndImuData(myo, AccelerometerData);
+}
+
+void FusionFrame::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                                  const myo::Vector3<float>& gyro) {
+  BeginImuData(myo, timestamp);
+  pending_imu_.gyro[0] = gyro.x();
+  pending_imu_.gyro[1] = gyro.y();
+  pending_imu_.gyro[2] = gyro.z();
+  core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, gyro);
+  EndImuData(myo, GyroscopeData);
+}
+
+void FusionFrame::onEmgData(myo::Myo* myo, uint64_t timestamp,
+                            const int8_t* emg) {
+  last_emg_.timestamp = timestamp;
+  std::copy(emg, emg + 8, last_emg_.emg);
+  core::DeviceListenerWrapper::onEmgData(myo, timestamp, emg);
+
+  if (rate_ != Rate::emg) {
+    return;
+  }
+  if (alignment_ == Alignment::hold || num_imu_samples_ == 0 ||
+      timestamp <= current_timestamp_) {
+    EmitEmgFrame(myo, last_emg_);
+  } else {
+    if (emg_queue_.full()) {
+      // IMU data has stopped arriving, so fall back to holding it.
+      EmitEmgFrame(myo, emg_queue_.front());
+      emg_queue_.pop_front();
+    }
+    emg_queue_.push_back(last_emg_);
+  }
+}
+
+void FusionFrame::saveState(core::FeatureState& state) const {
+  state.put<core::SensorFrame>(pending_imu_);
+  state.put<core::SensorFrame>(previous_imu_);
+  state.put<core::SensorFrame>(current_imu_);
+  state.put<uint64_t>(pending_timestamp_);
+  state.put<uint64_t>(previous_timestamp_);
+  state.put<uint64_t>(current_timestamp_);
+  state.put<int32_t>(pending_flags_);
+  state.put<int32_t>(num_imu_samples_);
+  state.put<EmgSample>(last_emg_);
+  state.put<uint32_t>(static_cast<uint32_t>(emg_queue_.size()));
+  for (const EmgSample& sample : emg_queue_) {
+    state.put<EmgSample>(sample);
+  }
+}
+
+void FusionFrame::loadState(core::FeatureState& state) {
+  pending_imu_ = state.get<core::SensorFrame>();
+  previous_imu_ = state.get<core::SensorFrame>();
+  current_imu_ = state.get<core::SensorFrame>();
+  pending_timestamp_ = state.get<uint64_t>();
+  previous_timestamp_ = state.get<uint64_t>();
+  current_timestamp_ = state.get<uint64_t>();
+  pending_flags_ = state.get<int32_t>();
+  num_imu_samples_ = state.get<int32_t>();
+  last_emg_ = state.get<EmgSample>();
+  const uint32_t queue_size = state.get<uint32_t>();
+  if (queue_size > emg_queue_.capacity()) {
+    throw std::runtime_error("The fusion frame has too many queued samples.");
+  }
+  emg_queue_.clear();
+  for (uint32_t i = 0; i < queue_size; ++i) {
+    emg_queue_.push_back(state.get<EmgSample>());
+  }
+}
+
+void FusionFrame::BeginImuData(myo::Myo* myo, uint64_t timestamp) {
+  if (pending_flags_ != 0 && timestamp != pending_timestamp_) {
+    // One of the streams is missing, so use its previous value.
+    CompleteImuSample(myo);
+  }
+  pending_timestamp_ = timestamp;
+}
+
+void FusionFrame::EndImuData(myo::Myo* myo, ImuFlags flag) {
+  pending_flags_ |= flag;
+  if (pending_flags_ == AllImuData) {
+    CompleteImuSample(myo);
+  }
+}
+
+void FusionFrame::CompleteImuSample(myo::Myo* myo) {
+  pending_flags_ = 0;
+  previous_imu_ = current_imu_;
+  previous_timestamp_ = current_timestamp_;
+  current_imu_ = pending_imu_;
+  current_timestamp_ = pending_timestamp_;
+  ++num_imu_samples_;
+
+  if (rate_ == Rate::imu) {
+    frame_ = current_imu_;
+    std::copy(last_emg_.emg, last_emg_.emg + 8, frame_.emg);
+    core::DeviceListenerWrapper::onSensorFrame(myo, current_timestamp_,
+                                               frame_);
+    return;
+  }
+  while (!emg_queue_.empty() &&
+         emg_queue_.front().timestamp <= current_timestamp_) {
+    EmitEmgFrame(myo, emg_queue_.front());
+    emg_queue_.pop_front();
+  }
+}
+
+void FusionFrame::EmitEmgFrame(myo::Myo* myo, const EmgSample& sample) {
+  if (alignment_ == Alignment::hold || num_imu_samples_ < 2 ||
+      current_timestamp_ <= previous_timestamp_) {
+    frame_ = current_imu_;
+  } else {
+    float t = static_cast<float>(
+        static_cast<double>(sample.timestamp - previous_timestamp_) /
+        (current_timestamp_ - previous_timestamp_));
+    if (sample.timestamp < previous_timestamp_) {
+      t = 0.f;
+    }
+    t = std::min(1.f, t);
+    for (std::size_t i = 0; i < 3; ++i) {
+      frame_.acceleration[i] = previous_imu_.acceleration[i] +
+          t * (current_imu_.acceleration[i] - previous_imu_.acceleration[i]);
+      frame_.gyro[i] = previous_imu_.gyro[i] +
+          t * (current_imu_.gyro[i] - previous_imu_.gyro[i]);
+    }
+    // Interpolate along the shorter arc, then renormalize.
+    float dot = 0.f;
+    for (std::size_t i = 0; i < 4; ++i) {
+      dot += previous_imu_.rotation[i] * current_imu_.rotation[i];
+    }
+    float sign = dot < 0.f ? -1.f : 1.f;
+    float norm = 0.f;
+    for (std::size_t i = 0; i < 4; ++i) {
+      frame_.rotation[i] = (1.f - t) * previous_imu_.rotation[i] +
+                           t * sign * current_imu_.rotation[i];
+      norm += frame_.rotation[i] * frame_.rotation[i];
+    }
+    norm = norm > 0.f ? 1.f / std::sqrt(norm) : 0.f;
+    for (std::size_t i = 0; i < 4; ++i) {
+      frame_.rotation[i] *= norm;
+    }
+  }
+  std::copy(sample.emg, sample.emg + 8, frame_.emg);
+  core::DeviceListenerWrapper::onSensorFrame(myo, sample.timestamp, frame_);
+}
+}
@@ -0,0 +1,55 @@
+/* Passes the events it receives on to its child features unmodified, e.g. to
+ * mark a point of a FeatureGraph where the application attaches its own
+ * features.
+ *
+ * A Group is added to its parent feature with the union of its children's
+ * masks, and updates it when children are added or removed, so events which
+ * none of its children receive are never dispatched to the Group either.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+
+#include "../core/DeviceListenerWrapper.h"
+#include "../core/Events.h"
+
+namespace features {
+class Group : public core::DeviceListenerWrapper {
+ public:
+  explicit Group(core::DeviceListenerWrapper& parent_feature);
+
+  virtual void addChildFeature(child_feature_t feature,
+                               int events = core::Events::All) override;
+  virtual void removeChildFeature(child_feature_t feature) override;
+
+ private:
+  void UpdateMask();
+
+  core::DeviceListenerWrapper& parent_feature_;
+};
+
+Group::Group(core::DeviceListenerWrapper& parent_feature)
+    : parent_feature_(parent_feature) {
+  UpdateMask();
+}
+
+void Group::addChildFeature(child_feature_t feature, int events) {
+  core::DeviceListenerWrapper::addChildFeature(feature, events);
+  UpdateMask();
+}
+
+void Group::removeChildFeature(child_feature_t feature) {
+  core::DeviceListenerWrapper::removeChildFeature(feature);
+  UpdateMask();
+}
+
+void Group::UpdateMask() {
+  // Stays a child without children, so that it's still part of the tree.
+  int events = 0;
+  for (const auto& child_feature : child_features_) {
+    events |= child_feature.second;
+  }
+  parent_feature_.addChildFeature(this, events);
+}
+}
@@ -0,0 +1,192 @@
+/* Estimates the orientation of the Myo from its gyroscope and accelerometer
+ * data using Madgwick's gradient descent filter, instead of relying on the
+ * orientation computed by the Myo itself. The estimate is emitted to the child
+ * features via onOrientationData, so features such as Orientation and
+ * OrientationPoses can use it unchanged. The Myo's own orientation data is
+ * blocked unless forward_device_orientation is set.
+ *
+ * beta trades gyroscope drift against accelerometer noise: higher values
+ * converge to the accelerometer's estimate of down faster. Yaw is not
+ * observable without a magnetometer and will drift.
+ *
+ * Every update costs a fixed number of floating point operations and a single
+ * square root per normalization, with no data dependent branches.
+ * http://www.x-io.co.uk/open-source-imu-and-ahrs-algorithms/
+ */
+
+#pragma once
+
+/* for MSVC++ */
+#define _USE_MATH_DEFINES
+#include <myo/myo.hpp>
+#include <cmath>
+
+#include "../core/DeviceListenerWrapper.h"
+
+namespace features {
+class ImuFusion : public core::DeviceListenerWrapper {
+ public:
+  ImuFusion(core::DeviceListenerWrapper& parent_feature, float beta = 0.1f,
+            bool forward_device_orientation = false);
+
+  virtual void onOrientationData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Quaternion<float>& rotation) override;
+  virtual void onAccelerometerData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Vector3<float>& acceleration) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+
+  // Updates the estimate with gyroscope data in degrees per second and
+  // accelerometer data in g, dt seconds after the previous update.
+  void update(const myo::Vector3<float>& gyro,
+              const myo::Vector3<float>& acceleration, float dt);
+
+  myo::Quaternion<float> getRotation() const;
+
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
+
+ private:
+  const float beta_;
+  const bool forward_device_orientation_;
+  float q0_, q1_, q2_, q3_;  // w, x, y, z
+  myo::Vector3<float> acceleration_;
+  uint64_t acceleration_timestamp_, last_update_timestamp_;
+  bool has_acceleration_, has_updated_;
+};
+
+ImuFusion::ImuFusion(core::DeviceListenerWrapper& parent_feature, float beta,
+                     bool forward_device_orientation)
+    : beta_(beta),
+      forward_device_orientation_(forward_device_orientation),
+      q0_(1.f),
+      q1_(0.f),
+      q2_(0.f),
+      q3_(0.f),
+      acceleration_(),
+      acceleration_timestamp_(0),
+      last_update_timestamp_(0),
+      has_acceleration_(false),
+      has_updated_(false) {
+  parent_feature.addChildFeature(this);
+}
+
+void ImuFusion::onOrientationData(myo::Myo* myo, uint64_t timestamp,
+                                  const myo::Quaternion<float>& rotation) {
+  if (forward_device_orientation_) {
+    core::DeviceListenerWrapper::onOrientationData(myo, timestamp, rotation);
+  }
+}
+
+void ImuFusion::onAccelerometerData(myo::Myo* myo, uint64_t timestamp,
+                                    const myo::Vector3<float>& acceleration) {
+  acceleration_ = acceleration;
+  acceleration_timestamp_ = timestamp;
+  has_acceleration_ = true;
+  core::DeviceListenerWrapper::onAccelerometerData(myo, timestamp,
+                                                   acceleration);
+}
+
+void ImuFusion::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                                const myo::Vector3<float>& gyro) {
+  core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, gyro);
+  // The Myo reports accelerometer and gyroscope data with the same timestamp,
+  // accelerometer data first.
+  if (!has_acceleration_ || acceleration_timestamp_ != timestamp) {
+    return;
+  }
+  float dt = has_updated_
+                 ? (timestamp - last_update_timestamp_) * 1e-6f
+                 : 0.f;
+  last_update_timestamp_ = timestamp;
+  has_updated_ = true;
+  update(gyro, acceleration_, dt);
+  core::DeviceListenerWrapper::onOrientationData(myo, timestamp,
+                                                 getRotation());
+}
+
+void ImuFusion::update(const myo::Vector3<float>& gyro,
+                       const myo::Vector3<float>& acceleration, float dt) {
+  const float deg_to_rad = static_cast<float>(M_PI / 180.0);
+  const float gx = gyro.x() * deg_to_rad;
+  const float gy = gyro.y() * deg_to_rad;
+  const float gz = gyro.z() * deg_to_rad;
+  float ax = acceleration.x(), ay = acceleration.y(), az = acceleration.z();
+
+  // Rate of change of the quaternion from the gyroscope.
+  float q_dot0 = 0.5f * (-q1_ * gx - q2_ * gy - q3_ * gz);
+  float q_dot1 = 0.5f * (q0_ * gx + q2_ * gz - q3_ * gy);
+  float q_dot2 = 0.5f * (q0_ * gy - q1_ * gz + q3_ * gx);
+  float q_dot3 = 0.5f * (q0_ * gz + q1_ * gy - q2_ * gx);
+
+  // Normalize the accelerometer data. A zero vector (free fall) has no
+  // direction of gravity, so its correction step is multiplied by zero.
+  float norm_squared = ax * ax + ay * ay + az * az;
+  const float correction = norm_squared > 0.f ? beta_ : 0.f;
+  float inverse_norm = norm_squared > 0.f ? 1.f / std::sqrt(norm_squared) : 0.f;
+  ax *= inverse_norm;
+  ay *= inverse_norm;
+  az *= inverse_norm;
+
+  // Gradient of the objective function comparing the estimated direction of
+  // gravity to the measured one.
+  const float _2q0 = 2.f * q0_, _2q1 = 2.f * q1_, _2q2 = 2.f * q2_,
+              _2q3 = 2.f * q3_;
+  const float _4q0 = 4.f * q0_, _4q1 = 4.f * q1_, _4q2 = 4.f * q2_;
+  const float _8q1 = 8.f * q1_, _8q2 = 8.f * q2_;
+  const float q0q0 = q0_ * q0_, q1q1 = q1_ * q1_, q2q2 = q2_ * q2_,
+              q3q3 = q3_ * q3_;
+  float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+  float s1 = _4q1 * q3q3 - _2q3 * ax + 4.f * q0q0 * q1_ - _2q0 * ay - _4q1 +
+             _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+  float s2 = 4.f * q0q0 * q2_ + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 +
+             _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+  float s3 = 4.f * q1q1 * q3_ - _2q1 * ax + 4.f * q2q2 * q3_ - _2q2 * ay;
+  norm_squared = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+  inverse_norm =
+      norm_squared > 0.f ? correction / std::sqrt(norm_squared) : 0.f;
+  q_dot0 -= inverse_norm * s0;
+  q_dot1 -= inverse_norm * s1;
+  q_dot2 -= inverse_norm * s2;
+  q_dot3 -= inverse_norm * s3;
+
+  q0_ += q_dot0 * dt;
+  q1_ += q_dot1 * dt;
+  q2_ += q_dot2 * dt;
+  q3_ += q_dot3 * dt;
+  inverse_norm =
+      1.f / std::sqrt(q0_ * q0_ + q1_ * q1_ + q2_ * q2_ + q3_ * q3_);
+  q0_ *= inverse_norm;
+  q1_ *= inverse_norm;
+  q2_ *= inverse_norm;
+  q3_ *= inverse_norm;
+}
+
+myo::Quaternion<float> ImuFusion::getRotation() const {
+  return myo::Quaternion<float>(q1_, q2_, q3_, q0_);
+}
+
+void ImuFusion::saveState(core::FeatureState& state) const {
+  state.putQuaternion(getRotation());
+  state.putVector(acceleration_);
+  state.put<uint64_t>(acceleration_timestamp_);
+  state.put<uint64_t>(last_update_timestamp_);
+  state.put<bool>(has_acceleration_);
+  state.put<bool>(has_updated_);
+}
+
+void ImuFusion::loadState(core::FeatureState& state) {
+  myo::Quaternion<float> rotation = state.getQuaternion();
+  q0_ = rotation.w();
+  q1_ = rotation.x();
+  q2_ = rotation.y();
+  q3_ = rotation.z();
+  acceleration_ = state.getVector();
+  acceleration_timestamp_ = state.get<uint64_t>();
+  last_update_timestamp_ = state.get<uint64_t>();
+  has_acceleration_ = state.get<bool>();
+  has_updated_ = state.get<bool>();
+}
+}
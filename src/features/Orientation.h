@@ -1,10 +1,15 @@
 /* Provides an easy interface for determining the basic orientation of the
  * user's arm and wrist.
+ *
+ * The relative angles and the resulting arm and wrist orientations are
+ * computed once per orientation sample, and the angles of the calibrated
+ * position once per calibration, so all of the getters are plain loads.
  */
 
 #pragma once
 
 #include <myo/myo.hpp>
+#include <utility>
 
 #include "../core/DeviceListenerWrapper.h"
 #include "../core/OrientationUtility.h"
@@ -21,7 +26,12 @@ class Orientation : public core::DeviceListenerWrapper {
       myo::Myo* myo, uint64_t timestamp,
       const myo::Quaternion<float>& rotation) override;
   virtual void onArmSync(myo::Myo* myo, uint64_t timestamp, myo::Arm arm,
-                         myo::XDirection x_direction) override;
+                         myo::XDirection x_direction, float rotation,
+                         myo::WarmupState warmup_state) override;
+
+  // The calibration, the arm it was synced to and the last orientation.
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
 
   // Calibrate sets the "start" position to use as a reference in order to
   // determine the orientation of the user's arm. Currently this start position
@@ -34,7 +44,15 @@ class Orientation : public core::DeviceListenerWrapper {
   Wrist getWristOrientation() const;
 
  private:
-  myo::Quaternion<float> rotation_, mid_;
+  // Recomputes the relative angles from the cached pitch and roll.
+  void UpdateRelativeAngles();
+  // Classifies the relative angles against the thresholds.
+  void UpdateOrientations();
+
+  float pitch_, roll_, mid_pitch_, mid_roll_;
+  float relative_arm_angle_, relative_wrist_angle_;
+  Arm arm_orientation_;
+  Wrist wrist_orientation_;
   Arm arm_orientation_a, arm_orientation_b;
   Wrist wrist_orientation_a, wrist_orientation_b;
 
@@ -50,8 +68,14 @@ const float Orientation::minWristAngle = -0.3;
 const float Orientation::maxWristAngle = 0.3;
 
 Orientation::Orientation(core::DeviceListenerWrapper& parent_feature)
-    : rotation_(),
-      mid_(),
+    : pitch_(0.f),
+      roll_(0.f),
+      mid_pitch_(0.f),
+      mid_roll_(0.f),
+      relative_arm_angle_(0.f),
+      relative_wrist_angle_(0.f),
+      arm_orientation_(Arm::forearmLevel),
+      wrist_orientation_(Wrist::palmSideways),
       arm_orientation_a(Arm::forearmUp),
       arm_orientation_b(Arm::forearmDown),
       wrist_orientation_a(Wrist::palmDown),
@@ -61,12 +85,15 @@ Orientation::Orientation(core::DeviceListenerWrapper& parent_feature)
 
 void Orientation::onOrientationData(myo::Myo* myo, uint64_t timestamp,
                                     const myo::Quaternion<float>& rotation) {
-  rotation_ = rotation;
+  pitch_ = core::OrientationUtility::QuaternionToPitch(rotation);
+  roll_ = core::OrientationUtility::QuaternionToRoll(rotation);
+  UpdateRelativeAngles();
   core::DeviceListenerWrapper::onOrientationData(myo, timestamp, rotation);
 }
 
 void Orientation::onArmSync(myo::Myo* myo, uint64_t timestamp, myo::Arm arm,
-                            myo::XDirection x_direction) {
+                            myo::XDirection x_direction, float rotation,
+                            myo::WarmupState warmup_state) {
   if (arm == myo::armLeft) {
     std::swap(wrist_orientation_a, wrist_orientation_b);
   }
@@ -74,44 +101,79 @@ void Orientation::onArmSync(myo::Myo* myo, uint64_t timestamp, myo::Arm arm,
     std::swap(arm_orientation_a, arm_orientation_b);
     std::swap(wrist_orientation_a, wrist_orientation_b);
   }
-  core::DeviceListenerWrapper::onArmSync(myo, timestamp, arm, x_direction);
+  UpdateOrientations();
+  core::DeviceListenerWrapper::onArmSync(myo, timestamp, arm, x_direction,
+                                         rotation, warmup_state);
+}
+
+void Orientation::saveState(core::FeatureState& state) const {
+  state.put<float>(pitch_);
+  state.put<float>(roll_);
+  state.put<float>(mid_pitch_);
+  state.put<float>(mid_roll_);
+  state.put<Arm>(arm_orientation_a);
+  state.put<Arm>(arm_orientation_b);
+  state.put<Wrist>(wrist_orientation_a);
+  state.put<Wrist>(wrist_orientation_b);
 }
 
-void Orientation::calibrateOrientation() { mid_ = rotation_; }
+void Orientation::loadState(core::FeatureState& state) {
+  pitch_ = state.get<float>();
+  roll_ = state.get<float>();
+  mid_pitch_ = state.get<float>();
+  mid_roll_ = state.get<float>();
+  arm_orientation_a = state.get<Arm>();
+  arm_orientation_b = state.get<Arm>();
+  wrist_orientation_a = state.get<Wrist>();
+  wrist_orientation_b = state.get<Wrist>();
+  UpdateRelativeAngles();
+}
 
-float Orientation::getRelativeArmAngle() const {
-  return core::OrientationUtility::RelativeOrientation(
-      mid_, rotation_, core::OrientationUtility::QuaternionToPitch);
+void Orientation::calibrateOrientation() {
+  mid_pitch_ = pitch_;
+  mid_roll_ = roll_;
+  UpdateRelativeAngles();
 }
 
+float Orientation::getRelativeArmAngle() const { return relative_arm_angle_; }
+
 // TODO: add a multiplier because your forearm only rotates a fraction of the
 // angle your wrist rotates.
 float Orientation::getRelativeWristAngle() const {
-  return core::OrientationUtility::RelativeOrientation(
-      mid_, rotation_, core::OrientationUtility::QuaternionToRoll);
+  return relative_wrist_angle_;
 }
 
 Orientation::Arm Orientation::getArmOrientation() const {
-  float pitch_diff = core::OrientationUtility::RelativeOrientation(
-      mid_, rotation_, core::OrientationUtility::QuaternionToPitch);
-  if (pitch_diff < minArmAngle) {
-    return arm_orientation_a;
-  } else if (pitch_diff > maxArmAngle) {
-    return arm_orientation_b;
-  } else {
-    return Arm::forearmLevel;
-  }
+  return arm_orientation_;
 }
 
 Orientation::Wrist Orientation::getWristOrientation() const {
-  float roll_diff = core::OrientationUtility::RelativeOrientation(
-      mid_, rotation_, core::OrientationUtility::QuaternionToRoll);
-  if (roll_diff < minWristAngle) {
-    return wrist_orientation_a;
-  } else if (roll_diff > maxWristAngle) {
-    return wrist_orientation_b;
+  return wrist_orientation_;
+}
+
+void Orientation::UpdateRelativeAngles() {
+  relative_arm_angle_ =
+      core::OrientationUtility::RelativeOrientation(mid_pitch_, pitch_);
+  relative_wrist_angle_ =
+      core::OrientationUtility::RelativeOrientation(mid_roll_, roll_);
+  UpdateOrientations();
+}
+
+void Orientation::UpdateOrientations() {
+  if (relative_arm_angle_ < minArmAngle) {
+    arm_orientation_ = arm_orientation_a;
+  } else if (relative_arm_angle_ > maxArmAngle) {
+    arm_orientation_ = arm_orientation_b;
+  } else {
+    arm_orientation_ = Arm::forearmLevel;
+  }
+
+  if (relative_wrist_angle_ < minWristAngle) {
+    wrist_orientation_ = wrist_orientation_a;
+  } else if (relative_wrist_angle_ > maxWristAngle) {
+    wrist_orientation_ = wrist_orientation_b;
   } else {
-    return Wrist::palmSideways;
+    wrist_orientation_ = Wrist::palmSideways;
   }
 }
 }
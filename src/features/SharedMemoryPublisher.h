@@ -0,0 +1,326 @@
+/* SharedMemoryPublisher publishes the events it receives to other processes on
+ * the same machine through a core::SharedMemoryRing, so that a UI, a logger
+ * and an analytics process can all consume the output of one feature tree
+ * instead of each running its own hub. Each process reads the events with a
+ * SharedMemorySubscriber.
+ *
+ * The publisher never waits for the subscribers. Subscribers which fall
+ * behind by more than num_slots events lose the oldest ones and can tell how
+ * many they lost. Events whose record doesn't fit into slot_size bytes, e.g.
+ * the spectra of a very long window, are skipped and counted. Periodic events
+ * aren't published, since every process has its own.
+ *
+ * Poses and gestures are published by name, as returned by toString, so the
+ * subscribers see them with the same names but not as the same classes.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../core/DeviceListenerWrapper.h"
+#include "../core/Events.h"
+#include "../core/SharedMemoryRing.h"
+
+namespace features {
+class SharedMemoryPublisher : public core::DeviceListenerWrapper {
+ public:
+  // Every record starts with this header, followed by the arguments of the
+  // event. The event is its core::Events::Index, and Myos are numbered in
+  // the order they are first seen.
+  struct RecordHeader {
+    uint16_t event;
+    uint16_t device;
+    uint32_t reserved;
+    uint64_t timestamp;
+  };
+
+  // Creates the ring called name, replacing any ring with the same name.
+  // Throws std::runtime_error if it can't be created.
+  SharedMemoryPublisher(core::DeviceListenerWrapper& parent_feature,
+                        const std::string& name, std::size_t num_slots = 4096,
+                        std::size_t slot_size = 1024);
+
+  virtual void onPair(myo::Myo* myo, uint64_t timestamp,
+                      myo::FirmwareVersion firmware_version) override;
+  virtual void onUnpair(myo::Myo* myo, uint64_t timestamp) override;
+  virtual void onConnect(myo::Myo* myo, uint64_t timestamp,
+                         myo::FirmwareVersion firmware_version) override;
+  virtual void onDisconnect(myo::Myo* myo, uint64_t timestamp) override;
+  virtual void onArmSync(myo::Myo* myo, uint64_t timestamp, myo::Arm arm,
+                         myo::XDirection x_direction, float rotation,
+                         myo::WarmupState warmup_state) override;
+  virtual void onArmUnsync(myo::Myo* myo, uint64_t timestamp) override;
+  virtual void onUnlock(myo::Myo* myo, uint64_t timestamp) override;
+  virtual void onLock(myo::Myo* myo, uint64_t timestamp) override;
+  virtual void onPose(myo::Myo* myo, uint64_t timestamp,
+                      const std::shared_ptr<core::Pose>& pose) override;
+  virtual void onGesture(
+      myo::Myo* myo, uint64_t timestamp,
+      const std::shared_ptr<core::Gesture>& gesture) override;
+  virtual void onSpeculativeGesture(
+      myo::Myo* myo, uint64_t timestamp,
+      const std::shared_ptr<core::Gesture>& gesture,
+      core::Gesture::Status status) override;
+  virtual void onOrientationData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Quaternion<float>& rotation) override;
+  virtual void onAccelerometerData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Vector3<float>& acceleration) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+  virtual void onRssi(myo::Myo* myo, uint64_t timestamp, int8_t rssi) override;
+  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) override;
+  virtual void onEmgFeatures(
+      myo::Myo* myo, uint64_t timestamp,
+      const core::EmgFeatureVector& emg_features) override;
+  virtual void onEmgSpectrum(myo::Myo* myo, uint64_t timestamp,
+                             const core::EmgSpectrum& emg_spectrum) override;
+  virtual void onSensorFrame(myo::Myo* myo, uint64_t timestamp,
+                             const core::SensorFrame& frame) override;
+
+  // The number of events published, and skipped because they didn't fit.
+  uint64_t published() const;
+  uint64_t skipped() const;
+
+ private:
+  // Starts a record in record_.
+  void Begin(myo::Myo* myo, uint64_t timestamp, int event);
+  void Put(const void* data, std::size_t size);
+  template <typename T>
+  void Put(T value);
+  void PutString(const std::string& string);
+  void PutFloats(const float* values, std::size_t count);
+  // Writes record_ to the ring, unless it's too large.
+  void Publish();
+
+  core::SharedMemoryRing ring_;
+  std::map<myo::Myo*, uint16_t> devices_;
+  std::vector<char> record_;
+  uint64_t published_, skipped_;
+};
+
+SharedMemoryPublisher::SharedMemoryPublisher(
+    core::DeviceListenerWrapper& parent_feature, const std::string& name,
+    std::size_t num_slots, std::size_t slot_size)
+    : ring_(name, num_slots, slot_size), published_(0), skipped_(0) {
+  record_.reserve(slot_size);
+  parent_feature.addChildFeature(this, core::Events::All &
+                                           ~core::Events::Periodic);
+}
+
+void SharedMemoryPublisher::onPair(myo::Myo* myo, uint64_t timestamp,
+                                   myo::FirmwareVersion firmware_version) {
+  Begin(myo, timestamp, core::Events::Pair);
+  Put<uint32_t>(firmware_version.firmwareVersionMajor);
+  Put<uint32_t>(firmware_version.firmwareVersionMinor);
+  Put<uint32_t>(firmware_version.firmwareVersionPatch);
+  Put<uint32_t>(firmware_version.firmwareVersionHardwareRev);
+  Publish();
+}
+
+void SharedMemoryPublisher::onUnpair(myo::Myo* myo, uint64_t timestamp) {
+  Begin(myo, timestamp, core::Events::Unpair);
+  Publish();
+}
+
+void SharedMemoryPublisher::onConnect(myo::Myo* myo, uint64_t timestamp,
+                                      myo::FirmwareVersion firmware_version) {
+  Begin(myo, timestamp, core::Events::Connect);
+  Put<uint32_t>(firmware_version.firmwareVersionMajor);
+  Put<uint32_t>(firmware_version.firmwareVersionMinor);
+  Put<uint32_t>(firmware_version.firmwareVersionPatch);
+  Put<uint32_t>(firmware_version.firmwareVersionHardwareRev);
+  Publish();
+}
+
+void SharedMemoryPublisher::onDisconnect(myo::Myo* myo, uint64_t timestamp) {
+  Begin(myo, timestamp, core::Events::Disconnect);
+  Publish();
+}
+
+void SharedMemoryPublisher::onArmSync(myo::Myo* myo, uint64_t timestamp,
+                                      myo::Arm arm,
+                                      myo::XDirection x_direction,
+                                      float rotation,
+                                      myo::WarmupState warmup_state) {
+  Begin(myo, timestamp, core::Events::ArmSync);
+  Put<int32_t>(arm);
+  Put<int32_t>(x_direction);
+  Put<float>(rotation);
+  Put<int32_t>(warmup_state);
+  Publish();
+}
+
+void SharedMemoryPublisher::onArmUnsync(myo::Myo* myo, uint64_t timestamp) {
+  Begin(myo, timestamp, core::Events::ArmUnsync);
+  Publish();
+}
+
+void SharedMemoryPublisher::onUnlock(myo::Myo* myo, uint64_t timestamp) {
+  Begin(myo, timestamp, core::Events::Unlock);
+  Publish();
+}
+
+void SharedMemoryPublisher::onLock(myo::Myo* myo, uint64_t timestamp) {
+  Begin(myo, timestamp, core::Events::Lock);
+  Publish();
+}
+
+void SharedMemoryPublisher::onPose(myo::Myo* myo, uint64_t timestamp,
+                                   const std::shared_ptr<core::Pose>& pose) {
+  Begin(myo, timestamp, core::Events::Pose);
+  PutString(pose->toString());
+  Publish();
+}
+
+void SharedMemoryPublisher::onGesture(
+    myo::Myo* myo, uint64_t timestamp,
+    const std::shared_ptr<core::Gesture>& gesture) {
+  Begin(myo, timestamp, core::Events::Gesture);
+  PutString(gesture->toString());
+  PutString(gesture->AssociatedPose()->toString());
+  Publish();
+}
+
+void SharedMemoryPublisher::onSpeculativeGesture(
+    myo::Myo* myo, uint64_t timestamp,
+    const std::shared_ptr<core::Gesture>& gesture,
+    core::Gesture::Status status) {
+  Begin(myo, timestamp, core::Events::SpeculativeGesture);
+  Put<int32_t>(static_cast<int32_t>(status));
+  PutString(gesture->toString());
+  PutString(gesture->AssociatedPose()->toString());
+  Publish();
+}
+
+void SharedMemoryPublisher::onOrientationData(
+    myo::Myo* myo, uint64_t timestamp, const myo::Quaternion<float>& rotation) {
+  Begin(myo, timestamp, core::Events::OrientationData);
+  Put<float>(rotation.x());
+  Put<float>(rotation.y());
+  Put<float>(rotation.z());
+  Put<float>(rotation.w());
+  Publish();
+}
+
+void SharedMemoryPublisher::onAccelerometerData(
+    myo::Myo* myo, uint64_t timestamp,
+    const myo::Vector3<float>& acceleration) {
+  Begin(myo, timestamp, core::Events::AccelerometerData);
+  Put<float>(acceleration.x());
+  Put<float>(acceleration.y());
+  Put<float>(acceleration.z());
+  Publish();
+}
+
+void SharedMemoryPublisher::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                                            const myo::Vector3<float>& gyro) {
+  Begin(myo, timestamp, core::Events::GyroscopeData);
+  Put<float>(gyro.x());
+  Put<float>(gyro.y());
+  Put<float>(gyro.z());
+  Publish();
+}
+
+void SharedMemoryPublisher::onRssi(myo::Myo* myo, uint64_t timestamp,
+                                   int8_t rssi) {
+  Begin(myo, timestamp, core::Events::Rssi);
+  Put<int8_t>(rssi);
+  Publish();
+}
+
+void SharedMemoryPublisher::onEmgData(myo::Myo* myo, uint64_t timestamp,
+                                      const int8_t* emg) {
+  Begin(myo, timestamp, core::Events::EmgData);
+  Put(emg, 8);
+  Publish();
+}
+
+void SharedMemoryPublisher::onEmgFeatures(
+    myo::Myo* myo, uint64_t timestamp,
+    const core::EmgFeatureVector& emg_features) {
+  Begin(myo, timestamp, core::Events::EmgFeatures);
+  PutFloats(emg_features.data(), core::EmgFeatureVector::size);
+  Publish();
+}
+
+void SharedMemoryPublisher::onEmgSpectrum(
+    myo::Myo* myo, uint64_t timestamp, const core::EmgSpectrum& emg_spectrum) {
+  const std::size_t num_channels = core::EmgSpectrum::numChannels;
+  Begin(myo, timestamp, core::Events::EmgSpectrum);
+  Put<uint32_t>(emg_spectrum.numBins());
+  Put<uint32_t>(emg_spectrum.numBands());
+  Put<float>(emg_spectrum.binWidth());
+  for (std::size_t bin = 0; bin < emg_spectrum.numBins(); ++bin) {
+    PutFloats(emg_spectrum.power(bin).data(), num_channels);
+  }
+  PutFloats(emg_spectrum.meanFrequency().data(), num_channels);
+  PutFloats(emg_spectrum.medianFrequency().data(), num_channels);
+  PutFloats(emg_spectrum.totalPower().data(), num_channels);
+  for (std::size_t band = 0; band < emg_spectrum.numBands(); ++band) {
+    PutFloats(emg_spectrum.bandPower(band).data(), num_channels);
+  }
+  Publish();
+}
+
+void SharedMemoryPublisher::onSensorFrame(myo::Myo* myo, uint64_t timestamp,
+                                          const core::SensorFrame& frame) {
+  Begin(myo, timestamp, core::Events::SensorFrame);
+  Put(&frame, sizeof(frame));
+  Publish();
+}
+
+uint64_t SharedMemoryPublisher::published() const { return published_; }
+
+uint64_t SharedMemoryPublisher::skipped() const { return skipped_; }
+
+void SharedMemoryPublisher::Begin(myo::Myo* myo, uint64_t timestamp,
+                                  int event) {
+  auto device = devices_.find(myo);
+  if (device == devices_.end()) {
+    device = devices_.emplace(myo, static_cast<uint16_t>(devices_.size()))
+                 .first;
+  }
+  RecordHeader header = {static_cast<uint16_t>(core::Events::Index(event)),
+                         device->second, 0, timestamp};
+  record_.clear();
+  Put(&header, sizeof(header));
+}
+
+void SharedMemoryPublisher::Put(const void* data, std::size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  record_.insert(record_.end(), bytes, bytes + size);
+}
+
+template <typename T>
+void SharedMemoryPublisher::Put(T value) {
+  Put(&value, sizeof(value));
+}
+
+void SharedMemoryPublisher::PutString(const std::string& string) {
+  Put<uint32_t>(string.size());
+  Put(string.data(), string.size());
+}
+
+void SharedMemoryPublisher::PutFloats(const float* values, std::size_t count) {
+  Put(values, count * sizeof(float));
+}
+
+void SharedMemoryPublisher::Publish() {
+  if (record_.size() > ring_.slotSize()) {
+    ++skipped_;
+    return;
+  }
+  ring_.write(record_.data(), record_.size());
+  ++published_;
+}
+}
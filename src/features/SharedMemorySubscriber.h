@@ -0,0 +1,358 @@
+/* SharedMemorySubscriber is the source of a feature tree in a process which
+ * consumes the events of a SharedMemoryPublisher in another process. It takes
+ * the place of a RootFeature: features are added to it as children, and poll
+ * or run passes the published events to them.
+ *
+ * A subscriber receives the events published after it was created. If it
+ * falls behind by more than the ring's number of slots, the oldest events are
+ * lost and counted by lost(); the publisher is never held up.
+ *
+ * The Myos of the publisher are represented by stand-ins: every Myo has a
+ * stable myo::Myo* which identifies it, but which mustn't be dereferenced.
+ * Poses named after one of the Myo's poses are passed on as that core::Pose,
+ * all other poses and all gestures as a SharedMemorySubscriber::Pose or
+ * SharedMemorySubscriber::Gesture with the published name. onPeriodic is
+ * called once per poll, for every Myo seen so far.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../core/DeviceListenerWrapper.h"
+#include "../core/Events.h"
+#include "../core/SharedMemoryRing.h"
+#include "SharedMemoryPublisher.h"
+
+namespace features {
+class SharedMemorySubscriber : public core::DeviceListenerWrapper {
+ public:
+  class Pose : public core::Pose {
+   public:
+    Pose(const std::string& name);
+
+    virtual std::string toString() const override;
+
+   private:
+    const std::string name_;
+  };
+
+  class Gesture : public core::Gesture {
+   public:
+    Gesture(const std::string& name, const std::shared_ptr<core::Pose>& pose);
+
+    virtual std::string toString() const override;
+
+   private:
+    const std::string name_;
+  };
+
+  // Throws std::runtime_error if there is no publisher called name.
+  explicit SharedMemorySubscriber(const std::string& name);
+
+  // Passes all of the events published since the last poll to the child
+  // features, and returns how many there were.
+  std::size_t poll();
+  // Polls for duration_ms, sleeping for a millisecond whenever there are no
+  // events.
+  void run(unsigned int duration_ms);
+
+  // The stand-in for the Myo with the given index, in the order the publisher
+  // first saw them.
+  myo::Myo* device(std::size_t index);
+  std::size_t numDevices() const;
+
+  // The number of events which were overwritten before they were read.
+  uint64_t lost() const;
+
+ private:
+  // Reads values from a record, throwing std::runtime_error if it's too short.
+  class Reader {
+   public:
+    Reader(const std::vector<char>& record);
+
+    void Get(void* data, std::size_t size);
+    template <typename T>
+    T Get();
+    std::string GetString();
+    void GetFloats(float* values, std::size_t count);
+
+   private:
+    const std::vector<char>& record_;
+    std::size_t position_;
+  };
+
+  void Dispatch(const std::vector<char>& record);
+  std::shared_ptr<core::Pose> GetPose(const std::string& name);
+  std::shared_ptr<core::Gesture> GetGesture(const std::string& name,
+                                            const std::string& pose_name);
+
+  core::SharedMemoryRing ring_;
+  // A byte per Myo, whose addresses are the stand-ins. A deque never moves
+  // its elements when it grows.
+  std::deque<char> devices_;
+  std::vector<char> record_;
+  // Poses and gestures are allocated once per name.
+  std::map<std::string, std::shared_ptr<core::Pose>> poses_;
+  std::map<std::pair<std::string, std::string>,
+           std::shared_ptr<core::Gesture>> gestures_;
+  core::EmgSpectrum emg_spectrum_;
+};
+
+SharedMemorySubscriber::Pose::Pose(const std::string& name) : name_(name) {}
+
+std::string SharedMemorySubscriber::Pose::toString() const { return name_; }
+
+SharedMemorySubscriber::Gesture::Gesture(
+    const std::string& name, const std::shared_ptr<core::Pose>& pose)
+    : core::Gesture(pose), name_(name) {}
+
+std::string SharedMemorySubscriber::Gesture::toString() const {
+  return name_;
+}
+
+SharedMemorySubscriber::SharedMemorySubscriber(const std::string& name)
+    : ring_(name) {
+  record_.reserve(ring_.slotSize());
+}
+
+std::size_t SharedMemorySubscriber::poll() {
+  std::size_t num_events = 0;
+  while (ring_.read(record_)) {
+    Dispatch(record_);
+    ++num_events;
+  }
+  for (char& device : devices_) {
+    core::DeviceListenerWrapper::onPeriodic(
+        reinterpret_cast<myo::Myo*>(&device));
+  }
+  return num_events;
+}
+
+void SharedMemorySubscriber::run(unsigned int duration_ms) {
+  auto end =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(duration_ms);
+  while (std::chrono::steady_clock::now() < end) {
+    if (poll() == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+myo::Myo* SharedMemorySubscriber::device(std::size_t index) {
+  if (index >= devices_.size()) {
+    devices_.resize(index + 1);
+  }
+  return reinterpret_cast<myo::Myo*>(&devices_[index]);
+}
+
+std::size_t SharedMemorySubscriber::numDevices() const {
+  return devices_.size();
+}
+
+uint64_t SharedMemorySubscriber::lost() const { return ring_.lost(); }
+
+void SharedMemorySubscriber::Dispatch(const std::vector<char>& record) {
+  typedef core::DeviceListenerWrapper Base;
+  Reader reader(record);
+  SharedMemoryPublisher::RecordHeader header;
+  reader.Get(&header, sizeof(header));
+  myo::Myo* myo = device(header.device);
+  uint64_t timestamp = header.timestamp;
+
+  switch (header.event) {
+    case core::Events::Index(core::Events::Pair):
+    case core::Events::Index(core::Events::Connect): {
+      myo::FirmwareVersion firmware_version;
+      firmware_version.firmwareVersionMajor = reader.Get<uint32_t>();
+      firmware_version.firmwareVersionMinor = reader.Get<uint32_t>();
+      firmware_version.firmwareVersionPatch = reader.Get<uint32_t>();
+      firmware_version.firmwareVersionHardwareRev = reader.Get<uint32_t>();
+      if (header.event == core::Events::Index(core::Events::Pair)) {
+        Base::onPair(myo, timestamp, firmware_version);
+      } else {
+        Base::onConnect(myo, timestamp, firmware_version);
+      }
+      break;
+    }
+    case core::Events::Index(core::Events::Unpair):
+      Base::onUnpair(myo, timestamp);
+      break;
+    case core::Events::Index(core::Events::Disconnect):
+      Base::onDisconnect(myo, timestamp);
+      break;
+    case core::Events::Index(core::Events::ArmSync): {
+      auto arm = static_cast<myo::Arm>(reader.Get<int32_t>());
+      auto x_direction = static_cast<myo::XDirection>(reader.Get<int32_t>());
+      float rotation = reader.Get<float>();
+      auto warmup_state = static_cast<myo::WarmupState>(reader.Get<int32_t>());
+      Base::onArmSync(myo, timestamp, arm, x_direction, rotation,
+                      warmup_state);
+      break;
+    }
+    case core::Events::Index(core::Events::ArmUnsync):
+      Base::onArmUnsync(myo, timestamp);
+      break;
+    case core::Events::Index(core::Events::Unlock):
+      Base::onUnlock(myo, timestamp);
+      break;
+    case core::Events::Index(core::Events::Lock):
+      Base::onLock(myo, timestamp);
+      break;
+    case core::Events::Index(core::Events::Pose):
+      Base::onPose(myo, timestamp, GetPose(reader.GetString()));
+      break;
+    case core::Events::Index(core::Events::Gesture): {
+      std::string name = reader.GetString();
+      Base::onGesture(myo, timestamp, GetGesture(name, reader.GetString()));
+      break;
+    }
+    case core::Events::Index(core::Events::SpeculativeGesture): {
+      auto status = static_cast<core::Gesture::Status>(reader.Get<int32_t>());
+      std::string name = reader.GetString();
+      Base::onSpeculativeGesture(myo, timestamp,
+                                 GetGesture(name, reader.GetString()), status);
+      break;
+    }
+    case core::Events::Index(core::Events::OrientationData): {
+      float rotation[4];
+      reader.GetFloats(rotation, 4);
+      Base::onOrientationData(
+          myo, timestamp, myo::Quaternion<float>(rotation[0], rotation[1],
+                                                 rotation[2], rotation[3]));
+      break;
+    }
+    case core::Events::Index(core::Events::AccelerometerData):
+    case core::Events::Index(core::Events::GyroscopeData): {
+      float vector[3];
+      reader.GetFloats(vector, 3);
+      myo::Vector3<float> data(vector[0], vector[1], vector[2]);
+      if (header.event == core::Events::Index(core::Events::GyroscopeData)) {
+        Base::onGyroscopeData(myo, timestamp, data);
+      } else {
+        Base::onAccelerometerData(myo, timestamp, data);
+      }
+      break;
+    }
+    case core::Events::Index(core::Events::Rssi):
+      Base::onRssi(myo, timestamp, reader.Get<int8_t>());
+      break;
+    case core::Events::Index(core::Events::EmgData): {
+      int8_t emg[8];
+      reader.Get(emg, sizeof(emg));
+      Base::onEmgData(myo, timestamp, emg);
+      break;
+    }
+    case core::Events::Index(core::Events::EmgFeatures): {
+      core::EmgFeatureVector emg_features;
+      for (std::size_t f = 0; f < core::EmgFeatureVector::numFeatures; ++f) {
+        auto feature = static_cast<core::EmgFeatureVector::Feature>(f);
+        for (std::size_t i = 0; i < core::EmgFeatureVector::numChannels; ++i) {
+          emg_features(feature, i) = reader.Get<float>();
+        }
+      }
+      Base::onEmgFeatures(myo, timestamp, emg_features);
+      break;
+    }
+    case core::Events::Index(core::Events::EmgSpectrum): {
+      const std::size_t num_channels = core::EmgSpectrum::numChannels;
+      std::size_t num_bins = reader.Get<uint32_t>();
+      std::size_t num_bands = reader.Get<uint32_t>();
+      float bin_width = reader.Get<float>();
+      if (num_bins != emg_spectrum_.numBins() ||
+          num_bands != emg_spectrum_.numBands() ||
+          bin_width != emg_spectrum_.binWidth()) {
+        emg_spectrum_ = core::EmgSpectrum(num_bins, bin_width, num_bands);
+      }
+      for (std::size_t bin = 0; bin < num_bins; ++bin) {
+        reader.GetFloats(emg_spectrum_.power(bin).data(), num_channels);
+      }
+      reader.GetFloats(emg_spectrum_.meanFrequency().data(), num_channels);
+      reader.GetFloats(emg_spectrum_.medianFrequency().data(), num_channels);
+      reader.GetFloats(emg_spectrum_.totalPower().data(), num_channels);
+      for (std::size_t band = 0; band < num_bands; ++band) {
+        reader.GetFloats(emg_spectrum_.bandPower(band).data(), num_channels);
+      }
+      Base::onEmgSpectrum(myo, timestamp, emg_spectrum_);
+      break;
+    }
+    case core::Events::Index(core::Events::SensorFrame): {
+      core::SensorFrame frame;
+      reader.Get(&frame, sizeof(frame));
+      Base::onSensorFrame(myo, timestamp, frame);
+      break;
+    }
+    default:
+      throw std::runtime_error("Unknown event in shared memory record.");
+  }
+}
+
+std::shared_ptr<core::Pose> SharedMemorySubscriber::GetPose(
+    const std::string& name) {
+  auto pose = poses_.find(name);
+  if (pose != poses_.end()) {
+    return pose->second;
+  }
+  std::shared_ptr<core::Pose> new_pose = core::Pose::fromString(name);
+  if (!new_pose) {
+    new_pose = std::make_shared<Pose>(name);
+  }
+  poses_.emplace(name, new_pose);
+  return new_pose;
+}
+
+std::shared_ptr<core::Gesture> SharedMemorySubscriber::GetGesture(
+    const std::string& name, const std::string& pose_name) {
+  auto key = std::make_pair(name, pose_name);
+  auto gesture = gestures_.find(key);
+  if (gesture != gestures_.end()) {
+    return gesture->second;
+  }
+  auto new_gesture = std::make_shared<Gesture>(name, GetPose(pose_name));
+  gestures_.emplace(key, new_gesture);
+  return new_gesture;
+}
+
+SharedMemorySubscriber::Reader::Reader(const std::vector<char>& record)
+    : record_(record), position_(0) {}
+
+void SharedMemorySubscriber::Reader::Get(void* data, std::size_t size) {
+  if (record_.size() - position_ < size) {
+    throw std::runtime_error("Truncated shared memory record.");
+  }
+  std::memcpy(data, record_.data() + position_, size);
+  position_ += size;
+}
+
+template <typename T>
+T SharedMemorySubscriber::Reader::Get() {
+  T value;
+  Get(&value, sizeof(value));
+  return value;
+}
+
+std::string SharedMemorySubscriber::Reader::GetString() {
+  std::size_t size = Get<uint32_t>();
+  if (record_.size() - position_ < size) {
+    throw std::runtime_error("Truncated shared memory record.");
+  }
+  std::string string(record_.data() + position_, size);
+  position_ += size;
+  return string;
+}
+
+void SharedMemorySubscriber::Reader::GetFloats(float* values,
+                                               std::size_t count) {
+  Get(values, count * sizeof(float));
+}
+}
@@ -0,0 +1,181 @@
+/* A chain of exponential moving average filters in a single feature. Each
+ * stage behaves exactly like an ExponentialMovingAverage with the same flags
+ * and alpha whose child is the next stage, so a chain of those can be
+ * replaced with one of these to save the dispatch of every event through the
+ * intermediate features. FeatureGraph does so when optimizing.
+ * See ExponentialMovingAverage.h for more info.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "InfiniteImpulseResponse.h"
+#include "../../core/DeviceListenerWrapper.h"
+
+namespace features {
+namespace filters {
+class CascadedExponentialMovingAverage : public core::DeviceListenerWrapper {
+ public:
+  typedef InfiniteImpulseResponse::DataFlags DataFlags;
+
+  struct Stage {
+    DataFlags flags;
+    float alpha;
+  };
+
+  CascadedExponentialMovingAverage(core::DeviceListenerWrapper& parent_feature,
+                                   const std::vector<Stage>& stages);
+
+  virtual void onOrientationData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Quaternion<float>& rotation) override;
+  virtual void onAccelerometerData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Vector3<float>& acceleration) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+
+  // Throws std::runtime_error when loading the state of a filter with
+  // different stages.
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
+
+  const std::vector<Stage>& stages() const;
+
+ private:
+  // The state of the stages which filter one stream.
+  struct Stream {
+    std::vector<float> alphas;
+    // size values per stage, valid once the stream has seen a value.
+    std::vector<float> values;
+    bool initialized;
+  };
+
+  static Stream MakeStream(const std::vector<Stage>& stages, DataFlags flag,
+                           std::size_t size);
+  // Passes values through the stages of stream in place.
+  static void Filter(Stream& stream, float* values, std::size_t size);
+  static void SaveStream(const Stream& stream, core::FeatureState& state);
+  static void LoadStream(Stream& stream, core::FeatureState& state);
+
+  const std::vector<Stage> stages_;
+  Stream orientation_, accelerometer_, gyroscope_;
+};
+
+CascadedExponentialMovingAverage::CascadedExponentialMovingAverage(
+    core::DeviceListenerWrapper& parent_feature,
+    const std::vector<Stage>& stages)
+    : stages_(stages),
+      orientation_(MakeStream(stages, InfiniteImpulseResponse::OrientationData,
+                              4)),
+      accelerometer_(MakeStream(
+          stages, InfiniteImpulseResponse::AccelerometerData, 3)),
+      gyroscope_(
+          MakeStream(stages, InfiniteImpulseResponse::GyroscopeData, 3)) {
+  parent_feature.addChildFeature(this);
+}
+
+void CascadedExponentialMovingAverage::onOrientationData(
+    myo::Myo* myo, uint64_t timestamp, const myo::Quaternion<float>& rotation) {
+  float values[] = {rotation.x(), rotation.y(), rotation.z(), rotation.w()};
+  Filter(orientation_, values, 4);
+  core::DeviceListenerWrapper::onOrientationData(
+      myo, timestamp,
+      myo::Quaternion<float>(values[0], values[1], values[2], values[3]));
+}
+
+void CascadedExponentialMovingAverage::onAccelerometerData(
+    myo::Myo* myo, uint64_t timestamp,
+    const myo::Vector3<float>& acceleration) {
+  float values[] = {acceleration.x(), acceleration.y(), acceleration.z()};
+  Filter(accelerometer_, values, 3);
+  core::DeviceListenerWrapper::onAccelerometerData(
+      myo, timestamp, myo::Vector3<float>(values[0], values[1], values[2]));
+}
+
+void CascadedExponentialMovingAverage::onGyroscopeData(
+    myo::Myo* myo, uint64_t timestamp, const myo::Vector3<float>& gyro) {
+  float values[] = {gyro.x(), gyro.y(), gyro.z()};
+  Filter(gyroscope_, values, 3);
+  core::DeviceListenerWrapper::onGyroscopeData(
+      myo, timestamp, myo::Vector3<float>(values[0], values[1], values[2]));
+}
+
+void CascadedExponentialMovingAverage::saveState(
+    core::FeatureState& state) const {
+  SaveStream(orientation_, state);
+  SaveStream(accelerometer_, state);
+  SaveStream(gyroscope_, state);
+}
+
+void CascadedExponentialMovingAverage::loadState(core::FeatureState& state) {
+  LoadStream(orientation_, state);
+  LoadStream(accelerometer_, state);
+  LoadStream(gyroscope_, state);
+}
+
+const std::vector<CascadedExponentialMovingAverage::Stage>&
+CascadedExponentialMovingAverage::stages() const {
+  return stages_;
+}
+
+CascadedExponentialMovingAverage::Stream
+CascadedExponentialMovingAverage::MakeStream(const std::vector<Stage>& stages,
+                                             DataFlags flag,
+                                             std::size_t size) {
+  Stream stream = {{}, {}, false};
+  for (const Stage& stage : stages) {
+    if (stage.flags & flag) {
+      stream.alphas.push_back(stage.alpha);
+    }
+  }
+  stream.values.resize(size * stream.alphas.size());
+  return stream;
+}
+
+void CascadedExponentialMovingAverage::Filter(Stream& stream, float* values,
+                                              std::size_t size) {
+  // Like InfiniteImpulseResponse, every stage starts with its first input,
+  // and since all stages see the same first value they start together.
+  if (!stream.initialized) {
+    for (std::size_t stage = 0; stage < stream.alphas.size(); ++stage) {
+      std::copy(values, values + size, stream.values.begin() + stage * size);
+    }
+    stream.initialized = true;
+    return;
+  }
+  for (std::size_t stage = 0; stage < stream.alphas.size(); ++stage) {
+    const float alpha = stream.alphas[stage];
+    float* state = &stream.values[stage * size];
+    for (std::size_t i = 0; i < size; ++i) {
+      state[i] = (alpha * values[i]) + ((1 - alpha) * state[i]);
+      values[i] = state[i];
+    }
+  }
+}
+void CascadedExponentialMovingAverage::SaveStream(const Stream& stream,
+                                                  core::FeatureState& state) {
+  state.put<uint32_t>(static_cast<uint32_t>(stream.values.size()));
+  state.put<bool>(stream.initialized);
+  for (float value : stream.values) {
+    state.put<float>(value);
+  }
+}
+
+void CascadedExponentialMovingAverage::LoadStream(Stream& stream,
+                                                  core::FeatureState& state) {
+  if (state.get<uint32_t>() != stream.values.size()) {
+    throw std::runtime_error("The stages of the filter have changed.");
+  }
+  stream.initialized = state.get<bool>();
+  for (float& value : stream.values) {
+    value = state.get<float>();
+  }
+}
+}
+}
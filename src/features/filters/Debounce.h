@@ -1,7 +1,12 @@
 /* Debounce class debounces poses to reduce accidental poses. Only poses held
  * for at least the debounce delay will trigger a pose. A pose which is held for
  * longer than the debounce delay will trigger the virtual function
- * onPose(myo::Myo*, Pose).
+ * onPose(myo::Myo*, Pose), with the timestamp at which the delay passed.
+ *
+ * The delay passes on the clock of the events: the timestamps of the sensor
+ * data which passes through, or of the next pose. During playback of a
+ * recording poses are therefore debounced as they were live. Without sensor
+ * data, onPeriodic detects the delay with the system clock.
  */
 
 #pragma once
@@ -21,9 +26,25 @@ class Debounce : public core::DeviceListenerWrapper {
 
   virtual void onPose(myo::Myo* myo, uint64_t timestamp,
                       const std::shared_ptr<core::Pose>& pose) override;
+  virtual void onOrientationData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Quaternion<float>& rotation) override;
+  virtual void onAccelerometerData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Vector3<float>& acceleration) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) override;
   virtual void onPeriodic(myo::Myo* myo) override;
 
+  // The wall clock time of the last pose isn't saved; it restarts on loading.
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
+
  private:
+  // Debounces the last pose if the delay has passed at timestamp.
+  void AdvanceTo(myo::Myo* myo, uint64_t timestamp);
   void debounceLastPose(myo::Myo* myo);
 
   int timeout_ms_;
@@ -43,10 +64,7 @@ Debounce::Debounce(core::DeviceListenerWrapper& parent_feature, int timeout_ms)
 
 void Debounce::onPose(myo::Myo* myo, uint64_t timestamp,
                       const std::shared_ptr<core::Pose>& pose) {
-  if (timestamp - last_pose_timestamp_ > 1000 * timeout_ms_ &&
-      *last_pose_ != *last_debounced_pose_) {
-    debounceLastPose(myo);
-  }
+  AdvanceTo(myo, timestamp);
   last_pose_ = pose;
   last_pose_time_ = std::chrono::system_clock::now();
   last_pose_timestamp_ = timestamp;
@@ -57,18 +75,66 @@ void Debounce::onPose(myo::Myo* myo, uint64_t timestamp,
   }
 }
 
+void Debounce::onOrientationData(myo::Myo* myo, uint64_t timestamp,
+                                 const myo::Quaternion<float>& rotation) {
+  AdvanceTo(myo, timestamp);
+  core::DeviceListenerWrapper::onOrientationData(myo, timestamp, rotation);
+}
+
+void Debounce::onAccelerometerData(myo::Myo* myo, uint64_t timestamp,
+                                   const myo::Vector3<float>& acceleration) {
+  AdvanceTo(myo, timestamp);
+  core::DeviceListenerWrapper::onAccelerometerData(myo, timestamp,
+                                                   acceleration);
+}
+
+void Debounce::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) {
+  AdvanceTo(myo, timestamp);
+  core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, gyro);
+}
+
+void Debounce::onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) {
+  AdvanceTo(myo, timestamp);
+  core::DeviceListenerWrapper::onEmgData(myo, timestamp, emg);
+}
+
 void Debounce::onPeriodic(myo::Myo* myo) {
-  if (std::chrono::duration_cast<std::chrono::milliseconds>(last_pose_time_ - std::chrono::system_clock::now()).count() > timeout_ms_ &&
+  if (std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now() - last_pose_time_).count() >
+          timeout_ms_ &&
       *last_pose_ != *last_debounced_pose_) {
     debounceLastPose(myo);
   }
   core::DeviceListenerWrapper::onPeriodic(myo);
 }
 
+void Debounce::saveState(core::FeatureState& state) const {
+  state.putPose(last_pose_);
+  state.putPose(last_debounced_pose_);
+  state.put<uint64_t>(last_pose_timestamp_);
+}
+
+void Debounce::loadState(core::FeatureState& state) {
+  last_pose_ = state.getPose();
+  last_debounced_pose_ = state.getPose();
+  last_pose_timestamp_ = state.get<uint64_t>();
+  last_pose_time_ = std::chrono::system_clock::now();
+}
+
+void Debounce::AdvanceTo(myo::Myo* myo, uint64_t timestamp) {
+  if (timestamp > last_pose_timestamp_ + 1000 * timeout_ms_ &&
+      *last_pose_ != *last_debounced_pose_) {
+    debounceLastPose(myo);
+  }
+}
+
 void Debounce::debounceLastPose(myo::Myo* myo) {
   last_debounced_pose_ = last_pose_;
   last_pose_time_ = std::chrono::system_clock::now();
-  core::DeviceListenerWrapper::onPose(myo, last_pose_timestamp_, last_pose_);
+  core::DeviceListenerWrapper::onPose(
+      myo, last_pose_timestamp_ + 1000 * timeout_ms_, last_pose_);
 }
 }
 }
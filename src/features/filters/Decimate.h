@@ -0,0 +1,25 @@
+/* Reduces the rate of the selected data streams by an integer factor. This is
+ * a Resample filter without interpolation; see Resample.h for more info.
+ */
+
+#pragma once
+
+#include "Resample.h"
+#include "../../core/DeviceListenerWrapper.h"
+
+namespace features {
+namespace filters {
+class Decimate : public Resample {
+ public:
+  // By default the anti-aliasing filter spans four output samples. Throws
+  // std::invalid_argument unless factor is positive.
+  explicit Decimate(core::DeviceListenerWrapper& parent_feature,
+                    DataFlags flags, int factor, int num_taps = 0);
+};
+
+Decimate::Decimate(core::DeviceListenerWrapper& parent_feature,
+                   DataFlags flags, int factor, int num_taps)
+    : Resample(parent_feature, flags, 1, factor,
+               num_taps > 0 ? num_taps : 4 * factor) {}
+}
+}
@@ -8,6 +8,7 @@
 #include <myo/myo.hpp>
 #include <boost/circular_buffer.hpp>
 #include <boost/optional.hpp>
+#include <stdexcept>
 
 #include "../../core/DeviceListenerWrapper.h"
 
@@ -33,6 +34,11 @@ class FiniteImpulseResponse : public core::DeviceListenerWrapper {
   virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
                                const myo::Vector3<float>& gyro) override;
 
+  // Throws std::runtime_error when loading the state of a filter with a
+  // different window size.
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
+
  protected:
   myo::Quaternion<float> UpdateOrientationData(
       const myo::Quaternion<float>& data);
@@ -103,6 +109,40 @@ void FiniteImpulseResponse::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
   }
 }
 
+void FiniteImpulseResponse::saveState(core::FeatureState& state) const {
+  state.put<uint32_t>(static_cast<uint32_t>(orientation_data_.capacity()));
+  state.put<uint32_t>(static_cast<uint32_t>(orientation_data_.size()));
+  for (const myo::Quaternion<float>& data : orientation_data_) {
+    state.putQuaternion(data);
+  }
+  state.put<uint32_t>(static_cast<uint32_t>(accelerometer_data_.size()));
+  for (const myo::Vector3<float>& data : accelerometer_data_) {
+    state.putVector(data);
+  }
+  state.put<uint32_t>(static_cast<uint32_t>(gyroscope_data_.size()));
+  for (const myo::Vector3<float>& data : gyroscope_data_) {
+    state.putVector(data);
+  }
+}
+
+void FiniteImpulseResponse::loadState(core::FeatureState& state) {
+  if (state.get<uint32_t>() != orientation_data_.capacity()) {
+    throw std::runtime_error("The window size of the filter has changed.");
+  }
+  orientation_data_.clear();
+  for (uint32_t size = state.get<uint32_t>(); size > 0; --size) {
+    orientation_data_.push_back(state.getQuaternion());
+  }
+  accelerometer_data_.clear();
+  for (uint32_t size = state.get<uint32_t>(); size > 0; --size) {
+    accelerometer_data_.push_back(state.getVector());
+  }
+  gyroscope_data_.clear();
+  for (uint32_t size = state.get<uint32_t>(); size > 0; --size) {
+    gyroscope_data_.push_back(state.getVector());
+  }
+}
+
 myo::Quaternion<float> FiniteImpulseResponse::UpdateOrientationData(
     const myo::Quaternion<float>& data) {
   boost::optional<myo::Quaternion<float>> old_data;
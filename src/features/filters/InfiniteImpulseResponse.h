@@ -34,6 +34,9 @@ class InfiniteImpulseResponse : public core::DeviceListenerWrapper {
   virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
                                const myo::Vector3<float>& gyro) override;
 
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
+
  protected:
   virtual float Update(float new_value, float old_value) = 0;
   void UpdateOrientationData(const myo::Quaternion<float>& data);
@@ -97,6 +100,36 @@ void InfiniteImpulseResponse::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
   }
 }
 
+void InfiniteImpulseResponse::saveState(core::FeatureState& state) const {
+  state.put<bool>(orientation_data_.is_initialized());
+  if (orientation_data_) {
+    state.putQuaternion(orientation_data_.get());
+  }
+  state.put<bool>(accelerometer_data_.is_initialized());
+  if (accelerometer_data_) {
+    state.putVector(accelerometer_data_.get());
+  }
+  state.put<bool>(gyroscope_data_.is_initialized());
+  if (gyroscope_data_) {
+    state.putVector(gyroscope_data_.get());
+  }
+}
+
+void InfiniteImpulseResponse::loadState(core::FeatureState& state) {
+  orientation_data_.reset();
+  if (state.get<bool>()) {
+    orientation_data_ = state.getQuaternion();
+  }
+  accelerometer_data_.reset();
+  if (state.get<bool>()) {
+    accelerometer_data_ = state.getVector();
+  }
+  gyroscope_data_.reset();
+  if (state.get<bool>()) {
+    gyroscope_data_ = state.getVector();
+  }
+}
+
 void InfiniteImpulseResponse::UpdateOrientationData(
     const myo::Quaternion<float>& data) {
   if (!orientation_data_) {
@@ -19,6 +19,9 @@ class MovingAverage : public FiniteImpulseResponse {
   explicit MovingAverage(core::DeviceListenerWrapper& parent_feature,
                          DataFlags flags, int window_size);
 
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
+
  private:
   virtual myo::Quaternion<float> RecalculateOrientation(
       const myo::Quaternion<float>& new_data,
@@ -39,6 +42,38 @@ MovingAverage::MovingAverage(core::DeviceListenerWrapper& parent_feature,
                              DataFlags flags, int window_size)
     : FiniteImpulseResponse(parent_feature, flags, window_size) {}
 
+void MovingAverage::saveState(core::FeatureState& state) const {
+  FiniteImpulseResponse::saveState(state);
+  state.put<bool>(orientation_avg_.is_initialized());
+  if (orientation_avg_) {
+    state.putQuaternion(orientation_avg_.get());
+  }
+  state.put<bool>(accelerometer_avg_.is_initialized());
+  if (accelerometer_avg_) {
+    state.putVector(accelerometer_avg_.get());
+  }
+  state.put<bool>(gyroscope_avg_.is_initialized());
+  if (gyroscope_avg_) {
+    state.putVector(gyroscope_avg_.get());
+  }
+}
+
+void MovingAverage::loadState(core::FeatureState& state) {
+  FiniteImpulseResponse::loadState(state);
+  orientation_avg_.reset();
+  if (state.get<bool>()) {
+    orientation_avg_ = state.getQuaternion();
+  }
+  accelerometer_avg_.reset();
+  if (state.get<bool>()) {
+    accelerometer_avg_ = state.getVector();
+  }
+  gyroscope_avg_.reset();
+  if (state.get<bool>()) {
+    gyroscope_avg_ = state.getVector();
+  }
+}
+
 myo::Quaternion<float> MovingAverage::RecalculateOrientation(
     const myo::Quaternion<float>& new_data,
     const boost::optional<myo::Quaternion<float>>& old_data) {
@@ -0,0 +1,332 @@
+/* Changes the rate of the selected data streams by the rational factor
+ * interpolation / decimation using a polyphase FIR filter. The prototype
+ * low-pass filter is a Blackman windowed sinc which removes everything above
+ * the lower of the two Nyquist frequencies, so decimated streams are band
+ * limited before samples are dropped. Child features only receive the
+ * resampled data, so every feature below this one does proportionally less
+ * work. Each output sample costs taps_per_phase multiply-adds per value.
+ *
+ * Resampled samples are emitted with the timestamp of the input sample that
+ * produced them. Streams not selected by DataFlags are passed on unmodified.
+ *
+ * q and -q are the same orientation, so each orientation is flipped into the
+ * hemisphere of the one before it before it's filtered, and the filtered
+ * quaternions are normalized again.
+ */
+
+#pragma once
+
+/* for MSVC++ */
+#define _USE_MATH_DEFINES
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../core/DeviceListenerWrapper.h"
+
+namespace features {
+namespace filters {
+class Resample : public core::DeviceListenerWrapper {
+ public:
+  enum DataFlags {
+    OrientationData   = 1 << 0,
+    AccelerometerData = 1 << 1,
+    GyroscopeData     = 1 << 2,
+    EmgData           = 1 << 3
+  };
+
+  // Throws std::invalid_argument unless interpolation, decimation and
+  // taps_per_phase are positive.
+  explicit Resample(core::DeviceListenerWrapper& parent_feature,
+                    DataFlags flags, int interpolation, int decimation,
+                    int taps_per_phase = 8);
+
+  virtual void onOrientationData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Quaternion<float>& rotation) override;
+  virtual void onAccelerometerData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Vector3<float>& acceleration) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) override;
+
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
+
+ private:
+  // Throws std::invalid_argument unless value is positive.
+  static std::size_t CheckPositive(int value, const std::string& name);
+
+  // The polyphase filter state of a stream of N dimensional samples.
+  template <std::size_t N>
+  class Stream {
+   public:
+    typedef std::array<float, N> Sample;
+
+    Stream(const Resample& resample);
+
+    // Adds an input sample and calls emit for each output sample that is due.
+    template <typename Emit>
+    void push(const Sample& sample, Emit emit);
+
+    // The last sample added, or zero if there is none.
+    const Sample& newest() const;
+
+    void save(core::FeatureState& state) const;
+    void load(core::FeatureState& state);
+
+   private:
+    const Resample& resample_;
+    // The newest sample is at next_, older samples follow. Each sample is
+    // written twice, taps_per_phase_ apart, so they are always contiguous.
+    std::vector<Sample> history_;
+    std::size_t next_;
+    // Position of the next output sample relative to the newest input sample,
+    // at the interpolated rate.
+    std::size_t offset_;
+  };
+
+  const DataFlags flags_;
+  const std::size_t interpolation_, decimation_, taps_per_phase_;
+  // Coefficients of the prototype filter ordered by phase, then tap.
+  std::vector<float> coefficients_;
+  Stream<4> orientation_stream_;
+  Stream<3> accelerometer_stream_, gyroscope_stream_;
+  Stream<8> emg_stream_;
+};
+
+Resample::DataFlags operator|(Resample::DataFlags lhs,
+                              Resample::DataFlags rhs) {
+  return static_cast<Resample::DataFlags>(static_cast<int>(lhs) |
+                                          static_cast<int>(rhs));
+}
+
+Resample::Resample(core::DeviceListenerWrapper& parent_feature,
+                   DataFlags flags, int interpolation, int decimation,
+                   int taps_per_phase)
+    : flags_(flags),
+      interpolation_(CheckPositive(interpolation, "interpolation factor")),
+      decimation_(CheckPositive(decimation, "decimation factor")),
+      taps_per_phase_(CheckPositive(taps_per_phase, "number of taps")),
+      coefficients_(interpolation_ * taps_per_phase_),
+      orientation_stream_(*this),
+      accelerometer_stream_(*this),
+      gyroscope_stream_(*this),
+      emg_stream_(*this) {
+  const std::size_t length = coefficients_.size();
+  const double cutoff =
+      0.5 / std::max(interpolation_, decimation_);  // cycles per sample
+  const double center = (length - 1) / 2.0;
+  std::vector<double> prototype(length);
+  std::vector<double> phase_sums(interpolation_, 0);
+  for (std::size_t k = 0; k < length; ++k) {
+    double t = k - center;
+    double sinc = t == 0 ? 1 : std::sin(2 * M_PI * cutoff * t) /
+                                   (2 * M_PI * cutoff * t);
+    double window = length == 1 ? 1 : 0.42 -
+                    0.5 * std::cos(2 * M_PI * k / (length - 1)) +
+                    0.08 * std::cos(4 * M_PI * k / (length - 1));
+    prototype[k] = sinc * window;
+    phase_sums[k % interpolation_] += prototype[k];
+  }
+  // Every output sample is computed by a single phase, so each phase is
+  // normalized separately to keep the DC gain at exactly one.
+  for (std::size_t k = 0; k < length; ++k) {
+    std::size_t phase = k % interpolation_;
+    std::size_t tap = k / interpolation_;
+    coefficients_[phase * taps_per_phase_ + tap] =
+        static_cast<float>(prototype[k] / phase_sums[phase]);
+  }
+  parent_feature.addChildFeature(this);
+}
+
+std::size_t Resample::CheckPositive(int value, const std::string& name) {
+  if (value <= 0) {
+    throw std::invalid_argument("The " + name + " must be positive.");
+  }
+  return value;
+}
+
+template <std::size_t N>
+Resample::Stream<N>::Stream(const Resample& resample)
+    : resample_(resample),
+      history_(2 * resample.taps_per_phase_, Sample()),
+      next_(0),
+      offset_(0) {}
+
+template <std::size_t N>
+template <typename Emit>
+void Resample::Stream<N>::push(const Sample& sample, Emit emit) {
+  const std::size_t taps = resample_.taps_per_phase_;
+  next_ = (next_ + taps - 1) % taps;
+  history_[next_] = sample;
+  history_[next_ + taps] = sample;
+
+  const Sample* newest = &history_[next_];
+  while (offset_ < resample_.interpolation_) {
+    const float* coefficients = &resample_.coefficients_[offset_ * taps];
+    Sample output = Sample();
+    for (std::size_t t = 0; t < taps; ++t) {
+      for (std::size_t i = 0; i < N; ++i) {
+        output[i] += coefficients[t] * newest[t][i];
+      }
+    }
+    emit(output);
+    offset_ += resample_.decimation_;
+  }
+  offset_ -= resample_.interpolation_;
+}
+
+template <std::size_t N>
+const typename Resample::Stream<N>::Sample& Resample::Stream<N>::newest()
+    const {
+  return history_[next_];
+}
+
+template <std::size_t N>
+void Resample::Stream<N>::save(core::FeatureState& state) const {
+  const std::size_t taps = resample_.taps_per_phase_;
+  for (std::size_t t = 0; t < taps; ++t) {
+    state.put<Sample>(history_[t]);
+  }
+  state.put<uint32_t>(static_cast<uint32_t>(next_));
+  state.put<uint32_t>(static_cast<uint32_t>(offset_));
+}
+
+template <std::size_t N>
+void Resample::Stream<N>::load(core::FeatureState& state) {
+  const std::size_t taps = resample_.taps_per_phase_;
+  for (std::size_t t = 0; t < taps; ++t) {
+    history_[t] = history_[t + taps] = state.get<Sample>();
+  }
+  next_ = state.get<uint32_t>() % taps;
+  offset_ = state.get<uint32_t>();
+}
+
+void Resample::saveState(core::FeatureState& state) const {
+  state.put<int32_t>(flags_);
+  state.put<uint32_t>(static_cast<uint32_t>(interpolation_));
+  state.put<uint32_t>(static_cast<uint32_t>(decimation_));
+  state.put<uint32_t>(static_cast<uint32_t>(taps_per_phase_));
+  // Streams which aren't resampled stay empty.
+  if (flags_ & OrientationData) {
+    orientation_stream_.save(state);
+  }
+  if (flags_ & AccelerometerData) {
+    accelerometer_stream_.save(state);
+  }
+  if (flags_ & GyroscopeData) {
+    gyroscope_stream_.save(state);
+  }
+  if (flags_ & EmgData) {
+    emg_stream_.save(state);
+  }
+}
+
+void Resample::loadState(core::FeatureState& state) {
+  if (state.get<int32_t>() != flags_ ||
+      state.get<uint32_t>() != interpolation_ ||
+      state.get<uint32_t>() != decimation_ ||
+      state.get<uint32_t>() != taps_per_phase_) {
+    throw std::runtime_error("The parameters of the filter have changed.");
+  }
+  if (flags_ & OrientationData) {
+    orientation_stream_.load(state);
+  }
+  if (flags_ & AccelerometerData) {
+    accelerometer_stream_.load(state);
+  }
+  if (flags_ & GyroscopeData) {
+    gyroscope_stream_.load(state);
+  }
+  if (flags_ & EmgData) {
+    emg_stream_.load(state);
+  }
+}
+
+void Resample::onOrientationData(myo::Myo* myo, uint64_t timestamp,
+                                 const myo::Quaternion<float>& rotation) {
+  if (flags_ & OrientationData) {
+    Stream<4>::Sample sample = {
+        {rotation.x(), rotation.y(), rotation.z(), rotation.w()}};
+    const Stream<4>::Sample& previous = orientation_stream_.newest();
+    float dot = 0.f;
+    for (std::size_t i = 0; i < 4; ++i) {
+      dot += sample[i] * previous[i];
+    }
+    if (dot < 0.f) {
+      for (float& value : sample) {
+        value = -value;
+      }
+    }
+    orientation_stream_.push(sample, [&](const Stream<4>::Sample& output) {
+      float norm = 0.f;
+      for (float value : output) {
+        norm += value * value;
+      }
+      norm = norm > 0.f ? 1.f / std::sqrt(norm) : 0.f;
+      core::DeviceListenerWrapper::onOrientationData(
+          myo, timestamp,
+          myo::Quaternion<float>(norm * output[0], norm * output[1],
+                                 norm * output[2], norm * output[3]));
+    });
+  } else {
+    core::DeviceListenerWrapper::onOrientationData(myo, timestamp, rotation);
+  }
+}
+
+void Resample::onAccelerometerData(myo::Myo* myo, uint64_t timestamp,
+                                   const myo::Vector3<float>& acceleration) {
+  if (flags_ & AccelerometerData) {
+    Stream<3>::Sample sample = {
+        {acceleration.x(), acceleration.y(), acceleration.z()}};
+    accelerometer_stream_.push(sample, [&](const Stream<3>::Sample& output) {
+      core::DeviceListenerWrapper::onAccelerometerData(
+          myo, timestamp, myo::Vector3<float>(output[0], output[1], output[2]));
+    });
+  } else {
+    core::DeviceListenerWrapper::onAccelerometerData(myo, timestamp,
+                                                     acceleration);
+  }
+}
+
+void Resample::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) {
+  if (flags_ & GyroscopeData) {
+    Stream<3>::Sample sample = {{gyro.x(), gyro.y(), gyro.z()}};
+    gyroscope_stream_.push(sample, [&](const Stream<3>::Sample& output) {
+      core::DeviceListenerWrapper::onGyroscopeData(
+          myo, timestamp, myo::Vector3<float>(output[0], output[1], output[2]));
+    });
+  } else {
+    core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, gyro);
+  }
+}
+
+void Resample::onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) {
+  if (flags_ & EmgData) {
+    Stream<8>::Sample sample;
+    std::copy(emg, emg + 8, sample.begin());
+    emg_stream_.push(sample, [&](const Stream<8>::Sample& output) {
+      int8_t resampled[8];
+      for (std::size_t i = 0; i < 8; ++i) {
+        float value = std::floor(output[i] + 0.5f);
+        resampled[i] =
+            static_cast<int8_t>(std::max(-128.f, std::min(127.f, value)));
+      }
+      core::DeviceListenerWrapper::onEmgData(myo, timestamp, resampled);
+    });
+  } else {
+    core::DeviceListenerWrapper::onEmgData(myo, timestamp, emg);
+  }
+}
+}
+}
@@ -0,0 +1,203 @@
+/* SuppressPrefixPoses hides poses which are part of a pose sequence gesture,
+ * so that e.g. the fist of "fist -> waveIn -> rest" doesn't also trigger
+ * whatever a fist does on its own. Only poses that could still be the start
+ * of a pattern are held back: a pose is passed on to the child features as
+ * soon as the next pose or the passing of time rules out every pattern it
+ * could be part of. When a pattern is completed its poses are dropped and a
+ * PoseSequences::Gesture is emitted via onGesture instead.
+ *
+ * Every step of a pattern after the first has a time limit, budget_ms unless
+ * it has its own. A held pose waits at most the limit of the next step for
+ * the next pose, but every pose which continues the pattern starts a new
+ * wait. So a pose can be delayed by the sum of the limits of the steps which
+ * follow it in the longest pattern it could be part of, e.g. 600 ms for the
+ * first pose of a three step pattern with limits of 300 ms, not just by a
+ * single limit. metrics() reports the delays actually added.
+ *
+ * Delays are measured with the pose timestamps, or with the system clock in
+ * onPeriodic if no pose follows.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "../../core/DeviceListenerWrapper.h"
+#include "../../core/Pose.h"
+#include "../../core/PoseSequenceAutomaton.h"
+#include "../gestures/PoseSequences.h"
+
+namespace features {
+namespace filters {
+class SuppressPrefixPoses : public core::DeviceListenerWrapper {
+ public:
+  struct Metrics {
+    // The number of poses passed on, of those the number held back for any
+    // time, and the number of poses dropped as part of a gesture.
+    std::size_t released, delayed, suppressed;
+    // The total and the largest delay of the released poses in microseconds.
+    uint64_t total_delay_us, max_delay_us;
+  };
+
+  // Throws the same exceptions as the PoseSequenceAutomaton constructor.
+  SuppressPrefixPoses(
+      core::DeviceListenerWrapper& parent_feature,
+      const std::vector<core::PoseSequenceAutomaton::Pattern>& patterns,
+      int budget_ms = 500);
+
+  virtual void onPose(myo::Myo* myo, uint64_t timestamp,
+                      const std::shared_ptr<core::Pose>& pose) override;
+  virtual void onPeriodic(myo::Myo* myo) override;
+
+  const core::PoseSequenceAutomaton& automaton() const;
+  const Metrics& metrics() const;
+  void resetMetrics();
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct HeldPose {
+    myo::Myo* myo;
+    uint64_t timestamp;
+    std::shared_ptr<core::Pose> pose;
+    // The position of the pose in the stream of poses.
+    std::size_t index;
+  };
+
+  // Fills in budget_ms as the time limit of every step without one.
+  static std::vector<core::PoseSequenceAutomaton::Pattern> WithBudget(
+      std::vector<core::PoseSequenceAutomaton::Pattern> patterns,
+      int budget_ms);
+
+  // The number of most recent poses which can still be part of a partial
+  // match elapsed_us after the last pose.
+  std::size_t LiveDepth(uint64_t elapsed_us) const;
+  // Passes on the held poses that aren't among the last depth poses.
+  void Release(std::size_t depth, uint64_t now);
+
+  const core::PoseSequenceAutomaton automaton_;
+  core::PoseSequenceAutomaton::State state_;
+  std::deque<HeldPose> held_;
+  // The number of poses so far, and when the last one arrived.
+  std::size_t num_poses_;
+  uint64_t last_timestamp_;
+  Clock::time_point last_time_;
+  Metrics metrics_;
+};
+
+SuppressPrefixPoses::SuppressPrefixPoses(
+    core::DeviceListenerWrapper& parent_feature,
+    const std::vector<core::PoseSequenceAutomaton::Pattern>& patterns,
+    int budget_ms)
+    : automaton_(WithBudget(patterns, budget_ms)),
+      state_(core::PoseSequenceAutomaton::start),
+      num_poses_(0),
+      last_timestamp_(0),
+      last_time_(Clock::now()),
+      metrics_() {
+  parent_feature.addChildFeature(this);
+}
+
+void SuppressPrefixPoses::onPose(myo::Myo* myo, uint64_t timestamp,
+                                 const std::shared_ptr<core::Pose>& pose) {
+  uint64_t elapsed = num_poses_ > 0 && timestamp >= last_timestamp_
+                         ? timestamp - last_timestamp_
+                         : std::numeric_limits<uint64_t>::max();
+  state_ =
+      automaton_.next(state_, automaton_.symbol(pose->toString()), elapsed);
+  HeldPose held_pose = {myo, timestamp, pose, num_poses_++};
+  held_.push_back(held_pose);
+  last_timestamp_ = timestamp;
+  last_time_ = Clock::now();
+
+  // Drop the poses of the longest completed pattern, since any shorter one
+  // ends with the same poses.
+  std::size_t completed = 0;
+  for (std::size_t index : automaton_.matches(state_)) {
+    completed = std::max(completed, automaton_.pattern(index).steps.size());
+  }
+  while (!held_.empty() && held_.back().index + completed >= num_poses_) {
+    held_.pop_back();
+    ++metrics_.suppressed;
+  }
+
+  Release(LiveDepth(0), timestamp);
+  for (std::size_t index : automaton_.matches(state_)) {
+    core::DeviceListenerWrapper::onGesture(
+        myo, timestamp,
+        std::make_shared<gestures::PoseSequences::Gesture>(
+            automaton_.pattern(index).name, pose));
+  }
+}
+
+void SuppressPrefixPoses::onPeriodic(myo::Myo* myo) {
+  if (!held_.empty()) {
+    uint64_t elapsed = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                              last_time_)
+            .count());
+    Release(LiveDepth(elapsed), last_timestamp_ + elapsed);
+  }
+  core::DeviceListenerWrapper::onPeriodic(myo);
+}
+
+const core::PoseSequenceAutomaton& SuppressPrefixPoses::automaton() const {
+  return automaton_;
+}
+
+const SuppressPrefixPoses::Metrics& SuppressPrefixPoses::metrics() const {
+  return metrics_;
+}
+
+void SuppressPrefixPoses::resetMetrics() { metrics_ = Metrics(); }
+
+std::vector<core::PoseSequenceAutomaton::Pattern>
+SuppressPrefixPoses::WithBudget(
+    std::vector<core::PoseSequenceAutomaton::Pattern> patterns,
+    int budget_ms) {
+  for (auto& pattern : patterns) {
+    for (auto& step : pattern.steps) {
+      if (step.within_ms == 0) {
+        step.within_ms = budget_ms;
+      }
+    }
+  }
+  return patterns;
+}
+
+std::size_t SuppressPrefixPoses::LiveDepth(uint64_t elapsed_us) const {
+  std::size_t depth = 0;
+  for (const auto& partial : automaton_.partialMatches(state_)) {
+    const auto& step =
+        automaton_.pattern(partial.pattern).steps[partial.matched];
+    if (elapsed_us <= 1000 * step.within_ms) {
+      depth = std::max(depth, partial.matched);
+    }
+  }
+  return depth;
+}
+
+void SuppressPrefixPoses::Release(std::size_t depth, uint64_t now) {
+  while (!held_.empty() && held_.front().index + depth < num_poses_) {
+    HeldPose held_pose = held_.front();
+    held_.pop_front();
+    uint64_t delay = now > held_pose.timestamp ? now - held_pose.timestamp : 0;
+    ++metrics_.released;
+    if (delay > 0) {
+      ++metrics_.delayed;
+      metrics_.total_delay_us += delay;
+      metrics_.max_delay_us = std::max(metrics_.max_delay_us, delay);
+    }
+    core::DeviceListenerWrapper::onPose(held_pose.myo, held_pose.timestamp,
+                                        held_pose.pose);
+  }
+}
+}
+}
@@ -0,0 +1,297 @@
+/* ChordGestures recognizes chords, i.e. poses made at the same time with
+ * several Myos, such as both fists within 150 ms. A chord is a list of poses
+ * which have to be held by distinct devices and started within its window of
+ * each other, in any assignment of poses to devices, so it works for any
+ * number of Myos. When a pose completes a chord a Gesture with the chord's
+ * name, associated with that pose, is emitted to the child features via
+ * onGesture. All events are forwarded unchanged.
+ *
+ * Every Myo timestamps its events with its own clock, so the start times of
+ * poses are first converted to a common time base. The offset of a device's
+ * clock is estimated as the minimum of the local receive time minus the event
+ * timestamp over the last offset_window events of any kind, since the event
+ * with the least transmission delay gives the tightest bound on it.
+ *
+ * Each pose costs amortized constant time for the given chords: the starts of
+ * the poses of all devices are kept in a sliding window per pose, which is
+ * only searched as far back as the longest chord window.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../core/DeviceListenerWrapper.h"
+#include "../../core/Gesture.h"
+#include "../../core/Pose.h"
+
+namespace features {
+namespace gestures {
+class ChordGestures : public core::DeviceListenerWrapper {
+ public:
+  class Gesture : public core::Gesture {
+   public:
+    Gesture(const std::string& name, const std::shared_ptr<core::Pose>& pose);
+
+    virtual std::string toString() const override;
+
+   private:
+    const std::string name_;
+  };
+
+  struct Chord {
+    std::string name;
+    // The poses of the chord, one per device.
+    std::vector<std::string> poses;
+    int window_ms;
+  };
+
+  // Returns the local time in microseconds. Defaults to the steady clock.
+  typedef std::function<int64_t()> Clock;
+
+  // Throws std::invalid_argument if a chord has no poses.
+  ChordGestures(core::DeviceListenerWrapper& parent_feature,
+                const std::vector<Chord>& chords,
+                std::size_t offset_window = 500, const Clock& clock = Clock());
+
+  virtual void onPose(myo::Myo* myo, uint64_t timestamp,
+                      const std::shared_ptr<core::Pose>& pose) override;
+  virtual void onOrientationData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Quaternion<float>& rotation) override;
+  virtual void onAccelerometerData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Vector3<float>& acceleration) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) override;
+
+  // The estimated local time minus the timestamps of myo in microseconds, or
+  // 0 for an unknown device.
+  int64_t clockOffset(myo::Myo* myo) const;
+  std::size_t numDevices() const;
+
+ private:
+  struct Device {
+    // The current pose, and the generation of the pose, which is incremented
+    // whenever the pose changes so that stale starts can be recognized.
+    std::size_t symbol, generation;
+    // The offset samples which can still become the minimum, in order, each
+    // with its sequence number.
+    std::deque<std::pair<uint64_t, int64_t>> offsets;
+    uint64_t num_samples;
+  };
+
+  struct Start {
+    int64_t time;
+    std::size_t device, generation;
+  };
+
+  // Returns the device of myo, adding it if it's new.
+  Device& GetDevice(myo::Myo* myo, std::size_t* index = nullptr);
+  // Adds a sample to the clock offset of myo and returns the new estimate.
+  int64_t AddSample(myo::Myo* myo, uint64_t timestamp,
+                    std::size_t* index = nullptr);
+  // The number of devices that started symbol at or after time and still
+  // hold it.
+  std::size_t CountSince(std::size_t symbol, int64_t time) const;
+
+  const std::vector<Chord> chords_;
+  const std::size_t offset_window_;
+  const Clock clock_;
+  int64_t max_window_us_;
+  std::unordered_map<std::string, std::size_t> symbols_;
+  // For each symbol, the chords containing it.
+  std::vector<std::vector<std::size_t>> chords_by_symbol_;
+  // For each chord, its poses as symbols and how many of each are needed.
+  std::vector<std::vector<std::pair<std::size_t, std::size_t>>> chord_counts_;
+  std::unordered_map<myo::Myo*, std::size_t> device_indices_;
+  std::vector<Device> devices_;
+  // For each symbol, the recent starts of that pose in order of time.
+  std::vector<std::deque<Start>> starts_;
+};
+
+ChordGestures::Gesture::Gesture(const std::string& name,
+                                const std::shared_ptr<core::Pose>& pose)
+    : core::Gesture(pose), name_(name) {}
+
+std::string ChordGestures::Gesture::toString() const { return name_; }
+
+ChordGestures::ChordGestures(core::DeviceListenerWrapper& parent_feature,
+                             const std::vector<Chord>& chords,
+                             std::size_t offset_window, const Clock& clock)
+    : chords_(chords),
+      offset_window_(std::max<std::size_t>(offset_window, 1)),
+      clock_(clock ? clock : Clock([]() {
+        return static_cast<int64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                .count());
+      })),
+      max_window_us_(0) {
+  for (std::size_t c = 0; c < chords_.size(); ++c) {
+    const Chord& chord = chords_[c];
+    if (chord.poses.empty()) {
+      throw std::invalid_argument("Chord " + chord.name + " has no poses.");
+    }
+    max_window_us_ = std::max<int64_t>(max_window_us_, 1000 * chord.window_ms);
+    chord_counts_.push_back({});
+    for (const std::string& pose : chord.poses) {
+      if (symbols_.count(pose) == 0) {
+        std::size_t symbol = symbols_.size();
+        symbols_[pose] = symbol;
+        chords_by_symbol_.push_back({});
+      }
+      std::size_t symbol = symbols_[pose];
+      auto& counts = chord_counts_.back();
+      auto found = std::find_if(counts.begin(), counts.end(),
+                                [symbol](const std::pair<std::size_t,
+                                                         std::size_t>& count) {
+                                  return count.first == symbol;
+                                });
+      if (found == counts.end()) {
+        counts.push_back(std::make_pair(symbol, 1));
+        chords_by_symbol_[symbol].push_back(c);
+      } else {
+        ++found->second;
+      }
+    }
+  }
+  starts_.resize(symbols_.size());
+  parent_feature.addChildFeature(this);
+}
+
+void ChordGestures::onPose(myo::Myo* myo, uint64_t timestamp,
+                           const std::shared_ptr<core::Pose>& pose) {
+  std::size_t index;
+  int64_t time = static_cast<int64_t>(timestamp) + AddSample(myo, timestamp,
+                                                             &index);
+  Device& device = devices_[index];
+  auto found = symbols_.find(pose->toString());
+  device.symbol = found == symbols_.end() ? symbols_.size() : found->second;
+  ++device.generation;
+  core::DeviceListenerWrapper::onPose(myo, timestamp, pose);
+  if (found == symbols_.end()) {
+    return;
+  }
+
+  std::deque<Start>& starts = starts_[device.symbol];
+  Start start = {time, index, device.generation};
+  // Starts usually arrive in order, but the clock offsets may reorder them
+  // slightly.
+  auto position = starts.end();
+  while (position != starts.begin() && (position - 1)->time > time) {
+    --position;
+  }
+  starts.insert(position, start);
+  while (!starts.empty() && starts.front().time < time - max_window_us_) {
+    starts.pop_front();
+  }
+
+  for (std::size_t c : chords_by_symbol_[device.symbol]) {
+    const int64_t since = time - 1000 * chords_[c].window_ms;
+    bool complete = true;
+    for (const auto& count : chord_counts_[c]) {
+      if (CountSince(count.first, since) < count.second) {
+        complete = false;
+        break;
+      }
+    }
+    if (complete) {
+      core::DeviceListenerWrapper::onGesture(
+          myo, timestamp, std::make_shared<Gesture>(chords_[c].name, pose));
+    }
+  }
+}
+
+void ChordGestures::onOrientationData(myo::Myo* myo, uint64_t timestamp,
+                                      const myo::Quaternion<float>& rotation) {
+  AddSample(myo, timestamp);
+  core::DeviceListenerWrapper::onOrientationData(myo, timestamp, rotation);
+}
+
+void ChordGestures::onAccelerometerData(
+    myo::Myo* myo, uint64_t timestamp,
+    const myo::Vector3<float>& acceleration) {
+  AddSample(myo, timestamp);
+  core::DeviceListenerWrapper::onAccelerometerData(myo, timestamp,
+                                                   acceleration);
+}
+
+void ChordGestures::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                                    const myo::Vector3<float>& gyro) {
+  AddSample(myo, timestamp);
+  core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, gyro);
+}
+
+void ChordGestures::onEmgData(myo::Myo* myo, uint64_t timestamp,
+                              const int8_t* emg) {
+  AddSample(myo, timestamp);
+  core::DeviceListenerWrapper::onEmgData(myo, timestamp, emg);
+}
+
+int64_t ChordGestures::clockOffset(myo::Myo* myo) const {
+  auto found = device_indices_.find(myo);
+  if (found == device_indices_.end()) {
+    return 0;
+  }
+  return devices_[found->second].offsets.front().second;
+}
+
+std::size_t ChordGestures::numDevices() const { return devices_.size(); }
+
+ChordGestures::Device& ChordGestures::GetDevice(myo::Myo* myo,
+                                                std::size_t* index) {
+  auto found = device_indices_.find(myo);
+  if (found == device_indices_.end()) {
+    found = device_indices_.insert(std::make_pair(myo, devices_.size())).first;
+    Device device = {symbols_.size(), 0, {}, 0};
+    devices_.push_back(device);
+  }
+  if (index) {
+    *index = found->second;
+  }
+  return devices_[found->second];
+}
+
+int64_t ChordGestures::AddSample(myo::Myo* myo, uint64_t timestamp,
+                                 std::size_t* index) {
+  Device& device = GetDevice(myo, index);
+  int64_t sample = clock_() - static_cast<int64_t>(timestamp);
+  // A sliding window minimum: samples that are no smaller than a newer one
+  // can never become the minimum again.
+  while (!device.offsets.empty() && device.offsets.back().second >= sample) {
+    device.offsets.pop_back();
+  }
+  device.offsets.push_back(std::make_pair(device.num_samples++, sample));
+  if (device.offsets.front().first + offset_window_ < device.num_samples) {
+    device.offsets.pop_front();
+  }
+  return device.offsets.front().second;
+}
+
+std::size_t ChordGestures::CountSince(std::size_t symbol, int64_t time) const {
+  std::size_t count = 0;
+  const std::deque<Start>& starts = starts_[symbol];
+  for (auto start = starts.rbegin();
+       start != starts.rend() && start->time >= time; ++start) {
+    const Device& device = devices_[start->device];
+    if (device.symbol == symbol && device.generation == start->generation) {
+      ++count;
+    }
+  }
+  return count;
+}
+}
+}
@@ -0,0 +1,197 @@
+/* DtwGestures spots motions which may be performed at varying speeds by
+ * matching the recent orientation and / or gyroscope data against a library
+ * of templates with dynamic time warping. Every hop_size IMU samples (once
+ * length samples have been received) the last length samples are compared to
+ * all templates, and if the closest one is within max_distance a Gesture with
+ * its name is emitted to the child features via onGesture. The window is then
+ * cleared so that a single motion is only spotted once.
+ *
+ * Each template is resampled to length points and compared with the whole
+ * window, so length should be about the duration of the motions in samples.
+ * A motion matches only when it fills the window, give or take band samples
+ * at either end. Shorter motions, or motions surrounded by other movement
+ * within the window, aren't found even if they match a template well. Motions
+ * at any offset in the stream are found as the window slides, which is most
+ * reliable with a hop_size of 1.
+ *
+ * Each point holds the selected streams in the order orientation (x, y, z, w,
+ * kept in the same hemisphere as the previous sample), gyroscope, so templates
+ * have 3, 4 or 7 values per point. band limits how far, in samples, the
+ * warping path may stray from the diagonal.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../core/DeviceListenerWrapper.h"
+#include "../../core/DynamicTimeWarping.h"
+#include "../../core/Gesture.h"
+#include "../../core/SlidingWindow.h"
+
+namespace features {
+namespace gestures {
+class DtwGestures : public core::DeviceListenerWrapper {
+ public:
+  class Gesture : public core::Gesture {
+   public:
+    Gesture(const std::string& name, float distance);
+
+    virtual std::string toString() const override;
+
+    float distance() const;
+
+   private:
+    const std::string name_;
+    const float distance_;
+  };
+
+  enum DataFlags {
+    OrientationData = 1 << 0,
+    GyroscopeData   = 1 << 1
+  };
+
+  DtwGestures(core::DeviceListenerWrapper& parent_feature, DataFlags flags,
+              float max_distance, int length = 50, int band = 5,
+              int hop_size = 1);
+
+  virtual void onOrientationData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Quaternion<float>& rotation) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+
+  // points holds consecutive points of dimensions() values each, which are
+  // resampled to the window length.
+  void addTemplate(const std::string& name, const std::vector<float>& points);
+
+  std::size_t dimensions() const;
+  const core::DynamicTimeWarping& dynamicTimeWarping() const;
+
+ private:
+  static std::size_t CheckSize(int size, const std::string& name);
+  static std::size_t CheckBand(int band);
+  void AddPoint(myo::Myo* myo, uint64_t timestamp);
+
+  const DataFlags flags_;
+  const float max_distance_;
+  const std::size_t hop_size_;
+  core::DynamicTimeWarping dtw_;
+  // The latest values of the selected streams.
+  std::vector<float> point_;
+  core::SlidingWindow<float> window_;
+  std::size_t samples_since_match_;
+};
+
+DtwGestures::DataFlags operator|(DtwGestures::DataFlags lhs,
+                                 DtwGestures::DataFlags rhs) {
+  return static_cast<DtwGestures::DataFlags>(static_cast<int>(lhs) |
+                                             static_cast<int>(rhs));
+}
+
+DtwGestures::Gesture::Gesture(const std::string& name, float distance)
+    : core::Gesture(), name_(name), distance_(distance) {}
+
+std::string DtwGestures::Gesture::toString() const { return name_; }
+
+float DtwGestures::Gesture::distance() const { return distance_; }
+
+DtwGestures::DtwGestures(core::DeviceListenerWrapper& parent_feature,
+                         DataFlags flags, float max_distance, int length,
+                         int band, int hop_size)
+    : flags_(flags),
+      max_distance_(max_distance),
+      hop_size_(CheckSize(hop_size, "hop size")),
+      dtw_(((flags & OrientationData) ? 4 : 0) +
+               ((flags & GyroscopeData) ? 3 : 0),
+           CheckSize(length, "length"), CheckBand(band)),
+      point_(dtw_.dimensions()),
+      window_(dtw_.length(), dtw_.dimensions()),
+      samples_since_match_(0) {
+  parent_feature.addChildFeature(this);
+}
+
+std::size_t DtwGestures::CheckSize(int size, const std::string& name) {
+  if (size <= 0) {
+    throw std::invalid_argument("The " + name + " must be positive.");
+  }
+  return size;
+}
+
+std::size_t DtwGestures::CheckBand(int band) {
+  if (band < 0) {
+    throw std::invalid_argument("The band must not be negative.");
+  }
+  return band;
+}
+
+void DtwGestures::onOrientationData(myo::Myo* myo, uint64_t timestamp,
+                                    const myo::Quaternion<float>& rotation) {
+  core::DeviceListenerWrapper::onOrientationData(myo, timestamp, rotation);
+  if (flags_ & OrientationData) {
+    // q and -q are the same rotation, so pick the one closest to the previous
+    // sample to keep the trajectory continuous.
+    float dot = point_[0] * rotation.x() + point_[1] * rotation.y() +
+                point_[2] * rotation.z() + point_[3] * rotation.w();
+    float sign = dot < 0.f ? -1.f : 1.f;
+    point_[0] = sign * rotation.x();
+    point_[1] = sign * rotation.y();
+    point_[2] = sign * rotation.z();
+    point_[3] = sign * rotation.w();
+    // The Myo reports gyroscope data after orientation data, so the point is
+    // complete once both have been received.
+    if (!(flags_ & GyroscopeData)) {
+      AddPoint(myo, timestamp);
+    }
+  }
+}
+
+void DtwGestures::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                                  const myo::Vector3<float>& gyro) {
+  core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, gyro);
+  if (flags_ & GyroscopeData) {
+    std::size_t offset = (flags_ & OrientationData) ? 4 : 0;
+    point_[offset] = gyro.x();
+    point_[offset + 1] = gyro.y();
+    point_[offset + 2] = gyro.z();
+    AddPoint(myo, timestamp);
+  }
+}
+
+void DtwGestures::addTemplate(const std::string& name,
+                              const std::vector<float>& points) {
+  dtw_.addTemplate(name, points.data(), points.size() / dimensions());
+}
+
+std::size_t DtwGestures::dimensions() const { return dtw_.dimensions(); }
+
+const core::DynamicTimeWarping& DtwGestures::dynamicTimeWarping() const {
+  return dtw_;
+}
+
+void DtwGestures::AddPoint(myo::Myo* myo, uint64_t timestamp) {
+  window_.push(point_.data());
+  ++samples_since_match_;
+
+  if (!window_.full() || samples_since_match_ < hop_size_ ||
+      dtw_.numTemplates() == 0) {
+    return;
+  }
+  samples_since_match_ = 0;
+  core::DynamicTimeWarping::Match match =
+      dtw_.recognize(window_.data(), max_distance_);
+  if (match.index >= 0) {
+    window_.clear();
+    core::DeviceListenerWrapper::onGesture(
+        myo, timestamp,
+        std::make_shared<Gesture>(dtw_.templateName(match.index),
+                                  match.distance));
+  }
+}
+}
+}
@@ -0,0 +1,142 @@
+/* NetworkGestures classifies windows of raw EMG data with a quantized neural
+ * network. Every hop_size samples (once the network's input length has been
+ * received) the last window is classified, and whenever the class changes it
+ * is emitted to the child features, either as a pose via onPose or as a
+ * gesture via onGesture. Raw EMG data is passed on unmodified.
+ *
+ * class_names names the outputs of the network. As poses, classes named after
+ * one of the Myo's poses are emitted as that core::Pose, all other classes as
+ * a NetworkGestures::Pose with the class name. As gestures, the first class is
+ * the background class and isn't emitted, all other classes are emitted as a
+ * NetworkGestures::Gesture with the class name.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../core/DeviceListenerWrapper.h"
+#include "../../core/Gesture.h"
+#include "../../core/Pose.h"
+#include "../../core/QuantizedNetwork.h"
+#include "../../core/SlidingWindow.h"
+
+namespace features {
+namespace gestures {
+class NetworkGestures : public core::DeviceListenerWrapper {
+ public:
+  class Pose : public core::Pose {
+   public:
+    Pose(const std::string& name);
+
+    virtual std::string toString() const override;
+
+   private:
+    const std::string name_;
+  };
+
+  class Gesture : public core::Gesture {
+   public:
+    Gesture(const std::string& name);
+
+    virtual std::string toString() const override;
+
+   private:
+    const std::string name_;
+  };
+
+  enum class Output { poses, gestures };
+
+  // Throws std::invalid_argument if the network doesn't take 8 channels of
+  // EMG data or class_names doesn't match its outputs.
+  NetworkGestures(core::DeviceListenerWrapper& parent_feature,
+                  std::unique_ptr<core::QuantizedNetwork> network,
+                  const std::vector<std::string>& class_names,
+                  Output output = Output::poses, int hop_size = 10);
+
+  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) override;
+
+  core::QuantizedNetwork& network();
+
+ private:
+  static const std::size_t numChannels = 8;
+
+  const std::unique_ptr<core::QuantizedNetwork> network_;
+  const Output output_;
+  const std::size_t hop_size_;
+  std::vector<std::shared_ptr<core::Pose>> poses_;
+  std::vector<std::shared_ptr<core::Gesture>> gestures_;
+  core::SlidingWindow<int8_t> window_;
+  std::size_t samples_since_classify_;
+  // The last emitted class, or -1 before the first window.
+  int last_class_;
+};
+
+NetworkGestures::Pose::Pose(const std::string& name)
+    : core::Pose(), name_(name) {}
+
+std::string NetworkGestures::Pose::toString() const { return name_; }
+
+NetworkGestures::Gesture::Gesture(const std::string& name)
+    : core::Gesture(), name_(name) {}
+
+std::string NetworkGestures::Gesture::toString() const { return name_; }
+
+NetworkGestures::NetworkGestures(
+    core::DeviceListenerWrapper& parent_feature,
+    std::unique_ptr<core::QuantizedNetwork> network,
+    const std::vector<std::string>& class_names, Output output, int hop_size)
+    : network_(std::move(network)),
+      output_(output),
+      hop_size_(hop_size),
+      window_(network_->inputLength(), numChannels),
+      samples_since_classify_(0),
+      last_class_(-1) {
+  if (network_->inputChannels() != numChannels ||
+      network_->numOutputs() != class_names.size()) {
+    throw std::invalid_argument(
+        "NetworkGestures network doesn't match the EMG data or classes.");
+  }
+  for (const auto& name : class_names) {
+    std::shared_ptr<core::Pose> pose = core::Pose::fromString(name);
+    poses_.push_back(pose ? pose : std::make_shared<Pose>(name));
+    gestures_.push_back(std::make_shared<Gesture>(name));
+  }
+  parent_feature.addChildFeature(this);
+}
+
+void NetworkGestures::onEmgData(myo::Myo* myo, uint64_t timestamp,
+                                const int8_t* emg) {
+  window_.push(emg);
+  ++samples_since_classify_;
+
+  core::DeviceListenerWrapper::onEmgData(myo, timestamp, emg);
+
+  if (!window_.full() || samples_since_classify_ < hop_size_) {
+    return;
+  }
+  samples_since_classify_ = 0;
+  int current_class = static_cast<int>(network_->classify(window_.data()));
+  if (current_class == last_class_) {
+    return;
+  }
+  last_class_ = current_class;
+  if (output_ == Output::poses) {
+    core::DeviceListenerWrapper::onPose(myo, timestamp,
+                                        poses_[current_class]);
+  } else if (current_class != 0) {
+    core::DeviceListenerWrapper::onGesture(myo, timestamp,
+                                           gestures_[current_class]);
+  }
+}
+
+core::QuantizedNetwork& NetworkGestures::network() { return *network_; }
+}
+}
@@ -1,17 +1,36 @@
 /* Pose adds gesture detection for poses. Gestures include clicking,
  * double clicking, and holding the pose.
+ *
+ * A pose which ends within click_max_hold_min milliseconds is a click, and a
+ * pose held for longer is a hold. A click of the same pose which starts within
+ * double_click_timeout milliseconds of the end of a click makes both a
+ * double click, so a single click is only certain once that timeout has
+ * passed. By default a singleClick is therefore emitted via onGesture that
+ * long after the click.
+ *
+ * In speculative mode every click is additionally reported immediately via
+ * onSpeculativeGesture as a tentative singleClick, which is later either
+ * confirmed, or cancelled and followed by a doubleClick. All other gestures
+ * are reported there as confirmed as well, so features overriding
+ * onSpeculativeGesture can ignore onGesture. onGesture is the same in both
+ * modes.
+ *
+ * Durations are taken from the timestamps of the events. Timeouts which pass
+ * without a new pose are detected with the timestamps of the sensor data
+ * which passes through, so during playback of a recording they pass as they
+ * did live, and in onPeriodic with the system clock when there's no data.
  */
 
 #pragma once
 
 #include <myo/myo.hpp>
+#include <chrono>
+#include <memory>
 #include <string>
-#include <unordered_map>
 
 #include "../../core/DeviceListenerWrapper.h"
 #include "../../core/Gesture.h"
-#include <ctime>
-#include <chrono>
+#include "../../core/Pose.h"
 
 namespace features {
 namespace gestures {
@@ -30,18 +49,60 @@ class PoseGestures : public core::DeviceListenerWrapper {
     Type type_;
   };
 
+  enum class Mode { conservative, speculative };
+
   PoseGestures(core::DeviceListenerWrapper& parent_feature,
-               int click_max_hold_min = 1000, int double_click_timeout = 750);
+               int click_max_hold_min = 1000, int double_click_timeout = 750,
+               Mode mode = Mode::conservative);
 
   virtual void onPose(myo::Myo* myo, uint64_t timestamp,
                       const std::shared_ptr<core::Pose>& pose) override;
+  virtual void onOrientationData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Quaternion<float>& rotation) override;
+  virtual void onAccelerometerData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Vector3<float>& acceleration) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+  virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
+                         const int8_t* emg) override;
   virtual void onPeriodic(myo::Myo* myo) override;
 
+  // The current pose and the pending click. Their system clock times aren't
+  // saved, so the timeouts detected in onPeriodic restart on loading.
+  virtual void saveState(core::FeatureState& state) const override;
+  virtual void loadState(core::FeatureState& state) override;
+
  private:
-  const int click_max_hold_min_, double_click_timeout_;
-//   std::unordered_map<std::string, BasicTimer> gesture_timers_;
-  std::unordered_map<std::string, std::chrono::system_clock::time_point current_time> gesture_timers_;
-  std::shared_ptr<Gesture> last_gesture_;
+  typedef std::chrono::steady_clock Clock;
+
+  // Emits gesture via onGesture, and via onSpeculativeGesture as confirmed in
+  // speculative mode.
+  void EmitGesture(myo::Myo* myo, uint64_t timestamp,
+                   const std::shared_ptr<core::Gesture>& gesture);
+  void EmitSpeculativeGesture(myo::Myo* myo, uint64_t timestamp,
+                              const std::shared_ptr<core::Gesture>& gesture,
+                              core::Gesture::Status status);
+  // Emits the gestures whose timeouts have passed at timestamp.
+  void AdvanceTo(myo::Myo* myo, uint64_t timestamp);
+  // Emits the pending single click.
+  void ConfirmClick(myo::Myo* myo, uint64_t timestamp);
+  void EmitHold(myo::Myo* myo, uint64_t timestamp);
+  bool Clickable(const core::Pose& pose) const;
+
+  const uint64_t click_max_hold_min_us_, double_click_timeout_us_;
+  const Mode mode_;
+  // The current pose, when it started, and whether it has been held.
+  std::shared_ptr<core::Pose> pose_;
+  uint64_t pose_timestamp_;
+  Clock::time_point pose_time_;
+  bool held_;
+  // The single click which might still become a double click, if any, and
+  // when it ended.
+  std::shared_ptr<Gesture> pending_click_;
+  uint64_t click_timestamp_;
+  Clock::time_point click_time_;
 };
 
 PoseGestures::Gesture::Gesture(Type type) : core::Gesture(), type_(type) {}
@@ -76,50 +137,172 @@ bool operator!=(const PoseGestures::Gesture& lhs,
 }
 
 PoseGestures::PoseGestures(core::DeviceListenerWrapper& parent_feature,
-                           int click_max_hold_min, int double_click_timeout)
-    : click_max_hold_min_(click_max_hold_min),
-      double_click_timeout_(double_click_timeout),
-      last_gesture_(new Gesture()) {
+                           int click_max_hold_min, int double_click_timeout,
+                           Mode mode)
+    : click_max_hold_min_us_(1000 * static_cast<uint64_t>(click_max_hold_min)),
+      double_click_timeout_us_(1000 *
+                               static_cast<uint64_t>(double_click_timeout)),
+      mode_(mode),
+      pose_(new core::Pose(core::Pose::rest)),
+      pose_timestamp_(0),
+      pose_time_(Clock::now()),
+      held_(false),
+      click_timestamp_(0),
+      click_time_(pose_time_) {
   parent_feature.addChildFeature(this);
 }
 
 void PoseGestures::onPose(myo::Myo* myo, uint64_t timestamp,
                           const std::shared_ptr<core::Pose>& pose) {
-
-  std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-
-  if (gesture_timers_.count(last_gesture_->toDescriptiveString()) > 0
-    && gesture_timers_[last_gesture_->toDescriptiveString()].millisecondsSinceTick() <= click_max_hold_min_) {
-    std::shared_ptr<core::Gesture> current_gesture;
-    if (gesture_timers_.count(Gesture(last_gesture_->AssociatedPose(), Gesture::singleClick).toDescriptiveString()) > 0
-        && millisecondsBetweenTicks(gesture_timers_[Gesture(last_gesture_->AssociatedPose(), Gesture::singleClick).toDescriptiveString()],
-            gesture_timers_[last_gesture_->toDescriptiveString()]) <=
-            double_click_timeout_) {
-      // Double click. Suppress the current single click.
-      current_gesture.reset(new Gesture(last_gesture_->AssociatedPose(), Gesture::doubleClick));
-    }
-    else {
-      // Single click.
-      current_gesture.reset(new Gesture(last_gesture_->AssociatedPose(), Gesture::singleClick));
+  AdvanceTo(myo, timestamp);
+  // The end of the previous pose.
+  if (Clickable(*pose_) && !held_) {
+    if (timestamp - pose_timestamp_ > click_max_hold_min_us_) {
+      EmitHold(myo, timestamp);
+    } else if (pending_click_ && *pending_click_->AssociatedPose() == *pose_) {
+      // Double click. Cancel the pending single click.
+      EmitSpeculativeGesture(myo, timestamp, pending_click_,
+                             core::Gesture::Status::cancelled);
+      pending_click_.reset();
+      EmitGesture(myo, timestamp,
+                  std::make_shared<Gesture>(pose_, Gesture::doubleClick));
+    } else {
+      pending_click_ = std::make_shared<Gesture>(pose_, Gesture::singleClick);
+      click_timestamp_ = timestamp;
+      click_time_ = Clock::now();
+      EmitSpeculativeGesture(myo, timestamp, pending_click_,
+                             core::Gesture::Status::tentative);
     }
-    gesture_timers_[current_gesture->toDescriptiveString()] = now;
-    core::DeviceListenerWrapper::onGesture(myo, timestamp, current_gesture);
   }
 
-  last_gesture_.reset(new Gesture(pose, Gesture::none));
-  gesture_timers_[last_gesture_->toDescriptiveString()] = now;
+  // The start of the new pose, which can only continue the pending click if
+  // it is the same pose in time.
+  if (pending_click_ &&
+      (timestamp - click_timestamp_ > double_click_timeout_us_ ||
+       (Clickable(*pose) && *pose != *pending_click_->AssociatedPose()))) {
+    ConfirmClick(myo, timestamp);
+  }
+  pose_ = pose;
+  pose_timestamp_ = timestamp;
+  pose_time_ = Clock::now();
+  held_ = false;
   core::DeviceListenerWrapper::onPose(myo, timestamp, pose);
 }
 
+void PoseGestures::onOrientationData(myo::Myo* myo, uint64_t timestamp,
+                                     const myo::Quaternion<float>& rotation) {
+  AdvanceTo(myo, timestamp);
+  core::DeviceListenerWrapper::onOrientationData(myo, timestamp, rotation);
+}
+
+void PoseGestures::onAccelerometerData(
+    myo::Myo* myo, uint64_t timestamp,
+    const myo::Vector3<float>& acceleration) {
+  AdvanceTo(myo, timestamp);
+  core::DeviceListenerWrapper::onAccelerometerData(myo, timestamp,
+                                                   acceleration);
+}
+
+void PoseGestures::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                                   const myo::Vector3<float>& gyro) {
+  AdvanceTo(myo, timestamp);
+  core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, gyro);
+}
+
+void PoseGestures::onEmgData(myo::Myo* myo, uint64_t timestamp,
+                             const int8_t* emg) {
+  AdvanceTo(myo, timestamp);
+  core::DeviceListenerWrapper::onEmgData(myo, timestamp, emg);
+}
+
 void PoseGestures::onPeriodic(myo::Myo* myo) {
-  if (*last_gesture_ != Gesture(Gesture::hold)
-    && gesture_timers_.count(Gesture(last_gesture_->AssociatedPose(), Gesture::none).toDescriptiveString()) > 0
-    && gesture_timers_[Gesture(last_gesture_->AssociatedPose(), Gesture::none).toDescriptiveString()].millisecondsSinceTick() >
-          click_max_hold_min_) {
-    last_gesture_.reset(new Gesture(last_gesture_->AssociatedPose(), Gesture::hold));
-    core::DeviceListenerWrapper::onGesture(myo, 0, last_gesture_);
+  Clock::time_point now = Clock::now();
+  auto microseconds = [now](Clock::time_point time) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(now - time)
+            .count());
+  };
+  if (pending_click_ && !Clickable(*pose_) &&
+      microseconds(click_time_) > double_click_timeout_us_) {
+    ConfirmClick(myo, click_timestamp_ + double_click_timeout_us_);
+  }
+  if (Clickable(*pose_) && !held_ &&
+      microseconds(pose_time_) > click_max_hold_min_us_) {
+    EmitHold(myo, pose_timestamp_ + click_max_hold_min_us_);
   }
   core::DeviceListenerWrapper::onPeriodic(myo);
 }
+
+void PoseGestures::saveState(core::FeatureState& state) const {
+  state.putPose(pose_);
+  state.put<uint64_t>(pose_timestamp_);
+  state.put<bool>(held_);
+  state.put<bool>(static_cast<bool>(pending_click_));
+  if (pending_click_) {
+    state.putPose(pending_click_->AssociatedPose());
+    state.put<uint64_t>(click_timestamp_);
+  }
+}
+
+void PoseGestures::loadState(core::FeatureState& state) {
+  pose_ = state.getPose();
+  pose_timestamp_ = state.get<uint64_t>();
+  pose_time_ = Clock::now();
+  held_ = state.get<bool>();
+  pending_click_.reset();
+  if (state.get<bool>()) {
+    pending_click_ =
+        std::make_shared<Gesture>(state.getPose(), Gesture::singleClick);
+    click_timestamp_ = state.get<uint64_t>();
+    click_time_ = pose_time_;
+  }
+}
+
+void PoseGestures::EmitGesture(myo::Myo* myo, uint64_t timestamp,
+                               const std::shared_ptr<core::Gesture>& gesture) {
+  EmitSpeculativeGesture(myo, timestamp, gesture,
+                         core::Gesture::Status::confirmed);
+  core::DeviceListenerWrapper::onGesture(myo, timestamp, gesture);
+}
+
+void PoseGestures::EmitSpeculativeGesture(
+    myo::Myo* myo, uint64_t timestamp,
+    const std::shared_ptr<core::Gesture>& gesture,
+    core::Gesture::Status status) {
+  if (mode_ == Mode::speculative) {
+    core::DeviceListenerWrapper::onSpeculativeGesture(myo, timestamp, gesture,
+                                                      status);
+  }
+}
+
+void PoseGestures::AdvanceTo(myo::Myo* myo, uint64_t timestamp) {
+  if (pending_click_ && !Clickable(*pose_) &&
+      timestamp > click_timestamp_ + double_click_timeout_us_) {
+    ConfirmClick(myo, click_timestamp_ + double_click_timeout_us_);
+  }
+  if (Clickable(*pose_) && !held_ &&
+      timestamp > pose_timestamp_ + click_max_hold_min_us_) {
+    EmitHold(myo, pose_timestamp_ + click_max_hold_min_us_);
+  }
+}
+
+void PoseGestures::ConfirmClick(myo::Myo* myo, uint64_t timestamp) {
+  std::shared_ptr<Gesture> click = pending_click_;
+  pending_click_.reset();
+  EmitGesture(myo, timestamp, click);
+}
+
+void PoseGestures::EmitHold(myo::Myo* myo, uint64_t timestamp) {
+  // A long second press of a click isn't a double click.
+  if (pending_click_) {
+    ConfirmClick(myo, timestamp);
+  }
+  held_ = true;
+  EmitGesture(myo, timestamp, std::make_shared<Gesture>(pose_, Gesture::hold));
+}
+
+bool PoseGestures::Clickable(const core::Pose& pose) const {
+  return pose != core::Pose::rest && pose != core::Pose::unknown;
+}
 }
 }
@@ -0,0 +1,97 @@
+/* PoseSequences recognizes gestures made of several poses in a row, such as
+ * "fist -> waveIn within 400 -> rest", where each pose has to follow the
+ * previous one within the given number of milliseconds. The patterns are
+ * compiled into a single PoseSequenceAutomaton, so each pose costs one table
+ * lookup however many patterns there are. Whenever a pattern is completed a
+ * Gesture with its name, associated with the last pose, is emitted to the
+ * child features via onGesture. Matches may overlap, e.g. fist, rest, fist,
+ * rest, fist matches "fist -> rest -> fist" twice. Poses are forwarded
+ * unchanged.
+ *
+ * Times are measured between the timestamps of the poses, which are in
+ * microseconds.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../../core/DeviceListenerWrapper.h"
+#include "../../core/Gesture.h"
+#include "../../core/Pose.h"
+#include "../../core/PoseSequenceAutomaton.h"
+
+namespace features {
+namespace gestures {
+class PoseSequences : public core::DeviceListenerWrapper {
+ public:
+  class Gesture : public core::Gesture {
+   public:
+    Gesture(const std::string& name, const std::shared_ptr<core::Pose>& pose);
+
+    virtual std::string toString() const override;
+
+   private:
+    const std::string name_;
+  };
+
+  // Throws the same exceptions as the PoseSequenceAutomaton constructor.
+  PoseSequences(
+      core::DeviceListenerWrapper& parent_feature,
+      const std::vector<core::PoseSequenceAutomaton::Pattern>& patterns);
+
+  virtual void onPose(myo::Myo* myo, uint64_t timestamp,
+                      const std::shared_ptr<core::Pose>& pose) override;
+
+  const core::PoseSequenceAutomaton& automaton() const;
+
+ private:
+  const core::PoseSequenceAutomaton automaton_;
+  core::PoseSequenceAutomaton::State state_;
+  // The timestamp of the last pose, if there has been one.
+  bool has_last_pose_;
+  uint64_t last_timestamp_;
+};
+
+PoseSequences::Gesture::Gesture(const std::string& name,
+                                const std::shared_ptr<core::Pose>& pose)
+    : core::Gesture(pose), name_(name) {}
+
+std::string PoseSequences::Gesture::toString() const { return name_; }
+
+PoseSequences::PoseSequences(
+    core::DeviceListenerWrapper& parent_feature,
+    const std::vector<core::PoseSequenceAutomaton::Pattern>& patterns)
+    : automaton_(patterns),
+      state_(core::PoseSequenceAutomaton::start),
+      has_last_pose_(false),
+      last_timestamp_(0) {
+  parent_feature.addChildFeature(this);
+}
+
+void PoseSequences::onPose(myo::Myo* myo, uint64_t timestamp,
+                           const std::shared_ptr<core::Pose>& pose) {
+  uint64_t elapsed = has_last_pose_ && timestamp >= last_timestamp_
+                         ? timestamp - last_timestamp_
+                         : std::numeric_limits<uint64_t>::max();
+  has_last_pose_ = true;
+  last_timestamp_ = timestamp;
+  state_ = automaton_.next(state_, automaton_.symbol(pose->toString()),
+                           elapsed);
+  core::DeviceListenerWrapper::onPose(myo, timestamp, pose);
+  for (std::size_t index : automaton_.matches(state_)) {
+    core::DeviceListenerWrapper::onGesture(
+        myo, timestamp, std::shared_ptr<core::Gesture>(new Gesture(
+                            automaton_.pattern(index).name, pose)));
+  }
+}
+
+const core::PoseSequenceAutomaton& PoseSequences::automaton() const {
+  return automaton_;
+}
+}
+}
@@ -0,0 +1,176 @@
+/* TemplateGestures recognizes motions of the arm by matching the recent
+ * accelerometer and / or gyroscope trajectory against a library of templates
+ * with an N-dimensional $1 recognizer. Every hop_size IMU samples (once
+ * window_size samples have been received) the last window_size samples are
+ * matched, and if the closest template is within max_distance a Gesture with
+ * its name is emitted to the child features via onGesture. The window is then
+ * cleared so that a single motion is only recognized once.
+ *
+ * Each point of the trajectory holds the selected streams in the order
+ * accelerometer, gyroscope, so templates have 3 or 6 values per point.
+ * Lower-bound pruning and early abandoning keep matching against hundreds of
+ * templates well within the 20 ms between IMU samples.
+ */
+
+#pragma once
+
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../core/DeviceListenerWrapper.h"
+#include "../../core/Gesture.h"
+#include "../../core/SlidingWindow.h"
+#include "../../core/TemplateRecognizer.h"
+
+namespace features {
+namespace gestures {
+class TemplateGestures : public core::DeviceListenerWrapper {
+ public:
+  class Gesture : public core::Gesture {
+   public:
+    Gesture(const std::string& name, float distance);
+
+    virtual std::string toString() const override;
+
+    float distance() const;
+
+   private:
+    const std::string name_;
+    const float distance_;
+  };
+
+  enum DataFlags {
+    AccelerometerData = 1 << 0,
+    GyroscopeData     = 1 << 1
+  };
+
+  TemplateGestures(core::DeviceListenerWrapper& parent_feature,
+                   DataFlags flags = AccelerometerData, int window_size = 50,
+                   int hop_size = 5, float max_distance = 0.5f,
+                   int num_points = 32);
+
+  virtual void onAccelerometerData(
+      myo::Myo* myo, uint64_t timestamp,
+      const myo::Vector3<float>& acceleration) override;
+  virtual void onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                               const myo::Vector3<float>& gyro) override;
+
+  // points holds consecutive points of dimensions() values each.
+  void addTemplate(const std::string& name, const std::vector<float>& points);
+
+  std::size_t dimensions() const;
+
+ private:
+  static std::size_t CheckSize(int size, const std::string& name);
+  void AddPoint(myo::Myo* myo, uint64_t timestamp);
+
+  const DataFlags flags_;
+  const std::size_t window_size_, hop_size_;
+  const float max_distance_;
+  core::TemplateRecognizer recognizer_;
+  // The latest values of the selected streams.
+  std::vector<float> point_;
+  core::SlidingWindow<float> window_;
+  std::size_t samples_since_match_;
+};
+
+TemplateGestures::DataFlags operator|(TemplateGestures::DataFlags lhs,
+                                      TemplateGestures::DataFlags rhs) {
+  return static_cast<TemplateGestures::DataFlags>(static_cast<int>(lhs) |
+                                                  static_cast<int>(rhs));
+}
+
+TemplateGestures::Gesture::Gesture(const std::string& name, float distance)
+    : core::Gesture(), name_(name), distance_(distance) {}
+
+std::string TemplateGestures::Gesture::toString() const { return name_; }
+
+float TemplateGestures::Gesture::distance() const { return distance_; }
+
+TemplateGestures::TemplateGestures(core::DeviceListenerWrapper& parent_feature,
+                                   DataFlags flags, int window_size,
+                                   int hop_size, float max_distance,
+                                   int num_points)
+    : flags_(flags),
+      window_size_(CheckSize(window_size, "window size")),
+      hop_size_(CheckSize(hop_size, "hop size")),
+      max_distance_(max_distance),
+      recognizer_(3 * (((flags & AccelerometerData) ? 1 : 0) +
+                       ((flags & GyroscopeData) ? 1 : 0)),
+                  CheckSize(num_points, "number of points")),
+      point_(recognizer_.dimensions()),
+      window_(window_size_, recognizer_.dimensions()),
+      samples_since_match_(0) {
+  parent_feature.addChildFeature(this);
+}
+
+std::size_t TemplateGestures::CheckSize(int size, const std::string& name) {
+  if (size <= 0) {
+    throw std::invalid_argument("The " + name + " must be positive.");
+  }
+  return size;
+}
+
+void TemplateGestures::onAccelerometerData(
+    myo::Myo* myo, uint64_t timestamp,
+    const myo::Vector3<float>& acceleration) {
+  core::DeviceListenerWrapper::onAccelerometerData(myo, timestamp,
+                                                   acceleration);
+  if (flags_ & AccelerometerData) {
+    point_[0] = acceleration.x();
+    point_[1] = acceleration.y();
+    point_[2] = acceleration.z();
+    // The Myo reports gyroscope data right after accelerometer data, so the
+    // point is complete once both have been received.
+    if (!(flags_ & GyroscopeData)) {
+      AddPoint(myo, timestamp);
+    }
+  }
+}
+
+void TemplateGestures::onGyroscopeData(myo::Myo* myo, uint64_t timestamp,
+                                       const myo::Vector3<float>& gyro) {
+  core::DeviceListenerWrapper::onGyroscopeData(myo, timestamp, gyro);
+  if (flags_ & GyroscopeData) {
+    std::size_t offset = (flags_ & AccelerometerData) ? 3 : 0;
+    point_[offset] = gyro.x();
+    point_[offset + 1] = gyro.y();
+    point_[offset + 2] = gyro.z();
+    AddPoint(myo, timestamp);
+  }
+}
+
+void TemplateGestures::addTemplate(const std::string& name,
+                                   const std::vector<float>& points) {
+  recognizer_.addTemplate(name, points.data(), points.size() / dimensions());
+}
+
+std::size_t TemplateGestures::dimensions() const {
+  return recognizer_.dimensions();
+}
+
+void TemplateGestures::AddPoint(myo::Myo* myo, uint64_t timestamp) {
+  window_.push(point_.data());
+  ++samples_since_match_;
+
+  if (!window_.full() || samples_since_match_ < hop_size_ ||
+      recognizer_.numTemplates() == 0) {
+    return;
+  }
+  samples_since_match_ = 0;
+  core::TemplateRecognizer::Match match =
+      recognizer_.recognize(window_.data(), window_size_, max_distance_);
+  if (match.index >= 0) {
+    window_.clear();
+    core::DeviceListenerWrapper::onGesture(
+        myo, timestamp,
+        std::make_shared<Gesture>(recognizer_.templateName(match.index),
+                                  match.distance));
+  }
+}
+}
+}
@@ -48,6 +48,21 @@ std::ostream& operator<<(std::ostream& out, myo::Arm arm) {
   return out;
 }
 
+std::ostream& operator<<(std::ostream& out, core::Gesture::Status status) {
+  switch (status) {
+    case core::Gesture::Status::tentative:
+      out << "tentative";
+      break;
+    case core::Gesture::Status::confirmed:
+      out << "confirmed";
+      break;
+    case core::Gesture::Status::cancelled:
+      out << "cancelled";
+      break;
+  }
+  return out;
+}
+
 std::ostream& operator<<(std::ostream& out, myo::XDirection x_direction) {
   switch (x_direction) {
     case myo::xDirectionTowardWrist:
@@ -88,6 +103,10 @@ class PrintEvents : public core::DeviceListenerWrapper {
   virtual void onGesture(
       myo::Myo* myo, uint64_t timestamp,
       const std::shared_ptr<core::Gesture>& gesture) override;
+  virtual void onSpeculativeGesture(
+      myo::Myo* myo, uint64_t timestamp,
+      const std::shared_ptr<core::Gesture>& gesture,
+      core::Gesture::Status status) override;
   virtual void onOrientationData(
       myo::Myo* myo, uint64_t timestamp,
       const myo::Quaternion<float>& rotation) override;
@@ -98,6 +117,13 @@ class PrintEvents : public core::DeviceListenerWrapper {
   virtual void onRssi(myo::Myo* myo, uint64_t timestamp, int8_t rssi) override;
   virtual void onEmgData(myo::Myo* myo, uint64_t timestamp,
                          const int8_t* emg) override;
+  virtual void onEmgFeatures(
+      myo::Myo* myo, uint64_t timestamp,
+      const core::EmgFeatureVector& emg_features) override;
+  virtual void onEmgSpectrum(myo::Myo* myo, uint64_t timestamp,
+                             const core::EmgSpectrum& emg_spectrum) override;
+  virtual void onSensorFrame(myo::Myo* myo, uint64_t timestamp,
+                             const core::SensorFrame& frame) override;
   virtual void onPeriodic(myo::Myo* myo) override;
 
  private:
@@ -214,6 +240,20 @@ void PrintEvents::onGesture(myo::Myo* myo, uint64_t timestamp,
   out_ += ss.str();
 }
 
+void PrintEvents::onSpeculativeGesture(
+    myo::Myo* myo, uint64_t timestamp,
+    const std::shared_ptr<core::Gesture>& gesture,
+    core::Gesture::Status status) {
+  std::stringstream ss;
+  ss << "onSpeculativeGesture -";
+  ss << PRINT_NAME_AND_VAR(myo);
+  ss << PRINT_NAME_AND_VAR(timestamp);
+  ss << PRINT_NAME_AND_VAR(gesture->toString());
+  ss << PRINT_NAME_AND_VAR(status);
+  ss << "\n";
+  out_ += ss.str();
+}
+
 void PrintEvents::onOrientationData(myo::Myo* myo, uint64_t timestamp,
                                     const myo::Quaternion<float>& rotation) {
   std::stringstream ss;
@@ -272,6 +312,59 @@ void PrintEvents::onEmgData(myo::Myo* myo, uint64_t timestamp,
   out_ += ss.str();
 }
 
+void PrintEvents::onEmgFeatures(myo::Myo* myo, uint64_t timestamp,
+                                const core::EmgFeatureVector& emg_features) {
+  static const char* feature_names[] = {"rms", "meanAbsoluteValue",
+                                        "waveformLength", "zeroCrossings",
+                                        "slopeSignChanges"};
+  std::stringstream ss;
+  ss << "onEmgFeatures -";
+  ss << PRINT_NAME_AND_VAR(myo);
+  ss << PRINT_NAME_AND_VAR(timestamp);
+  for (std::size_t f = 0; f < core::EmgFeatureVector::numFeatures; ++f) {
+    auto feature = static_cast<core::EmgFeatureVector::Feature>(f);
+    ss << " " << feature_names[f] << ": (" << emg_features(feature, 0);
+    for (std::size_t i = 1; i < core::EmgFeatureVector::numChannels; ++i) {
+      ss << ", " << emg_features(feature, i);
+    }
+    ss << ")";
+  }
+  ss << "\n";
+  out_ += ss.str();
+}
+
+void PrintEvents::onEmgSpectrum(myo::Myo* myo, uint64_t timestamp,
+                                const core::EmgSpectrum& emg_spectrum) {
+  std::stringstream ss;
+  ss << "onEmgSpectrum -";
+  ss << PRINT_NAME_AND_VAR(myo);
+  ss << PRINT_NAME_AND_VAR(timestamp);
+  ss << " medianFrequency: (" << emg_spectrum.medianFrequency()[0];
+  for (std::size_t i = 1; i < core::EmgSpectrum::numChannels; ++i) {
+    ss << ", " << emg_spectrum.medianFrequency()[i];
+  }
+  ss << ")\n";
+  out_ += ss.str();
+}
+
+void PrintEvents::onSensorFrame(myo::Myo* myo, uint64_t timestamp,
+                                const core::SensorFrame& frame) {
+  std::stringstream ss;
+  ss << "onSensorFrame -";
+  ss << PRINT_NAME_AND_VAR(myo);
+  ss << PRINT_NAME_AND_VAR(timestamp);
+  ss << " rotation: " << frame.getRotation();
+  ss << " accel: " << frame.getAcceleration();
+  ss << " gyro: " << frame.getGyro();
+  ss << " emg: (";
+  ss << int(frame.emg[0]);
+  for (std::size_t i = 1; i < 8; ++i) {
+    ss << ", " << int(frame.emg[i]);
+  }
+  ss << ")\n";
+  out_ += ss.str();
+}
+
 void PrintEvents::onPeriodic(myo::Myo* myo) {
   std::stringstream ss;
   ss << "onPeriodic -";
@@ -0,0 +1,623 @@
+/* Micro benchmarks for features with a per sample cost budget. Not run as part
+ * of the tests; build the myo_intelligesture_benchmark target and run it with
+ * optimizations enabled.
+ */
+
+#include <myo/myo.hpp>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/core/DeviceListenerWrapper.h"
+#include "../src/core/DynamicTimeWarping.h"
+#include "../src/core/LinearDiscriminant.h"
+#include "../src/core/OrientationUtility.h"
+#include "../src/core/PoseSequenceAutomaton.h"
+#include "../src/core/QuantizedNetwork.h"
+#include "../src/core/TemplateRecognizer.h"
+#include "../src/core/WorkStealingPool.h"
+#include "../src/features/RootFeature.h"
+#include "../src/features/ArchiveReader.h"
+#include "../src/features/ArchiveWriter.h"
+#include "../src/features/Blocker.h"
+#include "../src/features/Coalesce.h"
+#include "../src/features/CorrectForOrientation.h"
+#include "../src/features/FeatureGraph.h"
+#include "../src/features/ImuFusion.h"
+#include "../src/features/Orientation.h"
+#include "../src/features/SharedMemoryPublisher.h"
+#include "../src/features/SharedMemorySubscriber.h"
+#include "../src/features/filters/ExponentialMovingAverage.h"
+
+namespace {
+// Runs function iterations times and prints the average time per iteration.
+void Benchmark(const std::string& name, std::size_t iterations,
+               const std::function<void(std::size_t)>& function) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    function(i);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  std::printf("%-40s %12.1f ns/iteration\n", name.c_str(), ns / iterations);
+}
+
+void BenchmarkImuFusion() {
+  features::RootFeature root_feature;
+  features::ImuFusion imu_fusion(root_feature);
+  Benchmark("ImuFusion::update", 10000000, [&](std::size_t i) {
+    float f = static_cast<float>(i % 100) * 0.01f;
+    imu_fusion.update(myo::Vector3<float>(f, -f, 10.f),
+                      myo::Vector3<float>(0.1f, f, 1.f), 0.02f);
+  });
+  Benchmark("ImuFusion accelerometer + gyroscope", 10000000,
+            [&](std::size_t i) {
+    float f = static_cast<float>(i % 100) * 0.01f;
+    root_feature.onAccelerometerData(nullptr, i * 20000,
+                                     myo::Vector3<float>(0.1f, f, 1.f));
+    root_feature.onGyroscopeData(nullptr, i * 20000,
+                                 myo::Vector3<float>(f, -f, 10.f));
+  });
+  myo::Quaternion<float> rotation = imu_fusion.getRotation();
+  std::printf("(final rotation %f %f %f %f)\n", rotation.x(), rotation.y(),
+              rotation.z(), rotation.w());
+}
+
+void BenchmarkQuaternionsToRollPitchYaw() {
+  using namespace core::OrientationUtility;
+  const std::size_t n = 4096;
+  std::vector<myo::Quaternion<float>> quats;
+  for (std::size_t i = 0; i < n; ++i) {
+    float f = static_cast<float>(i);
+    quats.push_back(myo::Quaternion<float>(std::sin(f), std::cos(2 * f),
+                                           std::sin(3 * f), std::cos(f))
+                        .normalized());
+  }
+  std::vector<float> roll(n), pitch(n), yaw(n);
+  Benchmark("QuaternionToRoll/Pitch/Yaw per quaternion", 1000 * n,
+            [&](std::size_t i) {
+    roll[i % n] = QuaternionToRoll(quats[i % n]);
+    pitch[i % n] = QuaternionToPitch(quats[i % n]);
+    yaw[i % n] = QuaternionToYaw(quats[i % n]);
+  });
+  Benchmark("QuaternionsToRollPitchYaw precise per 4096", 1000,
+            [&](std::size_t) {
+    QuaternionsToRollPitchYaw(quats.data(), n, roll.data(), pitch.data(),
+                              yaw.data(), Precision::precise);
+  });
+  Benchmark("QuaternionsToRollPitchYaw fast per 4096", 1000,
+            [&](std::size_t) {
+    QuaternionsToRollPitchYaw(quats.data(), n, roll.data(), pitch.data(),
+                              yaw.data(), Precision::fast);
+  });
+}
+
+void BenchmarkRotateVectors() {
+  using namespace core::OrientationUtility;
+  const std::size_t n = 4096;
+  myo::Quaternion<float> quat =
+      myo::Quaternion<float>(0.1f, 0.2f, 0.3f, 0.9f).normalized();
+  std::vector<myo::Vector3<float>> vectors, rotated(n);
+  std::vector<float> values(3 * n), rotated_values(3 * n);
+  for (std::size_t i = 0; i < n; ++i) {
+    float f = static_cast<float>(i);
+    vectors.push_back(
+        myo::Vector3<float>(std::sin(f), std::cos(f), std::sin(2 * f)));
+    values[3 * i] = vectors[i].x();
+    values[3 * i + 1] = vectors[i].y();
+    values[3 * i + 2] = vectors[i].z();
+  }
+  Benchmark("myo::rotate per 4096", 1000, [&](std::size_t) {
+    for (std::size_t i = 0; i < n; ++i) {
+      rotated[i] = myo::rotate(quat, vectors[i]);
+    }
+  });
+  RotationMatrix matrix = QuaternionToRotationMatrix(quat);
+  Benchmark("Rotate per 4096", 1000, [&](std::size_t) {
+    for (std::size_t i = 0; i < n; ++i) {
+      rotated[i] = Rotate(matrix, vectors[i]);
+    }
+  });
+  Benchmark("RotateVectors per 4096", 1000, [&](std::size_t) {
+    RotateVectors(matrix, values.data(), n, rotated_values.data());
+  });
+}
+
+void BenchmarkTemplateRecognizer() {
+  // Random walks, so that most templates are far apart but a few are close.
+  const std::size_t window_size = 50;
+  std::vector<float> points(3 * window_size);
+  auto random_walk = [&](unsigned seed) {
+    float position[3] = {0.f, 0.f, 0.f};
+    for (std::size_t i = 0; i < window_size; ++i) {
+      for (std::size_t j = 0; j < 3; ++j) {
+        seed = seed * 1103515245u + 12345u;
+        position[j] += static_cast<float>((seed >> 16) & 0x7fff) / 0x7fff - 0.5f;
+        points[3 * i + j] = position[j];
+      }
+    }
+  };
+  for (std::size_t num_templates : {10, 100, 500}) {
+    core::TemplateRecognizer recognizer(3);
+    for (std::size_t t = 0; t < num_templates; ++t) {
+      random_walk(static_cast<unsigned>(t));
+      recognizer.addTemplate(std::to_string(t), points.data(), window_size);
+    }
+    random_walk(12345u);
+    Benchmark("TemplateRecognizer " + std::to_string(num_templates) +
+                  " templates",
+              10000, [&](std::size_t) {
+      recognizer.recognize(points.data(), window_size);
+    });
+  }
+}
+
+void BenchmarkDynamicTimeWarping() {
+  const std::size_t length = 50, dimensions = 3;
+  unsigned seed = 1;
+  auto random_walk = [&](std::vector<float>& points) {
+    float position[dimensions] = {};
+    for (std::size_t i = 0; i < length; ++i) {
+      for (std::size_t j = 0; j < dimensions; ++j) {
+        seed = seed * 1103515245u + 12345u;
+        position[j] += static_cast<float>((seed >> 16) & 0x7fff) / 0x7fff - 0.5f;
+        points[i * dimensions + j] = position[j];
+      }
+    }
+  };
+  std::vector<float> points(length * dimensions);
+  std::vector<std::vector<float>> queries(64, points);
+  for (auto& query : queries) {
+    random_walk(query);
+  }
+  for (std::size_t num_templates : {10, 100, 1000}) {
+    core::DynamicTimeWarping dtw(dimensions, length, 5);
+    for (std::size_t t = 0; t < num_templates; ++t) {
+      random_walk(points);
+      dtw.addTemplate(std::to_string(t), points.data(), length);
+    }
+    Benchmark("DynamicTimeWarping " + std::to_string(num_templates) +
+                  " templates",
+              20000, [&](std::size_t i) {
+      dtw.recognize(queries[i % queries.size()].data());
+    });
+    const core::DynamicTimeWarping::Statistics& statistics = dtw.statistics();
+    std::printf(
+        "(pruned by LB_Kim %zu, LB_Keogh template %zu, LB_Keogh sequence %zu, "
+        "abandoned %zu, full %zu)\n",
+        statistics.lb_kim, statistics.lb_keogh_template,
+        statistics.lb_keogh_sequence, statistics.abandoned, statistics.full);
+  }
+}
+
+void BenchmarkLinearDiscriminant() {
+  const std::size_t num_features = 40, num_classes = 10, num_samples = 1000;
+  std::vector<std::string> class_names;
+  std::vector<float> samples;
+  std::vector<int> labels;
+  for (std::size_t c = 0; c < num_classes; ++c) {
+    class_names.push_back(std::to_string(c));
+  }
+  for (std::size_t i = 0; i < num_samples; ++i) {
+    labels.push_back(static_cast<int>(i % num_classes));
+    for (std::size_t j = 0; j < num_features; ++j) {
+      samples.push_back(std::sin(0.1f * i * j + labels.back()) + labels.back());
+    }
+  }
+  core::LinearDiscriminant model = core::LinearDiscriminant::Train(
+      class_names, num_features, samples, labels);
+  std::size_t result = 0;
+  Benchmark("LinearDiscriminant::classify 10 classes", 10000000,
+            [&](std::size_t i) {
+    result += model.classify(&samples[(i % num_samples) * num_features]);
+  });
+  Benchmark("LinearDiscriminant::adapt 10 classes", 100000,
+            [&](std::size_t i) {
+    std::size_t sample = i % num_samples;
+    model.adapt(&samples[sample * num_features], labels[sample], 0.01f);
+  });
+  std::printf("(checksum %zu)\n", result);
+}
+
+void BenchmarkQuantizedNetwork() {
+  typedef core::QuantizedNetwork::LayerSpec LayerSpec;
+  typedef core::QuantizedNetwork::LayerType LayerType;
+  typedef core::QuantizedNetwork::Activation Activation;
+  auto make_layer = [](LayerType type, Activation activation,
+                       uint32_t in_channels, uint32_t out_channels,
+                       uint32_t kernel_size, uint32_t stride) {
+    LayerSpec layer = {type, activation, in_channels, out_channels,
+                       kernel_size, stride, 0.05f, {}, {}, {}};
+    for (uint32_t i = 0; i < out_channels * kernel_size * in_channels; ++i) {
+      layer.weights.push_back(static_cast<int8_t>(i * 37 % 255 - 127));
+    }
+    layer.biases.assign(out_channels, 0);
+    layer.weight_scales.assign(out_channels, 0.001f);
+    return layer;
+  };
+  std::stringstream model_file;
+  core::QuantizedNetwork::Write(
+      model_file, 50, 8, 1.f,
+      {make_layer(LayerType::conv1d, Activation::relu, 8, 16, 5, 2),
+       make_layer(LayerType::conv1d, Activation::relu, 16, 32, 5, 2),
+       make_layer(LayerType::dense, Activation::relu, 10 * 32, 64, 1, 1),
+       make_layer(LayerType::dense, Activation::none, 64, 6, 1, 1)});
+  std::unique_ptr<core::QuantizedNetwork> network =
+      core::QuantizedNetwork::Load(model_file);
+  std::vector<int8_t> input(50 * 8 * 16);
+  for (std::size_t i = 0; i < input.size(); ++i) {
+    input[i] = static_cast<int8_t>(i * 101 % 255 - 127);
+  }
+  std::size_t result = 0;
+  Benchmark(std::string("QuantizedNetwork 50x8 CNN (") +
+                core::QuantizedNetwork::kernelName() + ")",
+            1000000, [&](std::size_t i) {
+    result += network->classify(&input[(i % 16) * 50 * 8]);
+  });
+  std::printf("(checksum %zu)\n", result);
+}
+
+void BenchmarkPoseSequenceAutomaton() {
+  const char* poses[] = {"rest", "fist", "waveIn", "waveOut", "fingersSpread"};
+  const uint64_t limits[] = {0, 200, 400, 800};
+  for (std::size_t num_patterns : {10, 100, 1000}) {
+    std::vector<core::PoseSequenceAutomaton::Pattern> patterns;
+    for (std::size_t p = 0; p < num_patterns; ++p) {
+      core::PoseSequenceAutomaton::Pattern pattern = {std::to_string(p), {}};
+      for (std::size_t i = 0; i < 2 + p % 3; ++i) {
+        pattern.steps.push_back(
+            {poses[(p * 7 + i * (p + 3)) % 5], limits[(p + i) % 4]});
+      }
+      patterns.push_back(pattern);
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    core::PoseSequenceAutomaton automaton(patterns);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::printf("(%zu patterns: %zu states, compiled in %.1f ms)\n",
+                num_patterns, automaton.numStates(),
+                std::chrono::duration<double, std::milli>(end - start).count());
+    std::vector<std::size_t> symbols;
+    for (const char* pose : poses) {
+      symbols.push_back(automaton.symbol(pose));
+    }
+    core::PoseSequenceAutomaton::State state =
+        core::PoseSequenceAutomaton::start;
+    std::size_t result = 0;
+    Benchmark("PoseSequenceAutomaton " + std::to_string(num_patterns) +
+                  " patterns",
+              10000000, [&](std::size_t i) {
+      state = automaton.next(state, symbols[(i * 13 + i / 7) % 5],
+                             (i * 97 % 1000) * 1000);
+      result += automaton.matches(state).size();
+    });
+    std::printf("(checksum %zu)\n", result);
+  }
+}
+
+void BenchmarkBlocker() {
+  class Count : public core::DeviceListenerWrapper {
+   public:
+    Count(core::DeviceListenerWrapper& parent_feature) : count(0) {
+      parent_feature.addChildFeature(this);
+    }
+    virtual void onGyroscopeData(myo::Myo*, uint64_t,
+                                 const myo::Vector3<float>&) override {
+      ++count;
+    }
+    std::size_t count;
+  };
+  features::RootFeature root_feature;
+  Count direct(root_feature);
+  features::Blocker<core::Events::Pose> blocker(root_feature);
+  features::Blocker<core::Events::GyroscopeData> nested_blocker(blocker);
+  Count blocked(nested_blocker);
+  Count passed(blocker);
+  Benchmark("Gyroscope data to 3 features, 2 Blockers", 10000000,
+            [&](std::size_t i) {
+    root_feature.onGyroscopeData(nullptr, i * 20000,
+                                 myo::Vector3<float>(0.f, 0.f, 1.f));
+  });
+  std::printf("(counts %zu %zu %zu)\n", direct.count, passed.count,
+              blocked.count);
+}
+
+void BenchmarkCoalesce() {
+  features::RootFeature root_feature;
+  features::Coalesce coalesce(root_feature);
+  Benchmark("Coalesce orientation data, queue + dispatch", 1000000,
+            [&](std::size_t i) {
+    root_feature.onOrientationData(nullptr, i * 20000,
+                                   myo::Quaternion<float>());
+    if (i % 100 == 99) {
+      coalesce.dispatch();
+    }
+  });
+  // A consumer which is stuck, so every sample is coalesced.
+  int64_t now = 0;
+  features::RootFeature overloaded_root_feature;
+  features::Coalesce overloaded(overloaded_root_feature, 20,
+                                core::Events::OrientationData,
+                                [&now]() { return now; });
+  overloaded_root_feature.onPose(nullptr, 0, myo::Pose::fist);
+  now = 1000000;
+  Benchmark("Coalesce orientation data, overloaded", 1000000,
+            [&](std::size_t i) {
+    overloaded_root_feature.onOrientationData(nullptr, i * 20000,
+                                              myo::Quaternion<float>());
+  });
+  std::printf("(pending %zu)\n", overloaded.pending());
+}
+
+void BenchmarkFeatureGraph() {
+  // Three smoothing stages and a pass-through group, as a configuration might
+  // describe them.
+  std::istringstream config(
+      "{\"features\": [{\"type\": \"Group\", \"children\": ["
+      "  {\"type\": \"ExponentialMovingAverage\","
+      "   \"flags\": \"AccelerometerData|GyroscopeData\", \"alpha\": 0.5,"
+      "   \"children\": ["
+      "    {\"type\": \"ExponentialMovingAverage\","
+      "     \"flags\": \"AccelerometerData\", \"alpha\": 0.25, \"children\": ["
+      "      {\"type\": \"ExponentialMovingAverage\","
+      "       \"flags\": \"AccelerometerData|GyroscopeData\", \"alpha\": 0.2,"
+      "       \"children\": [{\"type\": \"Group\", \"name\": \"out\"}]}]}]}]}]}");
+  const std::vector<features::FeatureGraph::Node> nodes =
+      features::FeatureGraph::ParseJson(config);
+  for (int optimize = 0; optimize < 2; ++optimize) {
+    features::RootFeature root_feature;
+    features::FeatureGraph graph;
+    graph.build(root_feature, nodes, optimize == 1);
+    Benchmark(std::string("FeatureGraph accel + gyro ") +
+                  (optimize ? "optimized" : "as described"),
+              10000000, [&](std::size_t i) {
+      float f = static_cast<float>(i % 100) * 0.01f;
+      root_feature.onAccelerometerData(nullptr, i * 20000,
+                                       myo::Vector3<float>(0.1f, f, 1.f));
+      root_feature.onGyroscopeData(nullptr, i * 20000,
+                                   myo::Vector3<float>(f, -f, 10.f));
+    });
+  }
+}
+
+void BenchmarkSharedMemory() {
+  const std::string name = "/myo-intelligesture-benchmark";
+  features::RootFeature root_feature;
+  features::SharedMemoryPublisher publisher(root_feature, name);
+  Benchmark("SharedMemory orientation data, publish", 1000000,
+            [&](std::size_t i) {
+    root_feature.onOrientationData(nullptr, i * 20000,
+                                   myo::Quaternion<float>());
+  });
+  features::SharedMemorySubscriber subscriber(name);
+  Benchmark("SharedMemory orientation data, publish + poll", 1000000,
+            [&](std::size_t i) {
+    root_feature.onOrientationData(nullptr, i * 20000,
+                                   myo::Quaternion<float>());
+    if (i % 100 == 99) {
+      subscriber.poll();
+    }
+  });
+  std::printf("(lost %llu)\n",
+              static_cast<unsigned long long>(subscriber.lost()));
+}
+
+void BenchmarkArchive() {
+  // A minute of EMG at 200 Hz and IMU data at 50 Hz, repeated.
+  const std::size_t num_emg = 12000, repetitions = 100;
+  std::stringstream archive;
+  {
+    features::RootFeature root_feature;
+    features::ArchiveWriter writer(root_feature, archive);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < num_emg; ++i) {
+      uint64_t timestamp = i * 5000;
+      int8_t emg[8];
+      for (std::size_t channel = 0; channel < 8; ++channel) {
+        emg[channel] = static_cast<int8_t>(
+            30 * std::sin(0.3 * i + channel) + (i * 7 + channel * 13) % 9 - 4);
+      }
+      root_feature.onEmgData(nullptr, timestamp, emg);
+      if (i % 4 == 0) {
+        float t = i * 0.005f;
+        root_feature.onOrientationData(
+            nullptr, timestamp,
+            myo::Quaternion<float>(0.1f * std::sin(t), 0.2f * std::cos(t),
+                                   0.f, 0.97f));
+        root_feature.onAccelerometerData(
+            nullptr, timestamp,
+            myo::Vector3<float>(0.01f * std::sin(3 * t), 0.02f, -1.f));
+        root_feature.onGyroscopeData(
+            nullptr, timestamp,
+            myo::Vector3<float>(std::sin(t) * 10, std::cos(t) * 5, 0.5f));
+      }
+    }
+    writer.flush();
+    auto end = std::chrono::high_resolution_clock::now();
+    std::printf("%-40s %12.1f ns/sample\n", "Archive encode",
+                std::chrono::duration<double, std::nano>(end - start).count() /
+                    writer.samples());
+  }
+  // Decoded bytes are the samples as they are passed on: the values and an 8
+  // byte timestamp.
+  const std::size_t num_imu = num_emg / 4;
+  const double decoded_bytes = num_emg * 16.0 + num_imu * (24 + 20 + 20);
+  const std::string encoded = archive.str();
+  std::printf("(%.1f MB decoded, %.2f MB encoded, ratio %.1f)\n",
+              decoded_bytes / 1e6, encoded.size() / 1e6,
+              decoded_bytes / encoded.size());
+
+  for (int replay = 0; replay < 2; ++replay) {
+    features::RootFeature root_feature;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < repetitions; ++i) {
+      std::istringstream in(encoded);
+      features::ArchiveReader reader(in);
+      if (replay) {
+        reader.replay(root_feature);
+      } else {
+        while (reader.readSegment()) {
+        }
+      }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double s = std::chrono::duration<double>(end - start).count();
+    std::printf("%-40s %12.1f MB/s\n",
+                replay ? "Archive decode + replay" : "Archive decode",
+                decoded_bytes * repetitions / s / 1e6);
+  }
+}
+
+void BenchmarkArchiveSeek() {
+  using features::filters::ExponentialMovingAverage;
+  // Ten minutes of IMU data at 50 Hz, through filters with state.
+  struct Tree {
+    Tree()
+        : ema(root_feature, ExponentialMovingAverage::OrientationData |
+                                ExponentialMovingAverage::AccelerometerData |
+                                ExponentialMovingAverage::GyroscopeData,
+              0.2),
+          orientation(ema) {}
+
+    features::RootFeature root_feature;
+    ExponentialMovingAverage ema;
+    features::Orientation orientation;
+  };
+  const std::size_t num_imu = 30000, num_seeks = 100;
+  std::stringstream archive;
+  {
+    Tree tree;
+    features::ArchiveWriter writer(tree.root_feature, archive, 256,
+                                   &tree.root_feature, 8);
+    tree.root_feature.removeChildFeature(&tree.ema);
+    tree.root_feature.addChildFeature(&tree.ema);
+    for (std::size_t i = 0; i < num_imu; ++i) {
+      uint64_t timestamp = i * 20000;
+      float t = i * 0.02f;
+      tree.root_feature.onOrientationData(
+          nullptr, timestamp,
+          myo::Quaternion<float>(0.1f * std::sin(t), 0.2f * std::cos(t), 0.f,
+                                 0.97f));
+      tree.root_feature.onAccelerometerData(
+          nullptr, timestamp,
+          myo::Vector3<float>(0.01f * std::sin(3 * t), 0.02f, -1.f));
+      tree.root_feature.onGyroscopeData(
+          nullptr, timestamp,
+          myo::Vector3<float>(std::sin(t) * 10, std::cos(t) * 5, 0.5f));
+    }
+  }
+  const std::string encoded = archive.str();
+
+  // The time until the first segment at a random time is played back with
+  // warm state, by seeking, and by playing back everything before it.
+  for (int seek = 1; seek >= 0; --seek) {
+    Tree tree;
+    std::size_t num_samples = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < num_seeks; ++i) {
+      const uint64_t timestamp = (i * 7919 % num_imu) * 20000;
+      std::istringstream in(encoded);
+      features::ArchiveReader reader(in);
+      if (seek) {
+        reader.seek(timestamp, tree.root_feature);
+        reader.readSegment();
+        num_samples += reader.replaySegment(tree.root_feature);
+      } else {
+        while (reader.readSegment()) {
+          num_samples += reader.replaySegment(tree.root_feature);
+          if (reader.segment().last_timestamp >= timestamp) {
+            break;
+          }
+        }
+      }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    std::printf("%-40s %12.1f us/seek (%zu samples)\n",
+                seek ? "Archive seek" : "Archive replay to time",
+                std::chrono::duration<double, std::micro>(end - start).count() /
+                    num_seeks,
+                num_samples / num_seeks);
+  }
+}
+
+void BenchmarkWorkStealingPool() {
+  core::WorkStealingPool pool;
+  const std::size_t num_tasks = 100000;
+  std::atomic<std::size_t> count(0);
+  auto start = std::chrono::high_resolution_clock::now();
+  for (std::size_t i = 0; i < num_tasks; ++i) {
+    pool.submit([&count]() { ++count; });
+  }
+  pool.wait();
+  auto end = std::chrono::high_resolution_clock::now();
+  std::printf("%-40s %12.1f ns/task\n", "WorkStealingPool empty tasks",
+              std::chrono::duration<double, std::nano>(end - start).count() /
+                  num_tasks);
+
+  // Independent sessions, each played back through its own tree, on one
+  // thread and on all of them.
+  std::stringstream archive;
+  {
+    features::RootFeature root_feature;
+    features::ArchiveWriter writer(root_feature, archive);
+    for (std::size_t i = 0; i < 20000; ++i) {
+      float t = i * 0.02f;
+      root_feature.onAccelerometerData(
+          nullptr, i * 20000,
+          myo::Vector3<float>(0.01f * std::sin(3 * t), 0.02f, -1.f));
+    }
+  }
+  const std::string encoded = archive.str();
+  const std::size_t num_sessions = 64;
+  double single_thread = 0;
+  for (std::size_t num_threads : {std::size_t(1), pool.numThreads()}) {
+    core::WorkStealingPool session_pool(num_threads);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (std::size_t i = 0; i < num_sessions; ++i) {
+      session_pool.submit([&encoded]() {
+        std::istringstream in(encoded);
+        features::ArchiveReader reader(in);
+        features::RootFeature root_feature;
+        features::filters::ExponentialMovingAverage ema(
+            root_feature,
+            features::filters::ExponentialMovingAverage::AccelerometerData,
+            0.2);
+        reader.replay(root_feature);
+      });
+    }
+    session_pool.wait();
+    auto end = std::chrono::high_resolution_clock::now();
+    double s = std::chrono::duration<double>(end - start).count();
+    if (num_threads == 1) {
+      single_thread = s;
+    }
+    std::printf("%-40s %12.1f sessions/s (%zu threads, speedup %.1f)\n",
+                "WorkStealingPool session replay", num_sessions / s,
+                num_threads, single_thread / s);
+  }
+}
+}
+
+int main() {
+  BenchmarkImuFusion();
+  BenchmarkQuaternionsToRollPitchYaw();
+  BenchmarkRotateVectors();
+  BenchmarkTemplateRecognizer();
+  BenchmarkDynamicTimeWarping();
+  BenchmarkLinearDiscriminant();
+  BenchmarkQuantizedNetwork();
+  BenchmarkPoseSequenceAutomaton();
+  BenchmarkBlocker();
+  BenchmarkCoalesce();
+  BenchmarkFeatureGraph();
+  BenchmarkSharedMemory();
+  BenchmarkArchive();
+  BenchmarkArchiveSeek();
+  BenchmarkWorkStealingPool();
+  return 0;
+}
@@ -4,14 +4,57 @@
 #include <myo/myo.hpp>
 #include <string>
 #include <array>
+#include <atomic>
 #include <memory>
 #include <map>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
 
+#include "../src/core/ColumnCodec.h"
 #include "../src/core/DeviceListenerWrapper.h"
+#include "../src/core/DynamicTimeWarping.h"
+#include "../src/core/GestureEvaluation.h"
+#include "../src/core/LinearDiscriminant.h"
+#include "../src/core/OrientationUtility.h"
+#include "../src/core/PoseSequenceAutomaton.h"
+#include "../src/core/QuantizedNetwork.h"
+#include "../src/core/SensorArchive.h"
+#include "../src/core/SlidingWindow.h"
+#include "../src/core/TemplateRecognizer.h"
+#include "../src/core/WorkStealingPool.h"
 #include "../src/features/RootFeature.h"
+#include "../src/features/ArchiveReader.h"
+#include "../src/features/ArchiveWriter.h"
+#include "../src/features/Blocker.h"
+#include "../src/features/Coalesce.h"
+#include "../src/features/CorrectForOrientation.h"
+#include "../src/features/EmgFeatures.h"
+#include "../src/features/EmgPoses.h"
+#include "../src/features/EmgSpectrogram.h"
+#include "../src/features/FeatureGraph.h"
+#include "../src/features/FusionFrame.h"
+#include "../src/features/Group.h"
+#include "../src/features/ImuFusion.h"
+#include "../src/features/Orientation.h"
+#include "../src/features/SharedMemoryPublisher.h"
+#include "../src/features/SharedMemorySubscriber.h"
+#include "../src/features/gestures/ChordGestures.h"
+#include "../src/features/gestures/DtwGestures.h"
+#include "../src/features/gestures/NetworkGestures.h"
+#include "../src/features/gestures/PoseGestures.h"
+#include "../src/features/gestures/PoseSequences.h"
+#include "../src/features/gestures/TemplateGestures.h"
 #include "../src/features/filters/Debounce.h"
 #include "../src/features/filters/ExponentialMovingAverage.h"
 #include "../src/features/filters/MovingAverage.h"
+#include "../src/features/filters/Decimate.h"
+#include "../src/features/filters/Resample.h"
+#include "../src/features/filters/SuppressPrefixPoses.h"
 
 #include "hub.h"
 #include "event_types.h"
@@ -67,6 +110,1765 @@ BOOST_AUTO_TEST_CASE(testRootFeature) {
          "onPeriodic - myo: 00000000\n");
 }
 
+BOOST_AUTO_TEST_CASE(testOrientationUtility) {
+  using namespace core::OrientationUtility;
+  for (int i = -1000; i <= 1000; ++i) {
+    float x = i / 1000.f;
+    BOOST_CHECK_SMALL(FastAsin(x) - std::asin(double(x)),
+                      double(FastTrigMaxError));
+    for (int j = -20; j <= 20; ++j) {
+      float y = j / 10.f;
+      BOOST_CHECK_SMALL(FastAtan2(y, x) - std::atan2(double(y), double(x)),
+                        double(FastTrigMaxError));
+    }
+  }
+
+  std::vector<myo::Quaternion<float>> quats;
+  for (int i = 0; i < 1001; ++i) {
+    float a = std::sin(0.1f * i), b = std::cos(0.37f * i),
+          c = std::sin(1.3f * i + 1), d = std::cos(0.71f * i + 2);
+    quats.push_back(myo::Quaternion<float>(a, b, c, d).normalized());
+  }
+  // Gimbal lock and the identity.
+  quats.push_back(myo::Quaternion<float>(0.f, std::sqrt(0.5f), 0.f,
+                                         std::sqrt(0.5f)));
+  quats.push_back(myo::Quaternion<float>());
+
+  std::size_t n = quats.size();
+  std::vector<float> roll(n), pitch(n), yaw(n);
+  std::vector<float> fast_roll(n), fast_pitch(n), fast_yaw(n);
+  QuaternionsToRollPitchYaw(quats.data(), n, roll.data(), pitch.data(),
+                            yaw.data(), Precision::precise);
+  QuaternionsToRollPitchYaw(quats.data(), n, fast_roll.data(),
+                            fast_pitch.data(), fast_yaw.data());
+  for (std::size_t i = 0; i < n; ++i) {
+    BOOST_CHECK_EQUAL(roll[i], QuaternionToRoll(quats[i]));
+    BOOST_CHECK_EQUAL(pitch[i], QuaternionToPitch(quats[i]));
+    BOOST_CHECK_EQUAL(yaw[i], QuaternionToYaw(quats[i]));
+    // Roll and yaw wrap around at +-pi. Pitch is compared through its sine,
+    // since asin amplifies the rounding of its argument close to gimbal lock.
+    BOOST_CHECK_SMALL(RelativeOrientation(roll[i], fast_roll[i]), 1e-5f);
+    BOOST_CHECK_SMALL(std::sin(pitch[i]) - std::sin(fast_pitch[i]), 1e-5f);
+    BOOST_CHECK_SMALL(RelativeOrientation(yaw[i], fast_yaw[i]), 1e-5f);
+  }
+
+  std::function<float(const myo::Quaternion<float>&)> to_pitch =
+      QuaternionToPitch;
+  BOOST_CHECK_EQUAL(RelativeOrientation(quats[0], quats[1], to_pitch),
+                    RelativeOrientation(quats[0], quats[1], QuaternionToPitch));
+}
+
+BOOST_AUTO_TEST_CASE(testOrientation) {
+  features::RootFeature root_feature;
+  features::Orientation orientation(root_feature);
+  using features::Orientation;
+
+  auto rotation = [](float pitch, float roll) {
+    return myo::Quaternion<float>(0.f, std::sin(pitch / 2), 0.f,
+                                  std::cos(pitch / 2)) *
+           myo::Quaternion<float>(std::sin(roll / 2), 0.f, 0.f,
+                                  std::cos(roll / 2));
+  };
+  uint64_t timestamp = 0;
+  root_feature.onOrientationData(nullptr, timestamp++, rotation(0.2f, 0.1f));
+  orientation.calibrateOrientation();
+  BOOST_CHECK_EQUAL(orientation.getRelativeArmAngle(), 0.f);
+  BOOST_CHECK_EQUAL(orientation.getRelativeWristAngle(), 0.f);
+  BOOST_CHECK(orientation.getArmOrientation() == Orientation::Arm::forearmLevel);
+  BOOST_CHECK(orientation.getWristOrientation() ==
+              Orientation::Wrist::palmSideways);
+
+  root_feature.onOrientationData(nullptr, timestamp++, rotation(1.2f, 0.6f));
+  BOOST_CHECK_CLOSE(orientation.getRelativeArmAngle(), 1.f, 1e-3);
+  BOOST_CHECK_CLOSE(orientation.getRelativeWristAngle(), 0.5f, 1e-3);
+  BOOST_CHECK(orientation.getArmOrientation() == Orientation::Arm::forearmDown);
+  BOOST_CHECK(orientation.getWristOrientation() == Orientation::Wrist::palmUp);
+
+  // Wearing the Myo the other way around flips the classification.
+  root_feature.onArmSync(nullptr, timestamp++, myo::armRight,
+                         myo::xDirectionTowardElbow, 0, myo::warmupStateCold);
+  BOOST_CHECK(orientation.getArmOrientation() == Orientation::Arm::forearmUp);
+  BOOST_CHECK(orientation.getWristOrientation() ==
+              Orientation::Wrist::palmDown);
+}
+
+BOOST_AUTO_TEST_CASE(testCorrectForOrientation) {
+  features::RootFeature root_feature;
+  features::CorrectForOrientation correct_for_orientation(
+      root_feature, features::CorrectForOrientation::AccelerometerData);
+  std::string str;
+  PrintEvents print_events(correct_for_orientation, str);
+
+  // A half turn around z.
+  myo::Quaternion<float> quat(0.f, 0.f, 1.f, 0.f);
+  root_feature.onOrientationData(nullptr, 0, quat);
+  str.clear();
+  root_feature.onAccelerometerData(nullptr, 1, myo::Vector3<float>(2, 0, 3));
+  root_feature.onGyroscopeData(nullptr, 2, myo::Vector3<float>(2, 0, 3));
+  BOOST_CHECK_EQUAL(str,
+      "onAccelerometerData - myo: 00000000 timestamp: 1 accel: (-2, 0, 3)\n"
+      "onGyroscopeData - myo: 00000000 timestamp: 2 gyro: (2, 0, 3)\n");
+
+  // The batch path and the matrix agree with myo::rotate, including for
+  // quaternions that aren't normalized, and the tail after the last four
+  // vectors.
+  for (auto q : {quat, myo::Quaternion<float>(0.3f, -0.5f, 0.2f, 0.8f),
+                 myo::Quaternion<float>(1.f, 2.f, -3.f, 0.5f)}) {
+    root_feature.onOrientationData(nullptr, 4, q);
+    std::vector<float> vectors, rotated(3 * 7);
+    for (int i = 0; i < 3 * 7; ++i) {
+      vectors.push_back(std::sin(1.f + i));
+    }
+    correct_for_orientation.rotateVectors(vectors.data(), 7, rotated.data());
+    for (int i = 0; i < 7; ++i) {
+      myo::Vector3<float> v(vectors[3 * i], vectors[3 * i + 1],
+                            vectors[3 * i + 2]);
+      myo::Vector3<float> expected = myo::rotate(q, v);
+      myo::Vector3<float> actual = core::OrientationUtility::Rotate(
+          core::OrientationUtility::QuaternionToRotationMatrix(q), v);
+      for (int j = 0; j < 3; ++j) {
+        BOOST_CHECK_SMALL(rotated[3 * i + j] - expected[j], 1e-4f);
+        BOOST_CHECK_SMALL(actual[j] - expected[j], 1e-4f);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testTemplateGestures) {
+  // Pruning doesn't change the result of an exhaustive search.
+  core::TemplateRecognizer recognizer(3, 16, 4);
+  auto make_points = [](int seed, int count, float phase) {
+    std::vector<float> points;
+    for (int i = 0; i < 3 * count; ++i) {
+      points.push_back(std::sin(0.37f * seed * i + phase));
+    }
+    return points;
+  };
+  std::vector<std::vector<float>> templates;
+  for (int t = 0; t < 200; ++t) {
+    templates.push_back(make_points(t, 20, static_cast<float>(t)));
+    recognizer.addTemplate(std::to_string(t), templates.back().data(), 20);
+  }
+  std::vector<float> normalized(3 * 16), template_points(3 * 16);
+  for (int q = 0; q < 20; ++q) {
+    std::vector<float> points = make_points(q, 25, 0.5f * q + 0.1f);
+    recognizer.normalize(points.data(), 25, normalized.data());
+    int best = -1;
+    float best_distance = 1e9f;
+    for (int t = 0; t < 200; ++t) {
+      recognizer.normalize(templates[t].data(), 20, template_points.data());
+      float distance = 0.f;
+      for (int n = 0; n < 16; ++n) {
+        float squared = 0.f;
+        for (int j = 0; j < 3; ++j) {
+          float d = normalized[3 * n + j] - template_points[3 * n + j];
+          squared += d * d;
+        }
+        distance += std::sqrt(squared) / 16;
+      }
+      if (distance < best_distance) {
+        best = t;
+        best_distance = distance;
+      }
+    }
+    core::TemplateRecognizer::Match match =
+        recognizer.recognize(points.data(), 25);
+    BOOST_CHECK_EQUAL(match.index, best);
+    BOOST_CHECK_CLOSE(match.distance, best_distance, 1e-3);
+  }
+
+  features::RootFeature root_feature;
+  features::gestures::TemplateGestures template_gestures(
+      root_feature, features::gestures::TemplateGestures::AccelerometerData,
+      40, 5, 0.3f);
+  std::string str;
+  PrintEvents print_events(template_gestures, str);
+  std::vector<float> circle, line;
+  for (int i = 0; i < 20; ++i) {
+    float angle = 2 * static_cast<float>(M_PI) * i / 19;
+    circle.insert(circle.end(), {std::cos(angle), std::sin(angle), 0.f});
+    line.insert(line.end(), {static_cast<float>(i), 0.f, 0.f});
+  }
+  template_gestures.addTemplate("circle", circle);
+  template_gestures.addTemplate("line", line);
+
+  // The sizes are checked before anything is allocated.
+  for (int size : {0, -1}) {
+    using features::gestures::TemplateGestures;
+    BOOST_CHECK_THROW(TemplateGestures(root_feature,
+                                       TemplateGestures::AccelerometerData,
+                                       size, 5, 0.3f),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(TemplateGestures(root_feature,
+                                       TemplateGestures::AccelerometerData,
+                                       40, size, 0.3f),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(TemplateGestures(root_feature,
+                                       TemplateGestures::AccelerometerData,
+                                       40, 5, 0.3f, size),
+                      std::invalid_argument);
+  }
+
+  // Holding still doesn't match anything, then a larger, slower circle around
+  // gravity does, once.
+  uint64_t timestamp = 0;
+  for (int i = 0; i < 60; ++i) {
+    root_feature.onAccelerometerData(nullptr, timestamp++,
+                                     myo::Vector3<float>(0.f, 0.f, 1.f));
+  }
+  for (int i = 0; i < 80; ++i) {
+    float angle = 2 * static_cast<float>(M_PI) * std::min(i, 39) / 39;
+    root_feature.onAccelerometerData(
+        nullptr, timestamp++,
+        myo::Vector3<float>(0.5f * std::cos(angle), 0.5f * std::sin(angle),
+                            1.f));
+  }
+  std::size_t gesture = str.find("onGesture");
+  BOOST_CHECK_NE(gesture, std::string::npos);
+  BOOST_CHECK_EQUAL(str.find("onGesture", gesture + 1), std::string::npos);
+  BOOST_CHECK_NE(str.find("gesture->toString(): circle", gesture),
+                 std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(testDtwGestures) {
+  // The lower bound cascade doesn't change the result of an exhaustive search.
+  core::DynamicTimeWarping dtw(3, 30, 4);
+  auto make_points = [](int seed, int count, float phase) {
+    std::vector<float> points;
+    for (int i = 0; i < 3 * count; ++i) {
+      points.push_back(std::sin(0.11f * seed * (i / 3) + (i % 3) + phase));
+    }
+    return points;
+  };
+  std::vector<std::vector<float>> templates;
+  for (int t = 0; t < 100; ++t) {
+    templates.push_back(make_points(t, 30, 0.3f * t));
+    dtw.addTemplate(std::to_string(t), templates.back().data(), 30);
+  }
+  for (int q = 0; q < 20; ++q) {
+    std::vector<float> points = make_points(q * 5, 30, 0.3f * q * 5 + 0.2f);
+    int best = -1;
+    float best_distance = 1e9f;
+    for (int t = 0; t < 100; ++t) {
+      float distance = dtw.distance(points.data(), templates[t].data());
+      if (distance < best_distance) {
+        best = t;
+        best_distance = distance;
+      }
+    }
+    core::DynamicTimeWarping::Match match = dtw.recognize(points.data());
+    BOOST_CHECK_EQUAL(match.index, best);
+    BOOST_CHECK_CLOSE(match.distance, best_distance, 1e-3);
+  }
+  const core::DynamicTimeWarping::Statistics& statistics = dtw.statistics();
+  BOOST_CHECK_EQUAL(statistics.lb_kim + statistics.lb_keogh_template +
+                        statistics.lb_keogh_sequence + statistics.abandoned +
+                        statistics.full,
+                    20 * 100);
+  BOOST_CHECK_LT(statistics.full + statistics.abandoned, 20 * 100 / 2);
+  BOOST_CHECK_THROW(dtw.addTemplate("empty", nullptr, 0),
+                    std::invalid_argument);
+  BOOST_CHECK_EQUAL(dtw.numTemplates(), 100);
+
+  features::RootFeature root_feature;
+  features::gestures::DtwGestures dtw_gestures(
+      root_feature, features::gestures::DtwGestures::GyroscopeData, 20.f, 30,
+      6);
+  std::string str;
+  PrintEvents print_events(dtw_gestures, str);
+  // A twist one way and back, and a twist the other way and back.
+  std::vector<float> twist, reverse_twist;
+  for (int i = 0; i < 30; ++i) {
+    float speed = 200.f * std::sin(2 * static_cast<float>(M_PI) * i / 29);
+    twist.insert(twist.end(), {speed, 0.f, 0.f});
+    reverse_twist.insert(reverse_twist.end(), {-speed, 0.f, 0.f});
+  }
+  dtw_gestures.addTemplate("twist", twist);
+  dtw_gestures.addTemplate("reverseTwist", reverse_twist);
+
+  // The sizes are checked before anything is allocated.
+  {
+    using features::gestures::DtwGestures;
+    BOOST_CHECK_THROW(DtwGestures(root_feature, DtwGestures::GyroscopeData,
+                                  20.f, -1),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(DtwGestures(root_feature, DtwGestures::GyroscopeData,
+                                  20.f, 30, -1),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(DtwGestures(root_feature, DtwGestures::GyroscopeData,
+                                  20.f, 30, 6, 0),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(DtwGestures(root_feature, DtwGestures::GyroscopeData,
+                                  20.f, 30, 6, -1),
+                      std::invalid_argument);
+  }
+
+  // Hold still, then twist back slowly after twisting quickly.
+  uint64_t timestamp = 0;
+  auto gyro = [&](float x) {
+    root_feature.onGyroscopeData(nullptr, timestamp++,
+                                 myo::Vector3<float>(x, 0.f, 0.f));
+  };
+  for (int i = 0; i < 40; ++i) {
+    gyro(0.f);
+  }
+  for (int i = 0; i < 12; ++i) {
+    gyro(-200.f * std::sin(static_cast<float>(M_PI) * i / 12));
+  }
+  for (int i = 0; i < 18; ++i) {
+    gyro(200.f * std::sin(static_cast<float>(M_PI) * i / 18));
+  }
+  for (int i = 0; i < 20; ++i) {
+    gyro(0.f);
+  }
+  std::size_t gesture = str.find("onGesture");
+  BOOST_CHECK_NE(gesture, std::string::npos);
+  BOOST_CHECK_EQUAL(str.find("onGesture", gesture + 1), std::string::npos);
+  BOOST_CHECK_NE(str.find("gesture->toString(): reverseTwist", gesture),
+                 std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(testEmgPoses) {
+  // Synthetic EMG where each pose activates different channels.
+  auto emg_sample = [](int pose, int i, std::array<int8_t, 8>& emg) {
+    for (int c = 0; c < 8; ++c) {
+      bool active = (pose == 1 && c < 4) || (pose == 2 && c >= 4);
+      float noise = std::sin(1.7f * i + 2.3f * c) + std::sin(0.37f * i * c);
+      emg[c] = static_cast<int8_t>((active ? 30.f : 3.f) * noise);
+    }
+  };
+  const std::vector<std::string> class_names = {"rest", "fist", "pinch"};
+  std::vector<float> samples;
+  std::vector<int> labels;
+  for (int pose = 0; pose < 3; ++pose) {
+    features::RootFeature root_feature;
+    features::EmgFeatures emg_features(root_feature);
+    std::array<int8_t, 8> emg;
+    for (int i = 0; i < 400; ++i) {
+      emg_sample(pose, i, emg);
+      root_feature.onEmgData(nullptr, i, emg.data());
+      if (i >= 39 && (i - 39) % 10 == 0) {
+        const float* data = emg_features.getFeatures().data();
+        samples.insert(samples.end(), data,
+                       data + core::EmgFeatureVector::size);
+        labels.push_back(pose);
+      }
+    }
+  }
+  core::LinearDiscriminant trained = core::LinearDiscriminant::Train(
+      class_names, core::EmgFeatureVector::size, samples, labels);
+
+  std::stringstream model_file;
+  trained.save(model_file);
+  core::LinearDiscriminant model = core::LinearDiscriminant::Load(model_file);
+  BOOST_CHECK_EQUAL(model.numClasses(), 3);
+  BOOST_CHECK_EQUAL(model.className(2), "pinch");
+  std::vector<float> trained_scores(3), loaded_scores(3);
+  for (std::size_t i = 0; i < labels.size(); ++i) {
+    const float* sample = &samples[i * core::EmgFeatureVector::size];
+    BOOST_CHECK_EQUAL(model.classify(sample), labels[i]);
+    trained.scores(sample, trained_scores.data());
+    model.scores(sample, loaded_scores.data());
+    BOOST_CHECK(trained_scores == loaded_scores);
+  }
+  std::stringstream bad_file("MILD garbage");
+  BOOST_CHECK_THROW(core::LinearDiscriminant::Load(bad_file),
+                    std::runtime_error);
+
+  features::RootFeature root_feature;
+  features::EmgFeatures emg_features(root_feature);
+  features::EmgPoses emg_poses(emg_features, model);
+  std::string str;
+  PrintEvents print_events(emg_poses, str);
+  root_feature.onPose(nullptr, 0, myo::Pose::fist);
+  std::array<int8_t, 8> emg;
+  uint64_t timestamp = 0;
+  for (int pose : {0, 2, 0, 1}) {
+    for (int i = 0; i < 100; ++i) {
+      emg_sample(pose, i, emg);
+      root_feature.onEmgData(nullptr, timestamp++, emg.data());
+    }
+  }
+  std::string poses;
+  for (std::size_t i = str.find("onPose"); i != std::string::npos;
+       i = str.find("onPose", i + 1)) {
+    std::size_t begin = str.find("toString(): ", i) + 12;
+    poses += str.substr(begin, str.find('\n', begin) - begin) + " ";
+  }
+  BOOST_CHECK_EQUAL(poses, "rest pinch rest fist ");
+
+  // Adapt to the electrodes being rotated by two channels, which the trained
+  // model doesn't handle.
+  BOOST_CHECK(model.adaptive());
+  BOOST_CHECK_THROW(emg_poses.calibrate("wave", 10), std::invalid_argument);
+  auto shifted_sample = [&](int pose, int i, std::array<int8_t, 8>& emg) {
+    std::array<int8_t, 8> unshifted;
+    emg_sample(pose, i, unshifted);
+    for (int c = 0; c < 8; ++c) {
+      emg[(c + 2) % 8] = unshifted[c];
+    }
+  };
+  auto shifted_poses = [&]() {
+    str.clear();
+    for (int pose : {0, 2, 0, 1}) {
+      for (int i = 0; i < 100; ++i) {
+        shifted_sample(pose, i, emg);
+        root_feature.onEmgData(nullptr, timestamp++, emg.data());
+      }
+    }
+    std::string poses;
+    for (std::size_t i = str.find("onPose"); i != std::string::npos;
+         i = str.find("onPose", i + 1)) {
+      std::size_t begin = str.find("toString(): ", i) + 12;
+      poses += str.substr(begin, str.find('\n', begin) - begin) + " ";
+    }
+    return poses;
+  };
+  BOOST_CHECK_NE(shifted_poses(), "rest pinch rest fist ");
+  emg_poses.calibrateOnArmSync("rest", 30, 0.1f);
+  root_feature.onArmSync(nullptr, timestamp++, myo::armRight,
+                         myo::xDirectionTowardWrist, 0, myo::warmupStateWarm);
+  for (int pose : {0, 1, 2}) {
+    if (pose != 0) {
+      emg_poses.calibrate(class_names[pose], 30, 0.1f);
+    }
+    for (int i = 0; i < 340; ++i) {
+      shifted_sample(pose, i, emg);
+      root_feature.onEmgData(nullptr, timestamp++, emg.data());
+    }
+  }
+  BOOST_CHECK_EQUAL(shifted_poses(), "rest pinch rest fist ");
+
+  std::stringstream adapted_file;
+  emg_poses.model().save(adapted_file);
+  core::LinearDiscriminant adapted =
+      core::LinearDiscriminant::Load(adapted_file);
+  BOOST_CHECK(adapted.adaptive());
+  std::vector<float> adapted_scores(3), reloaded_scores(3);
+  for (std::size_t i = 0; i < labels.size(); ++i) {
+    const float* sample = &samples[i * core::EmgFeatureVector::size];
+    emg_poses.model().scores(sample, adapted_scores.data());
+    adapted.scores(sample, reloaded_scores.data());
+    BOOST_CHECK(adapted_scores == reloaded_scores);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testNetworkGestures) {
+  typedef core::QuantizedNetwork::LayerSpec LayerSpec;
+  typedef core::QuantizedNetwork::LayerType LayerType;
+  typedef core::QuantizedNetwork::Activation Activation;
+  unsigned seed = 1;
+  auto random = [&seed](int range) {
+    seed = seed * 1103515245u + 12345u;
+    return static_cast<int>((seed >> 16) % (2 * range + 1)) - range;
+  };
+  auto make_layer = [&](LayerType type, Activation activation,
+                        uint32_t in_channels, uint32_t out_channels,
+                        uint32_t kernel_size, uint32_t stride) {
+    LayerSpec layer = {type, activation, in_channels, out_channels,
+                       kernel_size, stride, 0.5f, {}, {}, {}};
+    for (uint32_t i = 0; i < out_channels * kernel_size * in_channels; ++i) {
+      layer.weights.push_back(static_cast<int8_t>(random(127)));
+    }
+    for (uint32_t o = 0; o < out_channels; ++o) {
+      layer.biases.push_back(random(1000));
+      layer.weight_scales.push_back(0.001f * (1 + random(5) + 5));
+    }
+    return layer;
+  };
+  const uint32_t input_length = 30;
+  std::vector<LayerSpec> layers = {
+      make_layer(LayerType::conv1d, Activation::relu, 8, 16, 3, 2),
+      make_layer(LayerType::conv1d, Activation::relu, 16, 12, 5, 1),
+      make_layer(LayerType::dense, Activation::relu, 10 * 12, 20, 1, 1),
+      make_layer(LayerType::dense, Activation::none, 20, 3, 1, 1)};
+
+  // A straightforward reference implementation.
+  auto reference = [&](const std::vector<int8_t>& input) {
+    std::vector<int> activations(input.begin(), input.end());
+    std::size_t length = input_length;
+    float scale = 1.f;
+    std::vector<float> outputs;
+    for (std::size_t l = 0; l < layers.size(); ++l) {
+      const LayerSpec& layer = layers[l];
+      std::size_t kernel = layer.kernel_size, stride = layer.stride;
+      if (layer.type == LayerType::dense) {
+        kernel = stride = 1;
+        length = 1;
+      }
+      std::size_t output_length = (length - kernel) / stride + 1;
+      std::size_t row = kernel * layer.in_channels;
+      std::vector<int> next;
+      outputs.clear();
+      for (std::size_t t = 0; t < output_length; ++t) {
+        for (std::size_t o = 0; o < layer.out_channels; ++o) {
+          int sum = layer.biases[o];
+          for (std::size_t i = 0; i < row; ++i) {
+            sum += layer.weights[o * row + i] *
+                   activations[t * stride * layer.in_channels + i];
+          }
+          float value = sum * scale * layer.weight_scales[o];
+          if (l + 1 == layers.size()) {
+            outputs.push_back(value);
+          } else {
+            value /= layer.output_scale;
+            value = std::max(layer.activation == Activation::relu ? 0.f
+                                                                  : -128.f,
+                             std::min(127.f, value));
+            next.push_back(static_cast<int>(std::floor(value + 0.5f)));
+          }
+        }
+      }
+      activations = next;
+      length = output_length;
+      scale = layer.output_scale;
+    }
+    return outputs;
+  };
+
+  std::stringstream model_file;
+  core::QuantizedNetwork::Write(model_file, input_length, 8, 1.f, layers);
+  std::string path = "myo_intelligesture_test.model";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << model_file.str();
+  }
+  std::unique_ptr<core::QuantizedNetwork> network =
+      core::QuantizedNetwork::Load(path);
+  std::unique_ptr<core::QuantizedNetwork> loaded =
+      core::QuantizedNetwork::Load(model_file);
+  std::remove(path.c_str());
+  BOOST_CHECK_EQUAL(network->numOutputs(), 3);
+  for (int trial = 0; trial < 10; ++trial) {
+    std::vector<int8_t> input;
+    for (uint32_t i = 0; i < input_length * 8; ++i) {
+      input.push_back(static_cast<int8_t>(random(128)));
+    }
+    std::vector<float> expected = reference(input);
+    const float* outputs = network->infer(input.data());
+    const float* loaded_outputs = loaded->infer(input.data());
+    for (std::size_t o = 0; o < expected.size(); ++o) {
+      BOOST_CHECK_CLOSE(outputs[o], expected[o], 1e-3);
+      BOOST_CHECK_EQUAL(outputs[o], loaded_outputs[o]);
+    }
+  }
+
+  // The first row of the first layer holds 3 * 8 weights, padded to 32, after
+  // the 32 byte model and layer headers.
+  std::string padded = model_file.str();
+  padded[32 + 32 + 3 * 8] = 1;
+  std::stringstream padded_file(padded);
+  BOOST_CHECK_THROW(core::QuantizedNetwork::Load(padded_file),
+                    std::runtime_error);
+
+  layers[1].weights[7] = -128;
+  std::stringstream bad_file;
+  core::QuantizedNetwork::Write(bad_file, input_length, 8, 1.f, layers);
+  BOOST_CHECK_THROW(core::QuantizedNetwork::Load(bad_file),
+                    std::runtime_error);
+
+  // A network which compares the mean absolute value of the first and last
+  // four channels against a threshold.
+  LayerSpec rectify = {LayerType::conv1d, Activation::relu, 8, 16, 1, 1, 1.f,
+                       {}, {}, {}};
+  for (int o = 0; o < 16; ++o) {
+    for (int i = 0; i < 8; ++i) {
+      rectify.weights.push_back(i == o / 2 ? (o % 2 ? -1 : 1) : 0);
+    }
+    rectify.biases.push_back(0);
+    rectify.weight_scales.push_back(1.f);
+  }
+  LayerSpec compare = {LayerType::dense, Activation::none, 4 * 16, 3, 1, 1,
+                       1.f, {}, {}, {}};
+  for (int o = 0; o < 3; ++o) {
+    for (int i = 0; i < 4 * 16; ++i) {
+      compare.weights.push_back(o == 0 ? 0 : ((i % 16 < 8) == (o == 1)));
+    }
+    compare.biases.push_back(o == 0 ? 4 * 4 * 20 : 0);
+    compare.weight_scales.push_back(1.f);
+  }
+  std::stringstream threshold_file;
+  core::QuantizedNetwork::Write(threshold_file, 4, 8, 1.f, {rectify, compare});
+
+  features::RootFeature root_feature;
+  features::gestures::NetworkGestures network_gestures(
+      root_feature, core::QuantizedNetwork::Load(threshold_file),
+      {"rest", "left", "right"}, features::gestures::NetworkGestures::Output::gestures, 2);
+  std::string str;
+  PrintEvents print_events(network_gestures, str);
+  uint64_t timestamp = 0;
+  for (auto emg : {std::array<int8_t, 8>{{1, -2, 3, 0, 1, 0, -1, 2}},
+                   std::array<int8_t, 8>{{-60, 50, 0, 0, 1, 0, -1, 2}},
+                   std::array<int8_t, 8>{{1, -2, 3, 0, 1, 0, -1, 2}},
+                   std::array<int8_t, 8>{{1, -2, 3, 0, 1, 90, -1, 2}}}) {
+    for (int i = 0; i < 8; ++i) {
+      root_feature.onEmgData(nullptr, timestamp++, emg.data());
+    }
+  }
+  std::string gestures;
+  for (std::size_t i = str.find("onGesture"); i != std::string::npos;
+       i = str.find("onGesture", i + 1)) {
+    std::size_t begin = str.find("toString(): ", i) + 12;
+    gestures += str.substr(begin, str.find('\n', begin) - begin) + " ";
+  }
+  BOOST_CHECK_EQUAL(gestures, "left right ");
+}
+
+BOOST_AUTO_TEST_CASE(testPoseGestures) {
+  using features::gestures::PoseGestures;
+  auto run = [](PoseGestures::Mode mode) {
+    features::RootFeature root_feature;
+    PoseGestures pose_gestures(root_feature, 200, 300, mode);
+    std::string str;
+    PrintEvents print_events(pose_gestures, str);
+    const std::vector<std::pair<uint64_t, myo::Pose::Type>> poses = {
+        {0, myo::Pose::fist},          {100, myo::Pose::rest},
+        {200, myo::Pose::fist},        {300, myo::Pose::rest},
+        {1000, myo::Pose::waveIn},     {1100, myo::Pose::rest},
+        {1200, myo::Pose::fist},       {1300, myo::Pose::rest},
+        {2000, myo::Pose::fingersSpread}, {2500, myo::Pose::rest},
+        {3000, myo::Pose::fist},       {3050, myo::Pose::rest}};
+    for (const auto& pose : poses) {
+      root_feature.onPose(nullptr, 1000 * pose.first, pose.second);
+    }
+    // The last click is only confirmed once the double click timeout has
+    // passed without another pose.
+    std::string before_timeout = str;
+    std::this_thread::sleep_for(std::chrono::milliseconds(350));
+    root_feature.onPeriodic(nullptr);
+    // Only keep the gestures.
+    std::string gestures;
+    std::istringstream lines(str);
+    for (std::string line; std::getline(lines, line);) {
+      if (line.find("Gesture") != std::string::npos) {
+        gestures += line.substr(0, line.find(" - ")) + " " +
+                    line.substr(line.find("timestamp: ") + 11) + "\n";
+      }
+    }
+    BOOST_CHECK_EQUAL(before_timeout.find("timestamp: 3350000"),
+                      std::string::npos);
+    return gestures;
+  };
+
+  BOOST_CHECK_EQUAL(run(PoseGestures::Mode::conservative),
+      "onGesture 300000 gesture->toString(): doubleClick\n"
+      "onGesture 1200000 gesture->toString(): singleClick\n"
+      "onGesture 1600000 gesture->toString(): singleClick\n"
+      "onGesture 2200000 gesture->toString(): hold\n"
+      "onGesture 3350000 gesture->toString(): singleClick\n");
+  BOOST_CHECK_EQUAL(run(PoseGestures::Mode::speculative),
+      "onSpeculativeGesture 100000 gesture->toString(): singleClick status: tentative\n"
+      "onSpeculativeGesture 300000 gesture->toString(): singleClick status: cancelled\n"
+      "onSpeculativeGesture 300000 gesture->toString(): doubleClick status: confirmed\n"
+      "onGesture 300000 gesture->toString(): doubleClick\n"
+      "onSpeculativeGesture 1100000 gesture->toString(): singleClick status: tentative\n"
+      "onSpeculativeGesture 1200000 gesture->toString(): singleClick status: confirmed\n"
+      "onGesture 1200000 gesture->toString(): singleClick\n"
+      "onSpeculativeGesture 1300000 gesture->toString(): singleClick status: tentative\n"
+      "onSpeculativeGesture 1600000 gesture->toString(): singleClick status: confirmed\n"
+      "onGesture 1600000 gesture->toString(): singleClick\n"
+      "onSpeculativeGesture 2200000 gesture->toString(): hold status: confirmed\n"
+      "onGesture 2200000 gesture->toString(): hold\n"
+      "onSpeculativeGesture 3050000 gesture->toString(): singleClick status: tentative\n"
+      "onSpeculativeGesture 3350000 gesture->toString(): singleClick status: confirmed\n"
+      "onGesture 3350000 gesture->toString(): singleClick\n");
+}
+
+BOOST_AUTO_TEST_CASE(testPoseSequences) {
+  typedef core::PoseSequenceAutomaton Automaton;
+  Automaton::Pattern flick =
+      Automaton::ParsePattern("flick", "fist -> waveIn within 400 -> rest");
+  BOOST_CHECK_EQUAL(flick.steps.size(), 3);
+  BOOST_CHECK_EQUAL(flick.steps[1].pose, "waveIn");
+  BOOST_CHECK_EQUAL(flick.steps[1].within_ms, 400);
+  BOOST_CHECK_EQUAL(flick.steps[2].within_ms, 0);
+  BOOST_CHECK_THROW(Automaton::ParsePattern("bad", "fist -> -> rest"),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(Automaton::ParsePattern("bad", "fist -> rest within"),
+                    std::invalid_argument);
+
+  features::RootFeature root_feature;
+  features::gestures::PoseSequences pose_sequences(
+      root_feature,
+      {flick, Automaton::ParsePattern("wave", "waveIn -> rest"),
+       Automaton::ParsePattern("spread", "fingersSpread"),
+       Automaton::ParsePattern("double", "fist -> rest within 200 -> fist "
+                                         "within 200")});
+  std::string str;
+  PrintEvents print_events(pose_sequences, str);
+  const std::vector<std::pair<uint64_t, myo::Pose::Type>> poses = {
+      {0, myo::Pose::fist},           {300000, myo::Pose::waveIn},
+      {2000000, myo::Pose::rest},     {3000000, myo::Pose::fist},
+      {3500000, myo::Pose::waveIn},   {3600000, myo::Pose::rest},
+      {4000000, myo::Pose::fingersSpread}, {4100000, myo::Pose::waveOut},
+      {4200000, myo::Pose::rest},     {5000000, myo::Pose::fist},
+      {5100000, myo::Pose::rest},     {5300000, myo::Pose::fist},
+      {5400000, myo::Pose::rest},     {5500000, myo::Pose::fist}};
+  for (const auto& pose : poses) {
+    root_feature.onPose(nullptr, pose.first, pose.second);
+  }
+  std::string gestures;
+  for (std::size_t i = str.find("onGesture"); i != std::string::npos;
+       i = str.find("onGesture", i + 1)) {
+    std::size_t begin = str.find("toString(): ", i) + 12;
+    gestures += str.substr(begin, str.find('\n', begin) - begin) + " ";
+  }
+  BOOST_CHECK_EQUAL(gestures, "flick wave wave spread double double ");
+  BOOST_CHECK_EQUAL(str.find("onPose"), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testSuppressPrefixPoses) {
+  features::RootFeature root_feature;
+  features::filters::SuppressPrefixPoses suppress(
+      root_feature, {core::PoseSequenceAutomaton::ParsePattern(
+                        "flick", "fist -> rest within 300 -> waveIn")},
+      300);
+  std::string str;
+  PrintEvents print_events(suppress, str);
+  const std::vector<std::pair<uint64_t, myo::Pose::Type>> poses = {
+      {0, myo::Pose::fist},       {100, myo::Pose::rest},
+      {200, myo::Pose::waveIn},   {1000, myo::Pose::fist},
+      {1100, myo::Pose::rest},    {1200, myo::Pose::fingersSpread},
+      {2000, myo::Pose::fist},    {2100, myo::Pose::rest},
+      {2500, myo::Pose::waveIn},  {3000, myo::Pose::fist}};
+  for (const auto& pose : poses) {
+    root_feature.onPose(nullptr, 1000 * pose.first, pose.second);
+  }
+  // The last fist is held until its budget has passed.
+  std::this_thread::sleep_for(std::chrono::milliseconds(350));
+  root_feature.onPeriodic(nullptr);
+
+  std::string events;
+  std::istringstream lines(str);
+  for (std::string line; std::getline(lines, line);) {
+    if (line.find("toString(): ") != std::string::npos) {
+      events += line.substr(0, line.find(" - ")) + " " +
+                line.substr(line.find("toString(): ") + 12) + "\n";
+    }
+  }
+  BOOST_CHECK_EQUAL(events,
+                    "onGesture flick\n"
+                    "onPose fist\n"
+                    "onPose rest\n"
+                    "onPose fingersSpread\n"
+                    "onPose fist\n"
+                    "onPose rest\n"
+                    "onPose waveIn\n"
+                    "onPose fist\n");
+  const auto& metrics = suppress.metrics();
+  BOOST_CHECK_EQUAL(metrics.released, 7);
+  BOOST_CHECK_EQUAL(metrics.delayed, 5);
+  BOOST_CHECK_EQUAL(metrics.suppressed, 3);
+  BOOST_CHECK_EQUAL(metrics.max_delay_us, 500000);
+  BOOST_CHECK_GE(metrics.total_delay_us, 1550000);
+  suppress.resetMetrics();
+  BOOST_CHECK_EQUAL(suppress.metrics().released, 0);
+}
+
+BOOST_AUTO_TEST_CASE(testChordGestures) {
+  using features::gestures::ChordGestures;
+  int64_t now = 0;
+  features::RootFeature root_feature;
+  ChordGestures chord_gestures(
+      root_feature,
+      {{"bothFists", {"fist", "fist"}, 150},
+       {"spreadAndWave", {"fingersSpread", "waveIn", "waveOut"}, 100}},
+      100, [&now]() { return now; });
+  std::string str;
+  PrintEvents print_events(chord_gestures, str);
+
+  // Three Myos with clocks that are far apart, and transmission delays
+  // between 5 and 25 ms.
+  int ids[3];
+  myo::Myo* myos[3];
+  const int64_t offsets[3] = {0, -5000000, 123456789};
+  for (int d = 0; d < 3; ++d) {
+    myos[d] = reinterpret_cast<myo::Myo*>(&ids[d]);
+  }
+  auto timestamp = [&](int d, int64_t delay) {
+    return static_cast<uint64_t>(now - delay - offsets[d]);
+  };
+  for (int i = 0; i < 200; ++i) {
+    now += 20000;
+    for (int d = 0; d < 3; ++d) {
+      int64_t delay = 5000 + (i * 7919 + d * 104729) % 20000;
+      root_feature.onOrientationData(myos[d], timestamp(d, delay),
+                                     myo::Quaternion<float>());
+    }
+  }
+  BOOST_CHECK_EQUAL(chord_gestures.numDevices(), 3);
+  for (int d = 0; d < 3; ++d) {
+    BOOST_CHECK_SMALL(chord_gestures.clockOffset(myos[d]) - offsets[d] - 5000,
+                      int64_t(1000));
+  }
+
+  // Poses are received with different delays, so only the aligned times
+  // decide whether they are within a chord's window.
+  auto pose = [&](int64_t time_ms, int d, int64_t delay_ms,
+                  myo::Pose::Type type) {
+    now = 4000000 + 1000 * (time_ms + delay_ms);
+    root_feature.onPose(myos[d], timestamp(d, 1000 * delay_ms), type);
+  };
+  pose(0, 0, 5, myo::Pose::fist);
+  pose(140, 1, 5, myo::Pose::fist);
+  pose(300, 0, 5, myo::Pose::rest);
+  pose(400, 1, 100, myo::Pose::rest);
+  pose(1000, 0, 5, myo::Pose::fist);
+  // Received 100 ms after the first fist, but made 200 ms after it.
+  pose(1200, 1, 5, myo::Pose::fist);
+  pose(1300, 1, 5, myo::Pose::rest);
+  // A chord needs distinct devices.
+  pose(2000, 2, 5, myo::Pose::fist);
+  pose(2100, 2, 5, myo::Pose::rest);
+  pose(2150, 2, 5, myo::Pose::fist);
+  pose(3000, 2, 5, myo::Pose::waveOut);
+  pose(3050, 0, 50, myo::Pose::fingersSpread);
+  pose(3060, 1, 5, myo::Pose::waveIn);
+  // Changing pose breaks the chord.
+  pose(4000, 2, 5, myo::Pose::fingersSpread);
+  pose(4010, 1, 5, myo::Pose::waveOut);
+  pose(4020, 1, 5, myo::Pose::waveIn);
+  pose(4030, 0, 5, myo::Pose::waveOut);
+
+  std::string gestures;
+  std::istringstream lines(str);
+  for (std::string line; std::getline(lines, line);) {
+    if (line.find("onGesture") == 0) {
+      gestures += line.substr(line.find("toString(): ") + 12) + " ";
+    }
+  }
+  BOOST_CHECK_EQUAL(gestures, "bothFists spreadAndWave spreadAndWave ");
+  BOOST_CHECK_THROW(ChordGestures(root_feature, {{"empty", {}, 100}}),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testBlocker) {
+  features::RootFeature root_feature;
+  features::Blocker<core::Events::Pose | core::Events::Rssi> blocker(
+      root_feature);
+  std::string blocked_str, nested_str;
+  PrintEvents print_events(blocker, blocked_str);
+  features::DynamicBlocker nested_blocker(blocker,
+                                          core::Events::OrientationData);
+  PrintEvents nested_print_events(nested_blocker, nested_str);
+
+  root_feature.onPose(nullptr, 0, myo::Pose::fist);
+  root_feature.onRssi(nullptr, 1, -50);
+  root_feature.onOrientationData(nullptr, 2, myo::Quaternion<float>());
+  root_feature.onLock(nullptr, 3);
+  // Events passed to a Blocker directly are blocked as well.
+  blocker.onPose(nullptr, 4, std::make_shared<core::Pose>(core::Pose::fist));
+  nested_blocker.onOrientationData(nullptr, 5, myo::Quaternion<float>());
+  nested_blocker.onLock(nullptr, 6);
+  BOOST_CHECK_EQUAL(
+      blocked_str,
+      "onOrientationData - myo: 00000000 timestamp: 2 rotation: (0, 0, 0, 1)\n"
+      "onLock - myo: 00000000 timestamp: 3\n");
+  BOOST_CHECK_EQUAL(nested_str,
+                    "onLock - myo: 00000000 timestamp: 3\n"
+                    "onLock - myo: 00000000 timestamp: 6\n");
+
+  // Removing a child from a Blocker removes it from the tree.
+  blocker.removeChildFeature(&print_events);
+  root_feature.onLock(nullptr, 7);
+  BOOST_CHECK_EQUAL(blocked_str,
+                    "onOrientationData - myo: 00000000 timestamp: 2 rotation: "
+                    "(0, 0, 0, 1)\n"
+                    "onLock - myo: 00000000 timestamp: 3\n");
+}
+
+BOOST_AUTO_TEST_CASE(testChangeChildrenWhileDispatching) {
+  // On a pose, removes itself and the feature to remove from its parent, and
+  // adds the feature to add.
+  class ChangeChildren : public core::DeviceListenerWrapper {
+   public:
+    ChangeChildren(core::DeviceListenerWrapper& parent_feature,
+                   core::DeviceListenerWrapper& remove,
+                   core::DeviceListenerWrapper& add)
+        : parent_feature_(parent_feature), remove_(remove), add_(add) {
+      parent_feature_.addChildFeature(this);
+    }
+    virtual void onPose(myo::Myo*, uint64_t,
+                        const std::shared_ptr<core::Pose>&) override {
+      parent_feature_.removeChildFeature(this);
+      parent_feature_.removeChildFeature(&remove_);
+      parent_feature_.addChildFeature(&add_);
+    }
+
+   private:
+    core::DeviceListenerWrapper& parent_feature_;
+    core::DeviceListenerWrapper& remove_;
+    core::DeviceListenerWrapper& add_;
+  };
+
+  features::RootFeature root_feature;
+  core::DeviceListenerWrapper unattached;
+  std::string removed_str, kept_str, added_str;
+  PrintEvents removed(unattached, removed_str), added(unattached, added_str);
+  ChangeChildren change_children(root_feature, removed, added);
+  root_feature.addChildFeature(&removed);
+  PrintEvents kept(root_feature, kept_str);
+
+  // The removed feature doesn't see the pose, the one after it still does,
+  // and the added feature sees the events after the pose.
+  root_feature.onPose(nullptr, 0, myo::Pose::fist);
+  root_feature.onLock(nullptr, 1);
+  BOOST_CHECK_EQUAL(removed_str, "");
+  BOOST_CHECK_EQUAL(kept_str,
+                    "onPose - myo: 00000000 timestamp: 0 pose->toString(): "
+                    "fist\n"
+                    "onLock - myo: 00000000 timestamp: 1\n");
+  BOOST_CHECK_EQUAL(added_str, "onLock - myo: 00000000 timestamp: 1\n");
+}
+
+BOOST_AUTO_TEST_CASE(testGroup) {
+  // Counts the events dispatched to the Group itself.
+  class CountingGroup : public features::Group {
+   public:
+    explicit CountingGroup(core::DeviceListenerWrapper& parent_feature)
+        : features::Group(parent_feature), count(0) {}
+    virtual void onPose(myo::Myo* myo, uint64_t timestamp,
+                        const std::shared_ptr<core::Pose>& pose) override {
+      ++count;
+      features::Group::onPose(myo, timestamp, pose);
+    }
+    virtual void onLock(myo::Myo* myo, uint64_t timestamp) override {
+      ++count;
+      features::Group::onLock(myo, timestamp);
+    }
+    int count;
+  };
+
+  features::RootFeature root_feature;
+  CountingGroup group(root_feature);
+  root_feature.onLock(nullptr, 0);
+  BOOST_CHECK_EQUAL(group.count, 0);
+
+  std::string str;
+  PrintEvents print_events(group, str);
+  group.addChildFeature(&print_events, core::Events::Pose);
+  root_feature.onLock(nullptr, 1);
+  root_feature.onPose(nullptr, 2, myo::Pose::fist);
+  BOOST_CHECK_EQUAL(group.count, 1);
+  BOOST_CHECK_EQUAL(str,
+                    "onPose - myo: 00000000 timestamp: 2 pose->toString(): "
+                    "fist\n");
+
+  group.removeChildFeature(&print_events);
+  root_feature.onPose(nullptr, 3, myo::Pose::fist);
+  BOOST_CHECK_EQUAL(group.count, 1);
+}
+
+BOOST_AUTO_TEST_CASE(testCoalesce) {
+  using features::Coalesce;
+  int64_t now = 0;
+  features::RootFeature root_feature;
+  Coalesce coalesce(root_feature, 10,
+                    core::Events::OrientationData | core::Events::Rssi,
+                    [&now]() { return now; });
+  std::string str;
+  PrintEvents print_events(coalesce, str);
+  BOOST_CHECK_THROW(Coalesce(root_feature, 10, core::Events::Pose),
+                    std::invalid_argument);
+
+  // Without load every event is delivered.
+  root_feature.onOrientationData(nullptr, 0, myo::Quaternion<float>());
+  root_feature.onRssi(nullptr, 1, -40);
+  root_feature.onRssi(nullptr, 2, -41);
+  BOOST_CHECK(str.empty());
+  BOOST_CHECK_EQUAL(coalesce.pending(), 3);
+  BOOST_CHECK_EQUAL(coalesce.dispatch(), 3);
+  BOOST_CHECK_EQUAL(str,
+                    "onOrientationData - myo: 00000000 timestamp: 0 rotation: "
+                    "(0, 0, 0, 1)\n"
+                    "onRssi - myo: 00000000 timestamp: 1 rssi: -40\n"
+                    "onRssi - myo: 00000000 timestamp: 2 rssi: -41\n");
+
+  // Once the oldest event is older than the latency target, new samples
+  // replace the pending ones, but poses and locks are kept in order.
+  str.clear();
+  root_feature.onOrientationData(nullptr, 3, myo::Quaternion<float>());
+  now = 5000;
+  root_feature.onPose(nullptr, 4, myo::Pose::fist);
+  root_feature.onRssi(nullptr, 5, -42);
+  BOOST_CHECK(!coalesce.overloaded());
+  now = 20000;
+  BOOST_CHECK(coalesce.overloaded());
+  root_feature.onOrientationData(nullptr, 6, myo::Quaternion<float>());
+  root_feature.onLock(nullptr, 7);
+  root_feature.onRssi(nullptr, 8, -43);
+  root_feature.onOrientationData(nullptr, 9, myo::Quaternion<float>());
+  root_feature.onAccelerometerData(nullptr, 10, myo::Vector3<float>());
+  root_feature.onAccelerometerData(nullptr, 11, myo::Vector3<float>());
+  BOOST_CHECK_EQUAL(coalesce.pending(), 6);
+  now = 25000;
+  BOOST_CHECK_EQUAL(coalesce.dispatch(2), 2);
+  BOOST_CHECK_EQUAL(coalesce.dispatch(), 4);
+  BOOST_CHECK_EQUAL(str,
+                    "onPose - myo: 00000000 timestamp: 4 pose->toString(): "
+                    "fist\n"
+                    "onLock - myo: 00000000 timestamp: 7\n"
+                    "onRssi - myo: 00000000 timestamp: 8 rssi: -43\n"
+                    "onOrientationData - myo: 00000000 timestamp: 9 rotation: "
+                    "(0, 0, 0, 1)\n"
+                    "onAccelerometerData - myo: 00000000 timestamp: 10 accel: "
+                    "(0, 0, 0)\n"
+                    "onAccelerometerData - myo: 00000000 timestamp: 11 accel: "
+                    "(0, 0, 0)\n");
+  Coalesce::Counters counters = coalesce.counters();
+  BOOST_CHECK_EQUAL(counters.received, 12);
+  BOOST_CHECK_EQUAL(counters.delivered, 9);
+  BOOST_CHECK_EQUAL(
+      counters.coalesced[core::Events::Index(core::Events::OrientationData)],
+      2);
+  BOOST_CHECK_EQUAL(counters.coalesced[core::Events::Index(core::Events::Rssi)],
+                    1);
+  BOOST_CHECK_EQUAL(counters.late, 1);
+  BOOST_CHECK_EQUAL(counters.max_latency_us, 20000);
+  BOOST_CHECK_EQUAL(counters.max_pending, 6);
+
+  // A dispatch thread delivers everything that is queued.
+  std::size_t num_events = 0;
+  class Count : public core::DeviceListenerWrapper {
+   public:
+    Count(core::DeviceListenerWrapper& parent_feature, std::size_t& count)
+        : count_(count) {
+      parent_feature.addChildFeature(this);
+    }
+    virtual void onPose(myo::Myo*, uint64_t,
+                        const std::shared_ptr<core::Pose>&) override {
+      ++count_;
+    }
+
+   private:
+    std::size_t& count_;
+  };
+  features::RootFeature threaded_root_feature;
+  Coalesce threaded_coalesce(threaded_root_feature);
+  Count count(threaded_coalesce, num_events);
+  threaded_coalesce.start();
+  for (int i = 0; i < 1000; ++i) {
+    threaded_root_feature.onPose(nullptr, i, myo::Pose::fist);
+  }
+  for (int i = 0; i < 1000 && threaded_coalesce.pending() > 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  threaded_coalesce.stop();
+  BOOST_CHECK_EQUAL(num_events, 1000);
+}
+
+BOOST_AUTO_TEST_CASE(testSharedMemory) {
+  using features::SharedMemoryPublisher;
+  using features::SharedMemorySubscriber;
+  const std::string name =
+      "/myo-intelligesture-test-" +
+      std::to_string(
+          std::chrono::steady_clock::now().time_since_epoch().count());
+  features::RootFeature root_feature;
+  SharedMemoryPublisher publisher(root_feature, name, 16, 256);
+  SharedMemorySubscriber subscriber(name), other_subscriber(name);
+  std::string published_str, subscribed_str, other_str;
+  PrintEvents print_published(root_feature, published_str);
+  PrintEvents print_subscribed(subscriber, subscribed_str);
+  PrintEvents print_other(other_subscriber, other_str);
+  BOOST_CHECK_THROW(SharedMemorySubscriber("/myo-intelligesture-missing"),
+                    std::runtime_error);
+
+  myo::Myo* myo = reinterpret_cast<myo::Myo*>(&root_feature);
+  myo::FirmwareVersion firmware_version = {1, 5, 1970, 2};
+  root_feature.onConnect(myo, 0, firmware_version);
+  root_feature.onArmSync(myo, 1, myo::armLeft, myo::xDirectionTowardElbow,
+                         0.5f, myo::warmupStateWarm);
+  root_feature.onPose(myo, 2, myo::Pose::fist);
+  root_feature.onOrientationData(myo, 3,
+                                 myo::Quaternion<float>(0.5f, 0.5f, 0.5f, 0.5f));
+  root_feature.onAccelerometerData(nullptr, 4,
+                                   myo::Vector3<float>(1.f, 2.f, 3.f));
+  root_feature.onRssi(myo, 5, -50);
+  int8_t emg[8] = {1, -2, 3, -4, 5, -6, 7, -128};
+  root_feature.onEmgData(myo, 6, emg);
+  auto pose = std::make_shared<features::gestures::NetworkGestures::Pose>(
+      "pinch");
+  auto gesture =
+      std::make_shared<features::gestures::NetworkGestures::Gesture>("swipe");
+  core::DeviceListenerWrapper& root = root_feature;
+  root.onPose(myo, 7, pose);
+  root.onGesture(myo, 8, gesture);
+  root.onSpeculativeGesture(myo, 9, gesture,
+                            core::Gesture::Status::cancelled);
+  core::SensorFrame frame = {{0.f, 0.f, 0.f, 1.f}, {0.f, 0.f, -1.f},
+                             {4.f, 5.f, 6.f}, {8, 7, 6, 5, 4, 3, 2, 1}};
+  root.onSensorFrame(myo, 10, frame);
+  root.onLock(myo, 11);
+  BOOST_CHECK_EQUAL(publisher.published(), 12);
+
+  BOOST_CHECK_EQUAL(subscriber.poll(), 12);
+  BOOST_CHECK_EQUAL(subscriber.poll(), 0);
+  BOOST_CHECK_EQUAL(subscriber.lost(), 0);
+  BOOST_CHECK_EQUAL(subscriber.numDevices(), 2);
+  // The subscriber passes on the same events, but for stand-ins of the Myos,
+  // and calls onPeriodic after every poll.
+  auto strip_myos = [](std::string str) {
+    for (std::size_t start = str.find(" myo: "); start != std::string::npos;
+         start = str.find(" myo: ", start + 1)) {
+      str.erase(start + 6, str.find_first_of(" \n", start + 6) - start - 6);
+    }
+    return str;
+  };
+  std::string periodic_str = "onPeriodic - myo: \nonPeriodic - myo: \n";
+  BOOST_CHECK_EQUAL(strip_myos(subscribed_str),
+                    strip_myos(published_str) + periodic_str + periodic_str);
+  BOOST_CHECK_EQUAL(subscribed_str.find("myo: 0 "), std::string::npos);
+
+  // A subscriber which falls behind loses the oldest events, without holding
+  // up the publisher.
+  for (int i = 0; i < 20; ++i) {
+    root_feature.onRssi(myo, 100 + i, -i);
+  }
+  BOOST_CHECK_EQUAL(other_subscriber.poll(), 16);
+  BOOST_CHECK_EQUAL(other_subscriber.lost(), 16);
+  BOOST_CHECK(other_str.find("timestamp: 103 ") == std::string::npos);
+  BOOST_CHECK(other_str.find("timestamp: 104 ") != std::string::npos);
+
+  // Records which don't fit into a slot are skipped.
+  root.onEmgSpectrum(myo, 200, core::EmgSpectrum(64, 3.125f));
+  BOOST_CHECK_EQUAL(publisher.skipped(), 1);
+  BOOST_CHECK_EQUAL(other_subscriber.poll(), 0);
+
+  // Publishers in a FeatureGraph are leaves, but aren't dropped.
+  std::istringstream config("{\"features\": [{\"type\": "
+                            "\"SharedMemoryPublisher\", \"ring\": \"" +
+                            name + "-graph\"}]}");
+  features::RootFeature graph_root_feature;
+  features::FeatureGraph graph;
+  graph.build(graph_root_feature, features::FeatureGraph::ParseJson(config));
+  SharedMemorySubscriber graph_subscriber(name + "-graph");
+  graph_root_feature.onPose(nullptr, 0, myo::Pose::waveIn);
+  BOOST_CHECK_EQUAL(graph_subscriber.poll(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testColumnCodec) {
+  using namespace core::ColumnCodec;
+  std::vector<char> encoded;
+
+  // Regular timestamps take a byte each, irregular ones still round trip.
+  std::vector<uint64_t> timestamps, decoded_timestamps(6);
+  for (uint64_t timestamp = 1000; timestamp < 6000; timestamp += 1000) {
+    timestamps.push_back(timestamp);
+  }
+  EncodeTimestamps(timestamps.data(), timestamps.size(), encoded);
+  BOOST_CHECK_EQUAL(encoded.size(), 6);
+  timestamps.push_back(3);
+  encoded.clear();
+  EncodeTimestamps(timestamps.data(), timestamps.size(), encoded);
+  BOOST_CHECK_EQUAL(DecodeTimestamps(encoded.data(), encoded.size(), 6,
+                                     decoded_timestamps.data()),
+                    encoded.size());
+  BOOST_CHECK(decoded_timestamps == timestamps);
+  BOOST_CHECK_THROW(DecodeTimestamps(encoded.data(), encoded.size() - 1, 6,
+                                     decoded_timestamps.data()),
+                    std::runtime_error);
+
+  // Noisy and smooth 8 bit columns, two interleaved channels.
+  std::vector<int8_t> values, decoded_values(200);
+  for (int i = 0; i < 100; ++i) {
+    values.push_back(static_cast<int8_t>(i % 2 ? -128 + i : 127 - i));
+    values.push_back(static_cast<int8_t>(i / 4));
+  }
+  for (std::size_t channel = 0; channel < 2; ++channel) {
+    encoded.clear();
+    EncodeInt8(values.data() + channel, 100, 2, encoded);
+    BOOST_CHECK_EQUAL(DecodeInt8(encoded.data(), encoded.size(), 100, 2,
+                                 decoded_values.data() + channel),
+                      encoded.size());
+    // The slowly rising channel needs two bits per sample as deltas.
+    BOOST_CHECK_EQUAL(encoded.size(), channel ? 2 + 25 : 2 + 100);
+  }
+  BOOST_CHECK(decoded_values == values);
+  BOOST_CHECK_THROW(DecodeInt8(encoded.data(), encoded.size() - 1, 100, 2,
+                               decoded_values.data()),
+                    std::runtime_error);
+
+  // Floats round trip bit for bit, and repeated values take a bit.
+  std::vector<float> floats = {1.f, 1.f, 1.f, 1.0001f, -0.f, 0.f,
+                               std::numeric_limits<float>::quiet_NaN(),
+                               std::numeric_limits<float>::infinity(),
+                               std::numeric_limits<float>::denorm_min(),
+                               -3.4e38f, 9.81f, 9.8f, 9.81f};
+  std::vector<float> decoded_floats(floats.size());
+  encoded.clear();
+  EncodeFloats(floats.data(), floats.size(), 1, encoded);
+  BOOST_CHECK_EQUAL(DecodeFloats(encoded.data(), encoded.size(),
+                                 floats.size(), 1, decoded_floats.data()),
+                    encoded.size());
+  BOOST_CHECK_EQUAL(std::memcmp(floats.data(), decoded_floats.data(),
+                                floats.size() * sizeof(float)),
+                    0);
+  encoded.clear();
+  std::vector<float> constant(80, 0.5f);
+  EncodeFloats(constant.data(), constant.size(), 1, encoded);
+  BOOST_CHECK_EQUAL(encoded.size(), 4 + 10);
+  BOOST_CHECK_THROW(DecodeFloats(encoded.data(), 4, constant.size(), 1,
+                                 constant.data()),
+                    std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(testArchive) {
+  features::RootFeature root_feature;
+  std::stringstream archive;
+  std::string recorded_str, replayed_str;
+  auto writer =
+      std::unique_ptr<features::ArchiveWriter>(
+          new features::ArchiveWriter(root_feature, archive, 4));
+  PrintEvents print_recorded(root_feature, recorded_str);
+
+  myo::Myo* myos[2] = {reinterpret_cast<myo::Myo*>(&root_feature), nullptr};
+  for (int i = 0; i < 10; ++i) {
+    myo::Myo* myo = myos[i % 2];
+    uint64_t timestamp = 1000 * i;
+    int8_t emg[8] = {1, -1, 2, -2, 3, -3, static_cast<int8_t>(i),
+                     static_cast<int8_t>(-i)};
+    root_feature.onEmgData(myo, timestamp, emg);
+    if (i % 3 == 0) {
+      root_feature.onOrientationData(
+          myo, timestamp, myo::Quaternion<float>(0.f, 0.f, 0.5f * i, 1.f));
+      root_feature.onAccelerometerData(
+          myo, timestamp + 1, myo::Vector3<float>(0.1f * i, 0.f, -1.f));
+      root_feature.onGyroscopeData(myo, timestamp + 2,
+                                   myo::Vector3<float>(3.f, 2.f, i));
+    }
+    // Only the sensor streams are recorded.
+    root_feature.onPose(myo, timestamp + 3, myo::Pose::rest);
+  }
+  BOOST_CHECK_EQUAL(writer->samples(), 22);
+  writer.reset();
+
+  features::ArchiveReader reader(archive);
+  features::RootFeature replay_root_feature;
+  PrintEvents print_replayed(replay_root_feature, replayed_str);
+  BOOST_CHECK(reader.readSegment());
+  BOOST_CHECK_EQUAL(reader.segment().first_timestamp, 0);
+  BOOST_CHECK_EQUAL(reader.segment().last_timestamp, 6000);
+  const core::SensorArchive::Block& block = reader.segment().blocks[0];
+  BOOST_CHECK(block.stream == core::SensorArchive::Stream::emg);
+  BOOST_CHECK_EQUAL(block.size(), 4);
+  BOOST_CHECK_EQUAL(block.min[6], 0.f);
+  BOOST_CHECK_EQUAL(block.max[6], 6.f);
+  BOOST_CHECK_EQUAL(block.min[7], -6.f);
+  std::size_t num_samples = reader.replaySegment(replay_root_feature);
+  num_samples += reader.replay(replay_root_feature);
+  BOOST_CHECK_EQUAL(num_samples, 22);
+  BOOST_CHECK(!reader.readSegment());
+
+  // The recorded Myos are replaced with stand-ins.
+  std::string expected_str;
+  std::istringstream recorded_lines(recorded_str);
+  for (std::string line; std::getline(recorded_lines, line);) {
+    if (line.find("onPose") == std::string::npos) {
+      expected_str += line + "\n";
+    }
+  }
+  for (std::size_t i = 0; i < 2; ++i) {
+    std::ostringstream recorded_myo, replayed_myo;
+    recorded_myo << "myo: " << myos[i] << " ";
+    replayed_myo << "myo: " << reader.device(i) << " ";
+    for (std::size_t position = expected_str.find(recorded_myo.str());
+         position != std::string::npos;
+         position = expected_str.find(recorded_myo.str(), position + 1)) {
+      expected_str.replace(position, recorded_myo.str().size(),
+                           replayed_myo.str());
+    }
+  }
+  BOOST_CHECK_EQUAL(replayed_str, expected_str);
+
+  std::istringstream not_an_archive("MIQN\1\0\0\0");
+  BOOST_CHECK_THROW(features::ArchiveReader reader(not_an_archive),
+                    std::runtime_error);
+  std::istringstream truncated(archive.str().substr(0, 60));
+  features::ArchiveReader truncated_reader(truncated);
+  BOOST_CHECK_THROW(truncated_reader.readSegment(), std::runtime_error);
+
+  // A block count which doesn't fit the segment is rejected before the
+  // blocks are allocated.
+  std::string corrupt = archive.str();
+  const std::size_t segment_offset = corrupt.find("MISG");
+  const uint32_t num_blocks = 0xffffffff;
+  std::memcpy(&corrupt[segment_offset + 8], &num_blocks, sizeof(num_blocks));
+  std::istringstream corrupt_archive(corrupt);
+  features::ArchiveReader corrupt_reader(corrupt_archive);
+  BOOST_CHECK_THROW(corrupt_reader.readSegment(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(testArchiveSeek) {
+  using features::filters::ExponentialMovingAverage;
+  using features::filters::MovingAverage;
+  // Filters whose output depends on the samples before.
+  struct Tree {
+    explicit Tree(std::string& str)
+        : ema(root_feature, ExponentialMovingAverage::AccelerometerData, 0.5),
+          moving_average(ema, MovingAverage::GyroscopeData, 3),
+          print_events(moving_average, str) {}
+
+    features::RootFeature root_feature;
+    ExponentialMovingAverage ema;
+    MovingAverage moving_average;
+    PrintEvents print_events;
+  };
+  auto record = [](std::ostream& archive, bool snapshots) {
+    std::string str;
+    Tree tree(str);
+    features::ArchiveWriter writer(
+        tree.root_feature, archive, 8,
+        snapshots ? &tree.root_feature : nullptr, 2);
+    // The writer must receive the samples before the filters do.
+    tree.root_feature.removeChildFeature(&tree.ema);
+    tree.root_feature.addChildFeature(&tree.ema);
+    for (int i = 0; i < 100; ++i) {
+      tree.root_feature.onAccelerometerData(
+          nullptr, 10000 * i, myo::Vector3<float>(0.1f * i, i % 7, -1.f));
+      tree.root_feature.onGyroscopeData(
+          nullptr, 10000 * i + 5, myo::Vector3<float>(i % 5, 0.5f * i, 1.f));
+    }
+    BOOST_CHECK_EQUAL(writer.snapshots(), snapshots ? 6 : 0);
+  };
+  std::stringstream archive;
+  record(archive, true);
+
+  std::string full_str, seek_str;
+  Tree full_tree(full_str), seek_tree(seek_str);
+  features::ArchiveReader reader(archive);
+  BOOST_CHECK_EQUAL(reader.replay(full_tree.root_feature), 200);
+  // Playback resumes at the last snapshot before the time, with the state
+  // the filters had then.
+  uint64_t resume = reader.seek(555555, seek_tree.root_feature);
+  BOOST_CHECK_EQUAL(resume, 450000);
+  reader.replay(seek_tree.root_feature);
+  std::size_t position =
+      full_str.find(" timestamp: " + std::to_string(resume) + " ");
+  position = full_str.rfind('\n', position) + 1;
+  BOOST_CHECK_EQUAL(seek_str, full_str.substr(position));
+  BOOST_CHECK_EQUAL(reader.seek(0, seek_tree.root_feature), 0);
+  BOOST_CHECK_EQUAL(reader.replay(seek_tree.root_feature), 200);
+
+  // The snapshot must fit the tree it's loaded into.
+  features::RootFeature other_root_feature;
+  ExponentialMovingAverage other_ema(
+      other_root_feature, ExponentialMovingAverage::AccelerometerData, 0.5);
+  BOOST_CHECK_THROW(reader.seek(555555, other_root_feature),
+                    std::runtime_error);
+
+  // An index whose counts don't match its size is rejected before the
+  // entries are allocated.
+  std::string corrupt = archive.str();
+  uint64_t index_offset;
+  std::memcpy(&index_offset, &corrupt[corrupt.size() - 8],
+              sizeof(index_offset));
+  const uint32_t num_segments = 0xffffffff;
+  std::memcpy(&corrupt[index_offset + 8], &num_segments, sizeof(num_segments));
+  std::istringstream corrupt_archive(corrupt);
+  features::ArchiveReader corrupt_reader(corrupt_archive);
+  BOOST_CHECK_THROW(corrupt_reader.seek(555555, seek_tree.root_feature),
+                    std::runtime_error);
+
+  // Archives which weren't finished are indexed by scanning them.
+  std::istringstream unfinished(
+      archive.str().substr(0, archive.str().size() - 20));
+  features::ArchiveReader unfinished_reader(unfinished);
+  BOOST_CHECK_EQUAL(unfinished_reader.seek(555555, seek_tree.root_feature),
+                    450000);
+
+  // Without snapshots, playback resumes at a segment with cold state.
+  std::stringstream cold_archive;
+  record(cold_archive, false);
+  features::ArchiveReader cold_reader(cold_archive);
+  BOOST_CHECK_EQUAL(cold_reader.seek(555555, seek_tree.root_feature), 520005);
+  BOOST_CHECK_EQUAL(cold_reader.replay(seek_tree.root_feature), 95);
+
+  // Gestures in progress continue after loading.
+  using features::gestures::PoseGestures;
+  features::RootFeature pose_root_feature, loaded_root_feature;
+  PoseGestures pose_gestures(pose_root_feature, 200, 300);
+  PoseGestures loaded_pose_gestures(loaded_root_feature, 200, 300);
+  std::string loaded_str;
+  PrintEvents print_loaded(loaded_pose_gestures, loaded_str);
+  pose_root_feature.onPose(nullptr, 0, myo::Pose::fist);
+  pose_root_feature.onPose(nullptr, 100000, myo::Pose::rest);
+  core::FeatureState snapshot;
+  pose_root_feature.saveTreeState(snapshot);
+  loaded_root_feature.loadTreeState(snapshot);
+  loaded_root_feature.onPose(nullptr, 200000, myo::Pose::fist);
+  loaded_root_feature.onPose(nullptr, 300000, myo::Pose::rest);
+  BOOST_CHECK_NE(loaded_str.find("doubleClick"), std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(testFeatureStates) {
+  using features::filters::Decimate;
+  using features::filters::Resample;
+  // The features which keep the samples before.
+  struct Tree {
+    explicit Tree(std::string& str)
+        : resample(root_feature,
+                   Resample::AccelerometerData | Resample::EmgData, 2, 3),
+          decimate(resample, Decimate::GyroscopeData, 2),
+          imu_fusion(decimate),
+          emg_features(imu_fusion, 8, 4),
+          emg_spectrogram(emg_features, 16, 4),
+          fusion_frame(emg_spectrogram),
+          print_events(fusion_frame, str) {}
+
+    features::RootFeature root_feature;
+    Resample resample;
+    Decimate decimate;
+    features::ImuFusion imu_fusion;
+    features::EmgFeatures emg_features;
+    features::EmgSpectrogram emg_spectrogram;
+    features::FusionFrame fusion_frame;
+    PrintEvents print_events;
+  };
+  auto play = [](Tree& tree, int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      const uint64_t timestamp = 5000 * i;
+      if (i % 4 == 0) {
+        float j = 0.01f * i;
+        tree.root_feature.onOrientationData(
+            nullptr, timestamp, myo::Quaternion<float>(j, 0.f, 0.f, 1.f));
+        tree.root_feature.onAccelerometerData(
+            nullptr, timestamp, myo::Vector3<float>(j, i % 3, 1.f));
+        tree.root_feature.onGyroscopeData(
+            nullptr, timestamp, myo::Vector3<float>(i % 5, -j, 10.f));
+      }
+      int8_t emg[8];
+      for (int c = 0; c < 8; ++c) {
+        emg[c] = static_cast<int8_t>((i * (c + 3)) % 51 - 25);
+      }
+      tree.root_feature.onEmgData(nullptr, timestamp, emg);
+    }
+  };
+
+  // A tree with the state of another continues like the other.
+  std::string str, loaded_str;
+  Tree tree(str), loaded_tree(loaded_str);
+  play(tree, 0, 101);
+  core::FeatureState snapshot;
+  tree.root_feature.saveTreeState(snapshot);
+  loaded_tree.root_feature.loadTreeState(snapshot);
+  str.clear();
+  play(tree, 101, 200);
+  play(loaded_tree, 101, 200);
+  BOOST_CHECK_NE(str.find("onEmgSpectrum"), std::string::npos);
+  BOOST_CHECK_EQUAL(loaded_str, str);
+
+  // The state only fits a feature with the same parameters.
+  core::FeatureState state;
+  tree.resample.saveState(state);
+  features::RootFeature other_root_feature;
+  Resample other_resample(other_root_feature,
+                          Resample::AccelerometerData | Resample::EmgData, 3,
+                          2);
+  BOOST_CHECK_THROW(other_resample.loadState(state), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(testWorkStealingPool) {
+  core::WorkStealingPool pool(2);
+  BOOST_CHECK_EQUAL(pool.numThreads(), 2);
+  std::atomic<int> sum(0);
+  for (int i = 1; i <= 100; ++i) {
+    pool.submit([&pool, &sum, i]() {
+      sum += i;
+      // Tasks can submit more tasks, which wait waits for as well.
+      pool.submit([&sum]() { sum += 1000; });
+    });
+  }
+  pool.wait();
+  BOOST_CHECK_EQUAL(sum, 5050 + 100000);
+
+  // Tasks submitted by a task go to its own thread, and are stolen by the
+  // other one while it's busy.
+  std::atomic<int> done(0);
+  const uint64_t stolen = pool.stolen();
+  pool.submit([&pool, &done]() {
+    for (int i = 0; i < 10; ++i) {
+      pool.submit([&done]() { ++done; });
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (done < 10 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::yield();
+    }
+  });
+  pool.wait();
+  BOOST_CHECK_EQUAL(done, 10);
+  BOOST_CHECK_GE(pool.stolen() - stolen, 10);
+
+  // Tasks submitted from outside run in order, and the tasks a task submits
+  // run right after it, newest first.
+  core::WorkStealingPool one_thread_pool(1);
+  std::vector<int> order;
+  std::atomic<bool> submitted(false);
+  one_thread_pool.submit([&submitted]() {
+    while (!submitted) {
+      std::this_thread::yield();
+    }
+  });
+  for (int i = 0; i < 3; ++i) {
+    one_thread_pool.submit([&one_thread_pool, &order, i]() {
+      order.push_back(i);
+      if (i == 0) {
+        one_thread_pool.submit([&order]() { order.push_back(10); });
+        one_thread_pool.submit([&order]() { order.push_back(11); });
+      }
+    });
+  }
+  submitted = true;
+  one_thread_pool.wait();
+  const std::vector<int> expected_order = {0, 11, 10, 1, 2};
+  BOOST_CHECK_EQUAL_COLLECTIONS(order.begin(), order.end(),
+                                expected_order.begin(), expected_order.end());
+
+  // The first exception is rethrown by wait, and the pool keeps working.
+  pool.submit([]() { throw std::runtime_error("task failed"); });
+  pool.submit([&sum]() { sum = 0; });
+  BOOST_CHECK_THROW(pool.wait(), std::runtime_error);
+  BOOST_CHECK_EQUAL(sum, 0);
+  pool.submit([&sum]() { sum = 1; });
+  pool.wait();
+  BOOST_CHECK_EQUAL(sum, 1);
+}
+
+BOOST_AUTO_TEST_CASE(testGestureEvaluation) {
+  std::istringstream labels_file(
+      "# timestamp,gesture\n1000000,doubleClick: fist\n\n"
+      "2000000,singleClick: fist\r\n3000000,doubleClick: fist\n");
+  std::vector<core::GestureEvaluation::Event> labels =
+      core::GestureEvaluation::ReadLabels(labels_file);
+  BOOST_REQUIRE_EQUAL(labels.size(), 3);
+  BOOST_CHECK_EQUAL(labels[1].timestamp, 2000000);
+  BOOST_CHECK_EQUAL(labels[1].gesture, "singleClick: fist");
+  for (const std::string invalid : {"abc,hold", "1000", "1000,"}) {
+    std::istringstream invalid_file(invalid);
+    BOOST_CHECK_THROW(core::GestureEvaluation::ReadLabels(invalid_file),
+                      std::runtime_error);
+  }
+
+  // The first double click is detected late, the single click early, the
+  // second double click too late to match, and the double click of another
+  // pose was never labelled.
+  std::vector<core::GestureEvaluation::Event> detections = {
+      {5000000, "doubleClick: fist"},
+      {1150000, "doubleClick: fist"},
+      {1950000, "singleClick: fist"},
+      {4000000, "doubleClick: waveIn"}};
+  std::map<std::string, core::GestureEvaluation::Result> results =
+      core::GestureEvaluation::Match(labels, detections, 100000, 1000000);
+  BOOST_REQUIRE_EQUAL(results.size(), 3);
+  const core::GestureEvaluation::Result& double_click =
+      results["doubleClick: fist"];
+  BOOST_CHECK_EQUAL(double_click.true_positives, 1);
+  BOOST_CHECK_EQUAL(double_click.false_positives, 1);
+  BOOST_CHECK_EQUAL(double_click.false_negatives, 1);
+  BOOST_REQUIRE_EQUAL(double_click.latencies.size(), 1);
+  BOOST_CHECK_EQUAL(double_click.latencies[0], 150000);
+  BOOST_CHECK_EQUAL(results["singleClick: fist"].latencies[0], -50000);
+  BOOST_CHECK_EQUAL(results["doubleClick: waveIn"].false_positives, 1);
+
+  core::GestureEvaluation::Result total =
+      core::GestureEvaluation::Total(results);
+  BOOST_CHECK_EQUAL(total.true_positives, 2);
+  BOOST_CHECK_EQUAL(total.false_positives, 2);
+  BOOST_CHECK_EQUAL(total.false_negatives, 1);
+  BOOST_CHECK_CLOSE(total.precision(), 0.5, 1e-9);
+  BOOST_CHECK_CLOSE(total.recall(), 2.0 / 3, 1e-9);
+  BOOST_CHECK_CLOSE(total.f1(), 4.0 / 7, 1e-9);
+  BOOST_CHECK_EQUAL(total.latencyPercentile(0.5), -50000);
+  BOOST_CHECK_EQUAL(total.latencyPercentile(1), 150000);
+
+  // A detection matches at most one label, even if it's within the windows
+  // of several.
+  std::vector<core::GestureEvaluation::Event> close_labels = {
+      {1000000, "hold"}, {1200000, "hold"}};
+  std::vector<core::GestureEvaluation::Event> one_detection = {
+      {1300000, "hold"}};
+  core::GestureEvaluation::Result hold = core::GestureEvaluation::Total(
+      core::GestureEvaluation::Match(close_labels, one_detection, 100000,
+                                     1000000));
+  BOOST_CHECK_EQUAL(hold.true_positives, 1);
+  BOOST_CHECK_EQUAL(hold.false_negatives, 1);
+  BOOST_CHECK_EQUAL(hold.false_positives, 0);
+
+  core::GestureEvaluation::Result none;
+  BOOST_CHECK_EQUAL(none.precision(), 1);
+  BOOST_CHECK_EQUAL(none.recall(), 1);
+  BOOST_CHECK_EQUAL(none.latencyPercentile(0.5), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testSlidingWindow) {
+  core::SlidingWindow<int> window(3, 2);
+  for (int i = 1; i <= 5; ++i) {
+    BOOST_CHECK_EQUAL(window.full(), i > 3);
+    const int sample[] = {i, -i};
+    window.push(sample);
+  }
+  // The window holds the last three samples, oldest first, contiguously.
+  const std::vector<int> expected = {3, -3, 4, -4, 5, -5};
+  BOOST_CHECK_EQUAL_COLLECTIONS(window.data(), window.data() + 6,
+                                expected.begin(), expected.end());
+  window.clear();
+  BOOST_CHECK(!window.full());
+
+  BOOST_CHECK_THROW(core::SlidingWindow<int>(0, 2), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testFeatureGraph) {
+  using features::FeatureGraph;
+  const std::string all_but_data =
+      "Pair|Unpair|Connect|Disconnect|ArmSync|ArmUnsync|Unlock|Lock|Pose|"
+      "Gesture";
+  const std::string data =
+      "OrientationData|AccelerometerData|GyroscopeData|Rssi|EmgData|Periodic|"
+      "EmgFeatures|EmgSpectrum|SensorFrame|SpeculativeGesture";
+  std::istringstream config(
+      "{\"features\": ["
+      "  {\"type\": \"Group\", \"children\": ["
+      "    {\"type\": \"ExponentialMovingAverage\","
+      "     \"flags\": \"AccelerometerData\", \"alpha\": 0.5, \"children\": ["
+      "      {\"type\": \"ExponentialMovingAverage\","
+      "       \"flags\": \"AccelerometerData|GyroscopeData\", \"alpha\": 0.25,"
+      "       \"children\": ["
+      "        {\"type\": \"Blocker\", \"events\": \"Rssi\", \"children\": ["
+      "          {\"type\": \"Print\"}]}]}]}]},"
+      "  {\"type\": \"Blocker\", \"events\": \"" + all_but_data + "\","
+      "   \"children\": ["
+      "    {\"type\": \"Blocker\", \"events\": \"" + data + "\","
+      "     \"children\": ["
+      "      {\"type\": \"Print\"},"
+      "      {\"type\": \"Orientation\", \"name\": \"orientation\"}]}]},"
+      "  {\"type\": \"Debounce\", \"name\": \"debounce\"},"
+      "  {\"type\": \"MovingAverage\", \"flags\": \"OrientationData\","
+      "   \"window_size\": 3}]}");
+  const std::vector<FeatureGraph::Node> nodes = FeatureGraph::ParseJson(config);
+  BOOST_CHECK_EQUAL(nodes.size(), 4);
+
+  std::string strs[2];
+  features::RootFeature root_features[2];
+  FeatureGraph graphs[2];
+  for (int optimize = 0; optimize < 2; ++optimize) {
+    std::string& str = strs[optimize];
+    graphs[optimize].registerType(
+        "Print", [&str](core::DeviceListenerWrapper& parent_feature,
+                        const FeatureGraph::Node&, FeatureGraph&) {
+          return std::unique_ptr<core::DeviceListenerWrapper>(
+              new PrintEvents(parent_feature, str));
+        });
+    graphs[optimize].build(root_features[optimize], nodes, optimize == 1);
+  }
+  BOOST_CHECK_EQUAL(graphs[0].numFeatures(), 11);
+  BOOST_CHECK_EQUAL(graphs[1].numFeatures(), 6);
+  BOOST_CHECK_EQUAL(graphs[1].statistics().fused, 1);
+  BOOST_CHECK_EQUAL(graphs[1].statistics().collapsed, 1);
+  BOOST_CHECK_EQUAL(graphs[1].statistics().dropped, 5);
+  const std::vector<FeatureGraph::Node> optimized = graphs[1].optimize(nodes);
+  BOOST_REQUIRE_EQUAL(optimized.size(), 3);
+  BOOST_CHECK_EQUAL(optimized[0].type, "CascadedExponentialMovingAverage");
+  BOOST_CHECK_EQUAL(optimized[1].type, "Detached");
+  BOOST_CHECK_EQUAL(optimized[2].name, "debounce");
+  graphs[1].get<features::Orientation>("orientation");
+  graphs[1].get<features::filters::Debounce>("debounce");
+  BOOST_CHECK_THROW(graphs[1].get<features::Orientation>("debounce"),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(graphs[1].get("missing"), std::invalid_argument);
+
+  // Both trees see the same events.
+  for (int optimize = 0; optimize < 2; ++optimize) {
+    features::RootFeature& root_feature = root_features[optimize];
+    for (int i = 0; i < 3; ++i) {
+      float j = static_cast<float>(i * i);
+      root_feature.onOrientationData(nullptr, 3 * i,
+                                     myo::Quaternion<float>(j, j, j, j));
+      root_feature.onAccelerometerData(nullptr, 3 * i + 1,
+                                       myo::Vector3<float>(j, j, j));
+      root_feature.onGyroscopeData(nullptr, 3 * i + 2,
+                                   myo::Vector3<float>(j, -j, j));
+    }
+    root_feature.onRssi(nullptr, 10, -50);
+    root_feature.onPose(nullptr, 11, myo::Pose::fist);
+  }
+  BOOST_CHECK(!strs[0].empty());
+  BOOST_CHECK_EQUAL(strs[0], strs[1]);
+
+  FeatureGraph graph;
+  features::RootFeature root_feature;
+  auto node = [](const std::string& json) {
+    std::istringstream in("{\"features\": [" + json + "]}");
+    return FeatureGraph::ParseJson(in);
+  };
+  BOOST_CHECK_THROW(graph.build(root_feature, node("{\"type\": \"Unknown\"}")),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(
+      graph.build(root_feature,
+                  node("{\"type\": \"Blocker\", \"events\": \"Pose|Typo\"}")),
+      std::invalid_argument);
+  BOOST_CHECK_THROW(
+      graph.build(root_feature,
+                  node("{\"type\": \"ExponentialMovingAverage\", "
+                       "\"flags\": \"GyroscopeData\", \"name\": \"ema\"}")),
+      std::invalid_argument);
+  BOOST_CHECK_THROW(
+      graph.build(root_feature, node("{\"type\": \"Group\", \"name\": \"a\"},"
+                                     "{\"type\": \"Group\", \"name\": \"a\"}")),
+      std::invalid_argument);
+  // Nobody could dispatch the events of an unnamed Coalesce without a thread.
+  BOOST_CHECK_THROW(
+      graph.build(root_feature, node("{\"type\": \"Coalesce\"}"), false),
+      std::invalid_argument);
+  // Errors of the features' constructors name the type.
+  try {
+    graph.build(root_feature,
+                node("{\"type\": \"Debounce\", \"name\": \"d\"},"
+                     "{\"type\": \"Coalesce\", \"events\": \"Pose\","
+                     " \"name\": \"c\"}"));
+    BOOST_ERROR("Coalescing poses must throw.");
+  } catch (const std::invalid_argument& e) {
+    BOOST_CHECK_EQUAL(std::string(e.what()).find("Invalid parameters of "
+                                                 "Coalesce: "),
+                      0);
+  }
+  BOOST_CHECK_THROW(graph.get("a"), std::invalid_argument);
+  BOOST_CHECK_EQUAL(graph.numFeatures(), 0);
+  BOOST_CHECK_THROW(node("{\"name\": \"a\"}"), std::invalid_argument);
+  BOOST_CHECK_THROW(node("{"), std::invalid_argument);
+
+  // A failed build leaves nothing attached to the parent feature.
+  std::string str;
+  graph.registerType(
+      "Print", [&str](core::DeviceListenerWrapper& parent_feature,
+                      const FeatureGraph::Node&, FeatureGraph&) {
+        return std::unique_ptr<core::DeviceListenerWrapper>(
+            new PrintEvents(parent_feature, str));
+      });
+  BOOST_CHECK_THROW(
+      graph.build(root_feature,
+                  node("{\"type\": \"Blocker\", \"events\": \"Pose\","
+                       " \"children\": [{\"type\": \"Print\"}]},"
+                       "{\"type\": \"Print\", \"name\": \"print\"},"
+                       "{\"type\": \"Unknown\"}")),
+      std::invalid_argument);
+  root_feature.onLock(nullptr, 0);
+  BOOST_CHECK_EQUAL(str, "");
+  BOOST_CHECK_THROW(graph.get("print"), std::invalid_argument);
+  BOOST_CHECK_EQUAL(graph.numFeatures(), 0);
+
+  // Events which a Blocker above a Group blocks don't reach the Group's
+  // children either.
+  FeatureGraph::Statistics statistics;
+  std::vector<FeatureGraph::Node> unreachable = graph.optimize(
+      node("{\"type\": \"Blocker\", \"events\": \"" + data + "\","
+           " \"children\": [{\"type\": \"Group\", \"children\": ["
+           "  {\"type\": \"Blocker\", \"events\": \"" + all_but_data +
+           "\", \"children\": [{\"type\": \"Print\"}]}]}]}"),
+      &statistics);
+  BOOST_CHECK(unreachable.empty());
+  BOOST_CHECK_EQUAL(statistics.dropped, 4);
+}
+
 BOOST_AUTO_TEST_CASE(testDebounce) {
   for (int debounce_ms : {5, 10, 100}) {
     auto test_debounce = [debounce_ms](int timestamp_offset) {
@@ -86,12 +1888,31 @@ BOOST_AUTO_TEST_CASE(testDebounce) {
       return str;
     };
 
+    // The pose is stamped with the time at which the delay passed.
+    const std::string expected =
+        "onPose - myo: 00000000 timestamp: " +
+        std::to_string(1 + debounce_ms * 1000) +
+        " pose->toString(): fist\n";
     std::string result;
     result = test_debounce(debounce_ms * 1000 + 1);
-    BOOST_CHECK_EQUAL(result, "onPose - myo: 00000000 timestamp: 1 pose->toString(): fist\n");
+    BOOST_CHECK_EQUAL(result, expected);
 
     result = test_debounce(debounce_ms * 1000 - 1);
     BOOST_CHECK_EQUAL(result, "");
+
+    // Sensor data passes the delay without another pose, e.g. when playing
+    // back a recording.
+    features::RootFeature root_feature;
+    features::filters::Debounce debounce(root_feature, debounce_ms);
+    std::string str;
+    PrintEvents print_events(debounce, str);
+    debounce.onPose(nullptr, 1, std::make_shared<core::Pose>(myo::Pose::fist));
+    debounce.onAccelerometerData(nullptr, debounce_ms * 1000,
+                                 myo::Vector3<float>());
+    BOOST_CHECK_EQUAL(str.find("onPose"), std::string::npos);
+    debounce.onAccelerometerData(nullptr, debounce_ms * 1000 + 2,
+                                 myo::Vector3<float>());
+    BOOST_CHECK_NE(str.find(expected), std::string::npos);
   }
 }
 
@@ -208,4 +2029,308 @@ BOOST_AUTO_TEST_CASE(testMovingAverage) {
 
     BOOST_CHECK_EQUAL(str, window_size.second);
   }
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE(testEmgFeatures) {
+  features::RootFeature root_feature;
+  features::EmgFeatures emg_features(root_feature, 4, 2);
+  std::string str;
+  PrintEvents print_events(emg_features, str);
+
+  // Channel i alternates between i and -i.
+  for (int timestamp = 0; timestamp < 6; ++timestamp) {
+    std::array<int8_t, 8> emg_data;
+    for (int i = 0; i < 8; ++i) {
+      emg_data[i] = timestamp % 2 ? -i : i;
+    }
+    emg_features.onEmgData(nullptr, timestamp, emg_data.data());
+  }
+
+  std::istringstream lines(str);
+  std::string line, result;
+  while (std::getline(lines, line)) {
+    if (line.find("onEmgFeatures") == 0) {
+      result += line + "\n";
+    }
+  }
+  BOOST_CHECK_EQUAL(result,
+      "onEmgFeatures - myo: 00000000 timestamp: 3"
+      " rms: (0, 1, 2, 3, 4, 5, 6, 7)"
+      " meanAbsoluteValue: (0, 1, 2, 3, 4, 5, 6, 7)"
+      " waveformLength: (0, 6, 12, 18, 24, 30, 36, 42)"
+      " zeroCrossings: (0, 3, 3, 3, 3, 3, 3, 3)"
+      " slopeSignChanges: (0, 2, 2, 2, 2, 2, 2, 2)\n"
+      "onEmgFeatures - myo: 00000000 timestamp: 5"
+      " rms: (0, 1, 2, 3, 4, 5, 6, 7)"
+      " meanAbsoluteValue: (0, 1, 2, 3, 4, 5, 6, 7)"
+      " waveformLength: (0, 8, 16, 24, 32, 40, 48, 56)"
+      " zeroCrossings: (0, 4, 4, 4, 4, 4, 4, 4)"
+      " slopeSignChanges: (0, 4, 4, 4, 4, 4, 4, 4)\n");
+
+  BOOST_CHECK_THROW(features::EmgFeatures(root_feature, 0, 2),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(features::EmgFeatures(root_feature, 4, 0),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(features::EmgFeatures(root_feature, -4, 2),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testEmgSpectrogram) {
+  features::RootFeature root_feature;
+  features::EmgSpectrogram spectrogram(root_feature, 64, 16, 200.f);
+  std::string str;
+  PrintEvents print_events(spectrogram, str);
+
+  // 25 Hz on even channels and 50 Hz on odd channels, which are exactly on a
+  // bin with 64 samples at 200 Hz.
+  for (int timestamp = 0; timestamp < 80; ++timestamp) {
+    std::array<int8_t, 8> emg_data;
+    for (int i = 0; i < 8; ++i) {
+      float frequency = i % 2 ? 50.f : 25.f;
+      emg_data[i] = static_cast<int8_t>(
+          100 * std::sin(2 * M_PI * frequency * timestamp / 200.f));
+    }
+    spectrogram.onEmgData(nullptr, timestamp, emg_data.data());
+  }
+
+  std::istringstream lines(str);
+  std::string line, result;
+  while (std::getline(lines, line)) {
+    if (line.find("onEmgSpectrum") == 0) {
+      result += line + "\n";
+    }
+  }
+  BOOST_CHECK_EQUAL(result,
+      "onEmgSpectrum - myo: 00000000 timestamp: 63"
+      " medianFrequency: (25, 50, 25, 50, 25, 50, 25, 50)\n"
+      "onEmgSpectrum - myo: 00000000 timestamp: 79"
+      " medianFrequency: (25, 50, 25, 50, 25, 50, 25, 50)\n");
+
+  const core::EmgSpectrum& spectrum = spectrogram.getSpectrum();
+  for (std::size_t i = 0; i < 8; ++i) {
+    float frequency = i % 2 ? 50.f : 25.f;
+    BOOST_CHECK_CLOSE(spectrum.meanFrequency()[i], frequency, 1.f);
+    // The Hann window leaks into the neighbouring bins, so the 50 Hz tone is
+    // split between the bands on either side of the 50 Hz band edge.
+    float band_power = i % 2
+        ? spectrum.bandPower(1)[i] + spectrum.bandPower(2)[i]
+        : spectrum.bandPower(0)[i];
+    BOOST_CHECK_CLOSE(band_power, spectrum.totalPower()[i], 1.f);
+  }
+
+  // The sizes are checked before anything is allocated.
+  BOOST_CHECK_THROW(features::EmgSpectrogram(root_feature, -64, 16),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(features::EmgSpectrogram(root_feature, 48, 16),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(features::EmgSpectrogram(root_feature, 64, 0),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(features::EmgSpectrogram(root_feature, 64, -16),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(core::FastFourierTransform(0), std::invalid_argument);
+  BOOST_CHECK_THROW(core::FastFourierTransform(std::size_t(-64)),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testResample) {
+  using features::filters::Resample;
+  // Maps interpolation / decimation to the number of expected output samples.
+  std::map<std::pair<int, int>, std::size_t> expected_results;
+  expected_results[std::make_pair(1, 1)] = 24;
+  expected_results[std::make_pair(1, 4)] = 6;
+  expected_results[std::make_pair(2, 3)] = 16;
+  expected_results[std::make_pair(3, 2)] = 36;
+
+  for (const auto& factors : expected_results) {
+    features::RootFeature root_feature;
+    Resample resample(root_feature, Resample::AccelerometerData,
+                      factors.first.first, factors.first.second, 4);
+    std::string str;
+    PrintEvents print_events(resample, str);
+
+    for (uint64_t timestamp = 0; timestamp < 24; ++timestamp) {
+      resample.onAccelerometerData(nullptr, timestamp,
+                                   myo::Vector3<float>(1.f, 2.f, -4.f));
+      resample.onGyroscopeData(nullptr, timestamp,
+                               myo::Vector3<float>(1.f, 2.f, -4.f));
+    }
+
+    std::istringstream lines(str);
+    std::string line, last_accel;
+    std::size_t num_accel = 0, num_gyro = 0;
+    while (std::getline(lines, line)) {
+      if (line.find("onAccelerometerData") == 0) {
+        ++num_accel;
+        last_accel = line;
+      } else if (line.find("onGyroscopeData") == 0) {
+        ++num_gyro;
+      }
+    }
+    BOOST_CHECK_EQUAL(num_accel, factors.second);
+    // Unselected streams are not resampled.
+    BOOST_CHECK_EQUAL(num_gyro, 24);
+    // Once the filter is filled a constant input is passed on unchanged.
+    BOOST_CHECK_EQUAL(last_accel.substr(last_accel.find("accel")),
+                      "accel: (1, 2, -4)");
+  }
+
+  // Orientations whose sign flips are the same rotation, and come out as a
+  // unit quaternion of it.
+  {
+    features::RootFeature root_feature;
+    Resample resample(root_feature, Resample::OrientationData, 1, 2, 4);
+    std::string str;
+    PrintEvents print_events(resample, str);
+    for (uint64_t timestamp = 0; timestamp < 16; ++timestamp) {
+      float sign = timestamp % 3 == 0 ? -1.f : 1.f;
+      resample.onOrientationData(
+          nullptr, timestamp,
+          myo::Quaternion<float>(0.f, sign * 0.6f, 0.f, sign * 0.8f));
+    }
+    std::istringstream lines(str);
+    std::string line;
+    std::size_t num_rotations = 0;
+    while (std::getline(lines, line)) {
+      std::string rotation = line.substr(line.find("rotation"));
+      BOOST_CHECK(rotation == "rotation: (0, 0.6, 0, 0.8)" ||
+                  rotation == "rotation: (0, -0.6, 0, -0.8)");
+      ++num_rotations;
+    }
+    BOOST_CHECK_EQUAL(num_rotations, 8);
+  }
+
+  features::RootFeature root_feature;
+  BOOST_CHECK_THROW(Resample(root_feature, Resample::EmgData, 0, 1),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(Resample(root_feature, Resample::EmgData, 1, 0),
+                    std::invalid_argument);
+  BOOST_CHECK_THROW(Resample(root_feature, Resample::EmgData, 1, 1, -1),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testDecimate) {
+  using features::filters::Decimate;
+  features::RootFeature root_feature;
+  Decimate decimate(root_feature, Decimate::EmgData, 4);
+  std::string str;
+  PrintEvents print_events(decimate, str);
+
+  std::array<int8_t, 8> emg_data = {0, 1, -2, 3, -4, 50, -60, 127};
+  for (uint64_t timestamp = 0; timestamp < 64; ++timestamp) {
+    decimate.onEmgData(nullptr, timestamp, emg_data.data());
+  }
+  BOOST_CHECK_EQUAL(str.substr(str.rfind("onEmgData")),
+      "onEmgData - myo: 00000000 timestamp: 60 "
+      "emg: (0, 1, -2, 3, -4, 50, -60, 127)\n");
+
+  BOOST_CHECK_THROW(Decimate(root_feature, Decimate::EmgData, 0),
+                    std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(testFusionFrame) {
+  using features::FusionFrame;
+  std::map<FusionFrame::Alignment, std::string> expected_results;
+  expected_results[FusionFrame::Alignment::hold] =
+      "onSensorFrame - myo: 00000000 timestamp: 0 rotation: (0, 0, 0, 1) accel: (0, 0, 0) gyro: (0, 0, 0) emg: (0, 0, 0, 0, 0, 0, 0, 0)\n"
+      "onSensorFrame - myo: 00000000 timestamp: 5000 rotation: (0, 0, 0, 1) accel: (0, 0, 0) gyro: (0, 0, 0) emg: (1, 1, 1, 1, 1, 1, 1, 1)\n"
+      "onSensorFrame - myo: 00000000 timestamp: 10000 rotation: (0, 0, 0, 1) accel: (0, 0, 0) gyro: (0, 0, 0) emg: (2, 2, 2, 2, 2, 2, 2, 2)\n"
+      "onSensorFrame - myo: 00000000 timestamp: 15000 rotation: (0, 0, 0, 1) accel: (0, 0, 0) gyro: (0, 0, 0) emg: (3, 3, 3, 3, 3, 3, 3, 3)\n"
+      "onSensorFrame - myo: 00000000 timestamp: 20000 rotation: (0, 0, 0, 1) accel: (4, 8, 0) gyro: (0, 0, 4) emg: (4, 4, 4, 4, 4, 4, 4, 4)\n";
+  expected_results[FusionFrame::Alignment::interpolate] =
+      "onSensorFrame - myo: 00000000 timestamp: 0 rotation: (0, 0, 0, 1) accel: (0, 0, 0) gyro: (0, 0, 0) emg: (0, 0, 0, 0, 0, 0, 0, 0)\n"
+      "onSensorFrame - myo: 00000000 timestamp: 5000 rotation: (0, 0, 0, 1) accel: (1, 2, 0) gyro: (0, 0, 1) emg: (1, 1, 1, 1, 1, 1, 1, 1)\n"
+      "onSensorFrame - myo: 00000000 timestamp: 10000 rotation: (0, 0, 0, 1) accel: (2, 4, 0) gyro: (0, 0, 2) emg: (2, 2, 2, 2, 2, 2, 2, 2)\n"
+      "onSensorFrame - myo: 00000000 timestamp: 15000 rotation: (0, 0, 0, 1) accel: (3, 6, 0) gyro: (0, 0, 3) emg: (3, 3, 3, 3, 3, 3, 3, 3)\n"
+      "onSensorFrame - myo: 00000000 timestamp: 20000 rotation: (0, 0, 0, 1) accel: (4, 8, 0) gyro: (0, 0, 4) emg: (4, 4, 4, 4, 4, 4, 4, 4)\n";
+
+  for (const auto& alignment : expected_results) {
+    features::RootFeature root_feature;
+    FusionFrame fusion_frame(root_feature, FusionFrame::Rate::emg,
+                             alignment.first);
+    std::string str;
+    PrintEvents print_events(fusion_frame, str);
+
+    auto imu_data = [&](uint64_t timestamp, float value) {
+      fusion_frame.onOrientationData(nullptr, timestamp,
+                                     myo::Quaternion<float>(0, 0, 0, 1));
+      fusion_frame.onAccelerometerData(
+          nullptr, timestamp, myo::Vector3<float>(value, 2 * value, 0));
+      fusion_frame.onGyroscopeData(nullptr, timestamp,
+                                   myo::Vector3<float>(0, 0, value));
+    };
+    auto emg_data = [&](uint64_t timestamp, int8_t value) {
+      std::array<int8_t, 8> emg;
+      emg.fill(value);
+      fusion_frame.onEmgData(nullptr, timestamp, emg.data());
+    };
+    imu_data(0, 0.f);
+    emg_data(0, 0);
+    emg_data(5000, 1);
+    emg_data(10000, 2);
+    emg_data(15000, 3);
+    imu_data(20000, 4.f);
+    emg_data(20000, 4);
+
+    std::istringstream lines(str);
+    std::string line, result;
+    while (std::getline(lines, line)) {
+      if (line.find("onSensorFrame") == 0) {
+        result += line + "\n";
+      }
+    }
+    BOOST_CHECK_EQUAL(result, alignment.second);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testImuFusion) {
+  features::RootFeature root_feature;
+  features::ImuFusion imu_fusion(root_feature, 0.f);
+  std::string str;
+  PrintEvents print_events(imu_fusion, str);
+
+  // Rotating at 90 degrees per second about z for one second without
+  // accelerometer correction results in a yaw of 90 degrees.
+  imu_fusion.onOrientationData(nullptr, 0, myo::Quaternion<float>());
+  for (uint64_t timestamp = 0; timestamp <= 1000000; timestamp += 20000) {
+    imu_fusion.onAccelerometerData(nullptr, timestamp,
+                                   myo::Vector3<float>(0.f, 0.f, 1.f));
+    imu_fusion.onGyroscopeData(nullptr, timestamp,
+                               myo::Vector3<float>(0.f, 0.f, 90.f));
+  }
+  BOOST_CHECK_CLOSE(
+      core::OrientationUtility::QuaternionToYaw(imu_fusion.getRotation()),
+      M_PI / 2, 0.1);
+  BOOST_CHECK_SMALL(
+      core::OrientationUtility::QuaternionToRoll(imu_fusion.getRotation()),
+      1e-4f);
+  // One orientation per update, the Myo's own orientation is blocked.
+  std::size_t num_orientations = 0;
+  for (std::size_t i = str.find("onOrientationData"); i != std::string::npos;
+       i = str.find("onOrientationData", i + 1)) {
+    ++num_orientations;
+  }
+  BOOST_CHECK_EQUAL(num_orientations, 51);
+
+  // With accelerometer correction the estimate converges to the measured
+  // direction of gravity, here a 90 degree pitch.
+  features::ImuFusion corrected(root_feature, 0.5f);
+  for (uint64_t timestamp = 0; timestamp <= 20000000; timestamp += 20000) {
+    corrected.onAccelerometerData(nullptr, timestamp,
+                                  myo::Vector3<float>(-1.f, 0.f, 0.f));
+    corrected.onGyroscopeData(nullptr, timestamp, myo::Vector3<float>());
+  }
+  BOOST_CHECK_CLOSE(
+      core::OrientationUtility::QuaternionToPitch(corrected.getRotation()),
+      M_PI / 2, 1);
+
+  // In free fall there's no direction of gravity to correct towards, so only
+  // the gyroscope is integrated, as without correction.
+  features::ImuFusion free_fall(root_feature, 0.5f);
+  for (int i = 0; i < 50; ++i) {
+    free_fall.update(myo::Vector3<float>(90.f, 0.f, 0.f),
+                     myo::Vector3<float>(), 0.02f);
+  }
+  BOOST_CHECK_CLOSE(
+      core::OrientationUtility::QuaternionToRoll(free_fall.getRotation()),
+      M_PI / 2, 0.1);
+}
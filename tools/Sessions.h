@@ -0,0 +1,109 @@
+/* Helpers for the tools which play back recorded sessions through a feature
+ * tree described as for features::FeatureGraph.
+ *
+ * Besides the types of FeatureGraph, the tree can contain EmgFeatures, with
+ * the optional parameters window_size, hop_size and threshold, and EmgPoses,
+ * whose model is the path of a model written by train_emg_poses. Models are
+ * loaded once and shared by all trees.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "../src/core/DeviceListenerWrapper.h"
+#include "../src/core/LinearDiscriminant.h"
+#include "../src/features/EmgFeatures.h"
+#include "../src/features/EmgPoses.h"
+#include "../src/features/FeatureGraph.h"
+
+namespace tools {
+typedef features::FeatureGraph::Node Node;
+// The models of the EmgPoses of the tree, by path.
+typedef std::map<std::string, core::LinearDiscriminant> Models;
+
+void LoadModels(const std::vector<Node>& nodes, Models& models) {
+  for (const Node& node : nodes) {
+    if (node.type == "EmgPoses") {
+      std::string path = node.params.get<std::string>("model");
+      if (models.find(path) == models.end()) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+          throw std::runtime_error("Can't open " + path + ".");
+        }
+        models.emplace(path, core::LinearDiscriminant::Load(in));
+      }
+    }
+    LoadModels(node.children, models);
+  }
+}
+
+void RegisterTypes(features::FeatureGraph& graph, const Models& models) {
+  graph.registerType("EmgFeatures",
+                     [](core::DeviceListenerWrapper& parent_feature,
+                        const Node& node, features::FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(
+        new features::EmgFeatures(parent_feature,
+                                  node.params.get<int>("window_size", 40),
+                                  node.params.get<int>("hop_size", 10),
+                                  node.params.get<int>("threshold", 0)));
+  }, true);
+  graph.registerType("EmgPoses",
+                     [&models](core::DeviceListenerWrapper& parent_feature,
+                               const Node& node, features::FeatureGraph&) {
+    return std::unique_ptr<core::DeviceListenerWrapper>(new features::EmgPoses(
+        parent_feature,
+        models.at(node.params.get<std::string>("model"))));
+  }, true);
+}
+
+uint64_t FileSize(const std::string& path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  return file ? static_cast<uint64_t>(file.tellg()) : 0;
+}
+
+// Adds path to paths, or the files in it, sorted by name, if it's a
+// directory. Files ending in suffix, e.g. the labels of the sessions, are
+// skipped.
+void AddSessionPaths(const std::string& path, const std::string& suffix,
+                     std::vector<std::string>& paths) {
+#if defined(__unix__) || defined(__APPLE__)
+  struct stat status;
+  if (stat(path.c_str(), &status) == 0 && S_ISDIR(status.st_mode)) {
+    DIR* directory = opendir(path.c_str());
+    if (!directory) {
+      throw std::runtime_error("Can't read the directory " + path + ".");
+    }
+    std::vector<std::string> entry_paths;
+    while (dirent* entry = readdir(directory)) {
+      std::string entry_path = path + "/" + entry->d_name;
+      bool skipped =
+          !suffix.empty() && entry_path.size() >= suffix.size() &&
+          entry_path.compare(entry_path.size() - suffix.size(), suffix.size(),
+                             suffix) == 0;
+      if (!skipped && stat(entry_path.c_str(), &status) == 0 &&
+          S_ISREG(status.st_mode)) {
+        entry_paths.push_back(entry_path);
+      }
+    }
+    closedir(directory);
+    std::sort(entry_paths.begin(), entry_paths.end());
+    paths.insert(paths.end(), entry_paths.begin(), entry_paths.end());
+    return;
+  }
+#endif
+  paths.push_back(path);
+}
+}
@@ -0,0 +1,219 @@
+/* Plays back many recorded sessions through a feature tree in parallel, and
+ * sums up the poses and gestures it detects, e.g. to evaluate a change to the
+ * tree on all recordings.
+ *
+ * Usage: batch_process <graph.json> <session>... [-j threads] [-v]
+ *
+ * The feature tree is described as for features::FeatureGraph. Every session
+ * is an archive written by features::ArchiveWriter, or a directory of them.
+ * Each session is played back through a tree of its own, so sessions are
+ * independent and run on all cores, or on the given number of threads, with
+ * a core::WorkStealingPool. The largest sessions are started first, so that
+ * none of them is left running alone at the end. Archives are read one
+ * segment at a time, so sessions of any length take little memory.
+ *
+ * Besides the types of FeatureGraph, the tree can contain the types described
+ * in Sessions.h.
+ *
+ * The poses and gestures of every named feature of the tree are counted, as
+ * e.g. "gestures: doubleClick" for a PoseGestures named gestures. The summary
+ * lists the counts over all sessions, and the sessions which failed; with -v
+ * the counts of each session are listed as well.
+ */
+
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/core/DeviceListenerWrapper.h"
+#include "../src/core/WorkStealingPool.h"
+#include "../src/features/ArchiveReader.h"
+#include "../src/features/FeatureGraph.h"
+#include "../src/features/RootFeature.h"
+#include "Sessions.h"
+
+namespace {
+using tools::Models;
+using tools::Node;
+typedef std::map<std::string, uint64_t> Counts;
+
+struct Session {
+  std::string path;
+  uint64_t size;
+  uint64_t samples;
+  Counts counts;
+  // Empty unless the session failed.
+  std::string error;
+};
+
+// Counts the poses and gestures of a named feature.
+class Counter : public core::DeviceListenerWrapper {
+ public:
+  Counter(core::DeviceListenerWrapper& parent_feature, const std::string& name,
+          Counts& counts)
+      : name_(name), counts_(counts) {
+    parent_feature.addChildFeature(
+        this, core::Events::Pose | core::Events::Gesture);
+  }
+
+  virtual void onPose(myo::Myo*, uint64_t,
+                      const std::shared_ptr<core::Pose>& pose) override {
+    ++counts_[name_ + ": " + pose->toString()];
+  }
+
+  virtual void onGesture(
+      myo::Myo*, uint64_t,
+      const std::shared_ptr<core::Gesture>& gesture) override {
+    ++counts_[name_ + ": " + gesture->toString()];
+  }
+
+ private:
+  const std::string name_;
+  Counts& counts_;
+};
+
+void GetNames(const std::vector<Node>& nodes,
+              std::vector<std::string>& names) {
+  for (const Node& node : nodes) {
+    if (!node.name.empty()) {
+      names.push_back(node.name);
+    }
+    GetNames(node.children, names);
+  }
+}
+
+void Process(Session& session, const std::vector<Node>& nodes,
+             const std::vector<std::string>& names, const Models& models) {
+  std::ifstream in(session.path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Can't open " + session.path + ".");
+  }
+  features::ArchiveReader reader(in);
+  features::RootFeature root_feature;
+  features::FeatureGraph graph;
+  tools::RegisterTypes(graph, models);
+  graph.build(root_feature, nodes);
+  std::vector<std::unique_ptr<Counter>> counters;
+  for (const std::string& name : names) {
+    counters.emplace_back(new Counter(graph.get(name), name, session.counts));
+  }
+  session.samples = reader.replay(root_feature);
+}
+
+void PrintCounts(const Counts& counts, const std::string& indent) {
+  for (const auto& count : counts) {
+    std::cout << indent << count.first << " " << count.second << std::endl;
+  }
+}
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<std::string> arguments;
+  std::size_t num_threads = 0;
+  bool verbose = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+    if (argument == "-j" && i + 1 < argc) {
+      num_threads = std::atoi(argv[++i]);
+    } else if (argument == "-v") {
+      verbose = true;
+    } else {
+      arguments.push_back(argument);
+    }
+  }
+  if (arguments.size() < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " <graph.json> <session>... [-j threads] [-v]" << std::endl;
+    return 1;
+  }
+
+  try {
+    std::ifstream config(arguments[0]);
+    if (!config) {
+      std::cerr << "Can't open " << arguments[0] << std::endl;
+      return 1;
+    }
+    const std::vector<Node> nodes = features::FeatureGraph::ParseJson(config);
+    Models models;
+    tools::LoadModels(nodes, models);
+    std::vector<std::string> names;
+    GetNames(nodes, names);
+    if (names.empty()) {
+      std::cerr << "The feature tree has no named features, so there is "
+                   "nothing to count." << std::endl;
+    }
+
+    std::vector<std::string> paths;
+    for (std::size_t i = 1; i < arguments.size(); ++i) {
+      tools::AddSessionPaths(arguments[i], "", paths);
+    }
+    std::vector<Session> sessions;
+    for (const std::string& path : paths) {
+      sessions.push_back({path, tools::FileSize(path), 0, {}, ""});
+    }
+    std::vector<Session*> by_size;
+    for (Session& session : sessions) {
+      by_size.push_back(&session);
+    }
+    std::stable_sort(by_size.begin(), by_size.end(),
+                     [](const Session* lhs, const Session* rhs) {
+                       return lhs->size > rhs->size;
+                     });
+
+    auto start = std::chrono::steady_clock::now();
+    core::WorkStealingPool pool(num_threads);
+    for (Session* session : by_size) {
+      pool.submit([session, &nodes, &names, &models]() {
+        try {
+          Process(*session, nodes, names, models);
+        } catch (const std::exception& e) {
+          session->error = e.what();
+        }
+      });
+    }
+    pool.wait();
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start).count();
+
+    Counts counts;
+    uint64_t samples = 0, bytes = 0;
+    std::size_t failed = 0;
+    for (const Session& session : sessions) {
+      if (!session.error.empty()) {
+        ++failed;
+        std::cout << session.path << ": " << session.error << std::endl;
+        continue;
+      }
+      samples += session.samples;
+      bytes += session.size;
+      for (const auto& count : session.counts) {
+        counts[count.first] += count.second;
+      }
+      if (verbose) {
+        std::cout << session.path << ": " << session.samples << " samples"
+                  << std::endl;
+        PrintCounts(session.counts, "  ");
+      }
+    }
+    std::cout << "Processed " << sessions.size() - failed << " of "
+              << sessions.size() << " sessions, " << samples
+              << " samples, in " << seconds << " s on " << pool.numThreads()
+              << " threads (" << samples / seconds / 1e6
+              << " million samples/s, " << bytes / seconds / 1e6
+              << " MB/s)" << std::endl;
+    PrintCounts(counts, "");
+    return failed == 0 ? 0 : 2;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
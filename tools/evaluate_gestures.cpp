@@ -0,0 +1,372 @@
+/* Plays back labelled sessions through a feature tree, matches the gestures of
+ * one of its features to the labels, and reports the precision, recall and
+ * detection latency, optionally for every combination of a set of parameter
+ * values, e.g. to choose the Debounce timeout or PoseGestures thresholds.
+ *
+ * Usage: evaluate_gestures <graph.json> <feature> <session>...
+ *            [-s name.param=value,...]... [-t before_ms,after_ms]
+ *            [-j threads] [-v]
+ *
+ * The feature tree is described as for features::FeatureGraph, and can
+ * contain the types described in Sessions.h. The gestures of the feature
+ * named feature are evaluated. Every session is an archive written by
+ * features::ArchiveWriter, or a directory of them, and is labelled by the file
+ * of the same path followed by .labels, as read by
+ * core::GestureEvaluation::ReadLabels. Detections are named by
+ * core::Gesture::toDescriptiveString, so labels name the gesture and its
+ * pose, e.g. "doubleClick: fist".
+ *
+ * A detection matches a label within the tolerance window, from before_ms
+ * earlier to after_ms later, by default 100 ms and 1000 ms. Each -s sweeps a
+ * parameter of a named feature over the given values, e.g.
+ * "-s debounce.timeout_ms=10,50,100", and the tree is evaluated with every
+ * combination of the values of all sweeps. Every combination and session is
+ * played back through a tree of its own on a core::WorkStealingPool, with the
+ * largest sessions started first.
+ *
+ * Debounce and PoseGestures pass their timeouts on the clock of the
+ * recording, with the timestamps of the sensor data played back, and stamp
+ * what they emit with the time at which the timeout passed, so the latency of
+ * e.g. a single click is the double click timeout however fast the session is
+ * played back.
+ *
+ * For every combination the precision, recall, F1 score and latency
+ * percentiles over all sessions are listed, and the combination with the best
+ * F1 score is named; with -v the results of each gesture are listed as well.
+ */
+
+#include <myo/myo.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../src/core/DeviceListenerWrapper.h"
+#include "../src/core/GestureEvaluation.h"
+#include "../src/core/WorkStealingPool.h"
+#include "../src/features/ArchiveReader.h"
+#include "../src/features/FeatureGraph.h"
+#include "../src/features/RootFeature.h"
+#include "Sessions.h"
+
+namespace {
+using core::GestureEvaluation::Event;
+using core::GestureEvaluation::Result;
+using tools::Models;
+using tools::Node;
+typedef std::map<std::string, Result> Results;
+
+const std::string labelsSuffix = ".labels";
+
+struct Sweep {
+  std::string name, param;
+  std::vector<std::string> values;
+};
+
+struct Configuration {
+  // E.g. "debounce.timeout_ms=50", empty without sweeps.
+  std::string description;
+  std::vector<Node> nodes;
+};
+
+struct Session {
+  std::string path;
+  uint64_t size;
+  std::vector<Event> labels;
+  // Empty unless the session failed.
+  std::string error;
+};
+
+// Records the gestures of a feature.
+class Detector : public core::DeviceListenerWrapper {
+ public:
+  Detector(core::DeviceListenerWrapper& parent_feature,
+           std::vector<Event>& detections)
+      : detections_(detections) {
+    parent_feature.addChildFeature(this, core::Events::Gesture);
+  }
+
+  // Named with their pose, as the labels are.
+  virtual void onGesture(
+      myo::Myo*, uint64_t timestamp,
+      const std::shared_ptr<core::Gesture>& gesture) override {
+    detections_.push_back({timestamp, gesture->toDescriptiveString()});
+  }
+
+ private:
+  std::vector<Event>& detections_;
+};
+
+std::vector<std::string> Split(const std::string& s, char delimiter) {
+  std::vector<std::string> parts;
+  std::istringstream ss(s);
+  std::string part;
+  while (std::getline(ss, part, delimiter)) {
+    parts.push_back(part);
+  }
+  return parts;
+}
+
+// Parses e.g. "debounce.timeout_ms=10,50".
+Sweep ParseSweep(const std::string& s) {
+  std::size_t dot = s.find('.'), equals = s.find('=');
+  if (dot == std::string::npos || equals == std::string::npos || dot == 0 ||
+      equals < dot + 2) {
+    throw std::invalid_argument("Invalid sweep " + s +
+                                ", expected name.param=value,...");
+  }
+  Sweep sweep = {s.substr(0, dot), s.substr(dot + 1, equals - dot - 1),
+                 Split(s.substr(equals + 1), ',')};
+  if (sweep.values.empty()) {
+    throw std::invalid_argument("The sweep " + s + " has no values.");
+  }
+  return sweep;
+}
+
+Node* FindNode(std::vector<Node>& nodes, const std::string& name) {
+  for (Node& node : nodes) {
+    if (node.name == name) {
+      return &node;
+    }
+    if (Node* child = FindNode(node.children, name)) {
+      return child;
+    }
+  }
+  return nullptr;
+}
+
+// Every combination of the values of the sweeps, the values of the last sweep
+// varying fastest.
+std::vector<Configuration> GetConfigurations(const std::vector<Node>& nodes,
+                                             const std::vector<Sweep>& sweeps) {
+  std::vector<Configuration> configurations = {{"", nodes}};
+  for (const Sweep& sweep : sweeps) {
+    std::vector<Configuration> swept;
+    for (const Configuration& configuration : configurations) {
+      for (const std::string& value : sweep.values) {
+        Configuration next = configuration;
+        Node* node = FindNode(next.nodes, sweep.name);
+        if (!node) {
+          throw std::invalid_argument("No feature is named " + sweep.name +
+                                      ".");
+        }
+        node->params.put(sweep.param, value);
+        next.description += (next.description.empty() ? "" : " ") +
+                            sweep.name + "." + sweep.param + "=" + value;
+        swept.push_back(next);
+      }
+    }
+    configurations.swap(swept);
+  }
+  return configurations;
+}
+
+std::vector<Event> LoadLabels(const std::string& path) {
+  std::ifstream in(path + labelsSuffix);
+  if (!in) {
+    throw std::runtime_error("Can't open " + path + labelsSuffix + ".");
+  }
+  return core::GestureEvaluation::ReadLabels(in);
+}
+
+Results Evaluate(const Session& session, const std::vector<Node>& nodes,
+                 const std::string& feature, const Models& models,
+                 uint64_t before, uint64_t after) {
+  std::ifstream in(session.path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Can't open " + session.path + ".");
+  }
+  features::ArchiveReader reader(in);
+  features::RootFeature root_feature;
+  features::FeatureGraph graph;
+  tools::RegisterTypes(graph, models);
+  graph.build(root_feature, nodes);
+  std::vector<Event> detections;
+  Detector detector(graph.get(feature), detections);
+  reader.replay(root_feature);
+  return core::GestureEvaluation::Match(session.labels, detections, before,
+                                        after);
+}
+
+void PrintResult(const std::string& name, const Result& result) {
+  std::cout << std::fixed << std::setprecision(3) << std::setw(10)
+            << result.precision() << std::setw(8) << result.recall()
+            << std::setw(8) << result.f1() << std::setprecision(0);
+  for (double fraction : {0.5, 0.9, 0.99}) {
+    std::cout << std::setw(8) << result.latencyPercentile(fraction) / 1e3;
+  }
+  std::cout << "  " << name << std::endl;
+}
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<std::string> arguments;
+  std::vector<Sweep> sweeps;
+  uint64_t before = 100000, after = 1000000;
+  std::size_t num_threads = 0;
+  bool verbose = false;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string argument = argv[i];
+      if (argument == "-s" && i + 1 < argc) {
+        sweeps.push_back(ParseSweep(argv[++i]));
+      } else if (argument == "-t" && i + 1 < argc) {
+        std::string value = argv[++i];
+        std::vector<std::string> tolerance = Split(value, ',');
+        if (tolerance.size() != 2) {
+          throw std::invalid_argument("Invalid tolerance " + value +
+                                      ", expected before_ms,after_ms");
+        }
+        before = std::strtoull(tolerance[0].c_str(), nullptr, 10) * 1000;
+        after = std::strtoull(tolerance[1].c_str(), nullptr, 10) * 1000;
+      } else if (argument == "-j" && i + 1 < argc) {
+        num_threads = std::atoi(argv[++i]);
+      } else if (argument == "-v") {
+        verbose = true;
+      } else {
+        arguments.push_back(argument);
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  if (arguments.size() < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <graph.json> <feature> <session>... "
+                 "[-s name.param=value,...]... [-t before_ms,after_ms] "
+                 "[-j threads] [-v]" << std::endl;
+    return 1;
+  }
+
+  try {
+    std::ifstream config(arguments[0]);
+    if (!config) {
+      std::cerr << "Can't open " << arguments[0] << std::endl;
+      return 1;
+    }
+    const std::vector<Node> nodes = features::FeatureGraph::ParseJson(config);
+    const std::string& feature = arguments[1];
+    Models models;
+    tools::LoadModels(nodes, models);
+    const std::vector<Configuration> configurations =
+        GetConfigurations(nodes, sweeps);
+
+    std::vector<std::string> paths;
+    for (std::size_t i = 2; i < arguments.size(); ++i) {
+      tools::AddSessionPaths(arguments[i], labelsSuffix, paths);
+    }
+    std::vector<Session> sessions;
+    for (const std::string& path : paths) {
+      Session session = {path, tools::FileSize(path), {}, ""};
+      try {
+        session.labels = LoadLabels(path);
+      } catch (const std::exception& e) {
+        session.error = e.what();
+      }
+      sessions.push_back(session);
+    }
+    std::vector<std::size_t> by_size;
+    for (std::size_t i = 0; i < sessions.size(); ++i) {
+      by_size.push_back(i);
+    }
+    std::stable_sort(by_size.begin(), by_size.end(),
+                     [&sessions](std::size_t lhs, std::size_t rhs) {
+                       return sessions[lhs].size > sessions[rhs].size;
+                     });
+
+    // The results of every configuration and session, and the errors of the
+    // sessions which failed with some configuration.
+    std::vector<std::vector<Results>> results(
+        configurations.size(), std::vector<Results>(sessions.size()));
+    std::vector<std::vector<std::string>> errors(
+        configurations.size(), std::vector<std::string>(sessions.size()));
+    auto start = std::chrono::steady_clock::now();
+    core::WorkStealingPool pool(num_threads);
+    for (std::size_t session : by_size) {
+      if (!sessions[session].error.empty()) {
+        continue;
+      }
+      for (std::size_t c = 0; c < configurations.size(); ++c) {
+        pool.submit([&, session, c]() {
+          try {
+            results[c][session] =
+                Evaluate(sessions[session], configurations[c].nodes, feature,
+                         models, before, after);
+          } catch (const std::exception& e) {
+            errors[c][session] = e.what();
+          }
+        });
+      }
+    }
+    pool.wait();
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start).count();
+
+    std::size_t failed = 0;
+    for (std::size_t s = 0; s < sessions.size(); ++s) {
+      std::string error = sessions[s].error;
+      for (std::size_t c = 0; c < configurations.size() && error.empty();
+           ++c) {
+        error = errors[c][s];
+      }
+      if (!error.empty()) {
+        ++failed;
+        std::cout << sessions[s].path << ": " << error << std::endl;
+      }
+    }
+    std::cout << "Evaluated " << configurations.size()
+              << " configurations on " << sessions.size() - failed << " of "
+              << sessions.size() << " sessions in " << seconds << " s on "
+              << pool.numThreads() << " threads" << std::endl;
+
+    // Sessions which failed with any configuration are left out of all of
+    // them, so that all configurations are compared on the same sessions.
+    std::cout << " precision  recall      F1  p50 ms  p90 ms  p99 ms"
+              << std::endl;
+    std::size_t best = 0;
+    double best_f1 = -1;
+    for (std::size_t c = 0; c < configurations.size(); ++c) {
+      Results gestures;
+      for (std::size_t s = 0; s < sessions.size(); ++s) {
+        bool ok = sessions[s].error.empty();
+        for (std::size_t i = 0; i < configurations.size() && ok; ++i) {
+          ok = errors[i][s].empty();
+        }
+        if (!ok) {
+          continue;
+        }
+        for (const auto& gesture : results[c][s]) {
+          gestures[gesture.first].add(gesture.second);
+        }
+      }
+      Result total = core::GestureEvaluation::Total(gestures);
+      PrintResult(configurations[c].description, total);
+      if (verbose) {
+        for (const auto& gesture : gestures) {
+          PrintResult("  " + gesture.first, gesture.second);
+        }
+      }
+      if (total.f1() > best_f1) {
+        best = c;
+        best_f1 = total.f1();
+      }
+    }
+    if (configurations.size() > 1) {
+      std::cout << "Best F1: " << configurations[best].description << std::endl;
+    }
+    return failed == 0 ? 0 : 2;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,153 @@
+/* Trains the linear discriminant model used by features::EmgPoses from
+ * recorded EMG data, and writes it to a binary model file.
+ *
+ * Usage: train_emg_poses <input.csv> <output.model> [window_size] [hop_size]
+ *                        [shrinkage]
+ *
+ * Every line of the input holds a class name followed by the eight values of
+ * one EMG sample, e.g. "fist,-3,5,12,40,-8,2,1,0". Consecutive lines with the
+ * same class name are treated as one recording, and features are extracted
+ * from each recording with features::EmgFeatures, so window_size and hop_size
+ * must match the EmgFeatures used with the model.
+ */
+
+#include <myo/myo.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/core/DeviceListenerWrapper.h"
+#include "../src/core/EmgFeatureVector.h"
+#include "../src/core/LinearDiscriminant.h"
+#include "../src/features/RootFeature.h"
+#include "../src/features/EmgFeatures.h"
+
+namespace {
+// Collects the feature vectors of a recording, labelled with its class.
+class FeatureCollector : public core::DeviceListenerWrapper {
+ public:
+  FeatureCollector(core::DeviceListenerWrapper& parent_feature, int label,
+                   std::vector<float>& samples, std::vector<int>& labels)
+      : label_(label), samples_(samples), labels_(labels) {
+    parent_feature.addChildFeature(this);
+  }
+
+  virtual void onEmgFeatures(myo::Myo*, uint64_t,
+                             const core::EmgFeatureVector& features) override {
+    samples_.insert(samples_.end(), features.data(),
+                    features.data() + core::EmgFeatureVector::size);
+    labels_.push_back(label_);
+  }
+
+ private:
+  const int label_;
+  std::vector<float>& samples_;
+  std::vector<int>& labels_;
+};
+
+// Extracts the features of one recording.
+void ExtractFeatures(const std::vector<std::vector<int8_t>>& recording,
+                     int label, int window_size, int hop_size,
+                     std::vector<float>& samples, std::vector<int>& labels) {
+  features::RootFeature root_feature;
+  features::EmgFeatures emg_features(root_feature, window_size, hop_size);
+  FeatureCollector collector(emg_features, label, samples, labels);
+  uint64_t timestamp = 0;
+  for (const auto& emg : recording) {
+    root_feature.onEmgData(nullptr, timestamp, emg.data());
+    timestamp += 5000;
+  }
+}
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "Usage: " << argv[0]
+              << " <input.csv> <output.model> [window_size] [hop_size]"
+                 " [shrinkage]" << std::endl;
+    return 1;
+  }
+  const int window_size = argc > 3 ? std::atoi(argv[3]) : 40;
+  const int hop_size = argc > 4 ? std::atoi(argv[4]) : 10;
+  const float shrinkage = argc > 5 ? static_cast<float>(std::atof(argv[5]))
+                                   : 0.01f;
+
+  std::ifstream input(argv[1]);
+  if (!input) {
+    std::cerr << "Can't open " << argv[1] << std::endl;
+    return 1;
+  }
+  std::vector<std::string> class_names;
+  std::vector<float> samples;
+  std::vector<int> labels;
+  std::vector<std::vector<int8_t>> recording;
+  int label = -1;
+  std::string line;
+  for (std::size_t line_number = 1; std::getline(input, line); ++line_number) {
+    if (line.empty()) {
+      continue;
+    }
+    std::istringstream ss(line);
+    std::string name, value;
+    std::getline(ss, name, ',');
+    std::vector<int8_t> emg;
+    while (std::getline(ss, value, ',')) {
+      emg.push_back(static_cast<int8_t>(std::atoi(value.c_str())));
+    }
+    if (emg.size() != core::EmgFeatureVector::numChannels) {
+      std::cerr << "Line " << line_number << " doesn't have 8 EMG values."
+                << std::endl;
+      return 1;
+    }
+
+    int line_label = -1;
+    for (std::size_t c = 0; c < class_names.size(); ++c) {
+      if (class_names[c] == name) {
+        line_label = static_cast<int>(c);
+      }
+    }
+    if (line_label < 0) {
+      line_label = static_cast<int>(class_names.size());
+      class_names.push_back(name);
+    }
+    if (line_label != label && !recording.empty()) {
+      ExtractFeatures(recording, label, window_size, hop_size, samples,
+                      labels);
+      recording.clear();
+    }
+    label = line_label;
+    recording.push_back(emg);
+  }
+  if (!recording.empty()) {
+    ExtractFeatures(recording, label, window_size, hop_size, samples, labels);
+  }
+
+  try {
+    core::LinearDiscriminant model = core::LinearDiscriminant::Train(
+        class_names, core::EmgFeatureVector::size, samples, labels, shrinkage);
+
+    std::size_t correct = 0;
+    for (std::size_t i = 0; i < labels.size(); ++i) {
+      correct += model.classify(&samples[i * core::EmgFeatureVector::size]) ==
+                 static_cast<std::size_t>(labels[i]);
+    }
+    std::cout << "Trained " << class_names.size() << " classes on "
+              << labels.size() << " windows, training accuracy "
+              << 100.0 * correct / labels.size() << "%" << std::endl;
+
+    std::ofstream output(argv[2], std::ios::binary);
+    model.save(output);
+    if (!output) {
+      std::cerr << "Can't write " << argv[2] << std::endl;
+      return 1;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}